@@ -293,8 +293,9 @@ typedef enum {
     CO_EM_CAN_TX_OVERFLOW           = 0x14U,
     /** 0x15, communication, critical, TPDO is outside SYNC window */
     CO_EM_TPDO_OUTSIDE_WINDOW       = 0x15U,
-    /** 0x16, communication, critical, (unused) */
-    CO_EM_16_unused                 = 0x16U,
+    /** 0x16, communication, critical, SRDO or GFC reaction time exceeded
+     * the limit, see @ref CO_safetyTiming */
+    CO_EM_SAFETY_LATENCY            = 0x16U,
     /** 0x17, communication, critical, (unused) */
     CO_EM_17_unused                 = 0x17U,
     /** 0x18, communication, critical, SYNC message timeout */
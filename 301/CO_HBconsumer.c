@@ -53,9 +53,12 @@ static void CO_HBcons_receive(void *object, void *msg){
 
     /* verify message length */
     if(DLC == 1){
-        /* copy data and set 'new message' flag. */
-        HBconsNode->NMTstate = (CO_NMT_internalState_t)data[0];
-        CO_FLAG_SET(HBconsNode->CANrxNew);
+        /* copy data into receive queue, message is discarded if full */
+        int16_t i = CO_rxQueue_pushIndex(&HBconsNode->CANrxQueue);
+        if (i >= 0) {
+            HBconsNode->CANrxNMTstate[i] = data[0];
+            CO_rxQueue_push(&HBconsNode->CANrxQueue);
+        }
     }
 
 #if (CO_CONFIG_HB_CONS) & CO_CONFIG_FLAG_CALLBACK_PRE
@@ -196,7 +199,7 @@ CO_ReturnError_t CO_HBconsumer_initEntry(
     || (CO_CONFIG_HB_CONS) & CO_CONFIG_HB_CONS_CALLBACK_MULTI
         monitoredNode->NMTstatePrev = CO_NMT_UNKNOWN;
 #endif
-        CO_FLAG_CLEAR(monitoredNode->CANrxNew);
+        CO_rxQueue_init(&monitoredNode->CANrxQueue);
 
         /* is channel used */
         if (monitoredNode->nodeId && monitoredNode->time_us) {
@@ -360,8 +363,17 @@ void CO_HBconsumer_process(
                 /* continue, if node is not monitored */
                 continue;
             }
-            /* Verify if received message is heartbeat or bootup */
-            if (CO_FLAG_READ(monitoredNode->CANrxNew)) {
+            /* Verify if received messages are heartbeat or bootup. Process
+             * all of them in order, so bootup followed by heartbeat within
+             * the same cycle is not lost. */
+            int16_t rxIdx;
+            while ((rxIdx = CO_rxQueue_peekIndex(&monitoredNode->CANrxQueue))
+                   >= 0
+            ) {
+                monitoredNode->NMTstate = (CO_NMT_internalState_t)
+                    monitoredNode->CANrxNMTstate[rxIdx];
+                CO_rxQueue_drop(&monitoredNode->CANrxQueue);
+
                 if (monitoredNode->NMTstate == CO_NMT_INITIALIZING) {
                     /* bootup message*/
 #if (CO_CONFIG_HB_CONS) & CO_CONFIG_HB_CONS_CALLBACK_MULTI
@@ -394,7 +406,6 @@ void CO_HBconsumer_process(
                     monitoredNode->timeoutTimer = 0;
                     timeDifference_us_copy = 0;
                 }
-                CO_FLAG_CLEAR(monitoredNode->CANrxNew);
             }
 
             /* Verify timeout */
@@ -464,7 +475,7 @@ void CO_HBconsumer_process(
     || (CO_CONFIG_HB_CONS) & CO_CONFIG_HB_CONS_CALLBACK_MULTI
             monitoredNode->NMTstatePrev = CO_NMT_UNKNOWN;
 #endif
-            CO_FLAG_CLEAR(monitoredNode->CANrxNew);
+            CO_rxQueue_clear(&monitoredNode->CANrxQueue);
             if (monitoredNode->HBstate != CO_HBconsumer_UNCONFIGURED) {
                 monitoredNode->HBstate = CO_HBconsumer_UNKNOWN;
             }
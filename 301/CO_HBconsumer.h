@@ -27,6 +27,7 @@
 #define CO_HB_CONS_H
 
 #include "301/CO_driver.h"
+#include "301/CO_rxQueue.h"
 
 /* default configuration, see CO_config.h */
 #ifndef CO_CONFIG_HB_CONS
@@ -83,8 +84,10 @@ typedef struct {
     uint32_t timeoutTimer;
     /** Consumer heartbeat time from OD */
     uint32_t time_us;
-    /** Indication if new Heartbeat message received from the CAN bus */
-    volatile void *CANrxNew;
+    /** Queue of Heartbeat messages received from the CAN bus */
+    CO_rxQueue_t CANrxQueue;
+    /** NMT states from received Heartbeat messages, used by CANrxQueue */
+    uint8_t CANrxNMTstate[CO_CONFIG_RX_QUEUE_SIZE];
 #if ((CO_CONFIG_HB_CONS) & CO_CONFIG_FLAG_CALLBACK_PRE) || defined CO_DOXYGEN
     /** From CO_HBconsumer_initCallbackPre() or NULL */
     void              (*pFunctSignalPre)(void *object);
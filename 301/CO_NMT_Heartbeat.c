@@ -42,7 +42,12 @@ static void CO_NMT_receive(void *object, void *msg) {
     CO_NMT_t *NMT = (CO_NMT_t*)object;
 
     if (DLC == 2 && (nodeId == 0 || nodeId == NMT->nodeId)) {
-        NMT->internalCommand = command;
+        /* copy command into receive queue, message is discarded if full */
+        int16_t i = CO_rxQueue_pushIndex(&NMT->CANrxQueue);
+        if (i >= 0) {
+            NMT->CANrxCommand[i] = command;
+            CO_rxQueue_push(&NMT->CANrxQueue);
+        }
 
 #if (CO_CONFIG_NMT) & CO_CONFIG_FLAG_CALLBACK_PRE
         /* Optional signal to RTOS, which can resume task, which handles NMT. */
@@ -257,10 +262,25 @@ CO_NMT_reset_cmd_t CO_NMT_process(CO_NMT_t *NMT,
     }
     NMT->operatingStatePrev = NMTstateCpy;
 
-    /* process internal NMT commands, received from CO_NMT_receive() or
-     * CO_NMT_sendCommand() */
-    if (NMT->internalCommand != 0) {
-        switch (NMT->internalCommand) {
+    /* process NMT commands, received from CO_NMT_receive() in order, then
+     * internal command from CO_NMT_sendCommand(). Stop at reset command. */
+    while (resetCommand == CO_RESET_NOT) {
+        uint8_t command;
+        int16_t rxIdx = CO_rxQueue_peekIndex(&NMT->CANrxQueue);
+
+        if (rxIdx >= 0) {
+            command = NMT->CANrxCommand[rxIdx];
+            CO_rxQueue_drop(&NMT->CANrxQueue);
+        }
+        else if (NMT->internalCommand != 0) {
+            command = NMT->internalCommand;
+            NMT->internalCommand = 0;
+        }
+        else {
+            break;
+        }
+
+        switch (command) {
             case CO_NMT_ENTER_OPERATIONAL:
                 NMTstateCpy = CO_NMT_OPERATIONAL;
                 break;
@@ -279,7 +299,6 @@ CO_NMT_reset_cmd_t CO_NMT_process(CO_NMT_t *NMT,
             default:
                 break;
         }
-        NMT->internalCommand = 0;
     }
 
     /* verify NMT transitions based on error register */
@@ -29,6 +29,7 @@
 #include "301/CO_driver.h"
 #include "301/CO_ODinterface.h"
 #include "301/CO_Emergency.h"
+#include "301/CO_rxQueue.h"
 
 /* default configuration, see CO_config.h */
 #ifndef CO_CONFIG_NMT
@@ -164,9 +165,14 @@ typedef struct {
     uint8_t operatingState;
     /** Previous NMT operating state. */
     uint8_t operatingStatePrev;
-    /** NMT internal command from CO_NMT_receive() or CO_NMT_sendCommand(),
-     * processed in CO_NMT_process(). 0 if no command or CO_NMT_command_t */
+    /** NMT internal command from CO_NMT_sendCommand() or from application
+     * after CO_NMT_init() (resume of the NMT state, for example), processed in
+     * CO_NMT_process() after boot-up. 0 if no command or CO_NMT_command_t */
     uint8_t internalCommand;
+    /** Queue of NMT commands from CO_NMT_receive() */
+    CO_rxQueue_t CANrxQueue;
+    /** NMT commands (CO_NMT_command_t), used by CANrxQueue */
+    uint8_t CANrxCommand[CO_CONFIG_RX_QUEUE_SIZE];
     /** From CO_NMT_init() */
     uint8_t nodeId;
     /** From CO_NMT_init() */
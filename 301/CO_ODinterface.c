@@ -70,9 +70,7 @@ OD_size_t OD_readOriginal(OD_stream_t *stream, uint8_t subIndex,
         }
     }
 
-    CO_LOCK_OD();
     memcpy(buf, odData, dataLenToCopy);
-    CO_UNLOCK_OD();
     return dataLenToCopy;
 }
 
@@ -127,9 +125,7 @@ OD_size_t OD_writeOriginal(OD_stream_t *stream, uint8_t subIndex,
         return 0;
     }
 
-    CO_LOCK_OD();
     memcpy(odData, buf, dataLenToCopy);
-    CO_UNLOCK_OD();
     return dataLenToCopy;
 }
 
@@ -467,3 +463,33 @@ ODR_t OD_set_value(const OD_entry_t *entry, uint8_t subIndex, void *val,
 
     return ret;
 }
+
+/******************************************************************************/
+ODR_t OD_get_valueLocked(CO_CANmodule_t *CANmodule, const OD_entry_t *entry,
+                         uint8_t subIndex, void *val, OD_size_t len,
+                         bool_t odOrig)
+{
+    ODR_t ret;
+
+    (void)CANmodule; /* may be unused */
+    CO_LOCK_OD(CANmodule);
+    ret = OD_get_value(entry, subIndex, val, len, odOrig);
+    CO_UNLOCK_OD(CANmodule);
+
+    return ret;
+}
+
+/******************************************************************************/
+ODR_t OD_set_valueLocked(CO_CANmodule_t *CANmodule, const OD_entry_t *entry,
+                         uint8_t subIndex, void *val, OD_size_t len,
+                         bool_t odOrig)
+{
+    ODR_t ret;
+
+    (void)CANmodule; /* may be unused */
+    CO_LOCK_OD(CANmodule);
+    ret = OD_set_value(entry, subIndex, val, len, odOrig);
+    CO_UNLOCK_OD(CANmodule);
+
+    return ret;
+}
@@ -312,6 +312,17 @@ typedef struct {
      * "write" function must always copy all available data from buf. If OD
      * variable expect more data, then "*returnCode" must return 'ODR_PARTIAL'.
      *
+     * Exception is "write" function, which passes data to slower device (file
+     * written by another thread, for example) and must not block. It may
+     * return 'ODR_PARTIAL' and less than count, if it can't accept all data
+     * at the moment. It may also return 'ODR_PARTIAL' with the last data, if
+     * it has accepted them, but is still completing them, then it leaves
+     * stream->dataOffset at dataLength. Caller (SDO server) calls it again
+     * later with remaining data or with count 0, until it returns 'ODR_OK'
+     * or error. If SDO transfer is aborted after write function returned
+     * 'ODR_PARTIAL', SDO server calls it once with buf NULL and count 0. Write
+     * function then discards accepted data and the pending completion.
+     *
      * @param stream Object Dictionary stream object.
      * @param subIndex Object Dictionary subIndex of the accessed element.
      * @param buf Pointer to external buffer, from where data will be copied.
@@ -365,6 +376,10 @@ typedef struct {
  * specified by Object dictionary. If no IO extension is used on OD entry, then
  * io->read returned by @ref OD_getSub() equals to this function. See
  * also @ref OD_IO_t.
+ *
+ * Function does not lock the Object Dictionary. Caller must protect the access
+ * with @ref CO_LOCK_OD() of the CAN module, if necessary, see also
+ * @ref OD_get_valueLocked().
  */
 OD_size_t OD_readOriginal(OD_stream_t *stream, uint8_t subIndex,
                           void *buf, OD_size_t count, ODR_t *returnCode);
@@ -378,6 +393,10 @@ OD_size_t OD_readOriginal(OD_stream_t *stream, uint8_t subIndex,
  * specified by Object dictionary. If no IO extension is used on OD entry, then
  * io->write returned by @ref OD_getSub() equals to this function. See
  * also @ref OD_IO_t.
+ *
+ * Function does not lock the Object Dictionary. Caller must protect the access
+ * with @ref CO_LOCK_OD() of the CAN module, if necessary, see also
+ * @ref OD_set_valueLocked().
  */
 OD_size_t OD_writeOriginal(OD_stream_t *stream, uint8_t subIndex,
                            const void *buf, OD_size_t count, ODR_t *returnCode);
@@ -466,9 +485,13 @@ uint32_t OD_getSDOabCode(ODR_t returnCode);
  * function.
  *
  * @warning
- * Read and write functions may be called from different threads, so critical
- * sections in custom functions must be protected with @ref CO_LOCK_OD() and
- * @ref CO_UNLOCK_OD().
+ * Read and write functions may be called from different threads. SDO server,
+ * SDO client and PDOs call them inside @ref CO_LOCK_OD() section of own CAN
+ * module, so custom functions must not lock the same CAN module again. They
+ * also must not block, because realtime processing waits for the lock. Slow
+ * write may accept data partially, see @ref OD_IO_t. Application, which
+ * accesses OD variables directly, must protect the access itself, for example
+ * with @ref OD_get_valueLocked() or @ref OD_set_valueLocked().
  *
  * @param entry OD entry returned by @ref OD_find().
  * @param object Object, which will be passed to read or write function.
@@ -635,6 +658,48 @@ ODR_t OD_set_value(const OD_entry_t *entry, uint8_t subIndex, void *val,
 #define OD_set_f64(entry, subIndex, val, odOrig) \
     OD_set_value((entry), (subIndex), &(val), sizeof(float64_t), (odOrig))
 
+/**
+ * Get variable from Object Dictionary inside @ref CO_LOCK_OD() section
+ *
+ * Same as @ref OD_get_value(), but protected against concurrent access by
+ * CANopen processing (PDOs in realtime thread, SDO server) of the CANopen
+ * instance. Use it from application threads. OD_get_value() and
+ * @ref OD_readOriginal() themselves do not lock. Must not be called from
+ * code, which already holds the lock of the same CAN module, for example from
+ * read or write function of IO extension.
+ *
+ * @param CANmodule CAN module of the CANopen instance, which uses the OD.
+ * @param entry OD entry returned by @ref OD_find().
+ * @param subIndex Sub-index of the variable from the OD object.
+ * @param [out] val Value will be written here.
+ * @param len Size of value to retrieve from OD.
+ * @param odOrig See @ref OD_get_value().
+ *
+ * @return Value from @ref ODR_t, see @ref OD_get_value().
+ */
+ODR_t OD_get_valueLocked(CO_CANmodule_t *CANmodule, const OD_entry_t *entry,
+                         uint8_t subIndex, void *val, OD_size_t len,
+                         bool_t odOrig);
+
+/**
+ * Set variable in Object Dictionary inside @ref CO_LOCK_OD() section
+ *
+ * Same as @ref OD_set_value(), protected the same way as
+ * @ref OD_get_valueLocked().
+ *
+ * @param CANmodule CAN module of the CANopen instance, which uses the OD.
+ * @param entry OD entry returned by @ref OD_find().
+ * @param subIndex Sub-index of the variable from the OD object.
+ * @param val Pointer to value to write.
+ * @param len Size of value to write.
+ * @param odOrig See @ref OD_set_value().
+ *
+ * @return Value from @ref ODR_t, see @ref OD_set_value().
+ */
+ODR_t OD_set_valueLocked(CO_CANmodule_t *CANmodule, const OD_entry_t *entry,
+                         uint8_t subIndex, void *val, OD_size_t len,
+                         bool_t odOrig);
+
 /** @} */ /* CO_ODgetSetters */
 
 #if defined OD_DEFINITION || defined CO_DOXYGEN
@@ -924,6 +924,11 @@ CO_ReturnError_t CO_TPDOsend(CO_TPDO_t *TPDO){
         }
     }
 #endif
+    /* Clear request before data are copied. Request from other thread, set
+     * after this point, will send the PDO again. */
+    TPDO->sendRequest = 0;
+    CO_MemoryBarrier();
+
     i = TPDO->dataLength;
     pPDOdataByte = &TPDO->CANtxBuff->data[0];
     ppODdataByte = &TPDO->mapPointer[0];
@@ -933,8 +938,6 @@ CO_ReturnError_t CO_TPDOsend(CO_TPDO_t *TPDO){
         *(pPDOdataByte++) = **(ppODdataByte++);
     }
 
-    TPDO->sendRequest = 0;
-
     return CO_CANsend(TPDO->CANdevTx, TPDO->CANtxBuff);
 }
 
@@ -230,8 +230,9 @@ typedef struct{
     /** Data length of the transmitting PDO message. Calculated from mapping */
     uint8_t             dataLength;
     /** If application set this flag, PDO will be later sent by
-    function CO_TPDO_process(). Depends on transmission type. */
-    uint8_t             sendRequest;
+    function CO_TPDO_process(). Depends on transmission type. From other
+    threads set it with CO_TPDO_requestSend(). */
+    volatile uint8_t    sendRequest;
     /** Pointers to 8 data objects, where PDO will be copied */
     uint8_t            *mapPointer[8];
     /** Inhibit timer used for inhibit PDO sending translated to microseconds */
@@ -387,6 +388,27 @@ CO_ReturnError_t CO_TPDO_init(
 uint8_t CO_TPDOisCOS(CO_TPDO_t *TPDO);
 
 
+/**
+ * Request sending of the TPDO from any thread.
+ *
+ * Function only sets _sendRequest_ flag, it does not lock. TPDO is then sent
+ * by CO_TPDO_process(), depending on transmission type and inhibit time.
+ * CO_TPDOsend() clears the flag before it copies data from Object Dictionary,
+ * so request, which arrives while TPDO is being prepared, is not lost, it
+ * causes another transmission.
+ *
+ * Data, which application writes to the Object Dictionary before the request,
+ * must be visible to the thread, which processes TPDOs (use @ref CO_LOCK_OD()
+ * or @ref CO_mailbox).
+ *
+ * @param TPDO TPDO object.
+ */
+static inline void CO_TPDO_requestSend(CO_TPDO_t *TPDO) {
+    CO_MemoryBarrier();
+    TPDO->sendRequest = 1;
+}
+
+
 /**
  * Send TPDO message.
  *
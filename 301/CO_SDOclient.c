@@ -65,27 +65,28 @@ static void CO_SDOclient_receive(void *object, void *msg) {
     uint8_t DLC = CO_CANrxMsg_readDLC(msg);
     uint8_t *data = CO_CANrxMsg_readData(msg);
 
-    /* Ignore messages in idle state and messages with wrong length. Ignore
-     * message also if previous message was not processed yet and not abort */
-    if (SDO_C->state != CO_SDO_ST_IDLE && DLC == 8U
-        && (!CO_FLAG_READ(SDO_C->CANrxNew) || data[0] == 0x80)
-    ) {
+    /* Ignore messages in idle state and messages with wrong length */
+    if (SDO_C->state != CO_SDO_ST_IDLE && DLC == 8U) {
 #if (CO_CONFIG_SDO_CLI) & CO_CONFIG_SDO_CLI_BLOCK
         if (data[0] == 0x80 /* abort from server */
             || (SDO_C->state != CO_SDO_ST_UPLOAD_BLK_SUBBLOCK_SREQ
                 && SDO_C->state != CO_SDO_ST_UPLOAD_BLK_SUBBLOCK_CRSP)
         ) {
 #endif
-            /* copy data and set 'new message' flag */
-            memcpy((void *)&SDO_C->CANrxData[0], (const void *)&data[0], 8);
-            CO_FLAG_SET(SDO_C->CANrxNew);
+            /* copy data into the queue, ignore message, if queue is full */
+            int16_t i = CO_rxQueue_pushIndex(&SDO_C->CANrxQueue);
+            if (i >= 0) {
+                memcpy((void *)&SDO_C->CANrxData[i][0],
+                       (const void *)&data[0], 8);
+                CO_rxQueue_push(&SDO_C->CANrxQueue);
 #if (CO_CONFIG_SDO_CLI) & CO_CONFIG_FLAG_CALLBACK_PRE
-            /* Optional signal to RTOS, which can resume task, which handles
-            * SDO client processing. */
-            if (SDO_C->pFunctSignal != NULL) {
-                SDO_C->pFunctSignal(SDO_C->functSignalObject);
-            }
+                /* Optional signal to RTOS, which can resume task, which
+                 * handles SDO client processing. */
+                if (SDO_C->pFunctSignal != NULL) {
+                    SDO_C->pFunctSignal(SDO_C->functSignalObject);
+                }
 #endif
+            }
 
 #if (CO_CONFIG_SDO_CLI) & CO_CONFIG_SDO_CLI_BLOCK
         }
@@ -150,8 +151,8 @@ static void CO_SDOclient_receive(void *object, void *msg) {
             /* Is exit from sub-block receive state? */
             if (state != CO_SDO_ST_UPLOAD_BLK_SUBBLOCK_SREQ) {
                 /* Processing will continue in another thread, so make memory
-                 * barrier here with CO_FLAG_CLEAR() call. */
-                CO_FLAG_CLEAR(SDO_C->CANrxNew);
+                 * barrier here. */
+                CO_MemoryBarrier();
                 SDO_C->state = state;
 #if (CO_CONFIG_SDO_CLI) & CO_CONFIG_FLAG_CALLBACK_PRE
                 /* Optional signal to RTOS, which can resume task, which handles
@@ -267,6 +268,7 @@ CO_ReturnError_t CO_SDOclient_init(CO_SDOclient_t *SDO_C,
     }
 
     /* Configure object variables */
+    CO_rxQueue_init(&SDO_C->CANrxQueue);
 #if (CO_CONFIG_SDO_CLI) & CO_CONFIG_SDO_CLI_LOCAL
     SDO_C->OD = OD;
     SDO_C->nodeId = nodeId;
@@ -353,6 +355,49 @@ static inline void reverseBytes(void *start, OD_size_t size) {
 }
 #endif
 
+#if (CO_CONFIG_SDO_CLI) & CO_CONFIG_SDO_CLI_LOCAL
+/* Find OD sub-object for local transfer, initialize OD_IO and verify access.
+ * Return CO_SDO_AB_NONE on success. */
+static CO_SDO_abortCode_t localFind(CO_SDOclient_t *SDO_C,
+                                    uint16_t index,
+                                    uint8_t subIndex,
+                                    OD_IO_t *OD_IO,
+                                    OD_attr_t *attribute,
+                                    bool_t write)
+{
+    OD_subEntry_t subEntry;
+    ODR_t odRet;
+
+    odRet = OD_getSub(OD_find(SDO_C->OD, index), subIndex,
+                      &subEntry, OD_IO, false);
+    if (odRet != ODR_OK) {
+        return (CO_SDO_abortCode_t)OD_getSDOabCode(odRet);
+    }
+
+    *attribute = subEntry.attribute;
+    if ((*attribute & ODA_SDO_RW) == 0) {
+        return CO_SDO_AB_UNSUPPORTED_ACCESS;
+    }
+    if (write) {
+        if ((*attribute & ODA_SDO_W) == 0) {
+            return CO_SDO_AB_READONLY;
+        }
+        if (OD_IO->write == NULL) {
+            return CO_SDO_AB_DEVICE_INCOMPAT;
+        }
+    }
+    else {
+        if ((*attribute & ODA_SDO_R) == 0) {
+            return CO_SDO_AB_WRITEONLY;
+        }
+        if (OD_IO->read == NULL) {
+            return CO_SDO_AB_DEVICE_INCOMPAT;
+        }
+    }
+    return CO_SDO_AB_NONE;
+}
+#endif
+
 
 /******************************************************************************/
 CO_SDO_return_t CO_SDOclient_setup(CO_SDOclient_t *SDO_C,
@@ -367,7 +412,7 @@ CO_SDO_return_t CO_SDOclient_setup(CO_SDOclient_t *SDO_C,
 
     /* Configure object variables */
     SDO_C->state = CO_SDO_ST_IDLE;
-    CO_FLAG_CLEAR(SDO_C->CANrxNew);
+    CO_rxQueue_clear(&SDO_C->CANrxQueue);
     SDO_C->nodeIDOfTheSDOServer = nodeIDOfTheSDOServer;
 
 #if (CO_CONFIG_SDO_CLI) & CO_CONFIG_FLAG_OD_DYNAMIC
@@ -473,7 +518,7 @@ CO_SDO_return_t CO_SDOclientDownloadInitiate(CO_SDOclient_t *SDO_C,
         SDO_C->state = CO_SDO_ST_DOWNLOAD_INITIATE_REQ;
     }
 
-    CO_FLAG_CLEAR(SDO_C->CANrxNew);
+    CO_rxQueue_clear(&SDO_C->CANrxQueue);
 
     return CO_SDO_RT_ok_communicationEnd;
 }
@@ -534,33 +579,14 @@ CO_SDO_return_t CO_SDOclientDownload(CO_SDOclient_t *SDO_C,
     else if (SDO_C->state == CO_SDO_ST_DOWNLOAD_LOCAL_TRANSFER && !abort) {
         /* search object dictionary in first pass */
         if (SDO_C->OD_IO.write == NULL) {
-            ODR_t odRet;
-            OD_subEntry_t subEntry;
-
-            odRet = OD_getSub(OD_find(SDO_C->OD, SDO_C->index), SDO_C->subIndex,
-                              &subEntry, &SDO_C->OD_IO, false);
-
-            SDO_C->attribute = subEntry.attribute;
-
-            if (odRet != ODR_OK) {
-                abortCode = (CO_SDO_abortCode_t)OD_getSDOabCode(odRet);
-                ret = CO_SDO_RT_endedWithClientAbort;
-            }
-            else if ((SDO_C->attribute & ODA_SDO_RW) == 0) {
-                abortCode = CO_SDO_AB_UNSUPPORTED_ACCESS;
-                ret = CO_SDO_RT_endedWithClientAbort;
-            }
-            else if ((SDO_C->attribute & ODA_SDO_W) == 0) {
-                abortCode = CO_SDO_AB_READONLY;
-                ret = CO_SDO_RT_endedWithClientAbort;
-            }
-            else if (SDO_C->OD_IO.write == NULL) {
-                abortCode = CO_SDO_AB_DEVICE_INCOMPAT;
+            abortCode = localFind(SDO_C, SDO_C->index, SDO_C->subIndex,
+                                  &SDO_C->OD_IO, &SDO_C->attribute, true);
+            if (abortCode != CO_SDO_AB_NONE) {
                 ret = CO_SDO_RT_endedWithClientAbort;
             }
         }
         /* write data, in several passes if necessary */
-        if (SDO_C->OD_IO.write != NULL) {
+        if (abortCode == CO_SDO_AB_NONE && SDO_C->OD_IO.write != NULL) {
             size_t count = CO_fifo_getOccupied(&SDO_C->bufFifo);
             char buf[count + 2];
 
@@ -624,8 +650,10 @@ CO_SDO_return_t CO_SDOclientDownload(CO_SDOclient_t *SDO_C,
             if (abortCode == CO_SDO_AB_NONE) {
                 ODR_t odRet;
                 /* write data to Object Dictionary */
+                CO_LOCK_OD(SDO_C->CANdevTx);
                 SDO_C->OD_IO.write(&SDO_C->OD_IO.stream, SDO_C->subIndex,
                                    buf, count, &odRet);
+                CO_UNLOCK_OD(SDO_C->CANdevTx);
 
                 /* verify for errors in write */
                 if (odRet != ODR_OK && odRet != ODR_PARTIAL) {
@@ -669,11 +697,14 @@ CO_SDO_return_t CO_SDOclientDownload(CO_SDOclient_t *SDO_C,
     }
 #endif /* CO_CONFIG_SDO_CLI_LOCAL */
     /* CAN data received ******************************************************/
-    else if (CO_FLAG_READ(SDO_C->CANrxNew)) {
+    else if (CO_rxQueue_isNew(&SDO_C->CANrxQueue)) {
+        const uint8_t *CANrxData =
+            SDO_C->CANrxData[CO_rxQueue_peekIndex(&SDO_C->CANrxQueue)];
+
         /* is SDO abort */
-        if (SDO_C->CANrxData[0] == 0x80) {
+        if (CANrxData[0] == 0x80) {
             uint32_t code;
-            memcpy(&code, &SDO_C->CANrxData[4], sizeof(code));
+            memcpy(&code, &CANrxData[4], sizeof(code));
             abortCode = (CO_SDO_abortCode_t)CO_SWAP_32(code);
             SDO_C->state = CO_SDO_ST_IDLE;
             ret = CO_SDO_RT_endedWithServerAbort;
@@ -685,13 +716,13 @@ CO_SDO_return_t CO_SDOclientDownload(CO_SDOclient_t *SDO_C,
         }
         else switch (SDO_C->state) {
             case CO_SDO_ST_DOWNLOAD_INITIATE_RSP: {
-                if (SDO_C->CANrxData[0] == 0x60) {
+                if (CANrxData[0] == 0x60) {
                     /* verify index and subindex */
                     uint16_t index;
                     uint8_t subindex;
-                    index = ((uint16_t) SDO_C->CANrxData[2]) << 8;
-                    index |= SDO_C->CANrxData[1];
-                    subindex = SDO_C->CANrxData[3];
+                    index = ((uint16_t) CANrxData[2]) << 8;
+                    index |= CANrxData[1];
+                    subindex = CANrxData[3];
                     if (index != SDO_C->index || subindex != SDO_C->subIndex) {
                         abortCode = CO_SDO_AB_PRAM_INCOMPAT;
                         SDO_C->state = CO_SDO_ST_ABORT;
@@ -724,9 +755,9 @@ CO_SDO_return_t CO_SDOclientDownload(CO_SDOclient_t *SDO_C,
 
 #if (CO_CONFIG_SDO_CLI) & CO_CONFIG_SDO_CLI_SEGMENTED
             case CO_SDO_ST_DOWNLOAD_SEGMENT_RSP: {
-                if ((SDO_C->CANrxData[0] & 0xEF) == 0x20) {
+                if ((CANrxData[0] & 0xEF) == 0x20) {
                     /* verify and alternate toggle bit */
-                    uint8_t toggle = SDO_C->CANrxData[0] & 0x10;
+                    uint8_t toggle = CANrxData[0] & 0x10;
                     if (toggle != SDO_C->toggle) {
                         abortCode = CO_SDO_AB_TOGGLE_BIT;
                         SDO_C->state = CO_SDO_ST_ABORT;
@@ -753,13 +784,13 @@ CO_SDO_return_t CO_SDOclientDownload(CO_SDOclient_t *SDO_C,
 
 #if (CO_CONFIG_SDO_CLI) & CO_CONFIG_SDO_CLI_BLOCK
             case CO_SDO_ST_DOWNLOAD_BLK_INITIATE_RSP: {
-                if ((SDO_C->CANrxData[0] & 0xFB) == 0xA0) {
+                if ((CANrxData[0] & 0xFB) == 0xA0) {
                     /* verify index and subindex */
                     uint16_t index;
                     uint8_t subindex;
-                    index = ((uint16_t) SDO_C->CANrxData[2]) << 8;
-                    index |= SDO_C->CANrxData[1];
-                    subindex = SDO_C->CANrxData[3];
+                    index = ((uint16_t) CANrxData[2]) << 8;
+                    index |= CANrxData[1];
+                    subindex = CANrxData[3];
                     if (index != SDO_C->index || subindex != SDO_C->subIndex) {
                         abortCode = CO_SDO_AB_PRAM_INCOMPAT;
                         SDO_C->state = CO_SDO_ST_ABORT;
@@ -767,7 +798,7 @@ CO_SDO_return_t CO_SDOclientDownload(CO_SDOclient_t *SDO_C,
                     }
 
                     SDO_C->block_crc = 0;
-                    SDO_C->block_blksize = SDO_C->CANrxData[4];
+                    SDO_C->block_blksize = CANrxData[4];
                     if (SDO_C->block_blksize < 1 || SDO_C->block_blksize > 127)
                         SDO_C->block_blksize = 127;
                     SDO_C->block_seqno = 0;
@@ -783,16 +814,16 @@ CO_SDO_return_t CO_SDOclientDownload(CO_SDOclient_t *SDO_C,
 
             case CO_SDO_ST_DOWNLOAD_BLK_SUBBLOCK_REQ:
             case CO_SDO_ST_DOWNLOAD_BLK_SUBBLOCK_RSP: {
-                if (SDO_C->CANrxData[0] == 0xA2) {
+                if (CANrxData[0] == 0xA2) {
                     /* check number of segments */
-                    if (SDO_C->CANrxData[1] < SDO_C->block_seqno) {
+                    if (CANrxData[1] < SDO_C->block_seqno) {
                         /* NOT all segments transferred successfully.
                          * Re-transmit data after erroneous segment. */
                         CO_fifo_altBegin(&SDO_C->bufFifo,
-                                         (size_t)SDO_C->CANrxData[1] * 7);
+                                         (size_t)CANrxData[1] * 7);
                         SDO_C->finished = false;
                     }
-                    else if (SDO_C->CANrxData[1] > SDO_C->block_seqno) {
+                    else if (CANrxData[1] > SDO_C->block_seqno) {
                         /* something strange from server, break transmission */
                         abortCode = CO_SDO_AB_CMD;
                         SDO_C->state = CO_SDO_ST_ABORT;
@@ -805,7 +836,7 @@ CO_SDO_return_t CO_SDOclientDownload(CO_SDOclient_t *SDO_C,
                     if (SDO_C->finished) {
                         SDO_C->state = CO_SDO_ST_DOWNLOAD_BLK_END_REQ;
                     } else {
-                        SDO_C->block_blksize = SDO_C->CANrxData[2];
+                        SDO_C->block_blksize = CANrxData[2];
                         SDO_C->block_seqno = 0;
                         CO_fifo_altBegin(&SDO_C->bufFifo, 0);
                         SDO_C->state = CO_SDO_ST_DOWNLOAD_BLK_SUBBLOCK_REQ;
@@ -819,7 +850,7 @@ CO_SDO_return_t CO_SDOclientDownload(CO_SDOclient_t *SDO_C,
             }
 
             case CO_SDO_ST_DOWNLOAD_BLK_END_RSP: {
-                if (SDO_C->CANrxData[0] == 0xA1) {
+                if (CANrxData[0] == 0xA1) {
                     /*  SDO block download successfully transferred */
                     SDO_C->state = CO_SDO_ST_IDLE;
                     ret = CO_SDO_RT_ok_communicationEnd;
@@ -840,7 +871,13 @@ CO_SDO_return_t CO_SDOclientDownload(CO_SDOclient_t *SDO_C,
         }
         SDO_C->timeoutTimer = 0;
         timeDifference_us = 0;
-        CO_FLAG_CLEAR(SDO_C->CANrxNew);
+        CO_rxQueue_drop(&SDO_C->CANrxQueue);
+#if (CO_CONFIG_SDO_CLI) & CO_CONFIG_FLAG_TIMERNEXT
+        /* more messages were received in a burst, process them next */
+        if (CO_rxQueue_isNew(&SDO_C->CANrxQueue) && timerNext_us != NULL) {
+            *timerNext_us = 0;
+        }
+#endif
     }
     else if (abort) {
         abortCode = (SDOabortCode != NULL)
@@ -994,52 +1031,85 @@ CO_SDO_return_t CO_SDOclientDownload(CO_SDOclient_t *SDO_C,
         }
 
         case CO_SDO_ST_DOWNLOAD_BLK_SUBBLOCK_REQ: {
-            if (CO_fifo_altGetOccupied(&SDO_C->bufFifo) < 7 && bufferPartial) {
-                /* wait until data are refilled */
-                break;
-            }
-            SDO_C->CANtxBuff->data[0] = ++SDO_C->block_seqno;
-
-            /* get up to 7 data bytes */
-            count = CO_fifo_altRead(&SDO_C->bufFifo,
-                                    (char *)&SDO_C->CANtxBuff->data[1], 7);
-            SDO_C->block_noData = 7 - count;
+            /* Send segments of the sub-block in one pass, until sub-block is
+             * complete, more data are needed or CAN driver can not accept more
+             * messages (transmit queue full or buffer waiting in driver). */
+            while (SDO_C->state == CO_SDO_ST_DOWNLOAD_BLK_SUBBLOCK_REQ) {
+                CO_ReturnError_t err;
+
+                if (CO_fifo_altGetOccupied(&SDO_C->bufFifo) < 7
+                    && bufferPartial
+                ) {
+                    /* wait until data are refilled */
+                    break;
+                }
+                if (SDO_C->CANtxBuff->bufferFull) {
+                    /* previous segment is still waiting in driver */
+                    break;
+                }
+                memset((void *)&SDO_C->CANtxBuff->data[0], 0, 8);
+                SDO_C->CANtxBuff->data[0] = ++SDO_C->block_seqno;
 
-            /* verify if sizeTran is too large */
-            SDO_C->sizeTran += count;
-            if (SDO_C->sizeInd > 0 && SDO_C->sizeTran > SDO_C->sizeInd) {
-                SDO_C->sizeTran -= count;
-                abortCode = CO_SDO_AB_DATA_LONG;
-                SDO_C->state = CO_SDO_ST_ABORT;
-                break;
-            }
+                /* get up to 7 data bytes */
+                count = CO_fifo_altRead(&SDO_C->bufFifo,
+                                        (char *)&SDO_C->CANtxBuff->data[1], 7);
+                SDO_C->block_noData = 7 - count;
 
-            /* is end of transfer? Verify also sizeTran */
-            if (CO_fifo_altGetOccupied(&SDO_C->bufFifo) == 0 && !bufferPartial){
-                if (SDO_C->sizeInd > 0 && SDO_C->sizeTran < SDO_C->sizeInd) {
-                    abortCode = CO_SDO_AB_DATA_SHORT;
+                /* verify if sizeTran is too large */
+                SDO_C->sizeTran += count;
+                if (SDO_C->sizeInd > 0 && SDO_C->sizeTran > SDO_C->sizeInd) {
+                    SDO_C->sizeTran -= count;
+                    abortCode = CO_SDO_AB_DATA_LONG;
                     SDO_C->state = CO_SDO_ST_ABORT;
                     break;
                 }
-                SDO_C->CANtxBuff->data[0] |= 0x80;
-                SDO_C->finished = true;
-                SDO_C->state = CO_SDO_ST_DOWNLOAD_BLK_SUBBLOCK_RSP;
-            }
-            /* are all segments in current block transferred? */
-            else if (SDO_C->block_seqno >= SDO_C->block_blksize) {
-                SDO_C->state = CO_SDO_ST_DOWNLOAD_BLK_SUBBLOCK_RSP;
+
+                /* is end of transfer? Verify also sizeTran */
+                if (CO_fifo_altGetOccupied(&SDO_C->bufFifo) == 0
+                    && !bufferPartial
+                ) {
+                    if (SDO_C->sizeInd > 0
+                        && SDO_C->sizeTran < SDO_C->sizeInd
+                    ) {
+                        abortCode = CO_SDO_AB_DATA_SHORT;
+                        SDO_C->state = CO_SDO_ST_ABORT;
+                        break;
+                    }
+                    SDO_C->CANtxBuff->data[0] |= 0x80;
+                    SDO_C->finished = true;
+                    SDO_C->state = CO_SDO_ST_DOWNLOAD_BLK_SUBBLOCK_RSP;
+                }
+                /* are all segments in current block transferred? */
+                else if (SDO_C->block_seqno >= SDO_C->block_blksize) {
+                    SDO_C->state = CO_SDO_ST_DOWNLOAD_BLK_SUBBLOCK_RSP;
+                }
+
+                /* reset timeout timer and send message */
+                SDO_C->timeoutTimer = 0;
+                CO_CANtxBuffer_busyRetry(SDO_C->CANtxBuff, true);
+                err = CO_CANsend(SDO_C->CANdevTx, SDO_C->CANtxBuff);
+                CO_CANtxBuffer_busyRetry(SDO_C->CANtxBuff, false);
+                if (err == CO_ERROR_TX_BUSY) {
+                    /* Segment was not sent, transmit queue is full. Revert it
+                     * and continue with the next call, after driver sends
+                     * some messages. */
+                    SDO_C->block_seqno--;
+                    SDO_C->sizeTran -= count;
+                    SDO_C->finished = false;
+                    SDO_C->state = CO_SDO_ST_DOWNLOAD_BLK_SUBBLOCK_REQ;
+                    CO_fifo_altBegin(&SDO_C->bufFifo,
+                                     (size_t)SDO_C->block_seqno * 7);
+                    break;
+                }
             }
 #if (CO_CONFIG_SDO_CLI) & CO_CONFIG_FLAG_TIMERNEXT
-            else {
+            if (SDO_C->state == CO_SDO_ST_DOWNLOAD_BLK_SUBBLOCK_REQ) {
                 /* Inform OS to call this function again without delay. */
                 if (timerNext_us != NULL) {
                     *timerNext_us = 0;
                 }
             }
 #endif
-            /* reset timeout timer and send message */
-            SDO_C->timeoutTimer = 0;
-            CO_CANsend(SDO_C->CANdevTx, SDO_C->CANtxBuff);
             break;
         }
 
@@ -1142,7 +1212,7 @@ CO_SDO_return_t CO_SDOclientUploadInitiate(CO_SDOclient_t *SDO_C,
         SDO_C->state = CO_SDO_ST_UPLOAD_INITIATE_REQ;
     }
 
-    CO_FLAG_CLEAR(SDO_C->CANrxNew);
+    CO_rxQueue_clear(&SDO_C->CANrxQueue);
 
     return CO_SDO_RT_ok_communicationEnd;
 }
@@ -1174,40 +1244,21 @@ CO_SDO_return_t CO_SDOclientUpload(CO_SDOclient_t *SDO_C,
     else if (SDO_C->state == CO_SDO_ST_UPLOAD_LOCAL_TRANSFER && !abort) {
         /* search object dictionary in first pass */
         if (SDO_C->OD_IO.read == NULL) {
-            ODR_t odRet;
-            OD_subEntry_t subEntry;
-
-            odRet = OD_getSub(OD_find(SDO_C->OD, SDO_C->index), SDO_C->subIndex,
-                              &subEntry, &SDO_C->OD_IO, false);
-
-            SDO_C->attribute = subEntry.attribute;
-
-            if (odRet != ODR_OK) {
-                abortCode = (CO_SDO_abortCode_t)OD_getSDOabCode(odRet);
-                ret = CO_SDO_RT_endedWithClientAbort;
-            }
-            else if ((SDO_C->attribute & ODA_SDO_RW) == 0) {
-                abortCode = CO_SDO_AB_UNSUPPORTED_ACCESS;
-                ret = CO_SDO_RT_endedWithClientAbort;
-            }
-            else if ((SDO_C->attribute & ODA_SDO_R) == 0) {
-                abortCode = CO_SDO_AB_WRITEONLY;
-                ret = CO_SDO_RT_endedWithClientAbort;
-            }
-            else if (SDO_C->OD_IO.read == NULL) {
-                abortCode = CO_SDO_AB_DEVICE_INCOMPAT;
+            abortCode = localFind(SDO_C, SDO_C->index, SDO_C->subIndex,
+                                  &SDO_C->OD_IO, &SDO_C->attribute, false);
+            if (abortCode != CO_SDO_AB_NONE) {
                 ret = CO_SDO_RT_endedWithClientAbort;
             }
         }
 
         size_t countFifo = CO_fifo_getSpace(&SDO_C->bufFifo);
 
-        /* skip copying if buffer full */
+        /* skip copying if buffer full (fifo is empty in first pass) */
         if (countFifo == 0) {
             ret = CO_SDO_RT_uploadDataBufferFull;
         }
         /* read data, in several passes if necessary */
-        else if (SDO_C->OD_IO.read != NULL) {
+        else if (abortCode == CO_SDO_AB_NONE && SDO_C->OD_IO.read != NULL) {
             /* Get size of data in Object Dictionary. If size is not indicated
              * use maximum SDO client buffer size. Prepare temp buffer. */
             OD_size_t countData = SDO_C->OD_IO.stream.dataLength;
@@ -1217,9 +1268,11 @@ CO_SDO_return_t CO_SDOclientUpload(CO_SDOclient_t *SDO_C,
             ODR_t odRet;
 
             /* load data from OD variable into the buffer */
+            CO_LOCK_OD(SDO_C->CANdevTx);
             OD_size_t countRd = SDO_C->OD_IO.read(&SDO_C->OD_IO.stream,
                                                   SDO_C->subIndex,
                                                   buf, countBuf, &odRet);
+            CO_UNLOCK_OD(SDO_C->CANdevTx);
 
             if (odRet != ODR_OK && odRet != ODR_PARTIAL) {
                 abortCode = (CO_SDO_abortCode_t)OD_getSDOabCode(odRet);
@@ -1280,11 +1333,14 @@ CO_SDO_return_t CO_SDOclientUpload(CO_SDOclient_t *SDO_C,
     }
 #endif /* CO_CONFIG_SDO_CLI_LOCAL */
     /* CAN data received ******************************************************/
-    else if (CO_FLAG_READ(SDO_C->CANrxNew)) {
+    else if (CO_rxQueue_isNew(&SDO_C->CANrxQueue)) {
+        const uint8_t *CANrxData =
+            SDO_C->CANrxData[CO_rxQueue_peekIndex(&SDO_C->CANrxQueue)];
+
         /* is SDO abort */
-        if (SDO_C->CANrxData[0] == 0x80) {
+        if (CANrxData[0] == 0x80) {
             uint32_t code;
-            memcpy(&code, &SDO_C->CANrxData[4], sizeof(code));
+            memcpy(&code, &CANrxData[4], sizeof(code));
             abortCode = (CO_SDO_abortCode_t)CO_SWAP_32(code);
             SDO_C->state = CO_SDO_ST_IDLE;
             ret = CO_SDO_RT_endedWithServerAbort;
@@ -1296,29 +1352,29 @@ CO_SDO_return_t CO_SDOclientUpload(CO_SDOclient_t *SDO_C,
         }
         else switch (SDO_C->state) {
             case CO_SDO_ST_UPLOAD_INITIATE_RSP: {
-                if ((SDO_C->CANrxData[0] & 0xF0) == 0x40) {
+                if ((CANrxData[0] & 0xF0) == 0x40) {
                     /* verify index and subindex */
                     uint16_t index;
                     uint8_t subindex;
-                    index = ((uint16_t) SDO_C->CANrxData[2]) << 8;
-                    index |= SDO_C->CANrxData[1];
-                    subindex = SDO_C->CANrxData[3];
+                    index = ((uint16_t) CANrxData[2]) << 8;
+                    index |= CANrxData[1];
+                    subindex = CANrxData[3];
                     if (index != SDO_C->index || subindex != SDO_C->subIndex) {
                         abortCode = CO_SDO_AB_PRAM_INCOMPAT;
                         SDO_C->state = CO_SDO_ST_ABORT;
                         break;
                     }
 
-                    if (SDO_C->CANrxData[0] & 0x02) {
+                    if (CANrxData[0] & 0x02) {
                         /* Expedited transfer */
                         size_t count = 4;
                         /* is size indicated? */
-                        if (SDO_C->CANrxData[0] & 0x01) {
-                            count -= (SDO_C->CANrxData[0] >> 2) & 0x03;
+                        if (CANrxData[0] & 0x01) {
+                            count -= (CANrxData[0] >> 2) & 0x03;
                         }
                         /* copy data, indicate size and finish */
                         CO_fifo_write(&SDO_C->bufFifo,
-                                      (const char *)&SDO_C->CANrxData[4],
+                                      (const char *)&CANrxData[4],
                                       count, NULL);
                         SDO_C->sizeTran = count;
                         SDO_C->state = CO_SDO_ST_IDLE;
@@ -1327,9 +1383,9 @@ CO_SDO_return_t CO_SDOclientUpload(CO_SDOclient_t *SDO_C,
                     else {
 #if (CO_CONFIG_SDO_CLI) & CO_CONFIG_SDO_CLI_SEGMENTED
                         /* segmented transfer, is size indicated? */
-                        if (SDO_C->CANrxData[0] & 0x01) {
+                        if (CANrxData[0] & 0x01) {
                             uint32_t size;
-                            memcpy(&size, &SDO_C->CANrxData[4], sizeof(size));
+                            memcpy(&size, &CANrxData[4], sizeof(size));
                             SDO_C->sizeInd = CO_SWAP_32(size);
                         }
                         SDO_C->toggle = 0x00;
@@ -1349,11 +1405,11 @@ CO_SDO_return_t CO_SDOclientUpload(CO_SDOclient_t *SDO_C,
 
 #if (CO_CONFIG_SDO_CLI) & CO_CONFIG_SDO_CLI_SEGMENTED
             case CO_SDO_ST_UPLOAD_SEGMENT_RSP: {
-                if ((SDO_C->CANrxData[0] & 0xE0) == 0x00) {
+                if ((CANrxData[0] & 0xE0) == 0x00) {
                     size_t count, countWr;
 
                     /* verify and alternate toggle bit */
-                    uint8_t toggle = SDO_C->CANrxData[0] & 0x10;
+                    uint8_t toggle = CANrxData[0] & 0x10;
                     if (toggle != SDO_C->toggle) {
                         abortCode = CO_SDO_AB_TOGGLE_BIT;
                         SDO_C->state = CO_SDO_ST_ABORT;
@@ -1362,9 +1418,9 @@ CO_SDO_return_t CO_SDOclientUpload(CO_SDOclient_t *SDO_C,
                     SDO_C->toggle = (toggle == 0x00) ? 0x10 : 0x00;
 
                     /* get data size and write data to the buffer */
-                    count = 7 - ((SDO_C->CANrxData[0] >> 1) & 0x07);
+                    count = 7 - ((CANrxData[0] >> 1) & 0x07);
                     countWr = CO_fifo_write(&SDO_C->bufFifo,
-                                            (const char *)&SDO_C->CANrxData[1],
+                                            (const char *)&CANrxData[1],
                                             count, NULL);
                     SDO_C->sizeTran += countWr;
 
@@ -1385,7 +1441,7 @@ CO_SDO_return_t CO_SDOclientUpload(CO_SDOclient_t *SDO_C,
                     }
 
                     /* If no more segments to be upload, finish */
-                    if (SDO_C->CANrxData[0] & 0x01) {
+                    if (CANrxData[0] & 0x01) {
                         /* verify size of data uploaded */
                         if (SDO_C->sizeInd > 0
                             && SDO_C->sizeTran < SDO_C->sizeInd
@@ -1411,26 +1467,26 @@ CO_SDO_return_t CO_SDOclientUpload(CO_SDOclient_t *SDO_C,
 
 #if (CO_CONFIG_SDO_CLI) & CO_CONFIG_SDO_CLI_BLOCK
             case CO_SDO_ST_UPLOAD_BLK_INITIATE_RSP: {
-                if ((SDO_C->CANrxData[0] & 0xF9) == 0xC0) {
+                if ((CANrxData[0] & 0xF9) == 0xC0) {
                     uint16_t index;
                     uint8_t subindex;
 
                     /* get server CRC support info and data size */
-                    if ((SDO_C->CANrxData[0] & 0x04) != 0) {
+                    if ((CANrxData[0] & 0x04) != 0) {
                         SDO_C->block_crcEnabled = true;
                     } else {
                         SDO_C->block_crcEnabled = false;
                     }
-                    if (SDO_C->CANrxData[0] & 0x02) {
+                    if (CANrxData[0] & 0x02) {
                         uint32_t size;
-                        memcpy(&size, &SDO_C->CANrxData[4], sizeof(size));
+                        memcpy(&size, &CANrxData[4], sizeof(size));
                         SDO_C->sizeInd = CO_SWAP_32(size);
                     }
 
                     /* verify index and subindex */
-                    index = ((uint16_t) SDO_C->CANrxData[2]) << 8;
-                    index |= SDO_C->CANrxData[1];
-                    subindex = SDO_C->CANrxData[3];
+                    index = ((uint16_t) CANrxData[2]) << 8;
+                    index |= CANrxData[1];
+                    subindex = CANrxData[3];
                     if (index != SDO_C->index || subindex != SDO_C->subIndex) {
                         abortCode = CO_SDO_AB_PRAM_INCOMPAT;
                         SDO_C->state = CO_SDO_ST_ABORT;
@@ -1440,29 +1496,29 @@ CO_SDO_return_t CO_SDOclientUpload(CO_SDOclient_t *SDO_C,
                     }
                 }
                 /* switch to regular transfer, CO_SDO_ST_UPLOAD_INITIATE_RSP */
-                else if ((SDO_C->CANrxData[0] & 0xF0) == 0x40) {
+                else if ((CANrxData[0] & 0xF0) == 0x40) {
                     /* verify index and subindex */
                     uint16_t index;
                     uint8_t subindex;
-                    index = ((uint16_t) SDO_C->CANrxData[2]) << 8;
-                    index |= SDO_C->CANrxData[1];
-                    subindex = SDO_C->CANrxData[3];
+                    index = ((uint16_t) CANrxData[2]) << 8;
+                    index |= CANrxData[1];
+                    subindex = CANrxData[3];
                     if (index != SDO_C->index || subindex != SDO_C->subIndex) {
                         abortCode = CO_SDO_AB_PRAM_INCOMPAT;
                         SDO_C->state = CO_SDO_ST_ABORT;
                         break;
                     }
 
-                    if (SDO_C->CANrxData[0] & 0x02) {
+                    if (CANrxData[0] & 0x02) {
                         /* Expedited transfer */
                         size_t count = 4;
                         /* is size indicated? */
-                        if (SDO_C->CANrxData[0] & 0x01) {
-                            count -= (SDO_C->CANrxData[0] >> 2) & 0x03;
+                        if (CANrxData[0] & 0x01) {
+                            count -= (CANrxData[0] >> 2) & 0x03;
                         }
                         /* copy data, indicate size and finish */
                         CO_fifo_write(&SDO_C->bufFifo,
-                                      (const char *)&SDO_C->CANrxData[4],
+                                      (const char *)&CANrxData[4],
                                       count, NULL);
                         SDO_C->sizeTran = count;
                         SDO_C->state = CO_SDO_ST_IDLE;
@@ -1470,9 +1526,9 @@ CO_SDO_return_t CO_SDOclientUpload(CO_SDOclient_t *SDO_C,
                     }
                     else {
                         /* segmented transfer, is size indicated? */
-                        if (SDO_C->CANrxData[0] & 0x01) {
+                        if (CANrxData[0] & 0x01) {
                             uint32_t size;
-                            memcpy(&size, &SDO_C->CANrxData[4], sizeof(size));
+                            memcpy(&size, &CANrxData[4], sizeof(size));
                             SDO_C->sizeInd = CO_SWAP_32(size);
                         }
                         SDO_C->toggle = 0x00;
@@ -1492,10 +1548,10 @@ CO_SDO_return_t CO_SDOclientUpload(CO_SDOclient_t *SDO_C,
             }
 
             case CO_SDO_ST_UPLOAD_BLK_END_SREQ: {
-                if ((SDO_C->CANrxData[0] & 0xE3) == 0xC1) {
+                if ((CANrxData[0] & 0xE3) == 0xC1) {
                     /* Get number of data bytes in last segment, that do not
                      * contain data. Then copy remaining data into fifo */
-                    uint8_t noData = ((SDO_C->CANrxData[0] >> 2) & 0x07);
+                    uint8_t noData = ((CANrxData[0] >> 2) & 0x07);
                     CO_fifo_write(&SDO_C->bufFifo,
                                   (const char *)&SDO_C->block_dataUploadLast[0],
                                   7 - noData,
@@ -1515,8 +1571,8 @@ CO_SDO_return_t CO_SDOclientUpload(CO_SDOclient_t *SDO_C,
                     /* verify CRC */
                     if (SDO_C->block_crcEnabled) {
                         uint16_t crcServer;
-                        crcServer = ((uint16_t) SDO_C->CANrxData[2]) << 8;
-                        crcServer |= SDO_C->CANrxData[1];
+                        crcServer = ((uint16_t) CANrxData[2]) << 8;
+                        crcServer |= CANrxData[1];
                         if (crcServer != SDO_C->block_crc) {
                             abortCode = CO_SDO_AB_CRC;
                             SDO_C->state = CO_SDO_ST_ABORT;
@@ -1541,7 +1597,13 @@ CO_SDO_return_t CO_SDOclientUpload(CO_SDOclient_t *SDO_C,
         }
         SDO_C->timeoutTimer = 0;
         timeDifference_us = 0;
-        CO_FLAG_CLEAR(SDO_C->CANrxNew);
+        CO_rxQueue_drop(&SDO_C->CANrxQueue);
+#if (CO_CONFIG_SDO_CLI) & CO_CONFIG_FLAG_TIMERNEXT
+        /* more messages were received in a burst, process them next */
+        if (CO_rxQueue_isNew(&SDO_C->CANrxQueue) && timerNext_us != NULL) {
+            *timerNext_us = 0;
+        }
+#endif
     }
     else if (abort) {
         abortCode = (SDOabortCode != NULL)
@@ -1583,9 +1645,9 @@ CO_SDO_return_t CO_SDOclientUpload(CO_SDOclient_t *SDO_C,
             }
             if (SDO_C->block_timeoutTimer >= SDO_C->block_SDOtimeoutTime_us) {
                 /* SDO_C->state will change, processing will continue in this
-                 * thread. Make memory barrier here with CO_FLAG_CLEAR() call.*/
+                 * thread. Make memory barrier here with CO_rxQueue_clear(). */
                 SDO_C->state = CO_SDO_ST_UPLOAD_BLK_SUBBLOCK_CRSP;
-                CO_FLAG_CLEAR(SDO_C->CANrxNew);
+                CO_rxQueue_clear(&SDO_C->CANrxQueue);
             }
 #if (CO_CONFIG_SDO_CLI) & CO_CONFIG_FLAG_TIMERNEXT
             else if (timerNext_us != NULL) {
@@ -1680,9 +1742,9 @@ CO_SDO_return_t CO_SDOclientUpload(CO_SDOclient_t *SDO_C,
             SDO_C->block_seqno = 0;
             SDO_C->block_crc = 0;
             /* Block segments will be received in different thread. Make memory
-             * barrier here with CO_FLAG_CLEAR() call. */
+             * barrier here with CO_rxQueue_clear() call. */
             SDO_C->state = CO_SDO_ST_UPLOAD_BLK_SUBBLOCK_SREQ;
-            CO_FLAG_CLEAR(SDO_C->CANrxNew);
+            CO_rxQueue_clear(&SDO_C->CANrxQueue);
             CO_CANsend(SDO_C->CANdevTx, SDO_C->CANtxBuff);
             break;
         }
@@ -1735,9 +1797,9 @@ CO_SDO_return_t CO_SDOclientUpload(CO_SDOclient_t *SDO_C,
                 SDO_C->block_blksize = (uint8_t)count;
                 SDO_C->block_seqno = 0;
                 /* Block segments will be received in different thread. Make
-                 * memory barrier here with CO_FLAG_CLEAR() call. */
+                 * memory barrier here with CO_rxQueue_clear() call. */
                 SDO_C->state = CO_SDO_ST_UPLOAD_BLK_SUBBLOCK_SREQ;
-                CO_FLAG_CLEAR(SDO_C->CANrxNew);
+                CO_rxQueue_clear(&SDO_C->CANrxQueue);
             }
 
             SDO_C->CANtxBuff->data[2] = SDO_C->block_blksize;
@@ -1821,6 +1883,215 @@ size_t CO_SDOclientUploadBufRead(CO_SDOclient_t *SDO_C,
 }
 
 
+#if (CO_CONFIG_SDO_CLI) & CO_CONFIG_SDO_CLI_LOCAL
+/******************************************************************************
+ * LOCAL                                                                      *
+ ******************************************************************************/
+CO_SDO_return_t CO_SDOclientDownloadLocal(CO_SDOclient_t *SDO_C,
+                                          uint16_t index,
+                                          uint8_t subIndex,
+                                          const uint8_t *buf,
+                                          size_t count,
+                                          CO_SDO_abortCode_t *SDOabortCode)
+{
+    CO_SDO_return_t ret = CO_SDO_RT_ok_communicationEnd;
+    CO_SDO_abortCode_t abortCode = CO_SDO_AB_NONE;
+    OD_IO_t OD_IO;
+    OD_attr_t attribute = 0;
+    OD_size_t countZero = 0;
+
+    if (SDO_C == NULL || SDO_C->OD == NULL || buf == NULL || count == 0) {
+        abortCode = CO_SDO_AB_DEVICE_INCOMPAT;
+        ret = CO_SDO_RT_wrongArguments;
+    }
+    else {
+        abortCode = localFind(SDO_C, index, subIndex, &OD_IO, &attribute, true);
+    }
+
+    /* verify size of data, see also CO_SDOclientDownload() */
+    if (abortCode == CO_SDO_AB_NONE) {
+        OD_size_t sizeInOd = OD_IO.stream.dataLength;
+
+        if ((size_t)(OD_size_t)count != count) {
+            abortCode = CO_SDO_AB_DATA_LONG;
+        }
+        /* Shorter string is terminated with one or two zero bytes */
+        else if ((attribute & ODA_STR) != 0
+                 && (sizeInOd == 0 || count < sizeInOd)
+        ) {
+            countZero = (sizeInOd == 0 || sizeInOd > count + 1) ? 2 : 1;
+            OD_IO.stream.dataLength = (OD_size_t)count + countZero;
+        }
+        else if (sizeInOd == 0) {
+            OD_IO.stream.dataLength = (OD_size_t)count;
+        }
+        else if (count != sizeInOd) {
+            abortCode = (count > sizeInOd) ?
+                        CO_SDO_AB_DATA_LONG : CO_SDO_AB_DATA_SHORT;
+        }
+    }
+
+    if (abortCode != CO_SDO_AB_NONE) {
+        if (ret == CO_SDO_RT_ok_communicationEnd) {
+            ret = CO_SDO_RT_endedWithClientAbort;
+        }
+    }
+    else {
+        static const uint8_t zeros[2] = {0, 0};
+        ODR_t odRet;
+#ifdef CO_BIG_ENDIAN
+        uint8_t bufSwapped[8];
+
+        /* data in buf are little endian, as in SDO */
+        if ((attribute & ODA_MB) != 0 && count <= sizeof(bufSwapped)) {
+            memcpy(bufSwapped, buf, count);
+            reverseBytes(bufSwapped, count);
+            buf = bufSwapped;
+        }
+#endif
+
+        /* write data directly from buf to Object Dictionary */
+        CO_LOCK_OD(SDO_C->CANdevTx);
+        OD_IO.write(&OD_IO.stream, subIndex, buf, (OD_size_t)count, &odRet);
+        if (countZero > 0 && odRet == ODR_PARTIAL) {
+            OD_IO.write(&OD_IO.stream, subIndex, zeros, countZero, &odRet);
+        }
+        CO_UNLOCK_OD(SDO_C->CANdevTx);
+
+        if (odRet == ODR_PARTIAL) {
+            abortCode = CO_SDO_AB_DATA_SHORT;
+            ret = CO_SDO_RT_endedWithClientAbort;
+        }
+        else if (odRet != ODR_OK) {
+            abortCode = (CO_SDO_abortCode_t)OD_getSDOabCode(odRet);
+            ret = CO_SDO_RT_endedWithServerAbort;
+        }
+    }
+
+    if (SDOabortCode != NULL) {
+        *SDOabortCode = abortCode;
+    }
+
+    return ret;
+}
+
+
+/******************************************************************************/
+CO_SDO_return_t CO_SDOclientUploadLocal(CO_SDOclient_t *SDO_C,
+                                        uint16_t index,
+                                        uint8_t subIndex,
+                                        uint8_t *buf,
+                                        size_t bufSize,
+                                        size_t *sizeRead,
+                                        CO_SDO_abortCode_t *SDOabortCode)
+{
+    CO_SDO_return_t ret = CO_SDO_RT_ok_communicationEnd;
+    CO_SDO_abortCode_t abortCode = CO_SDO_AB_NONE;
+    OD_IO_t OD_IO;
+    OD_attr_t attribute = 0;
+    bool_t toFifo = false;
+    size_t count = 0;
+
+    if (SDO_C == NULL || SDO_C->OD == NULL
+        || (buf == NULL && SDO_C->state != CO_SDO_ST_IDLE)
+    ) {
+        abortCode = CO_SDO_AB_DEVICE_INCOMPAT;
+        ret = CO_SDO_RT_wrongArguments;
+    }
+    else {
+        /* use internal buffer of the SDO client, it is free */
+        if (buf == NULL) {
+            buf = (uint8_t *)SDO_C->buf;
+            bufSize = CO_CONFIG_SDO_CLI_BUFFER_SIZE;
+            toFifo = true;
+        }
+        abortCode = localFind(SDO_C, index, subIndex, &OD_IO, &attribute,false);
+        if (abortCode != CO_SDO_AB_NONE) {
+            ret = CO_SDO_RT_endedWithClientAbort;
+        }
+    }
+
+    if (abortCode == CO_SDO_AB_NONE) {
+        OD_size_t sizeInOd = OD_IO.stream.dataLength;
+
+        /* data will not fit, leave it for CO_SDOclientUpload() */
+        if (sizeInOd > bufSize || (sizeInOd == 0 && toFifo)) {
+            ret = CO_SDO_RT_uploadDataBufferFull;
+        }
+        else {
+            ODR_t odRet = ODR_PARTIAL;
+
+            /* read data directly from Object Dictionary into buf, in several
+             * passes, if OD variable is a stream (domain) */
+            CO_LOCK_OD(SDO_C->CANdevTx);
+            while (odRet == ODR_PARTIAL && count < bufSize) {
+                size_t countBuf = bufSize - count;
+                OD_size_t countRd;
+
+                if ((size_t)(OD_size_t)countBuf != countBuf) {
+                    countBuf = (OD_size_t)-1;
+                }
+                countRd = OD_IO.read(&OD_IO.stream, subIndex, &buf[count],
+                                     (OD_size_t)countBuf, &odRet);
+                count += countRd;
+                if (countRd == 0 && odRet == ODR_PARTIAL) {
+                    /* domain has no data now, can't wait here */
+                    break;
+                }
+            }
+            CO_UNLOCK_OD(SDO_C->CANdevTx);
+
+            if (odRet == ODR_PARTIAL) {
+                abortCode = (count < bufSize) ?
+                            CO_SDO_AB_DATA_DEV_STATE : CO_SDO_AB_OUT_OF_MEM;
+                ret = CO_SDO_RT_endedWithClientAbort;
+            }
+            else if (odRet != ODR_OK) {
+                abortCode = (CO_SDO_abortCode_t)OD_getSDOabCode(odRet);
+                ret = CO_SDO_RT_endedWithServerAbort;
+            }
+            /* if data is string, return only data up to null termination */
+            else if ((attribute & ODA_STR) != 0) {
+                const uint8_t *term = memchr(buf, 0, count);
+                if (term != NULL) {
+                    count = (term == buf) ? 1 : (size_t)(term - buf);
+                }
+            }
+            else if (sizeInOd > 0 && count < sizeInOd) {
+                abortCode = CO_SDO_AB_DATA_SHORT;
+                ret = CO_SDO_RT_endedWithClientAbort;
+            }
+#ifdef CO_BIG_ENDIAN
+            /* return little endian data, as in SDO */
+            else if ((attribute & ODA_MB) != 0) {
+                reverseBytes(buf, count);
+            }
+#endif
+        }
+    }
+
+    if (toFifo) {
+        /* data are already in fifo buffer, from its beginning */
+        CO_fifo_reset(&SDO_C->bufFifo);
+        if (ret == CO_SDO_RT_ok_communicationEnd) {
+            SDO_C->bufFifo.writePtr = count;
+        }
+    }
+    if (ret != CO_SDO_RT_ok_communicationEnd) {
+        count = 0;
+    }
+    if (sizeRead != NULL) {
+        *sizeRead = count;
+    }
+    if (SDOabortCode != NULL) {
+        *SDOabortCode = abortCode;
+    }
+
+    return ret;
+}
+#endif /* CO_CONFIG_SDO_CLI_LOCAL */
+
+
 /******************************************************************************/
 void CO_SDOclientClose(CO_SDOclient_t *SDO_C) {
     if (SDO_C != NULL) {
@@ -28,6 +28,7 @@
 #define CO_SDO_CLIENT_H
 
 #include "301/CO_driver.h"
+#include "301/CO_rxQueue.h"
 #include "301/CO_ODinterface.h"
 #include "301/CO_SDOserver.h"
 #include "301/CO_fifo.h"
@@ -120,11 +121,11 @@ typedef struct {
     /** Data buffer of usable size @ref CO_CONFIG_SDO_CLI_BUFFER_SIZE, used
      * inside bufFifo. Must be one byte larger for fifo usage. */
     char buf[CO_CONFIG_SDO_CLI_BUFFER_SIZE + 1];
-    /** Indicates, if new SDO message received from CAN bus. It is not cleared,
-     * until received message is completely processed. */
-    volatile void *CANrxNew;
-    /** 8 data bytes of the received message */
-    uint8_t CANrxData[8];
+    /** Queue of SDO messages received from CAN bus. Message is not dropped,
+     * until it is completely processed. */
+    CO_rxQueue_t CANrxQueue;
+    /** 8 data bytes of the received messages, indexed by CANrxQueue */
+    uint8_t CANrxData[CO_CONFIG_RX_QUEUE_SIZE][8];
 #if ((CO_CONFIG_SDO_CLI) & CO_CONFIG_FLAG_CALLBACK_PRE) || defined CO_DOXYGEN
     /** From CO_SDOclient_initCallbackPre() or NULL */
     void (*pFunctSignal)(void *object);
@@ -309,9 +310,13 @@ size_t CO_SDOclientDownloadBufWrite(CO_SDOclient_t *SDO_C,
  * download communication initiated with CO_SDOclientDownloadInitiate().
  * Function is non-blocking.
  *
- * If function returns #CO_SDO_RT_blockDownldInProgress and OS has buffer for
- * CAN tx messages, then this function may be called multiple times within own
- * loop. This can speed-up SDO block transfer.
+ * In block download function sends all segments of the sub-block in one call,
+ * as long as data are available in the internal buffer and CAN driver accepts
+ * messages. If CO_CANsend() returns CO_ERROR_TX_BUSY (driver's transmit queue
+ * is full, see CO_CANtxBuffer_busyRetry()) or transmit buffer remains full in
+ * the driver, the remaining segments are sent in the next calls. In that case
+ * function returns #CO_SDO_RT_blockDownldInProgress and sets _timerNext_us_
+ * to zero.
  *
  * @param SDO_C This object.
  * @param timeDifference_us Time difference from previous function call in
@@ -425,6 +430,77 @@ size_t CO_SDOclientUploadBufRead(CO_SDOclient_t *SDO_C,
                                  size_t count);
 
 
+#if ((CO_CONFIG_SDO_CLI) & CO_CONFIG_SDO_CLI_LOCAL) || defined CO_DOXYGEN
+/**
+ * Write data directly into Object Dictionary of this node.
+ *
+ * Function is an alternative to CO_SDOclientDownloadInitiate() and
+ * CO_SDOclientDownload() for the local transfer. It completes in a single
+ * call: data are written from buf straight into the OD variable (also large
+ * domain), without the internal buffer and without the SDO client state
+ * machine, which is not changed. Access rights and data size are verified the
+ * same way as in SDO server. OD is locked with CO_LOCK_OD() during the write.
+ *
+ * @param SDO_C This object, OD from CO_SDOclient_init() is used.
+ * @param index Index of object in object dictionary of this node.
+ * @param subIndex Subindex of object in object dictionary of this node.
+ * @param buf Data, as in SDO (little endian).
+ * @param count Size of data in buf, must be greater than zero.
+ * @param [out] SDOabortCode In case of error, SDO abort code contains reason
+ * of error. Ignored if NULL.
+ *
+ * @return #CO_SDO_RT_ok_communicationEnd, #CO_SDO_RT_wrongArguments,
+ * #CO_SDO_RT_endedWithClientAbort or #CO_SDO_RT_endedWithServerAbort (error
+ * from OD write).
+ */
+CO_SDO_return_t CO_SDOclientDownloadLocal(CO_SDOclient_t *SDO_C,
+                                          uint16_t index,
+                                          uint8_t subIndex,
+                                          const uint8_t *buf,
+                                          size_t count,
+                                          CO_SDO_abortCode_t *SDOabortCode);
+
+
+/**
+ * Read data directly from Object Dictionary of this node.
+ *
+ * Function is an alternative to CO_SDOclientUploadInitiate() and
+ * CO_SDOclientUpload() for the local transfer. It completes in a single call:
+ * data are read from the OD variable (also large domain) straight into buf.
+ * SDO client state machine is not changed. OD is locked with CO_LOCK_OD()
+ * during the read.
+ *
+ * If buf is NULL, data are read into the internal buffer of the SDO client,
+ * which must be idle. Data can then be read with CO_SDOclientUploadBufRead()
+ * or with CO_fifo functions, as after CO_SDOclientUpload().
+ *
+ * If size of the OD variable is larger than bufSize (or is not known, if buf is
+ * NULL), nothing is read and #CO_SDO_RT_uploadDataBufferFull is returned. In
+ * that case use CO_SDOclientUploadInitiate(), which transfers data in parts.
+ *
+ * @param SDO_C This object, OD from CO_SDOclient_init() is used.
+ * @param index Index of object in object dictionary of this node.
+ * @param subIndex Subindex of object in object dictionary of this node.
+ * @param buf Buffer for data, as in SDO (little endian), or NULL.
+ * @param bufSize Size of buf, ignored if buf is NULL.
+ * @param [out] sizeRead Size of data read. Ignored if NULL.
+ * @param [out] SDOabortCode In case of error, SDO abort code contains reason
+ * of error. Ignored if NULL.
+ *
+ * @return #CO_SDO_RT_ok_communicationEnd, #CO_SDO_RT_uploadDataBufferFull,
+ * #CO_SDO_RT_wrongArguments, #CO_SDO_RT_endedWithClientAbort or
+ * #CO_SDO_RT_endedWithServerAbort (error from OD read).
+ */
+CO_SDO_return_t CO_SDOclientUploadLocal(CO_SDOclient_t *SDO_C,
+                                        uint16_t index,
+                                        uint8_t subIndex,
+                                        uint8_t *buf,
+                                        size_t bufSize,
+                                        size_t *sizeRead,
+                                        CO_SDO_abortCode_t *SDOabortCode);
+#endif /* CO_CONFIG_SDO_CLI_LOCAL */
+
+
 /**
  * Close SDO communication temporary.
  *
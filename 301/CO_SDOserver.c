@@ -64,9 +64,6 @@ static void CO_SDO_receive(void *object, void *msg) {
             /* abort from client, just make idle */
             SDO->state = CO_SDO_ST_IDLE;
         }
-        else if (CO_FLAG_READ(SDO->CANrxNew)) {
-            /* ignore message if previous message was not processed yet */
-        }
 #if (CO_CONFIG_SDO_SRV) & CO_CONFIG_SDO_SRV_BLOCK
         else if (SDO->state == CO_SDO_ST_UPLOAD_BLK_END_CRSP && data[0]==0xA1) {
             /*  SDO block download successfully transferred, just make idle */
@@ -128,9 +125,8 @@ static void CO_SDO_receive(void *object, void *msg) {
 
                 if (state != CO_SDO_ST_DOWNLOAD_BLK_SUBBLOCK_REQ) {
                     /* SDO->state has changed, processing will continue in
-                     * another thread. Make memory barrier here with
-                     * CO_FLAG_CLEAR() call. */
-                    CO_FLAG_CLEAR(SDO->CANrxNew);
+                     * another thread. Make memory barrier here. */
+                    CO_MemoryBarrier();
                     SDO->state = state;
 #if (CO_CONFIG_SDO_SRV) & CO_CONFIG_FLAG_CALLBACK_PRE
                     /* Optional signal to RTOS, which can resume task, which
@@ -147,17 +143,20 @@ static void CO_SDO_receive(void *object, void *msg) {
         }
 #endif /* (CO_CONFIG_SDO_SRV) & CO_CONFIG_SDO_SRV_BLOCK */
         else {
-            /* copy data and set 'new message' flag, data will be processed in
-             * CO_SDOserver_process() */
-            memcpy(SDO->CANrxData, data, DLC);
-            CO_FLAG_SET(SDO->CANrxNew);
+            /* copy data into the queue, data will be processed in
+             * CO_SDOserver_process(). Message is ignored, if queue is full. */
+            int16_t i = CO_rxQueue_pushIndex(&SDO->CANrxQueue);
+            if (i >= 0) {
+                memcpy(SDO->CANrxData[i], data, DLC);
+                CO_rxQueue_push(&SDO->CANrxQueue);
 #if (CO_CONFIG_SDO_SRV) & CO_CONFIG_FLAG_CALLBACK_PRE
-            /* Optional signal to RTOS, which can resume task, which handles
-            * SDO server processing. */
-            if (SDO->pFunctSignalPre != NULL) {
-                SDO->pFunctSignalPre(SDO->functSignalObjectPre);
-            }
+                /* Optional signal to RTOS, which can resume task, which
+                 * handles SDO server processing. */
+                if (SDO->pFunctSignalPre != NULL) {
+                    SDO->pFunctSignalPre(SDO->functSignalObjectPre);
+                }
 #endif
+            }
         }
     }
 }
@@ -452,7 +451,7 @@ CO_ReturnError_t CO_SDOserver_init(CO_SDOserver_t *SDO,
         return CO_ERROR_ILLEGAL_ARGUMENT;
     }
 
-    CO_FLAG_CLEAR(SDO->CANrxNew);
+    CO_rxQueue_init(&SDO->CANrxQueue);
 
     /* store the parameters and configure CANrx and CANtx */
 #if (CO_CONFIG_SDO_SRV) & CO_CONFIG_FLAG_OD_DYNAMIC
@@ -503,6 +502,84 @@ static inline void reverseBytes(void *start, OD_size_t size) {
 
 
 #if (CO_CONFIG_SDO_SRV) & CO_CONFIG_SDO_SRV_SEGMENTED
+/** Helper function for writing data from the buffer to Object dictionary.
+ *
+ * OD write function may accept only part of the data or, with the last data,
+ * indicate that it is still completing them (asynchronous commit), see
+ * @ref OD_IO_t. In that case remaining data stay in the buffer, writePending
+ * is set and function must be called again before the response is sent.
+ *
+ * @param SDO SDO server
+ * @param [out] abortCode SDO abort code in case of error
+ *
+ * Returns true on success or pending write, otherwise write also abortCode and
+ * sets state to CO_SDO_ST_ABORT */
+static bool_t writeToOD(CO_SDOserver_t *SDO, CO_SDO_abortCode_t *abortCode) {
+    ODR_t odRet;
+    OD_size_t countWr;
+
+    CO_LOCK_OD(SDO->CANdevTx);
+    countWr = SDO->OD_IO.write(&SDO->OD_IO.stream, SDO->subIndex,
+                               SDO->buf, SDO->bufOffsetWr, &odRet);
+    CO_UNLOCK_OD(SDO->CANdevTx);
+    SDO->writePending = false;
+    SDO->writeOpen = odRet == ODR_PARTIAL;
+
+    if (odRet == ODR_PARTIAL && countWr < SDO->bufOffsetWr) {
+        /* data accepted partially, keep the rest for the next call */
+        memmove(SDO->buf, SDO->buf + countWr, SDO->bufOffsetWr - countWr);
+        SDO->bufOffsetWr -= countWr;
+        SDO->writePending = true;
+        return true;
+    }
+    SDO->bufOffsetWr = 0;
+
+    /* verify write error value */
+    if (odRet != ODR_OK && odRet != ODR_PARTIAL) {
+        *abortCode = (CO_SDO_abortCode_t)OD_getSDOabCode(odRet);
+        SDO->state = CO_SDO_ST_ABORT;
+        return false;
+    }
+    else if (SDO->finished && odRet == ODR_PARTIAL) {
+        if (SDO->OD_IO.stream.dataLength > 0
+            && SDO->OD_IO.stream.dataOffset >= SDO->OD_IO.stream.dataLength
+        ) {
+            /* all data accepted, OD variable still completes them */
+            SDO->writePending = true;
+            return true;
+        }
+        /* OD variable was not written completely, but SDO download finished */
+        *abortCode = CO_SDO_AB_DATA_SHORT;
+        SDO->state = CO_SDO_ST_ABORT;
+        return false;
+    }
+    else if (!SDO->finished && odRet == ODR_OK) {
+        /* OD variable was written completely, but SDO download still has data*/
+        *abortCode = CO_SDO_AB_DATA_LONG;
+        SDO->state = CO_SDO_ST_ABORT;
+        return false;
+    }
+
+    return true;
+}
+
+
+/** Helper function, informs OD write function about aborted download, so it
+ * can discard already accepted data, see @ref OD_IO_t.
+ *
+ * @param SDO SDO server */
+static void abortWriteToOD(CO_SDOserver_t *SDO) {
+    ODR_t odRet;
+
+    CO_LOCK_OD(SDO->CANdevTx);
+    (void)SDO->OD_IO.write(&SDO->OD_IO.stream, SDO->subIndex,
+                           NULL, 0, &odRet);
+    CO_UNLOCK_OD(SDO->CANdevTx);
+    SDO->writeOpen = false;
+    SDO->writePending = false;
+}
+
+
 /** Helper function for writing data to Object dictionary. Function swaps data
  * if necessary, calcualtes (and verifies CRC) writes data to OD and verifies
  * data lengths.
@@ -592,32 +669,7 @@ static bool_t validateAndWriteToOD(CO_SDOserver_t *SDO,
     /* may be unused */
     (void) crcOperation; (void) crcClient; (void) bufOffsetWrOrig;
 
-    /* write data */
-    ODR_t odRet;
-    SDO->OD_IO.write(&SDO->OD_IO.stream, SDO->subIndex,
-                     SDO->buf, SDO->bufOffsetWr, &odRet);
-    SDO->bufOffsetWr = 0;
-
-    /* verify write error value */
-    if (odRet != ODR_OK && odRet != ODR_PARTIAL) {
-        *abortCode = (CO_SDO_abortCode_t)OD_getSDOabCode(odRet);
-        SDO->state = CO_SDO_ST_ABORT;
-        return false;
-    }
-    else if (SDO->finished && odRet == ODR_PARTIAL) {
-        /* OD variable was not written completely, but SDO download finished */
-        *abortCode = CO_SDO_AB_DATA_SHORT;
-        SDO->state = CO_SDO_ST_ABORT;
-        return false;
-    }
-    else if (!SDO->finished && odRet == ODR_OK) {
-        /* OD variable was written completely, but SDO download still has data*/
-        *abortCode = CO_SDO_AB_DATA_LONG;
-        SDO->state = CO_SDO_ST_ABORT;
-        return false;
-    }
-
-    return true;
+    return writeToOD(SDO, abortCode);
 }
 
 
@@ -651,10 +703,12 @@ static bool_t readFromOd(CO_SDOserver_t *SDO,
         /* load data from OD variable into the buffer */
         ODR_t odRet;
         char *bufShifted = SDO->buf + countRemain;
+        CO_LOCK_OD(SDO->CANdevTx);
         OD_size_t countRd = SDO->OD_IO.read(&SDO->OD_IO.stream, SDO->subIndex,
                                             bufShifted,
                                             countRdRequest,
                                             &odRet);
+        CO_UNLOCK_OD(SDO->CANdevTx);
 
         if (odRet != ODR_OK && odRet != ODR_PARTIAL) {
             *abortCode = (CO_SDO_abortCode_t)OD_getSDOabCode(odRet);
@@ -729,8 +783,17 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
 
     CO_SDO_return_t ret = CO_SDO_RT_waitingResponse;
     CO_SDO_abortCode_t abortCode = CO_SDO_AB_NONE;
-    bool_t isNew = CO_FLAG_READ(SDO->CANrxNew);
+    int16_t rxIdx = CO_rxQueue_peekIndex(&SDO->CANrxQueue);
+    bool_t isNew = rxIdx >= 0;
+    const uint8_t *CANrxData = isNew ? SDO->CANrxData[rxIdx] : NULL;
 
+#if (CO_CONFIG_SDO_SRV) & CO_CONFIG_SDO_SRV_SEGMENTED
+    /* Download was aborted by client or by reset of the state, before OD write
+     * function has finished */
+    if (SDO != NULL && SDO->writeOpen && SDO->state == CO_SDO_ST_IDLE) {
+        abortWriteToOD(SDO);
+    }
+#endif
 
     if (SDO == NULL) {
         ret = CO_SDO_RT_wrongArguments;
@@ -743,7 +806,7 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
         /* SDO is allowed only in operational or pre-operational NMT state
          * and must be valid */
         SDO->state = CO_SDO_ST_IDLE;
-        CO_FLAG_CLEAR(SDO->CANrxNew);
+        CO_rxQueue_clear(&SDO->CANrxQueue);
         ret = CO_SDO_RT_ok_communicationEnd;
     }
     /* CAN data received ******************************************************/
@@ -751,18 +814,22 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
         if (SDO->state == CO_SDO_ST_IDLE) { /* new SDO communication? */
             bool_t upload = false;
 
-            if ((SDO->CANrxData[0] & 0xF0) == 0x20) {
+#if (CO_CONFIG_SDO_SRV) & CO_CONFIG_SDO_SRV_SEGMENTED
+            SDO->writePending = false;
+#endif
+
+            if ((CANrxData[0] & 0xF0) == 0x20) {
                 SDO->state = CO_SDO_ST_DOWNLOAD_INITIATE_REQ;
             }
-            else if (SDO->CANrxData[0] == 0x40) {
+            else if (CANrxData[0] == 0x40) {
                 upload = true;
                 SDO->state = CO_SDO_ST_UPLOAD_INITIATE_REQ;
             }
 #if (CO_CONFIG_SDO_SRV) & CO_CONFIG_SDO_SRV_BLOCK
-            else if ((SDO->CANrxData[0] & 0xF9) == 0xC0) {
+            else if ((CANrxData[0] & 0xF9) == 0xC0) {
                 SDO->state = CO_SDO_ST_DOWNLOAD_BLK_INITIATE_REQ;
             }
-            else if ((SDO->CANrxData[0] & 0xFB) == 0xA0) {
+            else if ((CANrxData[0] & 0xFB) == 0xA0) {
                 upload = true;
                 SDO->state = CO_SDO_ST_UPLOAD_BLK_INITIATE_REQ;
             }
@@ -777,9 +844,9 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
                 ODR_t odRet;
                 OD_subEntry_t subEntry;
 
-                SDO->index = ((uint16_t)SDO->CANrxData[2]) << 8
-                             | SDO->CANrxData[1];
-                SDO->subIndex = SDO->CANrxData[3];
+                SDO->index = ((uint16_t)CANrxData[2]) << 8
+                             | CANrxData[1];
+                SDO->subIndex = CANrxData[3];
                 odRet = OD_getSub(OD_find(SDO->OD, SDO->index), SDO->subIndex,
                                   &subEntry, &SDO->OD_IO, false);
                 if (odRet != ODR_OK) {
@@ -841,7 +908,7 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
         if (SDO->state != CO_SDO_ST_IDLE && SDO->state != CO_SDO_ST_ABORT)
         switch (SDO->state) {
         case CO_SDO_ST_DOWNLOAD_INITIATE_REQ: {
-            if (SDO->CANrxData[0] & 0x02) {
+            if (CANrxData[0] & 0x02) {
                 /* Expedited transfer, max 4 bytes of data */
 
                 /* Size of OD variable (>0 if indicated) */
@@ -849,14 +916,14 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
 
                 /* Get SDO data size (indicated by SDO client or get from OD) */
                 OD_size_t dataSizeToWrite = 4;
-                if (SDO->CANrxData[0] & 0x01)
-                    dataSizeToWrite -= (SDO->CANrxData[0] >> 2) & 0x03;
+                if (CANrxData[0] & 0x01)
+                    dataSizeToWrite -= (CANrxData[0] >> 2) & 0x03;
                 else if (sizeInOd > 0 && sizeInOd < 4)
                     dataSizeToWrite = sizeInOd;
 
                 /* copy data to the temp buffer, swap data if necessary */
                 uint8_t buf[6] = {0};
-                memcpy(buf, &SDO->CANrxData[4], dataSizeToWrite);
+                memcpy(buf, &CANrxData[4], dataSizeToWrite);
 #ifdef CO_BIG_ENDIAN
                 if ((SDO->attribute & ODA_MB) != 0) {
                     reverseBytes(buf, dataSizeToWrite);
@@ -886,9 +953,22 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
                 }
 
                 /* Copy data */
+#if (CO_CONFIG_SDO_SRV) & CO_CONFIG_SDO_SRV_SEGMENTED
+                /* Write through the buffer, OD write function may complete
+                 * the data later, response is sent after writeToOD() */
+                memcpy(SDO->buf, buf, dataSizeToWrite);
+                SDO->bufOffsetWr = dataSizeToWrite;
+                SDO->finished = true;
+                if (!writeToOD(SDO, &abortCode)) {
+                    break;
+                }
+                SDO->state = CO_SDO_ST_DOWNLOAD_INITIATE_RSP;
+#else
                 ODR_t odRet;
+                CO_LOCK_OD(SDO->CANdevTx);
                 SDO->OD_IO.write(&SDO->OD_IO.stream, SDO->subIndex,
                                  buf, dataSizeToWrite, &odRet);
+                CO_UNLOCK_OD(SDO->CANdevTx);
                 if (odRet != ODR_OK) {
                     abortCode = (CO_SDO_abortCode_t)OD_getSDOabCode(odRet);
                     SDO->state = CO_SDO_ST_ABORT;
@@ -896,19 +976,17 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
                 }
                 else {
                     SDO->state = CO_SDO_ST_DOWNLOAD_INITIATE_RSP;
-#if (CO_CONFIG_SDO_SRV) & CO_CONFIG_SDO_SRV_SEGMENTED
-                    SDO->finished = true;
-#endif
                 }
+#endif
             }
             else {
 #if (CO_CONFIG_SDO_SRV) & CO_CONFIG_SDO_SRV_SEGMENTED
                 /* segmented transfer, is size indicated? */
-                if (SDO->CANrxData[0] & 0x01) {
+                if (CANrxData[0] & 0x01) {
                     uint32_t size;
                     OD_size_t sizeInOd = SDO->OD_IO.stream.dataLength;
 
-                    memcpy(&size, &SDO->CANrxData[4], sizeof(size));
+                    memcpy(&size, &CANrxData[4], sizeof(size));
                     SDO->sizeInd = CO_SWAP_32(size);
 
                     /* Indicated size of SDO matches sizeof OD variable? */
@@ -943,11 +1021,11 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
 
 #if (CO_CONFIG_SDO_SRV) & CO_CONFIG_SDO_SRV_SEGMENTED
         case CO_SDO_ST_DOWNLOAD_SEGMENT_REQ: {
-            if ((SDO->CANrxData[0] & 0xE0) == 0x00) {
-                SDO->finished = (SDO->CANrxData[0] & 0x01) != 0;
+            if ((CANrxData[0] & 0xE0) == 0x00) {
+                SDO->finished = (CANrxData[0] & 0x01) != 0;
 
                 /* verify and alternate toggle bit */
-                uint8_t toggle = SDO->CANrxData[0] & 0x10;
+                uint8_t toggle = CANrxData[0] & 0x10;
                 if (toggle != SDO->toggle) {
                     abortCode = CO_SDO_AB_TOGGLE_BIT;
                     SDO->state = CO_SDO_ST_ABORT;
@@ -955,8 +1033,8 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
                 }
 
                 /* get data size and write data to the buffer */
-                OD_size_t count = 7 - ((SDO->CANrxData[0] >> 1) & 0x07);
-                memcpy(SDO->buf + SDO->bufOffsetWr, &SDO->CANrxData[1], count);
+                OD_size_t count = 7 - ((CANrxData[0] >> 1) & 0x07);
+                memcpy(SDO->buf + SDO->bufOffsetWr, &CANrxData[1], count);
                 SDO->bufOffsetWr += count;
                 SDO->sizeTran += count;
 
@@ -994,9 +1072,9 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
 
 #if (CO_CONFIG_SDO_SRV) & CO_CONFIG_SDO_SRV_SEGMENTED
         case CO_SDO_ST_UPLOAD_SEGMENT_REQ: {
-            if ((SDO->CANrxData[0] & 0xEF) == 0x60) {
+            if ((CANrxData[0] & 0xEF) == 0x60) {
                 /* verify and alternate toggle bit */
-                uint8_t toggle = SDO->CANrxData[0] & 0x10;
+                uint8_t toggle = CANrxData[0] & 0x10;
                 if (toggle != SDO->toggle) {
                     abortCode = CO_SDO_AB_TOGGLE_BIT;
                     SDO->state = CO_SDO_ST_ABORT;
@@ -1014,14 +1092,14 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
 
 #if (CO_CONFIG_SDO_SRV) & CO_CONFIG_SDO_SRV_BLOCK
         case CO_SDO_ST_DOWNLOAD_BLK_INITIATE_REQ: {
-            SDO->block_crcEnabled = (SDO->CANrxData[0] & 0x04) != 0;
+            SDO->block_crcEnabled = (CANrxData[0] & 0x04) != 0;
 
             /* is size indicated? */
-            if ((SDO->CANrxData[0] & 0x02) != 0) {
+            if ((CANrxData[0] & 0x02) != 0) {
                 uint32_t size;
                 OD_size_t sizeInOd = SDO->OD_IO.stream.dataLength;
 
-                memcpy(&size, &SDO->CANrxData[4], sizeof(size));
+                memcpy(&size, &CANrxData[4], sizeof(size));
                 SDO->sizeInd = CO_SWAP_32(size);
 
                 /* Indicated size of SDO matches sizeof OD variable? */
@@ -1055,10 +1133,10 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
         }
 
         case CO_SDO_ST_DOWNLOAD_BLK_END_REQ: {
-            if ((SDO->CANrxData[0] & 0xE3) == 0xC1) {
+            if ((CANrxData[0] & 0xE3) == 0xC1) {
                 /* Get number of data bytes in last segment, that do not
                     * contain data. Then reduce buffer. */
-                uint8_t noData = ((SDO->CANrxData[0] >> 2) & 0x07);
+                uint8_t noData = ((CANrxData[0] >> 2) & 0x07);
                 if (SDO->bufOffsetWr <= noData) {
                     /* just in case, should never happen */
                     abortCode = CO_SDO_AB_DEVICE_INCOMPAT;
@@ -1070,8 +1148,8 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
 
                 uint16_t crcClient = 0;
                 if (SDO->block_crcEnabled) {
-                    crcClient = ((uint16_t) SDO->CANrxData[2]) << 8;
-                    crcClient |= SDO->CANrxData[1];
+                    crcClient = ((uint16_t) CANrxData[2]) << 8;
+                    crcClient |= CANrxData[1];
                 }
 
                 if (!validateAndWriteToOD(SDO, &abortCode, 2, crcClient))
@@ -1089,14 +1167,14 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
         case CO_SDO_ST_UPLOAD_BLK_INITIATE_REQ: {
             /* if pst (protocol switch threshold, byte5) is larger than data
              * size of OD variable, then switch to segmented transfer */
-            if (SDO->sizeInd > 0 && SDO->CANrxData[5] > 0
-                && SDO->CANrxData[5] >= SDO->sizeInd)
+            if (SDO->sizeInd > 0 && CANrxData[5] > 0
+                && CANrxData[5] >= SDO->sizeInd)
             {
                 SDO->state = CO_SDO_ST_UPLOAD_INITIATE_RSP;
             }
             else {
                 /* data were already loaded from OD variable, verify crc */
-                if ((SDO->CANrxData[0] & 0x04) != 0) {
+                if ((CANrxData[0] & 0x04) != 0) {
                     SDO->block_crcEnabled = true;
                     SDO->block_crc = crc16_ccitt((unsigned char *)SDO->buf,
                                                  SDO->bufOffsetWr,
@@ -1107,7 +1185,7 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
                 }
 
                 /* get blksize and verify it */
-                SDO->block_blksize = SDO->CANrxData[4];
+                SDO->block_blksize = CANrxData[4];
                 if (SDO->block_blksize < 1 || SDO->block_blksize > 127) {
                     SDO->block_blksize = 127;
                 }
@@ -1123,7 +1201,7 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
         }
 
         case CO_SDO_ST_UPLOAD_BLK_INITIATE_REQ2: {
-            if (SDO->CANrxData[0] == 0xA3) {
+            if (CANrxData[0] == 0xA3) {
                 SDO->block_seqno = 0;
                 SDO->state = CO_SDO_ST_UPLOAD_BLK_SUBBLOCK_SREQ;
             }
@@ -1136,22 +1214,22 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
 
         case CO_SDO_ST_UPLOAD_BLK_SUBBLOCK_SREQ:
         case CO_SDO_ST_UPLOAD_BLK_SUBBLOCK_CRSP: {
-            if (SDO->CANrxData[0] == 0xA2) {
-                SDO->block_blksize = SDO->CANrxData[2];
+            if (CANrxData[0] == 0xA2) {
+                SDO->block_blksize = CANrxData[2];
                 if (SDO->block_blksize < 1 || SDO->block_blksize > 127) {
                     SDO->block_blksize = 127;
                 }
 
                 /* check number of segments */
-                if (SDO->CANrxData[1] < SDO->block_seqno) {
+                if (CANrxData[1] < SDO->block_seqno) {
                     /* NOT all segments transferred successfully.
                      * Re-transmit data after erroneous segment. */
-                    OD_size_t cntFailed = SDO->block_seqno - SDO->CANrxData[1];
+                    OD_size_t cntFailed = SDO->block_seqno - CANrxData[1];
                     cntFailed = cntFailed * 7 - SDO->block_noData;
                     SDO->bufOffsetRd -= cntFailed;
                     SDO->sizeTran -= cntFailed;
                 }
-                else if (SDO->CANrxData[1] > SDO->block_seqno) {
+                else if (CANrxData[1] > SDO->block_seqno) {
                     /* something strange from server, break transmission */
                     abortCode = CO_SDO_AB_CMD;
                     SDO->state = CO_SDO_ST_ABORT;
@@ -1187,7 +1265,13 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
         } /* switch (SDO->state) */
         SDO->timeoutTimer = 0;
         timeDifference_us = 0;
-        CO_FLAG_CLEAR(SDO->CANrxNew);
+        CO_rxQueue_drop(&SDO->CANrxQueue);
+#if (CO_CONFIG_SDO_SRV) & CO_CONFIG_FLAG_TIMERNEXT
+        /* more messages were received in a burst, process them next */
+        if (CO_rxQueue_isNew(&SDO->CANrxQueue) && timerNext_us != NULL) {
+            *timerNext_us = 0;
+        }
+#endif
     } /* if (isNew) */
 
     /* Timeout timers *********************************************************/
@@ -1218,9 +1302,9 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
             }
             if (SDO->block_timeoutTimer >= SDO->block_SDOtimeoutTime_us) {
                 /* SDO->state will change, processing will continue in this
-                 * thread. Make memory barrier here with CO_FLAG_CLEAR() call.*/
+                 * thread. Make memory barrier here with CO_rxQueue_clear(). */
                 SDO->state = CO_SDO_ST_DOWNLOAD_BLK_SUBBLOCK_RSP;
-                CO_FLAG_CLEAR(SDO->CANrxNew);
+                CO_rxQueue_clear(&SDO->CANrxQueue);
             }
 #if (CO_CONFIG_SDO_SRV) & CO_CONFIG_FLAG_TIMERNEXT
             else if (timerNext_us != NULL) {
@@ -1241,8 +1325,30 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
     }
 #endif /* (CO_CONFIG_SDO_SRV) & CO_CONFIG_SDO_SRV_SEGMENTED */
 
+#if (CO_CONFIG_SDO_SRV) & CO_CONFIG_SDO_SRV_SEGMENTED
+    /* Pending write to OD must finish before the response *******************/
+    if (ret == CO_SDO_RT_waitingResponse && SDO->writePending) {
+        if (SDO->state == CO_SDO_ST_ABORT) {
+            SDO->writePending = false;
+        }
+        else if (writeToOD(SDO, &abortCode) && SDO->writePending) {
+#if (CO_CONFIG_SDO_SRV) & CO_CONFIG_FLAG_TIMERNEXT
+            if (timerNext_us != NULL
+                && *timerNext_us > CO_CONFIG_SDO_SRV_WRITE_POLL_US
+            ) {
+                *timerNext_us = CO_CONFIG_SDO_SRV_WRITE_POLL_US;
+            }
+#endif
+        }
+    }
+#endif
+
     /* Transmit CAN data ******************************************************/
+#if (CO_CONFIG_SDO_SRV) & CO_CONFIG_SDO_SRV_SEGMENTED
+    if (ret == CO_SDO_RT_waitingResponse && !SDO->writePending) {
+#else
     if (ret == CO_SDO_RT_waitingResponse) {
+#endif
         /* clear response buffer */
         memset(SDO->CANtxBuff->data, 0, sizeof(SDO->CANtxBuff->data));
 
@@ -1325,9 +1431,11 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
 #else /* Expedited transfer only */
             /* load data from OD variable */
             ODR_t odRet;
+            CO_LOCK_OD(SDO->CANdevTx);
             OD_size_t count = SDO->OD_IO.read(&SDO->OD_IO.stream, SDO->subIndex,
                                               &SDO->CANtxBuff->data[4], 4,
                                               &odRet);
+            CO_UNLOCK_OD(SDO->CANdevTx);
 
             /* strings are allowed to be shorter */
             if (odRet == ODR_PARTIAL && (SDO->attribute & ODA_STR) != 0) {
@@ -1439,9 +1547,9 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
             SDO->block_timeoutTimer = 0;
 
             /* Block segments will be received in different thread. Make memory
-             * barrier here with CO_FLAG_CLEAR() call. */
+             * barrier here with CO_rxQueue_clear() call. */
             SDO->state = CO_SDO_ST_DOWNLOAD_BLK_SUBBLOCK_REQ;
-            CO_FLAG_CLEAR(SDO->CANrxNew);
+            CO_rxQueue_clear(&SDO->CANrxQueue);
             CO_CANsend(SDO->CANdevTx, SDO->CANtxBuff);
             break;
         }
@@ -1466,9 +1574,13 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
                     count = 127;
                 }
                 else if (SDO->bufOffsetWr > 0) {
-                    /* it is necessary to empty the buffer */
-                    if (!validateAndWriteToOD(SDO, &abortCode, 1, 0))
+                    /* it is necessary to empty the buffer, respond after
+                     * pending write finishes */
+                    if (!validateAndWriteToOD(SDO, &abortCode, 1, 0)
+                        || SDO->writePending
+                    ) {
                         break;
+                    }
 
                     count =(CO_CONFIG_SDO_SRV_BUFFER_SIZE-2-SDO->bufOffsetWr)/7;
                     if (count >= 127) {
@@ -1479,9 +1591,9 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
                 SDO->block_blksize = (uint8_t)count;
                 SDO->block_seqno = 0;
                 /* Block segments will be received in different thread. Make
-                 * memory barrier here with CO_FLAG_CLEAR() call. */
+                 * memory barrier here with CO_rxQueue_clear() call. */
                 SDO->state = CO_SDO_ST_DOWNLOAD_BLK_SUBBLOCK_REQ;
-                CO_FLAG_CLEAR(SDO->CANrxNew);
+                CO_rxQueue_clear(&SDO->CANrxQueue);
             }
 
             SDO->CANtxBuff->data[2] = SDO->block_blksize;
@@ -1617,6 +1729,11 @@ CO_SDO_return_t CO_SDOserver_process(CO_SDOserver_t *SDO,
             CO_CANsend(SDO->CANdevTx, SDO->CANtxBuff);
             SDO->state = CO_SDO_ST_IDLE;
             ret = CO_SDO_RT_endedWithServerAbort;
+#if (CO_CONFIG_SDO_SRV) & CO_CONFIG_SDO_SRV_SEGMENTED
+            if (SDO->writeOpen) {
+                abortWriteToOD(SDO);
+            }
+#endif
         }
 #if (CO_CONFIG_SDO_SRV) & CO_CONFIG_SDO_SRV_BLOCK
         else if (SDO->state == CO_SDO_ST_DOWNLOAD_BLK_SUBBLOCK_REQ) {
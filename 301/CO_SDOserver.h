@@ -27,6 +27,7 @@
 #define CO_SDO_SERVER_H
 
 #include "301/CO_driver.h"
+#include "301/CO_rxQueue.h"
 #include "301/CO_ODinterface.h"
 
 /* default configuration, see CO_config.h */
@@ -36,6 +37,9 @@
 #ifndef CO_CONFIG_SDO_SRV_BUFFER_SIZE
 #define CO_CONFIG_SDO_SRV_BUFFER_SIZE 32
 #endif
+#ifndef CO_CONFIG_SDO_SRV_WRITE_POLL_US
+#define CO_CONFIG_SDO_SRV_WRITE_POLL_US 1000
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -457,11 +461,11 @@ typedef struct {
     uint8_t subIndex;
     /** Attribute bit-field of the current OD sub-object, see OD_attributes_t */
     OD_attr_t attribute;
-    /** Indicates, if new SDO message received from CAN bus. It is not cleared,
-     * until received message is completely processed. */
-    volatile void *CANrxNew;
-    /** 8 data bytes of the received message */
-    uint8_t CANrxData[8];
+    /** Queue of SDO messages received from CAN bus. Message is not dropped,
+     * until it is completely processed. */
+    CO_rxQueue_t CANrxQueue;
+    /** 8 data bytes of the received messages, indexed by CANrxQueue */
+    uint8_t CANrxData[CO_CONFIG_RX_QUEUE_SIZE][8];
 #if ((CO_CONFIG_SDO_SRV) & CO_CONFIG_FLAG_OD_DYNAMIC) || defined CO_DOXYGEN
     /** From CO_SDOserver_init() */
     CO_CANmodule_t *CANdevRx;
@@ -498,6 +502,12 @@ typedef struct {
     OD_size_t bufOffsetWr;
     /** Offset of first data available for read in the buffer */
     OD_size_t bufOffsetRd;
+    /** If true, OD write function has not accepted all data yet or is still
+     * completing the last data. Response is sent after write finishes. */
+    bool_t writePending;
+    /** If true, OD write function has accepted part of the download and
+     * expects more data. It is informed, if download is aborted. */
+    bool_t writeOpen;
 #endif
 #if ((CO_CONFIG_SDO_SRV) & CO_CONFIG_SDO_SRV_BLOCK) || defined CO_DOXYGEN
     /** Timeout time for SDO sub-block download, half of #SDOtimeoutTime_us */
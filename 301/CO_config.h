@@ -98,6 +98,22 @@ extern "C" {
  * This flag is common to multiple configuration macros.
  */
 #define CO_CONFIG_FLAG_OD_DYNAMIC 0x4000
+
+/**
+ * Size of receive queues
+ *
+ * SDO server, SDO client, NMT, Heartbeat consumer (each monitored node) and LSS
+ * master keep received messages in @ref CO_CANopen_301_rxQueue until they are
+ * processed. Messages received in a burst are then processed in order, instead
+ * of being ignored. Value must be power of 2, from 1 to 128. Each element takes
+ * 8 bytes in SDO and LSS objects and 1 byte in NMT and Heartbeat consumer.
+ *
+ * Value 1 is single buffer for tiny targets, as in previous versions: message
+ * is ignored, if previous message was not processed yet.
+ */
+#ifdef CO_DOXYGEN
+#define CO_CONFIG_RX_QUEUE_SIZE 4
+#endif
 /** @} */ /* CO_STACK_CONFIG_COMMON */
 
 
@@ -342,6 +358,17 @@ extern "C" {
 #define CO_CONFIG_SDO_SRV_BUFFER_SIZE 32
 #endif
 
+/**
+ * Interval in microseconds, in which SDO server calls OD write function again,
+ * if write is pending.
+ *
+ * Used with #CO_CONFIG_FLAG_TIMERNEXT. OD write function may accept data only
+ * partially or complete the last data asynchronously, see @ref OD_IO_t.
+ */
+#ifdef CO_DOXYGEN
+#define CO_CONFIG_SDO_SRV_WRITE_POLL_US 1000
+#endif
+
 /**
  * Configuration of @ref CO_SDOclient
  *
@@ -354,6 +381,8 @@ extern "C" {
  * - CO_CONFIG_SDO_CLI_LOCAL - Enable local transfer, if Node-ID of the SDO
  *   server is the same as node-ID of the SDO client. (SDO client is the same
  *   device as SDO server.) Transfer data directly without communication on CAN.
+ *   Also enables CO_SDOclientUploadLocal() and CO_SDOclientDownloadLocal(),
+ *   which transfer data in a single call.
  * - #CO_CONFIG_FLAG_CALLBACK_PRE - Enable custom callback after preprocessing
  *   received SDO CAN message.
  *   Callback is configured by CO_SDOclient_initCallbackPre().
@@ -492,6 +521,9 @@ extern "C" {
  * - CO_CONFIG_GFC_ENABLE - Enable the GFC object
  * - CO_CONFIG_GFC_CONSUMER - Enable the GFC consumer
  * - CO_CONFIG_GFC_PRODUCER - Enable the GFC producer
+ * - CO_CONFIG_GFC_TIMING - Record time from GFC reception by the driver to
+ *   the return of the safe state callback, see @ref CO_safetyTiming.
+ *   CO_timestamp_us() must be defined by the target.
  */
 #ifdef CO_DOXYGEN
 #define CO_CONFIG_GFC (0)
@@ -499,6 +531,7 @@ extern "C" {
 #define CO_CONFIG_GFC_ENABLE 0x01
 #define CO_CONFIG_GFC_CONSUMER 0x02
 #define CO_CONFIG_GFC_PRODUCER 0x04
+#define CO_CONFIG_GFC_TIMING 0x08
 
 /**
  * Configuration of @ref CO_SRDO
@@ -508,13 +541,22 @@ extern "C" {
  * - CO_CONFIG_SRDO_CHECK_TX - Enable checking data before sending.
  * - CO_CONFIG_RSRDO_CALLS_EXTENSION - Enable calling configured extension
  *   callbacks when received RSRDO CAN message modifies OD entries.
- * - CO_CONFIG_TRSRDO_CALLS_EXTENSION - Enable calling configured extension
+ * - CO_CONFIG_TSRDO_CALLS_EXTENSION - Enable calling configured extension
  *   callbacks before TSRDO CAN message is sent.
  * - #CO_CONFIG_FLAG_CALLBACK_PRE - Enable custom callback after preprocessing
  *   received RSRDO CAN message.
  *   Callback is configured by CO_SRDO_initCallbackPre().
  * - #CO_CONFIG_FLAG_TIMERNEXT - Enable calculation of timerNext_us variable
  *   inside CO_SRDO_process() (Tx SRDO only).
+ * - CO_CONFIG_SRDO_PROCESS_TIME - Measure execution time of CO_SRDO_process()
+ *   and keep the worst case. CO_timestamp_us() must be defined by the target.
+ * - CO_CONFIG_SRDO_TIMING - Record reception, pair and check times of Rx SRDO,
+ *   measured from reception by the driver, see @ref CO_safetyTiming.
+ *   CO_timestamp_us() must be defined by the target.
+ * - CO_CONFIG_SRDO_SAFE_RX - Check received SRDO pair already inside CAN
+ *   receive function and call callback, configured by
+ *   CO_SRDO_initCallbackSafeRx(), from there. CO_timestamp_us() must be defined
+ *   by the target.
  */
 #ifdef CO_DOXYGEN
 #define CO_CONFIG_SRDO (0)
@@ -523,6 +565,9 @@ extern "C" {
 #define CO_CONFIG_SRDO_CHECK_TX 0x02
 #define CO_CONFIG_RSRDO_CALLS_EXTENSION 0x04
 #define CO_CONFIG_TSRDO_CALLS_EXTENSION 0x08
+#define CO_CONFIG_SRDO_PROCESS_TIME 0x10
+#define CO_CONFIG_SRDO_TIMING 0x20
+#define CO_CONFIG_SRDO_SAFE_RX 0x40
 
 /**
  * SRDO Tx time delay
@@ -533,6 +578,16 @@ extern "C" {
 #ifdef CO_DOXYGEN
 #define CO_CONFIG_SRDO_MINIMUM_DELAY 0
 #endif
+
+/**
+ * Time budget for the callback from CO_SRDO_initCallbackSafeRx() in us
+ *
+ * Longer execution is counted and reported as emergency, see
+ * CO_CONFIG_SRDO_SAFE_RX.
+ */
+#ifdef CO_DOXYGEN
+#define CO_CONFIG_SRDO_SAFE_RX_BUDGET_US 20
+#endif
 /** @} */ /* CO_STACK_CONFIG_SRDO */
 
 
@@ -609,7 +664,9 @@ extern "C" {
  *
  * If SDO clint has block download in progress and OS has buffer for CAN tx
  * messages, then #CO_SDOclientDownload() functionion can be called multiple
- * times within own loop (up to 127). This can speed-up SDO block transfer.
+ * times within own loop (up to 127). #CO_SDOclientDownload() already sends the
+ * whole sub-block in one call, until driver's transmit queue is full, so value
+ * 1 is sufficient for most drivers.
  */
 #ifdef CO_DOXYGEN
 #define CO_CONFIG_GTW_BLOCK_DL_LOOP 1
@@ -701,17 +758,47 @@ extern "C" {
  *
  * Possible flags, can be ORed:
  * - CO_CONFIG_TRACE_ENABLE - Enable Trace recorder
- * - CO_CONFIG_TRACE_OWN_INTTYPES - If set, then macros PRIu32("u" or "lu")
- *   and PRId32("d" or "ld") must be set. (File inttypes.h can not be included).
  */
 #ifdef CO_DOXYGEN
 #define CO_CONFIG_TRACE (0)
 #endif
 #define CO_CONFIG_TRACE_ENABLE 0x01
-#define CO_CONFIG_TRACE_OWN_INTTYPES 0x02
+
+/**
+ * Size of the recording buffer for each trace object in bytes.
+ *
+ * Buffer is divided into blocks of CO_TRACE_BLOCK_SIZE (256) bytes, at least
+ * two blocks are required.
+ */
+#ifdef CO_DOXYGEN
+#define CO_CONFIG_TRACE_BUFFER_SIZE 4096
+#endif
 /** @} */ /* CO_STACK_CONFIG_TRACE */
 
 
+/**
+ * @defgroup CO_STACK_CONFIG_MBX Process data mailboxes
+ * Non standard object
+ * @{
+ */
+/**
+ * Configuration of @ref CO_mailbox for exchange of process data between
+ * application threads and CANopen realtime processing.
+ *
+ * Possible flags, can be ORed:
+ * - CO_CONFIG_MBX_ENABLE - Enable lock-free queues, triple buffers and
+ *   mailboxes on Object Dictionary variables.
+ * - CO_CONFIG_MBX_PROCESS_IMAGE - Enable PLC style process image, see
+ *   @ref CO_processImage. Requires CO_CONFIG_MBX_ENABLE.
+ */
+#ifdef CO_DOXYGEN
+#define CO_CONFIG_MBX (0)
+#endif
+#define CO_CONFIG_MBX_ENABLE 0x01
+#define CO_CONFIG_MBX_PROCESS_IMAGE 0x02
+/** @} */ /* CO_STACK_CONFIG_MBX */
+
+
 /**
  * @defgroup CO_STACK_CONFIG_DEBUG Debug messages
  * Messages from different parts of the stack.
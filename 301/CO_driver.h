@@ -29,6 +29,47 @@
 #include <string.h>
 
 #include "CO_config.h"
+
+/**
+ * Return values of some CANopen functions. If function was executed
+ * successfully it returns 0 otherwise it returns <0.
+ *
+ * Defined before CO_driver_target.h is included, so target specific
+ * functions may also use it.
+ *
+ * @ingroup CO_driver
+ */
+typedef enum {
+    CO_ERROR_NO = 0,                /**< Operation completed successfully */
+    CO_ERROR_ILLEGAL_ARGUMENT = -1, /**< Error in function arguments */
+    CO_ERROR_OUT_OF_MEMORY = -2,    /**< Memory allocation failed */
+    CO_ERROR_TIMEOUT = -3,          /**< Function timeout */
+    CO_ERROR_ILLEGAL_BAUDRATE = -4, /**< Illegal baudrate passed to function
+                                         CO_CANmodule_init() */
+    CO_ERROR_RX_OVERFLOW = -5,      /**< Previous message was not processed
+                                         yet */
+    CO_ERROR_RX_PDO_OVERFLOW = -6,  /**< previous PDO was not processed yet */
+    CO_ERROR_RX_MSG_LENGTH = -7,    /**< Wrong receive message length */
+    CO_ERROR_RX_PDO_LENGTH = -8,    /**< Wrong receive PDO length */
+    CO_ERROR_TX_OVERFLOW = -9,      /**< Previous message is still waiting,
+                                         buffer full */
+    CO_ERROR_TX_PDO_WINDOW = -10,   /**< Synchronous TPDO is outside window */
+    CO_ERROR_TX_UNCONFIGURED = -11, /**< Transmit buffer was not configured
+                                         properly */
+    CO_ERROR_OD_PARAMETERS = -12,   /**< Error in Object Dictionary parameters*/
+    CO_ERROR_DATA_CORRUPT = -13,    /**< Stored data are corrupt */
+    CO_ERROR_CRC = -14,             /**< CRC does not match */
+    CO_ERROR_TX_BUSY = -15,         /**< Sending rejected because driver is
+                                         busy. Try again */
+    CO_ERROR_WRONG_NMT_STATE = -16, /**< Command can't be processed in current
+                                         state */
+    CO_ERROR_SYSCALL = -17,         /**< Syscall failed */
+    CO_ERROR_INVALID_STATE = -18,   /**< Driver not ready */
+    CO_ERROR_NODE_ID_UNCONFIGURED_LSS = -19 /**< Node-id is in LSS unconfigured
+                                         state. If objects are handled properly,
+                                         this may not be an error. */
+} CO_ReturnError_t;
+
 #include "CO_driver_target.h"
 
 #ifdef __cplusplus
@@ -366,7 +407,17 @@ typedef struct {
  * mainline. Mainline thread must protect sections, which accesses the same OD
  * variables as timer thread. This care must also take the application. Note
  * that not all variables are allowed to be mapped to PDOs, so they may not need
- * to be protected. SDO server protects sections with access to OD variables.
+ * to be protected. SDO server and SDO client protect sections with access to
+ * OD variables, including calls to IO extensions. @ref OD_readOriginal() and
+ * @ref OD_writeOriginal() do not lock, application can use
+ * @ref OD_get_valueLocked() and @ref OD_set_valueLocked().
+ *
+ * #### Multiple CANopen networks
+ * Each macro takes CAN_MODULE argument, pointer to @ref CO_CANmodule_t of the
+ * CANopen instance. Target may keep locking objects inside CAN module, so
+ * multiple independent CANopenNode instances in the same program don't share
+ * any lock. Target may also ignore the argument and use global locks. Driver
+ * ports with macros without argument must be updated.
  *
  * #### Synchronization functions for CAN receive
  * After CAN message is received, it is pre-processed in CANrx_callback(), which
@@ -385,17 +436,17 @@ typedef struct {
  */
 
 /** Lock critical section in CO_CANsend() */
-#define CO_LOCK_CAN_SEND()
+#define CO_LOCK_CAN_SEND(CAN_MODULE)
 /** Unlock critical section in CO_CANsend() */
-#define CO_UNLOCK_CAN_SEND()
+#define CO_UNLOCK_CAN_SEND(CAN_MODULE)
 /** Lock critical section in CO_errorReport() or CO_errorReset() */
-#define CO_LOCK_EMCY()
+#define CO_LOCK_EMCY(CAN_MODULE)
 /** Unlock critical section in CO_errorReport() or CO_errorReset() */
-#define CO_UNLOCK_EMCY()
+#define CO_UNLOCK_EMCY(CAN_MODULE)
 /** Lock critical section when accessing Object Dictionary */
-#define CO_LOCK_OD()
+#define CO_LOCK_OD(CAN_MODULE)
 /** Unock critical section when accessing Object Dictionary */
-#define CO_UNLOCK_OD()
+#define CO_UNLOCK_OD(CAN_MODULE)
 
 /** Check if new message has arrived */
 #define CO_FLAG_READ(rxNew) ((rxNew) != NULL)
@@ -403,6 +454,14 @@ typedef struct {
 #define CO_FLAG_SET(rxNew) { __sync_synchronize(); rxNew = (void *)1L; }
 /** Clear new message flag */
 #define CO_FLAG_CLEAR(rxNew) { __sync_synchronize(); rxNew = NULL; }
+/** Full memory barrier, used by @ref CO_CANopen_301_rxQueue and other
+ * lock-free structures */
+#define CO_MemoryBarrier() { __sync_synchronize(); }
+
+/** Free running time stamp in microseconds, type uint32_t, may overflow. It is
+ * optional, used for measurement of execution times, for example with
+ * #CO_CONFIG_SRDO_PROCESS_TIME. */
+#define CO_timestamp_us() 0
 
 /** @} */
 #endif /* CO_DOXYGEN */
@@ -426,6 +485,22 @@ typedef struct {
 #endif
 
 
+/**
+ * CANrx_callback() can read reception time of the CAN message
+ *
+ * Time is in the same units as CO_timestamp_us(). It is used for measurement
+ * of reaction times, for example with #CO_CONFIG_GFC_TIMING. CO_driver_target.h
+ * may implement this macro with the time, when CAN message was received by the
+ * driver. By default it returns CO_timestamp_us(), the time of the call.
+ *
+ * @param rxMsg Pointer to received message
+ * @return Reception time in microseconds, type uint32_t, may overflow.
+ */
+#ifndef CO_CANrxMsg_readTimestamp_us
+#define CO_CANrxMsg_readTimestamp_us(rxMsg) CO_timestamp_us()
+#endif
+
+
 /**
  * Default CANopen identifiers.
  *
@@ -481,42 +556,6 @@ typedef enum {
 } CO_CAN_ERR_status_t;
 
 
-/**
- * Return values of some CANopen functions. If function was executed
- * successfully it returns 0 otherwise it returns <0.
- */
-typedef enum {
-    CO_ERROR_NO = 0,                /**< Operation completed successfully */
-    CO_ERROR_ILLEGAL_ARGUMENT = -1, /**< Error in function arguments */
-    CO_ERROR_OUT_OF_MEMORY = -2,    /**< Memory allocation failed */
-    CO_ERROR_TIMEOUT = -3,          /**< Function timeout */
-    CO_ERROR_ILLEGAL_BAUDRATE = -4, /**< Illegal baudrate passed to function
-                                         CO_CANmodule_init() */
-    CO_ERROR_RX_OVERFLOW = -5,      /**< Previous message was not processed
-                                         yet */
-    CO_ERROR_RX_PDO_OVERFLOW = -6,  /**< previous PDO was not processed yet */
-    CO_ERROR_RX_MSG_LENGTH = -7,    /**< Wrong receive message length */
-    CO_ERROR_RX_PDO_LENGTH = -8,    /**< Wrong receive PDO length */
-    CO_ERROR_TX_OVERFLOW = -9,      /**< Previous message is still waiting,
-                                         buffer full */
-    CO_ERROR_TX_PDO_WINDOW = -10,   /**< Synchronous TPDO is outside window */
-    CO_ERROR_TX_UNCONFIGURED = -11, /**< Transmit buffer was not configured
-                                         properly */
-    CO_ERROR_OD_PARAMETERS = -12,   /**< Error in Object Dictionary parameters*/
-    CO_ERROR_DATA_CORRUPT = -13,    /**< Stored data are corrupt */
-    CO_ERROR_CRC = -14,             /**< CRC does not match */
-    CO_ERROR_TX_BUSY = -15,         /**< Sending rejected because driver is
-                                         busy. Try again */
-    CO_ERROR_WRONG_NMT_STATE = -16, /**< Command can't be processed in current
-                                         state */
-    CO_ERROR_SYSCALL = -17,         /**< Syscall failed */
-    CO_ERROR_INVALID_STATE = -18,   /**< Driver not ready */
-    CO_ERROR_NODE_ID_UNCONFIGURED_LSS = -19 /**< Node-id is in LSS unconfigured
-                                         state. If objects are handled properly,
-                                         this may not be an error. */
-} CO_ReturnError_t;
-
-
 /**
  * Request CAN configuration (stopped) mode and *wait* until it is set.
  *
@@ -637,12 +676,29 @@ CO_CANtx_t *CO_CANtxBufferInit(CO_CANmodule_t *CANmodule,
  * @param buffer Pointer to transmit buffer, returned by CO_CANtxBufferInit().
  * Data bytes must be written in buffer before function call.
  *
- * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_TX_OVERFLOW or
- * CO_ERROR_TX_PDO_WINDOW (Synchronous TPDO is outside window).
+ * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_TX_OVERFLOW,
+ * CO_ERROR_TX_PDO_WINDOW (Synchronous TPDO is outside window) or
+ * CO_ERROR_TX_BUSY (driver's transmit queue is temporarily full, message was
+ * not sent and may be sent again later, not used by all drivers).
  */
 CO_ReturnError_t CO_CANsend(CO_CANmodule_t *CANmodule, CO_CANtx_t *buffer);
 
 
+/**
+ * Macro, which informs driver, that caller handles CO_ERROR_TX_BUSY.
+ *
+ * If driver's transmit queue is full, CO_CANsend() normally reports the lost
+ * message (CO_CAN_ERRTX_OVERFLOW, CO_ERROR_TX_OVERFLOW). If _retry_ is true
+ * for the buffer, driver returns CO_ERROR_TX_BUSY without reporting the error
+ * and caller must send the same message again later. Used by SDO client in
+ * block download. CO_driver_target.h may implement this macro, by default it
+ * does nothing.
+ */
+#ifndef CO_CANtxBuffer_busyRetry
+#define CO_CANtxBuffer_busyRetry(buffer, retry)
+#endif
+
+
 /**
  * Clear all synchronous TPDOs from CAN module transmit buffers.
  *
@@ -0,0 +1,180 @@
+/**
+ * Receive queue between CAN receive function and processing function
+ *
+ * @file        CO_rxQueue.h
+ * @ingroup     CO_CANopen_301_rxQueue
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CO_RX_QUEUE_H
+#define CO_RX_QUEUE_H
+
+#include "301/CO_driver.h"
+
+/* default configuration, see CO_config.h */
+#ifndef CO_CONFIG_RX_QUEUE_SIZE
+#define CO_CONFIG_RX_QUEUE_SIZE 4
+#endif
+
+#if CO_CONFIG_RX_QUEUE_SIZE < 1 || CO_CONFIG_RX_QUEUE_SIZE > 128 \
+    || (CO_CONFIG_RX_QUEUE_SIZE & (CO_CONFIG_RX_QUEUE_SIZE - 1)) != 0
+#error CO_CONFIG_RX_QUEUE_SIZE must be power of 2, from 1 to 128.
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup CO_CANopen_301_rxQueue Receive queue
+ * @ingroup CO_CANopen_301
+ * @{
+ *
+ * Bounded single producer - single consumer queue of received messages.
+ *
+ * Producer is CAN receive function of the object, consumer is its processing
+ * function. Queue holds only indexes, elements (for example 8 data bytes of
+ * the CAN message) are stored by the object in array of
+ * @ref CO_CONFIG_RX_QUEUE_SIZE elements. Producer writes the element at index
+ * from CO_rxQueue_pushIndex() and publishes it with CO_rxQueue_push().
+ * Consumer processes the element at index from CO_rxQueue_peekIndex() and
+ * releases it with CO_rxQueue_drop(). If queue is full, received message is
+ * discarded and counted in _overflow_.
+ *
+ * Queue is lock-free, it depends only on @ref CO_MemoryBarrier(). With
+ * @ref CO_CONFIG_RX_QUEUE_SIZE equal to 1 it behaves as the single buffer
+ * with "new message" flag: message is ignored, if previous message was not
+ * processed yet.
+ */
+
+/**
+ * Receive queue object
+ */
+typedef struct {
+    /** Free running counter of pushed elements, only producer writes */
+    volatile uint8_t head;
+    /** Free running counter of dropped elements, only consumer writes */
+    volatile uint8_t tail;
+    /** Number of discarded messages, only producer writes */
+    volatile uint16_t overflow;
+} CO_rxQueue_t;
+
+
+/**
+ * Initialize queue, called before CAN receive is configured
+ *
+ * @param q This object will be initialized.
+ */
+static inline void CO_rxQueue_init(CO_rxQueue_t *q) {
+    q->head = 0;
+    q->tail = 0;
+    q->overflow = 0;
+}
+
+/**
+ * Get index of free element. Called only by producer.
+ *
+ * @param q This object
+ *
+ * @return Index of element, which may be written, or -1, if queue is full.
+ * Full queue increments _overflow_.
+ */
+static inline int16_t CO_rxQueue_pushIndex(CO_rxQueue_t *q) {
+    uint8_t head = q->head;
+
+    if ((uint8_t)(head - q->tail) >= CO_CONFIG_RX_QUEUE_SIZE) {
+        q->overflow++;
+        return -1;
+    }
+    return (int16_t)(head & (CO_CONFIG_RX_QUEUE_SIZE - 1));
+}
+
+/**
+ * Publish element, written at index from CO_rxQueue_pushIndex(). Called only
+ * by producer.
+ *
+ * @param q This object
+ */
+static inline void CO_rxQueue_push(CO_rxQueue_t *q) {
+    CO_MemoryBarrier();
+    q->head = (uint8_t)(q->head + 1);
+}
+
+/**
+ * Get index of the oldest element. Called only by consumer.
+ *
+ * Element stays valid until CO_rxQueue_drop() or CO_rxQueue_clear().
+ *
+ * @param q This object
+ *
+ * @return Index of element or -1, if queue is empty.
+ */
+static inline int16_t CO_rxQueue_peekIndex(CO_rxQueue_t *q) {
+    uint8_t tail = q->tail;
+
+    if (tail == q->head) return -1;
+    CO_MemoryBarrier();
+    return (int16_t)(tail & (CO_CONFIG_RX_QUEUE_SIZE - 1));
+}
+
+/**
+ * Remove the oldest element. Called only by consumer.
+ *
+ * @param q This object
+ */
+static inline void CO_rxQueue_drop(CO_rxQueue_t *q) {
+    uint8_t tail = q->tail;
+
+    if (tail == q->head) return;
+    CO_MemoryBarrier();
+    q->tail = (uint8_t)(tail + 1);
+}
+
+/**
+ * Remove all elements. Called only by consumer.
+ *
+ * Function also makes memory barrier, so it can be used, when processing
+ * hands the object to the CAN receive function.
+ *
+ * @param q This object
+ */
+static inline void CO_rxQueue_clear(CO_rxQueue_t *q) {
+    CO_MemoryBarrier();
+    q->tail = q->head;
+}
+
+/**
+ * Check, if queue is not empty. May be called by consumer.
+ *
+ * @param q This object
+ *
+ * @return true, if there is at least one element.
+ */
+static inline bool_t CO_rxQueue_isNew(CO_rxQueue_t *q) {
+    return q->tail != q->head;
+}
+
+/** @} */ /* CO_CANopen_301_rxQueue */
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus*/
+
+#endif /* CO_RX_QUEUE_H */
@@ -45,6 +45,12 @@ static void CO_GFC_receive(void *object, void *msg)
         if (GFC->pFunctSignalSafe != NULL) {
             GFC->pFunctSignalSafe(GFC->functSignalObjectSafe);
         }
+#if (CO_CONFIG_GFC) & CO_CONFIG_GFC_TIMING
+        /* reaction time: from reception of the frame by the driver until
+         * safe state callback returns */
+        CO_safetyTiming_record(&GFC->timing, CO_CANrxMsg_readTimestamp_us(msg),
+                               0xFFFFFFFFUL, 0);
+#endif
 #endif
     }
 }
@@ -61,7 +67,7 @@ void CO_GFC_initCallbackEnterSafeState(CO_GFC_t *GFC,
 #endif
 
 CO_ReturnError_t CO_GFC_init(CO_GFC_t *GFC,
-                             uint8_t *valid,
+                             const OD_entry_t *OD_1300_gfcParameter,
                              CO_CANmodule_t *GFC_CANdevRx,
                              uint16_t GFC_rxIdx,
                              uint16_t CANidRxGFC,
@@ -69,11 +75,20 @@ CO_ReturnError_t CO_GFC_init(CO_GFC_t *GFC,
                              uint16_t GFC_txIdx,
                              uint16_t CANidTxGFC)
 {
-    if (GFC == NULL || valid == NULL || GFC_CANdevRx == NULL ||
+    OD_size_t len;
+
+    if (GFC == NULL || OD_1300_gfcParameter == NULL || GFC_CANdevRx == NULL ||
         GFC_CANdevTx == NULL) {
         return CO_ERROR_ILLEGAL_ARGUMENT;
     }
-    GFC->valid = valid;
+
+    if (OD_getPtr(OD_1300_gfcParameter, 0, (void **)&GFC->valid, &len)
+            != ODR_OK
+        || len != sizeof(uint8_t)
+    ) {
+        CO_errinfo(GFC_CANdevRx, OD_getIndex(OD_1300_gfcParameter));
+        return CO_ERROR_OD_PARAMETERS;
+    }
 #if (CO_CONFIG_GFC) & CO_CONFIG_GFC_PRODUCER
     GFC->CANdevTx = GFC_CANdevTx;
 #endif
@@ -27,6 +27,7 @@
 #define CO_GFC_H
 
 #include "301/CO_driver.h"
+#include "301/CO_ODinterface.h"
 
 /* default configuration, see CO_config.h */
 #ifndef CO_CONFIG_GFC
@@ -35,6 +36,10 @@
 
 #if ((CO_CONFIG_GFC) & CO_CONFIG_GFC_ENABLE) || defined CO_DOXYGEN
 
+#if ((CO_CONFIG_GFC) & CO_CONFIG_GFC_TIMING) || defined CO_DOXYGEN
+#include "304/CO_safetyTiming.h"
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -58,7 +63,9 @@ extern "C" {
  * GFC object.
  */
 typedef struct {
-    uint8_t *valid; /**< From CO_GFC_init() */
+    /** Global fail-safe command parameter from OD (0x1300), from
+     * CO_GFC_init() */
+    uint8_t *valid;
 #if ((CO_CONFIG_GFC)&CO_CONFIG_GFC_PRODUCER) || defined CO_DOXYGEN
     CO_CANmodule_t *CANdevTx; /**< From CO_GFC_init() */
     CO_CANtx_t *CANtxBuff;    /**< CAN transmit buffer inside CANdevTx */
@@ -69,6 +76,11 @@ typedef struct {
     /** From CO_GFC_initCallbackEnterSafeState() or NULL */
     void *functSignalObjectSafe;
 #endif
+#if ((CO_CONFIG_GFC) & CO_CONFIG_GFC_TIMING) || defined CO_DOXYGEN
+    /** Timing statistics from reception to the safe state callback,
+     * initialized by CO_safetyTiming_init() after CO_GFC_init() */
+    CO_safetyTiming_t timing;
+#endif
 } CO_GFC_t;
 
 /**
@@ -77,7 +89,8 @@ typedef struct {
  * Function must be called in the communication reset section.
  *
  * @param GFC This object will be initialized.
- * @param valid pointer to the valid flag in OD (0x1300)
+ * @param OD_1300_gfcParameter OD entry for 0x1300 - "Global fail-safe command
+ * parameter", entry is required.
  * @param GFC_CANdevRx  CAN device used for SRDO reception.
  * @param GFC_rxIdx Index of receive buffer in the above CAN device.
  * @param CANidRxGFC GFC CAN ID for reception
@@ -85,10 +98,11 @@ typedef struct {
  * @param GFC_txIdx Index of transmit buffer in the above CAN device.
  * @param CANidTxGFC GFC CAN ID for transmission
  *
- * @return #CO_ReturnError_t: CO_ERROR_NO or CO_ERROR_ILLEGAL_ARGUMENT.
+ * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT or
+ * CO_ERROR_OD_PARAMETERS.
  */
 CO_ReturnError_t CO_GFC_init(CO_GFC_t *GFC,
-                             uint8_t *valid,
+                             const OD_entry_t *OD_1300_gfcParameter,
                              CO_CANmodule_t *GFC_CANdevRx,
                              uint16_t GFC_rxIdx,
                              uint16_t CANidRxGFC,
@@ -101,7 +115,9 @@ CO_ReturnError_t CO_GFC_init(CO_GFC_t *GFC,
  * Initialize GFC callback function.
  *
  * Function initializes optional callback function, that is called when GFC is
- * received. Callback is called from receive function (interrupt).
+ * received. Callback is called from receive function (interrupt), without any
+ * further processing delay, so it must finish in bounded time and must not
+ * allocate memory, block, take locks or access the Object Dictionary.
  *
  * @param GFC This object.
  * @param object Pointer to object, which will be passed to pFunctSignalSafe().
@@ -113,6 +129,20 @@ void CO_GFC_initCallbackEnterSafeState(CO_GFC_t *GFC,
                                        void (*pFunctSignalSafe)(void *object));
 #endif
 
+#if ((CO_CONFIG_GFC) & CO_CONFIG_GFC_TIMING) || defined CO_DOXYGEN
+/**
+ * Process GFC object.
+ *
+ * Reports emergency for timing limit violation, which was recorded in the CAN
+ * receive function. Function must be called cyclically.
+ *
+ * @param GFC This object.
+ */
+static inline void CO_GFC_process(CO_GFC_t *GFC) {
+    CO_safetyTiming_process(&GFC->timing);
+}
+#endif
+
 #if ((CO_CONFIG_GFC)&CO_CONFIG_GFC_PRODUCER) || defined CO_DOXYGEN
 /**
  * Send GFC message.
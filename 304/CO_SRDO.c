@@ -23,6 +23,9 @@
  * limitations under the License.
  */
 
+
+#include <string.h>
+
 #include "304/CO_SRDO.h"
 
 #if (CO_CONFIG_SRDO) & CO_CONFIG_SRDO_ENABLE
@@ -33,6 +36,11 @@
 #if !((CO_CONFIG_CRC16) & CO_CONFIG_CRC16_ENABLE)
  #error CO_CONFIG_CRC16_ENABLE must be enabled.
 #endif
+#if ((CO_CONFIG_SRDO) & (CO_CONFIG_SRDO_PROCESS_TIME | CO_CONFIG_SRDO_TIMING \
+                         | CO_CONFIG_SRDO_SAFE_RX)) \
+    && !defined CO_timestamp_us
+ #error CO_timestamp_us() must be defined by CO_driver_target.h
+#endif
 
 #define CO_SRDO_INVALID          (0U)
 #define CO_SRDO_TX               (1U)
@@ -40,6 +48,25 @@
 
 #define CO_SRDO_VALID_MAGIC    (0xA5)
 
+/* Size of serialized configuration, used for checksum: informationDirection,
+ * safetyCycleTime, safetyRelatedValidationTime, two COB_IDs, number of mapped
+ * objects and sub-index with mapping for each mapped object. */
+#define CO_SRDO_CRC_BUF_SIZE (1 + 2 + 1 + 4 + 4 + 1 \
+                              + CO_SRDO_MAX_MAPPED_ENTRIES * 5)
+
+
+/* Compare normal and inverted data inside dataLength as 64-bit words, returns
+ * true, if each bit of inverted data is complement of normal data. */
+static inline bool_t CO_SRDO_dataConsistent(const CO_SRDO_t *SRDO,
+                                            const uint8_t *normal,
+                                            const uint8_t *inverted)
+{
+    uint64_t n, i;
+
+    memcpy(&n, normal, sizeof(n));
+    memcpy(&i, inverted, sizeof(i));
+    return ((n ^ ~i) & SRDO->dataMask) == 0;
+}
 
 static void CO_SRDO_receive_normal(void *object, void *msg){
     CO_SRDO_t *SRDO;
@@ -53,6 +80,9 @@ static void CO_SRDO_receive_normal(void *object, void *msg){
     {
         /* copy data into appropriate buffer and set 'new message' flag */
         memcpy(SRDO->CANrxData[0], data, sizeof(SRDO->CANrxData[0]));
+#if (CO_CONFIG_SRDO) & (CO_CONFIG_SRDO_TIMING | CO_CONFIG_SRDO_SAFE_RX)
+        SRDO->rxTimestamp_us[0] = CO_CANrxMsg_readTimestamp_us(msg);
+#endif
         CO_FLAG_SET(SRDO->CANrxNew[0]);
 
 #if (CO_CONFIG_SRDO) & CO_CONFIG_FLAG_CALLBACK_PRE
@@ -74,8 +104,44 @@ static void CO_SRDO_receive_inverted(void *object, void *msg){
     if( (SRDO->valid == CO_SRDO_RX) &&
         (DLC >= SRDO->dataLength) && CO_FLAG_READ(SRDO->CANrxNew[0]))
     {
+#if (CO_CONFIG_SRDO) & CO_CONFIG_SRDO_SAFE_RX
+        uint32_t rxTimestamp_us = CO_CANrxMsg_readTimestamp_us(msg);
+
+        /* Check the pair here, before further processing. */
+        if (SRDO->pFunctSafeRx != NULL) {
+            CO_SRDO_safeRx_t reason = (CO_SRDO_safeRx_t)0;
+
+            if (!CO_SRDO_dataConsistent(SRDO, SRDO->CANrxData[0], data)) {
+                reason = CO_SRDO_SAFE_RX_MISMATCH;
+            }
+            else if ((rxTimestamp_us - SRDO->rxTimestamp_us[0])
+                     > SRDO->validationTime_us) {
+                reason = CO_SRDO_SAFE_RX_LATE;
+            }
+
+            if (reason != 0) {
+                uint32_t start_us = CO_timestamp_us();
+
+                SRDO->pFunctSafeRx(SRDO->functSafeRxObject, reason);
+
+                uint32_t time_us = CO_timestamp_us() - start_us;
+                if (time_us > SRDO->safeRxTimeMax_us) {
+                    SRDO->safeRxTimeMax_us = time_us;
+                }
+                if (time_us > CO_CONFIG_SRDO_SAFE_RX_BUDGET_US) {
+                    SRDO->safeRxOverruns++;
+                    CO_FLAG_SET(SRDO->safeRxOverrunNew);
+                }
+            }
+        }
+#endif
         /* copy data into appropriate buffer and set 'new message' flag */
         memcpy(SRDO->CANrxData[1], data, sizeof(SRDO->CANrxData[1]));
+#if (CO_CONFIG_SRDO) & CO_CONFIG_SRDO_SAFE_RX
+        SRDO->rxTimestamp_us[1] = rxTimestamp_us;
+#elif (CO_CONFIG_SRDO) & CO_CONFIG_SRDO_TIMING
+        SRDO->rxTimestamp_us[1] = CO_CANrxMsg_readTimestamp_us(msg);
+#endif
         CO_FLAG_SET(SRDO->CANrxNew[1]);
 
 #if (CO_CONFIG_SRDO) & CO_CONFIG_FLAG_CALLBACK_PRE
@@ -87,31 +153,53 @@ static void CO_SRDO_receive_inverted(void *object, void *msg){
     }
 }
 
-static void CO_SRDOconfigCom(CO_SRDO_t* SRDO, uint32_t COB_IDnormal, uint32_t COB_IDinverted){
-    uint16_t IDs[2][2] = {0};
+/* Actual CAN-ID from the COB_ID, stored in the Object Dictionary. If default
+ * COB_ID is used, it is stored without node-ID. */
+static uint16_t CO_SRDO_canId(const CO_SRDO_t *SRDO, uint8_t inverted,
+                              uint32_t COB_ID)
+{
+    uint16_t ID = (uint16_t)(COB_ID & 0x7FF);
+
+    if (ID == SRDO->defaultCOB_ID[inverted] && ID != 0 && SRDO->nodeId <= 64) {
+        ID += 2 * SRDO->nodeId;
+    }
+    return ID;
+}
+
+static void CO_SRDOconfigCom(CO_SRDO_t* SRDO){
+    uint16_t IDs[2][2] = {{0}};
     uint16_t* ID;
     uint16_t successCount = 0;
+    uint8_t direction = CO_SRDO_INVALID;
+    uint16_t safetyCycleTime = 0;
+    uint8_t safetyRelatedValidationTime = 0;
+    uint32_t COB_ID[2] = {0, 0};
 
     int16_t i;
 
-    uint32_t COB_ID[2];
-    COB_ID[0] = COB_IDnormal;
-    COB_ID[1] = COB_IDinverted;
-
     SRDO->valid = CO_SRDO_INVALID;
 
+    if (OD_get_u8(SRDO->OD_130x_entry, 1, &direction, true) != ODR_OK
+        || OD_get_u16(SRDO->OD_130x_entry, 2, &safetyCycleTime, true) != ODR_OK
+        || OD_get_u8(SRDO->OD_130x_entry, 3,
+                     &safetyRelatedValidationTime, true) != ODR_OK
+        || OD_get_u32(SRDO->OD_130x_entry, 5, &COB_ID[0], true) != ODR_OK
+        || OD_get_u32(SRDO->OD_130x_entry, 6, &COB_ID[1], true) != ODR_OK
+    ) {
+        direction = CO_SRDO_INVALID;
+    }
+    SRDO->cycleTime_us = (uint32_t)safetyCycleTime * 1000U;
+    SRDO->validationTime_us = (uint32_t)safetyRelatedValidationTime * 1000U;
+
     /* is SRDO used? */
-    if(*SRDO->SRDOGuard->configurationValid == CO_SRDO_VALID_MAGIC && (SRDO->SRDOCommPar->informationDirection == CO_SRDO_TX || SRDO->SRDOCommPar->informationDirection == CO_SRDO_RX) &&
+    if(*SRDO->SRDOGuard->configurationValid == CO_SRDO_VALID_MAGIC && (direction == CO_SRDO_TX || direction == CO_SRDO_RX) &&
         SRDO->dataLength){
-        ID = &IDs[SRDO->SRDOCommPar->informationDirection - 1][0];
+        ID = &IDs[direction - 1][0];
         /* is used default COB-ID? */
         for(i = 0; i < 2; i++){
             if(!(COB_ID[i] & 0xBFFFF800L)){
-                ID[i] = (uint16_t)COB_ID[i] & 0x7FF;
+                ID[i] = CO_SRDO_canId(SRDO, (uint8_t)i, COB_ID[i]);
 
-                if(ID[i] == SRDO->defaultCOB_ID[i] && SRDO->nodeId <= 64){
-                    ID[i] += 2*SRDO->nodeId;
-                }
                 if(0x101 <= ID[i] && ID[i] <= 0x180 && ((ID[i] & 1) != i )){
                     successCount++;
                 }
@@ -120,13 +208,13 @@ static void CO_SRDOconfigCom(CO_SRDO_t* SRDO, uint32_t COB_IDnormal, uint32_t CO
     }
     /* all ids are ok*/
     if(successCount == 2){
-        SRDO->valid = SRDO->SRDOCommPar->informationDirection;
+        SRDO->valid = direction;
 
         if (SRDO->valid == CO_SRDO_TX){
             SRDO->timer = 500 * SRDO->nodeId; /* 0.5ms * node-ID delay*/
         }
         else if (SRDO->valid == CO_SRDO_RX){
-            SRDO->timer = SRDO->SRDOCommPar->safetyCycleTime * 1000U;
+            SRDO->timer = SRDO->cycleTime_us;
         }
     }
     else{
@@ -166,340 +254,475 @@ static void CO_SRDOconfigCom(CO_SRDO_t* SRDO, uint32_t COB_IDnormal, uint32_t CO
     }
 }
 
-static uint32_t CO_SRDOfindMap(
-        CO_SDO_t               *SDO,
-        uint32_t                map,
-        uint8_t                 R_T,
-        uint8_t               **ppData,
-        uint8_t                *pLength,
-        uint8_t                *pSendIfCOSFlags,
-        uint8_t                *pIsMultibyteVar)
+/* Resolve one mapped object into the copy plan entry. Returns ODR_OK or the
+ * reason, why object can not be mapped. */
+static ODR_t CO_SRDOfindMap(CO_SRDO_t *SRDO,
+                            uint32_t map,
+                            bool_t isTx,
+                            CO_SRDO_copy_t *copy)
 {
-    uint16_t entryNo;
-    uint16_t index;
-    uint8_t subIndex;
-    uint8_t dataLen;
-    uint8_t objectLen;
-    uint8_t attr;
-
-    index = (uint16_t)(map>>16);
-    subIndex = (uint8_t)(map>>8);
-    dataLen = (uint8_t) map;   /* data length in bits */
+    static uint8_t dummyTX[8] = {0};
+    static uint8_t dummyRX[8];
+    uint16_t index = (uint16_t)(map >> 16);
+    uint8_t subIndex = (uint8_t)(map >> 8);
+    uint8_t mappedLengthBits = (uint8_t)map;
+    uint8_t dataLen = mappedLengthBits >> 3;
 
     /* data length must be byte aligned */
-    if(dataLen&0x07) return CO_SDO_AB_NO_MAP;   /* Object cannot be mapped to the PDO. */
-
-    dataLen >>= 3;    /* new data length is in bytes */
-    *pLength += dataLen;
+    if ((mappedLengthBits & 0x07) != 0 || dataLen == 0) return ODR_NO_MAP;
 
-    /* total PDO length can not be more than 8 bytes */
-    if(*pLength > 8) return CO_SDO_AB_MAP_LEN;  /* The number and length of the objects to be mapped would exceed PDO length. */
+    copy->length = dataLen;
+#if (CO_CONFIG_SRDO) & (CO_CONFIG_RSRDO_CALLS_EXTENSION | CO_CONFIG_TSRDO_CALLS_EXTENSION)
+    copy->useIO = false;
+#endif
+#ifdef CO_BIG_ENDIAN
+    copy->swap = false;
+#endif
 
     /* is there a reference to dummy entries */
-    if(index <=7 && subIndex == 0){
-        static uint32_t dummyTX = 0;
-        static uint32_t dummyRX;
+    if (index <= 7 && subIndex == 0) {
         uint8_t dummySize = 4;
 
-        if(index<2) dummySize = 0;
-        else if(index==2 || index==5) dummySize = 1;
-        else if(index==3 || index==6) dummySize = 2;
+        if (index < 2) dummySize = 0;
+        else if (index == 2 || index == 5) dummySize = 1;
+        else if (index == 3 || index == 6) dummySize = 2;
 
         /* is size of variable big enough for map */
-        if(dummySize < dataLen) return CO_SDO_AB_NO_MAP;   /* Object cannot be mapped to the PDO. */
+        if (dummySize < dataLen) return ODR_NO_MAP;
 
-        /* Data and ODE pointer */
-        if(R_T == 0) *ppData = (uint8_t*) &dummyRX;
-        else         *ppData = (uint8_t*) &dummyTX;
-
-        return 0;
+        copy->data = isTx ? dummyTX : dummyRX;
+        return ODR_OK;
     }
 
     /* find object in Object Dictionary */
-    entryNo = CO_OD_find(SDO, index);
-
-    /* Does object exist in OD? */
-    if(entryNo == 0xFFFF || subIndex > SDO->OD[entryNo].maxSubIndex)
-        return CO_SDO_AB_NOT_EXIST;   /* Object does not exist in the object dictionary. */
-
-    attr = CO_OD_getAttribute(SDO, entryNo, subIndex);
-    /* Is object Mappable for RPDO? */
-    if(R_T==0 && !((attr&CO_ODA_RPDO_MAPABLE) && (attr&CO_ODA_WRITEABLE))) return CO_SDO_AB_NO_MAP;   /* Object cannot be mapped to the PDO. */
-    /* Is object Mappable for TPDO? */
-    if(R_T!=0 && !((attr&CO_ODA_TPDO_MAPABLE) && (attr&CO_ODA_READABLE))) return CO_SDO_AB_NO_MAP;   /* Object cannot be mapped to the PDO. */
+    OD_subEntry_t subEntry;
+    OD_IO_t io;
+    ODR_t odRet = OD_getSub(OD_find(SRDO->OD, index), subIndex,
+                            &subEntry, &io, false);
+    if (odRet != ODR_OK) return odRet;
+
+    /* Is object mappable? */
+    if ((subEntry.attribute & (isTx ? ODA_TSRDO : ODA_RSRDO)) == 0) {
+        return ODR_NO_MAP;
+    }
 
     /* is size of variable big enough for map */
-    objectLen = CO_OD_getLength(SDO, entryNo, subIndex);
-    if(objectLen < dataLen) return CO_SDO_AB_NO_MAP;   /* Object cannot be mapped to the PDO. */
+    if (io.stream.dataLength < dataLen) return ODR_NO_MAP;
+
+    copy->data = (uint8_t *)io.stream.data;
+
+#if (CO_CONFIG_SRDO) & (CO_CONFIG_RSRDO_CALLS_EXTENSION | CO_CONFIG_TSRDO_CALLS_EXTENSION)
+    /* Variable with IO extension is accessed with read or write function, if
+     * it is mapped in full length. */
+ #if (CO_CONFIG_SRDO) & CO_CONFIG_TSRDO_CALLS_EXTENSION
+    if (isTx && io.read != OD_readOriginal) copy->useIO = true;
+ #endif
+ #if (CO_CONFIG_SRDO) & CO_CONFIG_RSRDO_CALLS_EXTENSION
+    if (!isTx && io.write != OD_writeOriginal) copy->useIO = true;
+ #endif
+    if (copy->useIO) {
+        if (io.stream.dataLength != dataLen) {
+            copy->useIO = false;
+        }
+        else {
+            copy->io = io;
+            copy->subIndex = subIndex;
+            return ODR_OK;
+        }
+    }
+#endif
 
-    /* mark multibyte variable */
-    *pIsMultibyteVar = (attr&CO_ODA_MB_VALUE) ? 1 : 0;
+    if (copy->data == NULL) return ODR_NO_MAP;
 
-    /* pointer to data */
-    *ppData = (uint8_t*) CO_OD_getDataPointer(SDO, entryNo, subIndex);
 #ifdef CO_BIG_ENDIAN
-    /* skip unused MSB bytes */
-    if(*pIsMultibyteVar){
-        *ppData += objectLen - dataLen;
+    /* skip unused MSB bytes and swap bytes of multi-byte variable */
+    if ((subEntry.attribute & ODA_MB) != 0) {
+        copy->data += io.stream.dataLength - dataLen;
+        copy->swap = true;
     }
 #endif
 
-    /* setup change of state flags */
-    if(attr&CO_ODA_TPDO_DETECT_COS){
-        int16_t i;
-        for(i=*pLength-dataLen; i<*pLength; i++){
-            *pSendIfCOSFlags |= 1<<i;
-        }
-    }
-
-    return 0;
+    return ODR_OK;
 }
 
-static uint32_t CO_SRDOconfigMap(CO_SRDO_t* SRDO, uint8_t noOfMappedObjects){
-    int16_t i;
-    uint8_t lengths[2] = {0};
-    uint32_t ret = 0;
-    const uint32_t* pMap = &SRDO->SRDOMapPar->mappedObjects[0];
+/* Build copy plans from the mapping parameter. Even mapped objects (sub-index
+ * 1, 3, ...) are normal, odd are inverted. */
+static ODR_t CO_SRDOconfigMap(CO_SRDO_t* SRDO){
+    uint8_t lengths[2] = {0, 0};
+    uint8_t noOfMappedObjects = 0;
+    uint8_t direction = CO_SRDO_INVALID;
+    uint32_t map = 0;
+    ODR_t ret = ODR_OK;
+    uint8_t i;
+
+    SRDO->planCount[0] = SRDO->planCount[1] = 0;
+    SRDO->dataLength = 0;
+
+    if (OD_get_u8(SRDO->OD_138x_entry, 0, &noOfMappedObjects, true) != ODR_OK
+        || OD_get_u8(SRDO->OD_130x_entry, 1, &direction, true) != ODR_OK
+        || noOfMappedObjects > CO_SRDO_MAX_MAPPED_ENTRIES
+        || (noOfMappedObjects & 1) != 0
+    ) {
+        ret = ODR_MAP_LEN;
+    }
 
+    for (i = 0; ret == ODR_OK && i < noOfMappedObjects; i++) {
+        uint8_t inv = i & 1;
+        CO_SRDO_copy_t *copy = &SRDO->plan[inv][SRDO->planCount[inv]];
 
-    for(i=noOfMappedObjects; i>0; i--){
-        int16_t j;
-        uint8_t* pData;
-        uint8_t dummy = 0;
-        uint8_t* length = &lengths[i%2];
-        uint8_t** mapPointer = SRDO->mapPointer[i%2];
-        uint8_t prevLength = *length;
-        uint8_t MBvar;
-        uint32_t map = *(pMap++);
+        ret = OD_get_u32(SRDO->OD_138x_entry, i + 1, &map, true);
+        if (ret != ODR_OK) {
+            break;
+        }
 
         /* function do much checking of errors in map */
-        ret = CO_SRDOfindMap(
-                SRDO->SDO,
-                map,
-                SRDO->SRDOCommPar->informationDirection == CO_SRDO_TX,
-                &pData,
-                length,
-                &dummy,
-                &MBvar);
-        if(ret){
-            *length = 0;
-            CO_errorReport(SRDO->em, CO_EM_PDO_WRONG_MAPPING, CO_EMC_PROTOCOL_ERROR, map);
+        ret = CO_SRDOfindMap(SRDO, map, direction == CO_SRDO_TX, copy);
+        if (ret == ODR_OK && lengths[inv] + copy->length > 8) {
+            ret = ODR_MAP_LEN;
+        }
+        if (ret != ODR_OK) {
             break;
         }
 
-        /* write SRDO data pointers */
+        copy->offset = lengths[inv];
+        lengths[inv] += copy->length;
+        SRDO->planCount[inv]++;
+    }
+
+    if (ret == ODR_OK && lengths[0] != lengths[1]) {
+        map = 0;
+        ret = ODR_MAP_LEN;
+    }
+
+    if (ret != ODR_OK) {
+        SRDO->planCount[0] = SRDO->planCount[1] = 0;
+        CO_errorReport(SRDO->em, CO_EM_PDO_WRONG_MAPPING, CO_EMC_PROTOCOL_ERROR, map);
+        return ret;
+    }
+
+    SRDO->dataLength = lengths[0];
+    if (SRDO->dataLength == 8) {
+        SRDO->dataMask = ~(uint64_t)0;
+    }
+    else {
 #ifdef CO_BIG_ENDIAN
-        if(MBvar){
-            for(j=*length-1; j>=prevLength; j--)
-                mapPointer[j] = pData++;
-        }
-        else{
-            for(j=prevLength; j<*length; j++)
-                mapPointer[j] = pData++;
-        }
+        /* first bytes of the message are the most significant */
+        SRDO->dataMask = ~((~(uint64_t)0) >> (SRDO->dataLength * 8));
 #else
-        for(j=prevLength; j<*length; j++){
-            mapPointer[j] = pData++;
-        }
+        SRDO->dataMask = ((uint64_t)1 << (SRDO->dataLength * 8)) - 1;
 #endif
+    }
 
+    return ODR_OK;
+}
+
+/* Calculate configuration checksum over serialized SRDO parameters, as they
+ * are read by SDO (COB_IDs including node-ID, if default is used). */
+static uint16_t CO_SRDOcalcCrc(const CO_SRDO_t *SRDO){
+    uint8_t buf[CO_SRDO_CRC_BUF_SIZE];
+    size_t len = 0;
+    uint8_t direction = 0, safetyRelatedValidationTime = 0;
+    uint8_t noOfMappedObjects = 0;
+    uint16_t safetyCycleTime = 0;
+    uint32_t COB_ID = 0, map = 0;
+    uint8_t i;
+
+    (void)OD_get_u8(SRDO->OD_130x_entry, 1, &direction, true);
+    (void)OD_get_u16(SRDO->OD_130x_entry, 2, &safetyCycleTime, true);
+    (void)OD_get_u8(SRDO->OD_130x_entry, 3, &safetyRelatedValidationTime, true);
+
+    buf[len++] = direction;
+    len += CO_setUint16(&buf[len], CO_SWAP_16(safetyCycleTime));
+    buf[len++] = safetyRelatedValidationTime;
+
+    for (i = 0; i < 2; i++) {
+        (void)OD_get_u32(SRDO->OD_130x_entry, 5 + i, &COB_ID, true);
+        COB_ID = (COB_ID & 0xFFFFF800) | CO_SRDO_canId(SRDO, i, COB_ID);
+        len += CO_setUint32(&buf[len], CO_SWAP_32(COB_ID));
     }
-    if(lengths[0] == lengths[1])
-        SRDO->dataLength = lengths[0];
-    else{
-        SRDO->dataLength = 0;
-        CO_errorReport(SRDO->em, CO_EM_PDO_WRONG_MAPPING, CO_EMC_PROTOCOL_ERROR, 0);
-        ret = CO_SDO_AB_MAP_LEN;
+
+    (void)OD_get_u8(SRDO->OD_138x_entry, 0, &noOfMappedObjects, true);
+    if (noOfMappedObjects > CO_SRDO_MAX_MAPPED_ENTRIES) {
+        noOfMappedObjects = CO_SRDO_MAX_MAPPED_ENTRIES;
+    }
+    buf[len++] = noOfMappedObjects;
+    for (i = 1; i <= noOfMappedObjects; i++) {
+        map = 0;
+        (void)OD_get_u32(SRDO->OD_138x_entry, i, &map, true);
+        buf[len++] = i;
+        len += CO_setUint32(&buf[len], CO_SWAP_32(map));
     }
 
-    return ret;
+    return crc16_ccitt(buf, len, 0x0000);
 }
 
-static uint16_t CO_SRDOcalcCrc(const CO_SRDO_t *SRDO){
-    uint16_t i;
-    uint16_t result = 0x0000;
-    uint8_t buffer[4];
-    uint32_t cob;
-
-    const CO_SRDOCommPar_t *com = SRDO->SRDOCommPar;
-    const CO_SRDOMapPar_t *map = SRDO->SRDOMapPar;
-
-    result = crc16_ccitt(&com->informationDirection, 1, result);
-    CO_memcpySwap2(&buffer[0], &com->safetyCycleTime);
-    result = crc16_ccitt(&buffer[0], 2, result);
-    result = crc16_ccitt(&com->safetyRelatedValidationTime, 1, result);
-
-    /* adjust COB-ID if the default is used
-    Caution: if the node id changes and you are using the default COB-ID you have to recalculate the checksum
-    This behaviour is controversial and could be changed or made optional.
-    */
-    cob = com->COB_ID1_normal;
-    if(((cob)&0x7FF) == SRDO->defaultCOB_ID[0] && SRDO->nodeId <= 64)
-        cob += SRDO->nodeId;
-    CO_memcpySwap4(&buffer[0], &cob);
-    result = crc16_ccitt(&buffer[0], 4, result);
-
-    cob = com->COB_ID2_inverted;
-    if(((cob)&0x7FF) == SRDO->defaultCOB_ID[1] && SRDO->nodeId <= 64)
-        cob += SRDO->nodeId;
-    CO_memcpySwap4(&buffer[0], &cob);
-    result = crc16_ccitt(&buffer[0], 4, result);
-
-    result = crc16_ccitt(&map->numberOfMappedObjects, 1, result);
-    for(i = 0; i < map->numberOfMappedObjects;){
-        uint8_t subindex = i + 1;
-        result = crc16_ccitt(&subindex, 1, result);
-        CO_memcpySwap4(&buffer[0], &map->mappedObjects[i]);
-        result = crc16_ccitt(&buffer[0], 4, result);
-        i = subindex;
+/* Common part of writing SRDO parameters. Writing is not allowed in NMT
+ * operational state, otherwise configuration becomes invalid. */
+static bool_t CO_SRDO_writeAllowed(CO_SRDOGuard_t *SRDOGuard,
+                                   ODR_t *returnCode)
+{
+    if (*SRDOGuard->operatingState == CO_NMT_OPERATIONAL) {
+        *returnCode = ODR_DATA_DEV_STATE;
+        return false;
     }
-    return result;
+    return true;
 }
 
-static CO_SDO_abortCode_t CO_ODF_SRDOcom(CO_ODF_arg_t *ODF_arg){
-    CO_SRDO_t *SRDO;
+/*
+ * Custom functions for read/write OD object "SRDO communication parameter"
+ *
+ * For more information see file CO_ODinterface.h, OD_IO_t.
+ */
+static OD_size_t OD_read_130x(OD_stream_t *stream, uint8_t subIndex,
+                              void *buf, OD_size_t count, ODR_t *returnCode)
+{
+    if (stream == NULL || buf == NULL || returnCode == NULL) {
+        if (returnCode != NULL) *returnCode = ODR_DEV_INCOMPAT;
+        return 0;
+    }
 
-    SRDO = (CO_SRDO_t*) ODF_arg->object;
+    CO_SRDO_t *SRDO = (CO_SRDO_t *)stream->object;
+    OD_size_t countRd = OD_readOriginal(stream, subIndex, buf, count,
+                                        returnCode);
+
+    /* if default COB ID is used, add node-ID */
+    if ((subIndex == 5 || subIndex == 6) && *returnCode == ODR_OK
+        && countRd == sizeof(uint32_t)
+    ) {
+        uint32_t value = CO_getUint32(buf);
+        value = (value & 0xFFFFF800)
+                | CO_SRDO_canId(SRDO, subIndex - 5, value);
+        CO_setUint32(buf, value);
+    }
 
-    /* Reading Object Dictionary variable */
-    if(ODF_arg->reading){
-        if(ODF_arg->subIndex == 5 || ODF_arg->subIndex == 6){
-            uint32_t value = CO_getUint32(ODF_arg->data);
-            uint16_t index = ODF_arg->subIndex - 5;
+    return countRd;
+}
 
-            /* if default COB ID is used, write default value here */
-            if(((value)&0x7FF) == SRDO->defaultCOB_ID[index] && SRDO->nodeId <= 64)
-                value += SRDO->nodeId;
+static OD_size_t OD_write_130x(OD_stream_t *stream, uint8_t subIndex,
+                               const void *buf, OD_size_t count,
+                               ODR_t *returnCode)
+{
+    if (stream == NULL || buf == NULL || returnCode == NULL || count == 0) {
+        if (returnCode != NULL) *returnCode = ODR_DEV_INCOMPAT;
+        return 0;
+    }
 
-            /* If SRDO is not valid, set bit 31. but I do not think this applies to SRDO ?! */
-            /* if(!SRDO->valid) value |= 0x80000000L; */
+    CO_SRDO_t *SRDO = (CO_SRDO_t *)stream->object;
+    uint8_t bufCopy[4];
 
-            CO_setUint32(ODF_arg->data, value);
-        }
-        return CO_SDO_AB_NONE;
+    if (!CO_SRDO_writeAllowed(SRDO->SRDOGuard, returnCode)) {
+        return 0;
     }
 
-    /* Writing Object Dictionary variable */
-    if(*SRDO->SRDOGuard->operatingState == CO_NMT_OPERATIONAL)
-        return CO_SDO_AB_DATA_DEV_STATE;   /* Data cannot be transferred or stored to the application because of the present device state. */
-
-    if(ODF_arg->subIndex == 1){
-        uint8_t value = ODF_arg->data[0];
-        if (value > 2)
-            return CO_SDO_AB_INVALID_VALUE;
+    if (subIndex == 1) {
+        if (CO_getUint8(buf) > 2) {
+            *returnCode = ODR_INVALID_VALUE;
+            return 0;
+        }
     }
-    else if(ODF_arg->subIndex == 2){
-        uint16_t value = CO_getUint16(ODF_arg->data);
-        if (value == 0)
-            return CO_SDO_AB_INVALID_VALUE;
+    else if (subIndex == 2) {
+        if (count != sizeof(uint16_t) || CO_getUint16(buf) == 0) {
+            *returnCode = ODR_INVALID_VALUE;
+            return 0;
+        }
     }
-    else if(ODF_arg->subIndex == 3){
-        uint8_t value = ODF_arg->data[0];
-        if (value == 0)
-            return CO_SDO_AB_INVALID_VALUE;
+    else if (subIndex == 3) {
+        if (CO_getUint8(buf) == 0) {
+            *returnCode = ODR_INVALID_VALUE;
+            return 0;
+        }
     }
-    else if(ODF_arg->subIndex == 4){   /* Transmission_type */
-        uint8_t *value = (uint8_t*) ODF_arg->data;
-        if(*value != 254)
-            return CO_SDO_AB_INVALID_VALUE;  /* Invalid value for parameter (download only). */
+    else if (subIndex == 4) {   /* Transmission_type */
+        if (CO_getUint8(buf) != 254) {
+            *returnCode = ODR_INVALID_VALUE;
+            return 0;
+        }
     }
-   else if(ODF_arg->subIndex == 5 || ODF_arg->subIndex == 6){   /* COB_ID */
-        uint32_t value = CO_getUint32(ODF_arg->data);
-        uint16_t index = ODF_arg->subIndex - 5;
+    else if (subIndex == 5 || subIndex == 6) {   /* COB_ID */
+        uint8_t inverted = subIndex - 5;
+        uint32_t value;
+
+        if (count != sizeof(uint32_t)) {
+            *returnCode = ODR_TYPE_MISMATCH;
+            return 0;
+        }
+        value = CO_getUint32(buf);
 
         /* check value range, the spec does not specify if COB-ID flags are allowed */
-        if(value < 0x101 || value > 0x180 || (value & 1) == index)
-            return CO_SDO_AB_INVALID_VALUE;  /* Invalid value for parameter (download only). */
+        if (value < 0x101 || value > 0x180 || (value & 1) == inverted) {
+            *returnCode = ODR_INVALID_VALUE;
+            return 0;
+        }
 
         /* if default COB-ID is being written, write defaultCOB_ID without nodeId */
-        if(SRDO->nodeId <= 64 && value == (SRDO->defaultCOB_ID[index] + SRDO->nodeId)){
-            value = SRDO->defaultCOB_ID[index];
-            CO_setUint32(ODF_arg->data, value);
+        if (SRDO->nodeId <= 64
+            && value == (SRDO->defaultCOB_ID[inverted] + 2U * SRDO->nodeId)
+        ) {
+            value = SRDO->defaultCOB_ID[inverted];
         }
+        CO_setUint32(bufCopy, value);
+        buf = bufCopy;
     }
 
+    SRDO->checksumCached = false;
     *SRDO->SRDOGuard->configurationValid = CO_SRDO_INVALID;
 
-    return CO_SDO_AB_NONE;
+    /* write value to the original location in the Object Dictionary */
+    return OD_writeOriginal(stream, subIndex, buf, count, returnCode);
 }
 
-static CO_SDO_abortCode_t CO_ODF_SRDOmap(CO_ODF_arg_t *ODF_arg){
-    CO_SRDO_t *SRDO;
+/*
+ * Custom function for writing OD object "SRDO mapping parameter"
+ *
+ * For more information see file CO_ODinterface.h, OD_IO_t.
+ */
+static OD_size_t OD_write_138x(OD_stream_t *stream, uint8_t subIndex,
+                               const void *buf, OD_size_t count,
+                               ODR_t *returnCode)
+{
+    if (stream == NULL || buf == NULL || returnCode == NULL || count == 0) {
+        if (returnCode != NULL) *returnCode = ODR_DEV_INCOMPAT;
+        return 0;
+    }
 
-    SRDO = (CO_SRDO_t*) ODF_arg->object;
-    if(ODF_arg->reading)
-        return CO_SDO_AB_NONE;
+    CO_SRDO_t *SRDO = (CO_SRDO_t *)stream->object;
+    uint8_t direction = CO_SRDO_INVALID;
+    uint8_t noOfMappedObjects = 0;
 
-    /* Writing Object Dictionary variable */
+    if (!CO_SRDO_writeAllowed(SRDO->SRDOGuard, returnCode)) {
+        return 0;
+    }
 
-    if(*SRDO->SRDOGuard->operatingState == CO_NMT_OPERATIONAL)
-        return CO_SDO_AB_DATA_DEV_STATE;   /* Data cannot be transferred or stored to the application because of the present device state. */
-    if(SRDO->SRDOCommPar->informationDirection) /* SRDO must be deleted */
-        return CO_SDO_AB_UNSUPPORTED_ACCESS;  /* Unsupported access to an object. */
+    /* SRDO must be deleted */
+    (void)OD_get_u8(SRDO->OD_130x_entry, 1, &direction, true);
+    if (direction != CO_SRDO_INVALID) {
+        *returnCode = ODR_UNSUPP_ACCESS;
+        return 0;
+    }
 
     /* numberOfMappedObjects */
-    if(ODF_arg->subIndex == 0){
-        uint8_t *value = (uint8_t*) ODF_arg->data;
+    if (subIndex == 0) {
+        uint8_t value = CO_getUint8(buf);
 
-        if(*value > 16 || *value & 1) /*only odd numbers are allowed*/
-            return CO_SDO_AB_MAP_LEN;  /* Number and length of object to be mapped exceeds SRDO length. */
+        /* only even numbers are allowed */
+        if (value > CO_SRDO_MAX_MAPPED_ENTRIES || (value & 1) != 0) {
+            *returnCode = ODR_MAP_LEN;
+            return 0;
+        }
     }
-    else{
-        if (SRDO->SRDOMapPar->numberOfMappedObjects != 0)
-            return CO_SDO_AB_UNSUPPORTED_ACCESS;
+    else {
+        (void)OD_get_u8(SRDO->OD_138x_entry, 0, &noOfMappedObjects, true);
+        if (noOfMappedObjects != 0) {
+            *returnCode = ODR_UNSUPP_ACCESS;
+            return 0;
+        }
     }
+
+    SRDO->checksumCached = false;
     *SRDO->SRDOGuard->configurationValid = CO_SRDO_INVALID;
-    return CO_SDO_AB_NONE;
+
+    /* write value to the original location in the Object Dictionary */
+    return OD_writeOriginal(stream, subIndex, buf, count, returnCode);
 }
 
-static CO_SDO_abortCode_t CO_ODF_SRDOcrc(CO_ODF_arg_t *ODF_arg){
-    CO_SRDOGuard_t *SRDOGuard;
+/*
+ * Custom function for writing OD object "Safety configuration checksum"
+ *
+ * For more information see file CO_ODinterface.h, OD_IO_t.
+ */
+static OD_size_t OD_write_13FF(OD_stream_t *stream, uint8_t subIndex,
+                               const void *buf, OD_size_t count,
+                               ODR_t *returnCode)
+{
+    if (stream == NULL || buf == NULL || returnCode == NULL) {
+        if (returnCode != NULL) *returnCode = ODR_DEV_INCOMPAT;
+        return 0;
+    }
 
-    SRDOGuard = (CO_SRDOGuard_t*) ODF_arg->object;
+    CO_SRDOGuard_t *SRDOGuard = (CO_SRDOGuard_t *)stream->object;
 
-    if (!ODF_arg->reading){
-        if(*SRDOGuard->operatingState == CO_NMT_OPERATIONAL)
-            return CO_SDO_AB_DATA_DEV_STATE;   /* Data cannot be transferred or stored to the application because of the present device state. */
-        *SRDOGuard->configurationValid = CO_SRDO_INVALID;
+    if (!CO_SRDO_writeAllowed(SRDOGuard, returnCode)) {
+        return 0;
     }
-    return CO_SDO_AB_NONE;
+    *SRDOGuard->configurationValid = CO_SRDO_INVALID;
+
+    /* write value to the original location in the Object Dictionary */
+    return OD_writeOriginal(stream, subIndex, buf, count, returnCode);
 }
 
-static CO_SDO_abortCode_t CO_ODF_SRDOvalid(CO_ODF_arg_t *ODF_arg){
-    CO_SRDOGuard_t *SRDOGuard;
+/*
+ * Custom function for writing OD object "Configuration valid"
+ *
+ * For more information see file CO_ODinterface.h, OD_IO_t.
+ */
+static OD_size_t OD_write_13FE(OD_stream_t *stream, uint8_t subIndex,
+                               const void *buf, OD_size_t count,
+                               ODR_t *returnCode)
+{
+    if (stream == NULL || subIndex != 0 || buf == NULL || count != 1
+        || returnCode == NULL
+    ) {
+        if (returnCode != NULL) *returnCode = ODR_DEV_INCOMPAT;
+        return 0;
+    }
 
-    SRDOGuard = (CO_SRDOGuard_t*) ODF_arg->object;
+    CO_SRDOGuard_t *SRDOGuard = (CO_SRDOGuard_t *)stream->object;
 
-    if(!ODF_arg->reading){
-        if(*SRDOGuard->operatingState == CO_NMT_OPERATIONAL)
-            return CO_SDO_AB_DATA_DEV_STATE;   /* Data cannot be transferred or stored to the application because of the present device state. */
-        SRDOGuard->checkCRC = ODF_arg->data[0] == CO_SRDO_VALID_MAGIC;
+    if (!CO_SRDO_writeAllowed(SRDOGuard, returnCode)) {
+        return 0;
     }
-    return CO_SDO_AB_NONE;
+    SRDOGuard->checkCRC = CO_getUint8(buf) == CO_SRDO_VALID_MAGIC;
+
+    /* write value to the original location in the Object Dictionary */
+    return OD_writeOriginal(stream, subIndex, buf, count, returnCode);
 }
 
 CO_ReturnError_t CO_SRDOGuard_init(
         CO_SRDOGuard_t         *SRDOGuard,
-        CO_SDO_t               *SDO,
-        CO_NMT_internalState_t *operatingState,
-        uint8_t                *configurationValid,
-        uint16_t                idx_SRDOvalid,
-        uint16_t                idx_SRDOcrc)
+        uint8_t                *operatingState,
+        const OD_entry_t       *OD_13FE_configurationValid,
+        const OD_entry_t       *OD_13FF_safetyConfigurationChecksum,
+        CO_CANmodule_t         *CANdevRx)
 {
+    OD_size_t len = 0;
+
     /* verify arguments */
-    if(SRDOGuard==NULL || SDO==NULL || operatingState==NULL || configurationValid==NULL){
+    if(SRDOGuard==NULL || operatingState==NULL || CANdevRx==NULL
+       || OD_13FE_configurationValid==NULL
+       || OD_13FF_safetyConfigurationChecksum==NULL){
         return CO_ERROR_ILLEGAL_ARGUMENT;
     }
 
+    /* get and verify "Configuration valid" from Object Dictionary */
+    if (OD_getPtr(OD_13FE_configurationValid, 0,
+                  (void **)&SRDOGuard->configurationValid, &len) != ODR_OK
+        || len != 1
+    ) {
+        CO_errinfo(CANdevRx, OD_getIndex(OD_13FE_configurationValid));
+        return CO_ERROR_OD_PARAMETERS;
+    }
+
     SRDOGuard->operatingState = operatingState;
     SRDOGuard->operatingStatePrev = CO_NMT_INITIALIZING;
-    SRDOGuard->configurationValid = configurationValid;
-    SRDOGuard->checkCRC = *configurationValid == CO_SRDO_VALID_MAGIC;
-
+    SRDOGuard->checkCRC = *SRDOGuard->configurationValid == CO_SRDO_VALID_MAGIC;
 
     /* Configure Object dictionary entry at index 0x13FE and 0x13FF */
-    CO_OD_configure(SDO, idx_SRDOvalid, CO_ODF_SRDOvalid, (void*)SRDOGuard, 0, 0);
-    CO_OD_configure(SDO, idx_SRDOcrc, CO_ODF_SRDOcrc, (void*)SRDOGuard, 0, 0);
+    ODR_t odRet0 = OD_extensionIO_init(OD_13FE_configurationValid,
+                                       (void *)SRDOGuard,
+                                       OD_readOriginal,
+                                       OD_write_13FE);
+    if (odRet0 != ODR_OK) {
+        CO_errinfo(CANdevRx, OD_getIndex(OD_13FE_configurationValid));
+        return CO_ERROR_OD_PARAMETERS;
+    }
+    ODR_t odRet1 = OD_extensionIO_init(OD_13FF_safetyConfigurationChecksum,
+                                       (void *)SRDOGuard,
+                                       OD_readOriginal,
+                                       OD_write_13FF);
+    if (odRet1 != ODR_OK) {
+        CO_errinfo(CANdevRx, OD_getIndex(OD_13FF_safetyConfigurationChecksum));
+        return CO_ERROR_OD_PARAMETERS;
+    }
 
     return CO_ERROR_NO;
 }
@@ -508,7 +731,7 @@ uint8_t CO_SRDOGuard_process(
         CO_SRDOGuard_t         *SRDOGuard)
 {
     uint8_t result = 0;
-    CO_NMT_internalState_t operatingState = *SRDOGuard->operatingState;
+    uint8_t operatingState = *SRDOGuard->operatingState;
     if(operatingState != SRDOGuard->operatingStatePrev){
         SRDOGuard->operatingStatePrev = operatingState;
         if (operatingState == CO_NMT_OPERATIONAL)
@@ -536,6 +759,21 @@ void CO_SRDO_initCallbackPre(
 }
 #endif
 
+#if (CO_CONFIG_SRDO) & CO_CONFIG_SRDO_SAFE_RX
+/******************************************************************************/
+void CO_SRDO_initCallbackSafeRx(
+        CO_SRDO_t              *SRDO,
+        void                   *object,
+        void                  (*pFunctSafeRx)(void *object,
+                                              CO_SRDO_safeRx_t reason))
+{
+    if(SRDO != NULL){
+        SRDO->functSafeRxObject = object;
+        SRDO->pFunctSafeRx = pFunctSafeRx;
+    }
+}
+#endif
+
 /******************************************************************************/
 void CO_SRDO_initCallbackEnterSafeState(
         CO_SRDO_t              *SRDO,
@@ -552,14 +790,12 @@ CO_ReturnError_t CO_SRDO_init(
         CO_SRDO_t              *SRDO,
         CO_SRDOGuard_t         *SRDOGuard,
         CO_EM_t                *em,
-        CO_SDO_t               *SDO,
+        const OD_t             *OD,
         uint8_t                 nodeId,
         uint16_t                defaultCOB_ID,
-        const CO_SRDOCommPar_t *SRDOCommPar,
-        const CO_SRDOMapPar_t  *SRDOMapPar,
-        const uint16_t         *checksum,
-        uint16_t                idx_SRDOCommPar,
-        uint16_t                idx_SRDOMapPar,
+        const OD_entry_t       *OD_130x_SRDOCommPar,
+        const OD_entry_t       *OD_138x_SRDOMapPar,
+        const OD_entry_t       *OD_13FF_safetyConfigurationChecksum,
         CO_CANmodule_t         *CANdevRx,
         uint16_t                CANdevRxIdxNormal,
         uint16_t                CANdevRxIdxInverted,
@@ -567,18 +803,42 @@ CO_ReturnError_t CO_SRDO_init(
         uint16_t                CANdevTxIdxNormal,
         uint16_t                CANdevTxIdxInverted)
 {
-        /* verify arguments */
-    if(SRDO==NULL || SRDOGuard==NULL || em==NULL || SDO==NULL || checksum==NULL ||
-        SRDOCommPar==NULL || SRDOMapPar==NULL || CANdevRx==NULL || CANdevTx==NULL){
+    uint8_t maxSubIndex = 0;
+    uint8_t checksumSubIndex;
+    OD_size_t len = 0;
+
+    /* verify arguments */
+    if(SRDO==NULL || SRDOGuard==NULL || em==NULL || OD==NULL ||
+        OD_130x_SRDOCommPar==NULL || OD_138x_SRDOMapPar==NULL ||
+        OD_13FF_safetyConfigurationChecksum==NULL ||
+        CANdevRx==NULL || CANdevTx==NULL){
         return CO_ERROR_ILLEGAL_ARGUMENT;
     }
 
+    memset(SRDO, 0, sizeof(CO_SRDO_t));
+
+    /* get and verify parameters from Object Dictionary */
+    if (OD_get_u8(OD_130x_SRDOCommPar, 0, &maxSubIndex, true) != ODR_OK
+        || maxSubIndex != 6
+    ) {
+        CO_errinfo(CANdevRx, OD_getIndex(OD_130x_SRDOCommPar));
+        return CO_ERROR_OD_PARAMETERS;
+    }
+    checksumSubIndex = (uint8_t)(OD_getIndex(OD_130x_SRDOCommPar)
+                                 - OD_H1301_SRDO_1_PARAM + 1);
+    if (OD_getPtr(OD_13FF_safetyConfigurationChecksum, checksumSubIndex,
+                  (void **)&SRDO->checksum, &len) != ODR_OK
+        || len != sizeof(uint16_t)
+    ) {
+        CO_errinfo(CANdevRx, OD_getIndex(OD_13FF_safetyConfigurationChecksum));
+        return CO_ERROR_OD_PARAMETERS;
+    }
+
     SRDO->SRDOGuard = SRDOGuard;
     SRDO->em = em;
-    SRDO->SDO = SDO;
-    SRDO->SRDOCommPar = SRDOCommPar;
-    SRDO->SRDOMapPar = SRDOMapPar;
-    SRDO->checksum = checksum;
+    SRDO->OD = OD;
+    SRDO->OD_130x_entry = OD_130x_SRDOCommPar;
+    SRDO->OD_138x_entry = OD_138x_SRDOMapPar;
     SRDO->CANdevRx = CANdevRx;
     SRDO->CANdevRxIdx[0] = CANdevRxIdxNormal;
     SRDO->CANdevRxIdx[1] = CANdevRxIdxInverted;
@@ -589,18 +849,25 @@ CO_ReturnError_t CO_SRDO_init(
     SRDO->defaultCOB_ID[0] = defaultCOB_ID;
     SRDO->defaultCOB_ID[1] = defaultCOB_ID + 1;
     SRDO->valid = CO_SRDO_INVALID;
-    SRDO->toogle = 0;
-    SRDO->timer = 0;
-    SRDO->pFunctSignalSafe = NULL;
-    SRDO->functSignalObjectSafe = NULL;
-#if (CO_CONFIG_SRDO) & CO_CONFIG_FLAG_CALLBACK_PRE
-    SRDO->pFunctSignalPre = NULL;
-    SRDO->functSignalObjectPre = NULL;
-#endif
+    SRDO->checksumCached = false;
 
     /* Configure Object dictionary entry at index 0x1301+ and 0x1381+ */
-    CO_OD_configure(SDO, idx_SRDOCommPar, CO_ODF_SRDOcom, (void*)SRDO, 0, 0);
-    CO_OD_configure(SDO, idx_SRDOMapPar, CO_ODF_SRDOmap, (void*)SRDO, 0, 0);
+    ODR_t odRet0 = OD_extensionIO_init(OD_130x_SRDOCommPar,
+                                       (void *)SRDO,
+                                       OD_read_130x,
+                                       OD_write_130x);
+    if (odRet0 != ODR_OK) {
+        CO_errinfo(CANdevRx, OD_getIndex(OD_130x_SRDOCommPar));
+        return CO_ERROR_OD_PARAMETERS;
+    }
+    ODR_t odRet1 = OD_extensionIO_init(OD_138x_SRDOMapPar,
+                                       (void *)SRDO,
+                                       OD_readOriginal,
+                                       OD_write_138x);
+    if (odRet1 != ODR_OK) {
+        CO_errinfo(CANdevRx, OD_getIndex(OD_138x_SRDOMapPar));
+        return CO_ERROR_OD_PARAMETERS;
+    }
 
     return CO_ERROR_NO;
 }
@@ -621,6 +888,62 @@ CO_ReturnError_t CO_SRDO_requestSend(
     return CO_ERROR_NO;
 }
 
+/* Copy mapped objects from the Object Dictionary into CAN message */
+static void CO_SRDO_copyFromOD(CO_SRDO_copy_t *copy, uint8_t count,
+                               uint8_t *msg)
+{
+    for (; count > 0; count--, copy++) {
+        uint8_t *dest = &msg[copy->offset];
+#if (CO_CONFIG_SRDO) & CO_CONFIG_TSRDO_CALLS_EXTENSION
+        if (copy->useIO) {
+            ODR_t odRet;
+            OD_rwRestart(&copy->io.stream);
+            copy->io.read(&copy->io.stream, copy->subIndex,
+                          dest, copy->length, &odRet);
+            continue;
+        }
+#endif
+#ifdef CO_BIG_ENDIAN
+        if (copy->swap) {
+            uint8_t i;
+            for (i = 0; i < copy->length; i++) {
+                dest[i] = copy->data[copy->length - 1 - i];
+            }
+            continue;
+        }
+#endif
+        memcpy(dest, copy->data, copy->length);
+    }
+}
+
+/* Copy data from CAN message into mapped objects in the Object Dictionary */
+static void CO_SRDO_copyToOD(CO_SRDO_copy_t *copy, uint8_t count,
+                             const uint8_t *msg)
+{
+    for (; count > 0; count--, copy++) {
+        const uint8_t *src = &msg[copy->offset];
+#if (CO_CONFIG_SRDO) & CO_CONFIG_RSRDO_CALLS_EXTENSION
+        if (copy->useIO) {
+            ODR_t odRet;
+            OD_rwRestart(&copy->io.stream);
+            copy->io.write(&copy->io.stream, copy->subIndex,
+                           src, copy->length, &odRet);
+            continue;
+        }
+#endif
+#ifdef CO_BIG_ENDIAN
+        if (copy->swap) {
+            uint8_t i;
+            for (i = 0; i < copy->length; i++) {
+                copy->data[copy->length - 1 - i] = src[i];
+            }
+            continue;
+        }
+#endif
+        memcpy(copy->data, src, copy->length);
+    }
+}
+
 void CO_SRDO_process(
         CO_SRDO_t              *SRDO,
         uint8_t                 commands,
@@ -628,16 +951,22 @@ void CO_SRDO_process(
         uint32_t               *timerNext_us)
 {
     (void)timerNext_us; /* may be unused */
+#if (CO_CONFIG_SRDO) & CO_CONFIG_SRDO_PROCESS_TIME
+    uint32_t timeStart_us = CO_timestamp_us();
+#endif
 
     if(commands & (1<<1)){
-        uint16_t crcValue = CO_SRDOcalcCrc(SRDO);
-        if (*SRDO->checksum != crcValue)
+        if (!SRDO->checksumCached) {
+            SRDO->checksumCalculated = CO_SRDOcalcCrc(SRDO);
+            SRDO->checksumCached = true;
+        }
+        if (*SRDO->checksum != SRDO->checksumCalculated)
             *SRDO->SRDOGuard->configurationValid = 0;
     }
 
     if((commands & (1<<0)) && *SRDO->SRDOGuard->configurationValid == CO_SRDO_VALID_MAGIC){
-        if(CO_SRDOconfigMap(SRDO, SRDO->SRDOMapPar->numberOfMappedObjects) == 0){
-            CO_SRDOconfigCom(SRDO, SRDO->SRDOCommPar->COB_ID1_normal, SRDO->SRDOCommPar->COB_ID2_inverted);
+        if(CO_SRDOconfigMap(SRDO) == ODR_OK){
+            CO_SRDOconfigCom(SRDO);
         }
         else{
             SRDO->valid = CO_SRDO_INVALID;
@@ -650,74 +979,22 @@ void CO_SRDO_process(
             if(SRDO->timer == 0){
                 if(SRDO->toogle){
                     CO_CANsend(SRDO->CANdevTx, SRDO->CANtxBuff[1]);
-                    SRDO->timer = SRDO->SRDOCommPar->safetyCycleTime * 1000U - CO_CONFIG_SRDO_MINIMUM_DELAY;
+                    SRDO->timer = SRDO->cycleTime_us - CO_CONFIG_SRDO_MINIMUM_DELAY;
                 }
                 else{
-
-                    int16_t i;
-                    uint8_t* pSRDOdataByte_normal;
-                    uint8_t* pSRDOdataByte_inverted;
-
-                    uint8_t** ppODdataByte_normal;
-                    uint8_t** ppODdataByte_inverted;
-
+                    uint8_t *normal = &SRDO->CANtxBuff[0]->data[0];
+                    uint8_t *inverted = &SRDO->CANtxBuff[1]->data[0];
                     bool_t data_ok = true;
-#if (CO_CONFIG_SRDO) & CO_CONFIG_TSRDO_CALLS_EXTENSION
-                    if(SRDO->SDO->ODExtensions){
-                        /* for each mapped OD, check mapping to see if an OD extension is available, and call it if it is */
-                        const uint32_t* pMap = &SRDO->SRDOMapPar->mappedObjects[0];
-                        CO_SDO_t *pSDO = SRDO->SDO;
-
-                        for(i=SRDO->SRDOMapPar->numberOfMappedObjects; i>0; i--){
-                            uint32_t map = *(pMap++);
-                            uint16_t index = (uint16_t)(map>>16);
-                            uint8_t subIndex = (uint8_t)(map>>8);
-                            uint16_t entryNo = CO_OD_find(pSDO, index);
-                            if ( entryNo != 0xFFFF )
-                            {
-                                CO_OD_extension_t *ext = &pSDO->ODExtensions[entryNo];
-                                if( ext->pODFunc != NULL)
-                                {
-                                    CO_ODF_arg_t ODF_arg;
-                                    memset((void*)&ODF_arg, 0, sizeof(CO_ODF_arg_t));
-                                    ODF_arg.reading = true;
-                                    ODF_arg.index = index;
-                                    ODF_arg.subIndex = subIndex;
-                                    ODF_arg.object = ext->object;
-                                    ODF_arg.attribute = CO_OD_getAttribute(pSDO, entryNo, subIndex);
-                                    ODF_arg.pFlags = CO_OD_getFlagsPointer(pSDO, entryNo, subIndex);
-                                    ODF_arg.data = CO_OD_getDataPointer(pSDO, entryNo, subIndex); /* https://github.com/CANopenNode/CANopenNode/issues/100 */
-                                    ODF_arg.dataLength = CO_OD_getLength(pSDO, entryNo, subIndex);
-                                    ext->pODFunc(&ODF_arg);
-                                }
-                            }
-                        }
-                    }
-#endif
-                    pSRDOdataByte_normal = &SRDO->CANtxBuff[0]->data[0];
-                    ppODdataByte_normal = &SRDO->mapPointer[0][0];
 
-                    pSRDOdataByte_inverted = &SRDO->CANtxBuff[1]->data[0];
-                    ppODdataByte_inverted = &SRDO->mapPointer[1][0];
+                    /* Copy data from Object dictionary. */
+                    CO_SRDO_copyFromOD(SRDO->plan[0], SRDO->planCount[0], normal);
+                    CO_SRDO_copyFromOD(SRDO->plan[1], SRDO->planCount[1], inverted);
 
 #if (CO_CONFIG_SRDO) & CO_CONFIG_SRDO_CHECK_TX
                     /* check data before sending (optional) */
-                    for(i = 0; i<SRDO->dataLength; i++){
-                        uint8_t invert = ~*(ppODdataByte_inverted[i]);
-                        if (*(ppODdataByte_normal[i]) != invert)
-                        {
-                            data_ok = false;
-                            break;
-                        }
-                    }
+                    data_ok = CO_SRDO_dataConsistent(SRDO, normal, inverted);
 #endif
                     if(data_ok){
-                        /* Copy data from Object dictionary. */
-                        for(i = 0; i<SRDO->dataLength; i++){
-                            pSRDOdataByte_normal[i] = *(ppODdataByte_normal[i]);
-                            pSRDOdataByte_inverted[i] = *(ppODdataByte_inverted[i]);
-                        }
-
                         CO_CANsend(SRDO->CANdevTx, SRDO->CANtxBuff[0]);
 
                         SRDO->timer = CO_CONFIG_SRDO_MINIMUM_DELAY;
@@ -744,69 +1021,15 @@ void CO_SRDO_process(
             if(CO_FLAG_READ(SRDO->CANrxNew[SRDO->toogle])){
 
                 if(SRDO->toogle){
-                    int16_t i;
-                    uint8_t* pSRDOdataByte_normal;
-                    uint8_t* pSRDOdataByte_inverted;
-
-                    uint8_t** ppODdataByte_normal;
-                    uint8_t** ppODdataByte_inverted;
-                    bool_t data_ok = true;
-
-                    pSRDOdataByte_normal = &SRDO->CANrxData[0][0];
-                    pSRDOdataByte_inverted = &SRDO->CANrxData[1][0];
-                    for(i = 0; i<SRDO->dataLength; i++){
-                        uint8_t invert = ~pSRDOdataByte_inverted[i];
-                        if(pSRDOdataByte_normal[i] != invert){
-                            data_ok = false;
-                            break;
-                        }
-                    }
-                    if(data_ok){
-                        ppODdataByte_normal = &SRDO->mapPointer[0][0];
-                        ppODdataByte_inverted = &SRDO->mapPointer[1][0];
-
-                        /* Copy data to Object dictionary. If between the copy operation CANrxNew
-                        * is set to true by receive thread, then copy the latest data again. */
-
-                        for(i = 0; i<SRDO->dataLength; i++){
-                            *(ppODdataByte_normal[i]) = pSRDOdataByte_normal[i];
-                            *(ppODdataByte_inverted[i]) = pSRDOdataByte_inverted[i];
-                        }
+                    if(CO_SRDO_dataConsistent(SRDO, SRDO->CANrxData[0],
+                                              SRDO->CANrxData[1])){
+                        /* Copy data to Object dictionary. */
+                        CO_SRDO_copyToOD(SRDO->plan[0], SRDO->planCount[0],
+                                         SRDO->CANrxData[0]);
+                        CO_SRDO_copyToOD(SRDO->plan[1], SRDO->planCount[1],
+                                         SRDO->CANrxData[1]);
                         CO_FLAG_CLEAR(SRDO->CANrxNew[0]);
                         CO_FLAG_CLEAR(SRDO->CANrxNew[1]);
-#if (CO_CONFIG_SRDO) & CO_CONFIG_RSRDO_CALLS_EXTENSION
-                        if(SRDO->SDO->ODExtensions){
-                            int16_t i;
-                            /* for each mapped OD, check mapping to see if an OD extension is available, and call it if it is */
-                            const uint32_t* pMap = &SRDO->SRDOMapPar->mappedObjects[0];
-                            CO_SDO_t *pSDO = SRDO->SDO;
-
-                            for(i=SRDO->SRDOMapPar->numberOfMappedObjects; i>0; i--){
-                                uint32_t map = *(pMap++);
-                                uint16_t index = (uint16_t)(map>>16);
-                                uint8_t subIndex = (uint8_t)(map>>8);
-                                uint16_t entryNo = CO_OD_find(pSDO, index);
-                                if ( entryNo != 0xFFFF )
-                                {
-                                    CO_OD_extension_t *ext = &pSDO->ODExtensions[entryNo];
-                                    if( ext->pODFunc != NULL)
-                                    {
-                                        CO_ODF_arg_t ODF_arg;
-                                        memset((void*)&ODF_arg, 0, sizeof(CO_ODF_arg_t));
-                                        ODF_arg.reading = false;
-                                        ODF_arg.index = index;
-                                        ODF_arg.subIndex = subIndex;
-                                        ODF_arg.object = ext->object;
-                                        ODF_arg.attribute = CO_OD_getAttribute(pSDO, entryNo, subIndex);
-                                        ODF_arg.pFlags = CO_OD_getFlagsPointer(pSDO, entryNo, subIndex);
-                                        ODF_arg.data = CO_OD_getDataPointer(pSDO, entryNo, subIndex); /* https://github.com/CANopenNode/CANopenNode/issues/100 */
-                                        ODF_arg.dataLength = CO_OD_getLength(pSDO, entryNo, subIndex);
-                                        ext->pODFunc(&ODF_arg);
-                                    }
-                                }
-                            }
-                        }
-#endif
                     }
                     else{
                         CO_FLAG_CLEAR(SRDO->CANrxNew[0]);
@@ -816,18 +1039,25 @@ void CO_SRDO_process(
                             SRDO->pFunctSignalSafe(SRDO->functSignalObjectSafe);
                         }
                     }
+#if (CO_CONFIG_SRDO) & CO_CONFIG_SRDO_TIMING
+                    CO_safetyTiming_record(&SRDO->timing,
+                                           SRDO->rxTimestamp_us[0],
+                                           SRDO->rxTimestamp_us[1]
+                                           - SRDO->rxTimestamp_us[0],
+                                           SRDO->validationTime_us);
+#endif
 
-                    SRDO->timer = SRDO->SRDOCommPar->safetyCycleTime * 1000U;
+                    SRDO->timer = SRDO->cycleTime_us;
                 }
                 else{
-                    SRDO->timer = SRDO->SRDOCommPar->safetyRelatedValidationTime * 1000U;
+                    SRDO->timer = SRDO->validationTime_us;
                 }
                 SRDO->toogle = !SRDO->toogle;
             }
 
             if(SRDO->timer == 0){
                 SRDO->toogle = 0;
-                SRDO->timer = SRDO->SRDOCommPar->safetyRelatedValidationTime * 1000U;
+                SRDO->timer = SRDO->validationTime_us;
                 CO_FLAG_CLEAR(SRDO->CANrxNew[0]);
                 CO_FLAG_CLEAR(SRDO->CANrxNew[1]);
                 /* save state */
@@ -842,6 +1072,24 @@ void CO_SRDO_process(
         CO_FLAG_CLEAR(SRDO->CANrxNew[0]);
         CO_FLAG_CLEAR(SRDO->CANrxNew[1]);
     }
+
+#if (CO_CONFIG_SRDO) & CO_CONFIG_SRDO_TIMING
+    CO_safetyTiming_process(&SRDO->timing);
+#endif
+#if (CO_CONFIG_SRDO) & CO_CONFIG_SRDO_SAFE_RX
+    if (CO_FLAG_READ(SRDO->safeRxOverrunNew)) {
+        CO_FLAG_CLEAR(SRDO->safeRxOverrunNew);
+        CO_errorReport(SRDO->em, CO_EM_GENERIC_SOFTWARE_ERROR,
+                       CO_EMC_SOFTWARE_INTERNAL, SRDO->safeRxTimeMax_us);
+    }
+#endif
+
+#if (CO_CONFIG_SRDO) & CO_CONFIG_SRDO_PROCESS_TIME
+    SRDO->processTime_us = CO_timestamp_us() - timeStart_us;
+    if (SRDO->processTime_us > SRDO->processTimeMax_us) {
+        SRDO->processTimeMax_us = SRDO->processTime_us;
+    }
+#endif
 }
 
 #endif /* (CO_CONFIG_SRDO) & CO_CONFIG_SRDO_ENABLE */
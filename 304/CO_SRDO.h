@@ -27,9 +27,12 @@
 #define CO_SRDO_H
 
 #include "301/CO_driver.h"
-#include "301/CO_SDOserver.h"
+#include "301/CO_ODinterface.h"
 #include "301/CO_Emergency.h"
 #include "301/CO_NMT_Heartbeat.h"
+#if ((CO_CONFIG_SRDO) & CO_CONFIG_SRDO_TIMING) || defined CO_DOXYGEN
+#include "304/CO_safetyTiming.h"
+#endif
 
 /* default configuration, see CO_config.h */
 #ifndef CO_CONFIG_SRDO
@@ -38,6 +41,9 @@
 #ifndef CO_CONFIG_SRDO_MINIMUM_DELAY
 #define CO_CONFIG_SRDO_MINIMUM_DELAY 0
 #endif
+#ifndef CO_CONFIG_SRDO_SAFE_RX_BUDGET_US
+#define CO_CONFIG_SRDO_SAFE_RX_BUDGET_US 20
+#endif
 
 #if ((CO_CONFIG_SRDO) & CO_CONFIG_SRDO_ENABLE) || defined CO_DOXYGEN
 
@@ -57,52 +63,27 @@ extern "C" {
  * The second message must be bitwise inverted. The delay between the two messages and between each message pair is monitored.
  * The distinction between sending and receiving SRDO is made at runtime (for PDO it is compile time).
  * If the security protocol is used, at least one SRDO is mandatory.
+ *
+ * SRDO parameters are in the Object Dictionary: communication parameter
+ * (0x1301+), mapping parameter (0x1381+), configuration valid (0x13FE) and
+ * safety configuration checksum (0x13FF). All of them must have IO extension
+ * enabled. They can be written only outside NMT operational state and each
+ * write invalidates configuration.
+ *
+ * Mapping is resolved once, when SRDO is configured on entering NMT
+ * operational state. Each mapped object then has own entry in the copy plan
+ * for normal or for inverted data, so per cycle processing only copies bytes
+ * between the Object Dictionary and the CAN frames. Normal and inverted frames
+ * are compared as two 64-bit words.
+ *
+ * Configuration checksum is calculated only after SRDO parameters were written
+ * and it is cached otherwise. If application changes SRDO parameters directly
+ * in the Object Dictionary memory, it must call
+ * @ref CO_SRDO_invalidateChecksum().
  */
 
-
-/**
- * SRDO communication parameter. The same as record from Object dictionary (index 0x1301-0x1340).
- */
-typedef struct{
-    uint8_t             maxSubIndex;    /**< Equal to 6 */
-    /** Direction of the SRDO. Values:
-        - 0: SRDO is invalid (deleted)
-        - 1: SRDO is transmiting data
-        - 2: SRDO is receive data */
-    uint8_t             informationDirection;
-    /** Refresh-time / SCT
-        - in tx mode (Refresh-time): transmission interval
-        - in rx mode (SCT): receive timeout between two SRDO */
-    uint16_t            safetyCycleTime;
-    /** SRVT
-        - in tx mode: unsed
-        - in rx mode: receive timeout between first and second SRDO message */
-    uint8_t             safetyRelatedValidationTime;
-    /** Transmission type. Values:
-        - 254:     Manufacturer specific.*/
-    uint8_t             transmissionType;
-    /** Communication object identifier for message received. Meaning of the specific bits:
-        - Bit  0-10: COB-ID for SRDO
-        - Bit 11-31: set to 0 for 11 bit COB-ID. */
-    uint32_t            COB_ID1_normal;
-    /** Communication object identifier for message received. Meaning of the specific bits:
-        - Bit  0-10: COB-ID for SRDO
-        - Bit 11-31: set to 0 for 11 bit COB-ID. */
-    uint32_t            COB_ID2_inverted;
-}CO_SRDOCommPar_t;
-
-
-typedef struct{
-    /** Actual number of mapped objects from 0 to 16. Only even numbers are allowed. To change mapped object,
-    this value must be 0. */
-    uint8_t             numberOfMappedObjects;
-    /** Location and size of the mapped object.
-        Even index is the normal object. Odd index is the inverted object. Bit meanings `0xIIIISSLL`:
-        - Bit  0-7:  Data Length in bits.
-        - Bit 8-15:  Subindex from object distionary.
-        - Bit 16-31: Index from object distionary. */
-    uint32_t            mappedObjects[16];
-}CO_SRDOMapPar_t;
+/** Maximum number of mapped objects, normal and inverted together */
+#define CO_SRDO_MAX_MAPPED_ENTRIES 16
 
 /**
  * Gurad Object for SRDO
@@ -112,30 +93,82 @@ typedef struct{
  * - change in operation state
  */
 typedef struct{
-    CO_NMT_internalState_t *operatingState;     /**< pointer to current operation state */
-    CO_NMT_internalState_t  operatingStatePrev; /**< last operation state */
+    uint8_t                *operatingState;     /**< pointer to current operation state, @ref CO_NMT_internalState_t */
+    uint8_t                 operatingStatePrev; /**< last operation state */
     uint8_t                *configurationValid; /**< pointer to the configuration valid flag in OD */
     uint8_t                 checkCRC;           /**< specifies whether a CRC check should be performed */
 }CO_SRDOGuard_t;
 
+/**
+ * One entry of the SRDO copy plan, mapped object.
+ */
+typedef struct{
+    /** Pointer to the variable in the Object Dictionary, or to the dummy */
+    uint8_t                *data;
+#if ((CO_CONFIG_SRDO) & (CO_CONFIG_RSRDO_CALLS_EXTENSION | CO_CONFIG_TSRDO_CALLS_EXTENSION)) || defined CO_DOXYGEN
+    /** Object Dictionary IO, used instead of data, if useIO is true */
+    OD_IO_t                 io;
+    /** True, if variable has IO extension, which must be called */
+    bool_t                  useIO;
+    /** Sub-index of the variable, used with io */
+    uint8_t                 subIndex;
+#endif
+    /** Offset of the data inside CAN message */
+    uint8_t                 offset;
+    /** Length of the data in bytes */
+    uint8_t                 length;
+#if defined CO_BIG_ENDIAN || defined CO_DOXYGEN
+    /** True for multi-byte variable, which must be swapped */
+    bool_t                  swap;
+#endif
+}CO_SRDO_copy_t;
+
+/**
+ * Reason for the safe state, detected inside CAN receive function, see
+ * CO_SRDO_initCallbackSafeRx().
+ */
+typedef enum {
+    /** Inverted data are not bitwise complement of normal data */
+    CO_SRDO_SAFE_RX_MISMATCH = 1,
+    /** Inverted message received after safetyRelatedValidationTime */
+    CO_SRDO_SAFE_RX_LATE = 2
+} CO_SRDO_safeRx_t;
+
 /**
  * SRDO object.
  */
 typedef struct{
     CO_EM_t                *em;                  /**< From CO_SRDO_init() */
-    CO_SDO_t               *SDO;                 /**< From CO_SRDO_init() */
+    const OD_t             *OD;                  /**< From CO_SRDO_init() */
     CO_SRDOGuard_t         *SRDOGuard;           /**< From CO_SRDO_init() */
-    /** Pointers to 2*8 data objects, where SRDO will be copied */
-    uint8_t                *mapPointer[2][8];
+    /** From CO_SRDO_init(), SRDO communication parameter (0x1301+) */
+    const OD_entry_t       *OD_130x_entry;
+    /** From CO_SRDO_init(), SRDO mapping parameter (0x1381+) */
+    const OD_entry_t       *OD_138x_entry;
+    /** Copy plans, [0] for normal data and [1] for inverted data */
+    CO_SRDO_copy_t          plan[2][CO_SRDO_MAX_MAPPED_ENTRIES / 2];
+    /** Number of used entries in each plan */
+    uint8_t                 planCount[2];
     /** Data length of the received SRDO message. Calculated from mapping */
     uint8_t                 dataLength;
+    /** Mask of dataLength bytes, applied to the CAN message loaded into
+     * uint64_t */
+    uint64_t                dataMask;
     uint8_t                 nodeId;              /**< From CO_SRDO_init() */
     uint16_t                defaultCOB_ID[2];    /**< From CO_SRDO_init() */
     /** 0 - invalid, 1 - tx, 2 - rx */
     uint8_t                 valid;
-    const CO_SRDOCommPar_t *SRDOCommPar;         /**< From CO_SRDO_init() */
-    const CO_SRDOMapPar_t  *SRDOMapPar;          /**< From CO_SRDO_init() */
-    const uint16_t         *checksum;            /**< From CO_SRDO_init() */
+    /** Safety cycle time in microseconds, from the OD when configured */
+    uint32_t                cycleTime_us;
+    /** Safety related validation time in microseconds, from the OD when
+     * configured */
+    uint32_t                validationTime_us;
+    /** Pointer to the checksum for this SRDO inside the OD (0x13FF) */
+    const uint16_t         *checksum;
+    /** Cached configuration checksum, valid if checksumCached is true */
+    uint16_t                checksumCalculated;
+    /** False, if SRDO parameters were written after checksum calculation */
+    bool_t                  checksumCached;
     CO_CANmodule_t         *CANdevRx;            /**< From CO_SRDO_init() */
     CO_CANmodule_t         *CANdevTx;            /**< From CO_SRDO_init() */
     CO_CANtx_t             *CANtxBuff[2];        /**< CAN transmit buffer inside CANdevTx */
@@ -157,6 +190,38 @@ typedef struct{
     /** From CO_SRDO_initCallbackPre() or NULL */
     void                   *functSignalObjectPre;
 #endif
+#if ((CO_CONFIG_SRDO) & CO_CONFIG_SRDO_PROCESS_TIME) || defined CO_DOXYGEN
+    /** Execution time of the last CO_SRDO_process() call in microseconds */
+    uint32_t                processTime_us;
+    /** Worst case execution time of CO_SRDO_process() in microseconds.
+     * Application may reset it to zero. */
+    uint32_t                processTimeMax_us;
+#endif
+#if ((CO_CONFIG_SRDO) & (CO_CONFIG_SRDO_TIMING | CO_CONFIG_SRDO_SAFE_RX)) \
+    || defined CO_DOXYGEN
+    /** Reception time of the normal and inverted message by the CAN driver,
+     * from CO_CANrxMsg_readTimestamp_us() */
+    uint32_t                rxTimestamp_us[2];
+#endif
+#if ((CO_CONFIG_SRDO) & CO_CONFIG_SRDO_SAFE_RX) || defined CO_DOXYGEN
+    /** From CO_SRDO_initCallbackSafeRx() or NULL */
+    void                  (*pFunctSafeRx)(void *object,
+                                          CO_SRDO_safeRx_t reason);
+    /** From CO_SRDO_initCallbackSafeRx() or NULL */
+    void                   *functSafeRxObject;
+    /** Worst case execution time of pFunctSafeRx in microseconds */
+    uint32_t                safeRxTimeMax_us;
+    /** Number of pFunctSafeRx calls longer than
+     * CO_CONFIG_SRDO_SAFE_RX_BUDGET_US */
+    uint32_t                safeRxOverruns;
+    /** Set on budget overrun, emergency is reported from CO_SRDO_process() */
+    volatile void          *safeRxOverrunNew;
+#endif
+#if ((CO_CONFIG_SRDO) & CO_CONFIG_SRDO_TIMING) || defined CO_DOXYGEN
+    /** Timing statistics of Rx SRDO, initialized by CO_safetyTiming_init()
+     * after CO_SRDO_init() */
+    CO_safetyTiming_t       timing;
+#endif
 }CO_SRDO_t;
 
 /**
@@ -165,21 +230,22 @@ typedef struct{
  * Function must be called in the communication reset section.
  *
  * @param SRDOGuard This object will be initialized.
- * @param SDO SDO object.
  * @param operatingState Pointer to variable indicating CANopen device NMT internal state.
- * @param configurationValid Pointer to variable with the SR valid flag
- * @param idx_SRDOvalid Index in Object Dictionary
- * @param idx_SRDOcrc Index in Object Dictionary
+ * @param OD_13FE_configurationValid OD entry for 0x13FE - "Configuration
+ * valid", entry is required, IO extension is required.
+ * @param OD_13FF_safetyConfigurationChecksum OD entry for 0x13FF - "Safety
+ * configuration checksum", entry is required, IO extension is required.
+ * @param CANdevRx CAN device, used for @ref CO_errinfo().
  *
- * @return #CO_ReturnError_t: CO_ERROR_NO or CO_ERROR_ILLEGAL_ARGUMENT.
+ * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT or
+ * CO_ERROR_OD_PARAMETERS.
  */
 CO_ReturnError_t CO_SRDOGuard_init(
         CO_SRDOGuard_t         *SRDOGuard,
-        CO_SDO_t               *SDO,
-        CO_NMT_internalState_t *operatingState,
-        uint8_t                *configurationValid,
-        uint16_t                idx_SRDOvalid,
-        uint16_t                idx_SRDOcrc);
+        uint8_t                *operatingState,
+        const OD_entry_t       *OD_13FE_configurationValid,
+        const OD_entry_t       *OD_13FF_safetyConfigurationChecksum,
+        CO_CANmodule_t         *CANdevRx);
 
 /**
  * Process operation and valid state changes.
@@ -200,16 +266,15 @@ uint8_t CO_SRDOGuard_process(
  * @param SRDO This object will be initialized.
  * @param SRDOGuard SRDOGuard object.
  * @param em Emergency object.
- * @param SDO SDO object.
+ * @param OD Object Dictionary, where mapped objects are searched.
  * @param nodeId CANopen Node ID of this device. If default COB_ID is used, value will be added.
  * @param defaultCOB_ID Default COB ID for this SRDO (without NodeId).
- * @param SRDOCommPar Pointer to _SRDO communication parameter_ record from Object
- * dictionary (index 0x1301+).
- * @param SRDOMapPar Pointer to _SRDO mapping parameter_ record from Object
- * dictionary (index 0x1381+).
- * @param checksum
- * @param idx_SRDOCommPar Index in Object Dictionary
- * @param idx_SRDOMapPar Index in Object Dictionary
+ * @param OD_130x_SRDOCommPar OD entry for 0x1301+ - "SRDO communication
+ * parameter", entry is required, IO extension is required.
+ * @param OD_138x_SRDOMapPar OD entry for 0x1381+ - "SRDO mapping parameter",
+ * entry is required, IO extension is required.
+ * @param OD_13FF_safetyConfigurationChecksum OD entry for 0x13FF - "Safety
+ * configuration checksum", sub-index is determined from OD_130x_SRDOCommPar.
  * @param CANdevRx CAN device used for SRDO reception.
  * @param CANdevRxIdxNormal Index of receive buffer in the above CAN device.
  * @param CANdevRxIdxInverted Index of receive buffer in the above CAN device.
@@ -217,20 +282,19 @@ uint8_t CO_SRDOGuard_process(
  * @param CANdevTxIdxNormal Index of transmit buffer in the above CAN device.
  * @param CANdevTxIdxInverted Index of transmit buffer in the above CAN device.
  *
- * @return #CO_ReturnError_t: CO_ERROR_NO or CO_ERROR_ILLEGAL_ARGUMENT.
+ * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT or
+ * CO_ERROR_OD_PARAMETERS.
  */
 CO_ReturnError_t CO_SRDO_init(
         CO_SRDO_t              *SRDO,
         CO_SRDOGuard_t         *SRDOGuard,
         CO_EM_t                *em,
-        CO_SDO_t               *SDO,
+        const OD_t             *OD,
         uint8_t                 nodeId,
         uint16_t                defaultCOB_ID,
-        const CO_SRDOCommPar_t *SRDOCommPar,
-        const CO_SRDOMapPar_t  *SRDOMapPar,
-        const uint16_t         *checksum,
-        uint16_t                idx_SRDOCommPar,
-        uint16_t                idx_SRDOMapPar,
+        const OD_entry_t       *OD_130x_SRDOCommPar,
+        const OD_entry_t       *OD_138x_SRDOMapPar,
+        const OD_entry_t       *OD_13FF_safetyConfigurationChecksum,
         CO_CANmodule_t         *CANdevRx,
         uint16_t                CANdevRxIdxNormal,
         uint16_t                CANdevRxIdxInverted,
@@ -274,6 +338,39 @@ void CO_SRDO_initCallbackEnterSafeState(
         void                  (*pFunctSignalSafe)(void *object));
 
 
+#if ((CO_CONFIG_SRDO) & CO_CONFIG_SRDO_SAFE_RX) || defined CO_DOXYGEN
+/**
+ * Initialize SRDO safe state callback, called from CAN receive function.
+ *
+ * With @ref CO_CONFIG_SRDO_SAFE_RX, inverted Rx SRDO message is compared with
+ * normal message already inside CAN receive function. If data are not
+ * consistent, or if inverted message came after safetyRelatedValidationTime,
+ * callback is called immediately from there, independent of the
+ * CO_SRDO_process() cadence. Message is then processed as usual and
+ * CO_SRDO_process() calls pFunctSignalSafe() as well. Missing messages are
+ * still detected only by CO_SRDO_process().
+ *
+ * Callback runs in CAN receive context (interrupt or receive thread) and must
+ * finish in bounded time, must not allocate memory, block, take locks, access
+ * the Object Dictionary or call CANopenNode functions. Typically it only sets
+ * outputs to safe values or signals a task. CANopenNode calls it at most once
+ * per message pair, without holding any lock. Execution time is measured into
+ * safeRxTimeMax_us. Each call longer than @ref CO_CONFIG_SRDO_SAFE_RX_BUDGET_US
+ * is counted in safeRxOverruns and reported as emergency
+ * @ref CO_EM_GENERIC_SOFTWARE_ERROR from CO_SRDO_process().
+ *
+ * @param SRDO This object.
+ * @param object Pointer to object, which will be passed to pFunctSafeRx(). Can
+ * be NULL
+ * @param pFunctSafeRx Pointer to the callback function. Not called if NULL.
+ */
+void CO_SRDO_initCallbackSafeRx(
+        CO_SRDO_t              *SRDO,
+        void                   *object,
+        void                  (*pFunctSafeRx)(void *object,
+                                              CO_SRDO_safeRx_t reason));
+#endif
+
 /**
  * Send SRDO on event
  *
@@ -286,12 +383,28 @@ void CO_SRDO_initCallbackEnterSafeState(
 CO_ReturnError_t CO_SRDO_requestSend(
         CO_SRDO_t              *SRDO);
 
+/**
+ * Invalidate cached configuration checksum.
+ *
+ * Must be called, if SRDO parameters are changed directly in the Object
+ * Dictionary memory, not through the SDO or OD_set_value() with IO extension.
+ *
+ * @param SRDO This object.
+ */
+static inline void CO_SRDO_invalidateChecksum(CO_SRDO_t *SRDO) {
+    if (SRDO != NULL) SRDO->checksumCached = false;
+}
+
 /**
  * Process transmitting/receiving SRDO messages.
  *
  *  This function verifies the checksum on demand.
  *  This function also configures the SRDO on operation state change to operational
  *
+ * If @ref CO_CONFIG_SRDO_PROCESS_TIME is enabled, function measures own
+ * execution time with CO_timestamp_us() and stores it into processTime_us
+ * and processTimeMax_us.
+ *
  * @param SRDO This object.
  * @param commands result from CO_SRDOGuard_process().
  * @param timeDifference_us Time difference from previous function call in [microseconds].
@@ -0,0 +1,240 @@
+/**
+ * CANopen Safety timing statistics for SRDO and GFC.
+ *
+ * @file        CO_safetyTiming.c
+ * @ingroup     CO_safetyTiming
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "304/CO_safetyTiming.h"
+
+#if (((CO_CONFIG_SRDO) & CO_CONFIG_SRDO_ENABLE) \
+     && ((CO_CONFIG_SRDO) & CO_CONFIG_SRDO_TIMING)) \
+    || (((CO_CONFIG_GFC) & CO_CONFIG_GFC_ENABLE) \
+        && ((CO_CONFIG_GFC) & CO_CONFIG_GFC_TIMING))
+
+/* verify configuration */
+#ifndef CO_timestamp_us
+ #error CO_timestamp_us() must be defined by CO_driver_target.h
+#endif
+
+/* sub-indexes of the "safety timing" object */
+#define SUB_COUNT           1
+#define SUB_RX_TIMESTAMP    2
+#define SUB_PAIR_MIN        3
+#define SUB_PAIR_MAX        4
+#define SUB_REACTION_LAST   5
+#define SUB_REACTION_MIN    6
+#define SUB_REACTION_MAX    7
+#define SUB_LIMIT           8
+#define SUB_VIOLATIONS      9
+#define SUB_HIST            10
+
+#define NO_VALUE 0xFFFFFFFFUL
+
+
+static void timingReset(CO_safetyTiming_t *st) {
+    st->count = 0;
+    st->rxTimestamp_us = 0;
+    st->pairMin_us = NO_VALUE;
+    st->pairMax_us = 0;
+    st->reactionLast_us = 0;
+    st->reactionMin_us = NO_VALUE;
+    st->reactionMax_us = 0;
+    st->violations = 0;
+    memset(st->hist, 0, sizeof(st->hist));
+}
+
+
+/*
+ * Custom functions for read/write OD object "safety timing"
+ *
+ * For more information see file CO_ODinterface.h, OD_IO_t.
+ */
+static OD_size_t OD_read_safetyTiming(OD_stream_t *stream, uint8_t subIndex,
+                                      void *buf, OD_size_t count,
+                                      ODR_t *returnCode)
+{
+    if (stream == NULL || buf == NULL || returnCode == NULL) {
+        if (returnCode != NULL) *returnCode = ODR_DEV_INCOMPAT;
+        return 0;
+    }
+
+    CO_safetyTiming_t *st = (CO_safetyTiming_t *)stream->object;
+    uint32_t value;
+
+    if (subIndex < SUB_COUNT
+        || subIndex >= SUB_HIST + CO_SAFETY_TIMING_HIST_SIZE
+    ) {
+        return OD_readOriginal(stream, subIndex, buf, count, returnCode);
+    }
+    if (count < sizeof(uint32_t)) {
+        *returnCode = ODR_DEV_INCOMPAT;
+        return 0;
+    }
+
+    switch (subIndex) {
+    case SUB_COUNT:         value = st->count; break;
+    case SUB_RX_TIMESTAMP:  value = st->rxTimestamp_us; break;
+    case SUB_PAIR_MIN:      value = st->pairMin_us; break;
+    case SUB_PAIR_MAX:      value = st->pairMax_us; break;
+    case SUB_REACTION_LAST: value = st->reactionLast_us; break;
+    case SUB_REACTION_MIN:  value = st->reactionMin_us; break;
+    case SUB_REACTION_MAX:  value = st->reactionMax_us; break;
+    case SUB_LIMIT:         value = st->limit_us; break;
+    case SUB_VIOLATIONS:    value = st->violations; break;
+    default:                value = st->hist[subIndex - SUB_HIST]; break;
+    }
+
+    /* reset is pending, report values as reset */
+    if (st->resetRequest && subIndex != SUB_LIMIT) {
+        value = (subIndex == SUB_PAIR_MIN || subIndex == SUB_REACTION_MIN)
+              ? NO_VALUE : 0;
+    }
+
+    *returnCode = ODR_OK;
+    return CO_setUint32(buf, value);
+}
+
+static OD_size_t OD_write_safetyTiming(OD_stream_t *stream, uint8_t subIndex,
+                                       const void *buf, OD_size_t count,
+                                       ODR_t *returnCode)
+{
+    if (stream == NULL || buf == NULL || returnCode == NULL) {
+        if (returnCode != NULL) *returnCode = ODR_DEV_INCOMPAT;
+        return 0;
+    }
+
+    CO_safetyTiming_t *st = (CO_safetyTiming_t *)stream->object;
+
+    switch (subIndex) {
+    case SUB_COUNT:
+        if (count != sizeof(uint32_t)) {
+            *returnCode = ODR_TYPE_MISMATCH;
+            return 0;
+        }
+        if (CO_getUint32(buf) != 0) {
+            *returnCode = ODR_INVALID_VALUE;
+            return 0;
+        }
+        /* applied by the next event, which owns the statistics */
+        st->resetRequest = true;
+        CO_errorReset(st->em, CO_EM_SAFETY_LATENCY, 0);
+        break;
+    case SUB_LIMIT:
+        if (count != sizeof(uint32_t)) {
+            *returnCode = ODR_TYPE_MISMATCH;
+            return 0;
+        }
+        st->limit_us = CO_getUint32(buf);
+        break;
+    default:
+        if (subIndex > SUB_COUNT
+            && subIndex < SUB_HIST + CO_SAFETY_TIMING_HIST_SIZE
+        ) {
+            *returnCode = ODR_READONLY;
+            return 0;
+        }
+        break;
+    }
+
+    /* write value to the original location in the Object Dictionary */
+    return OD_writeOriginal(stream, subIndex, buf, count, returnCode);
+}
+
+
+/******************************************************************************/
+CO_ReturnError_t CO_safetyTiming_init(CO_safetyTiming_t *st,
+                                      CO_EM_t *em,
+                                      const OD_entry_t *OD_timing,
+                                      uint32_t *errInfo)
+{
+    /* verify arguments */
+    if (st == NULL || em == NULL) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    /* clear the object */
+    memset(st, 0, sizeof(CO_safetyTiming_t));
+    st->em = em;
+    CO_FLAG_CLEAR(st->violationNew);
+    timingReset(st);
+
+    /* Object Dictionary entry is optional */
+    if (OD_timing == NULL) {
+        return CO_ERROR_NO;
+    }
+
+    ODR_t odRet0 = OD_get_u32(OD_timing, SUB_LIMIT, &st->limit_us, true);
+    ODR_t odRet1 = OD_extensionIO_init(OD_timing,
+                                       (void *)st,
+                                       OD_read_safetyTiming,
+                                       OD_write_safetyTiming);
+    if (odRet0 != ODR_OK || odRet1 != ODR_OK) {
+        if (errInfo != NULL) *errInfo = OD_getIndex(OD_timing);
+        return CO_ERROR_OD_PARAMETERS;
+    }
+
+    return CO_ERROR_NO;
+}
+
+
+/******************************************************************************/
+void CO_safetyTiming_record(CO_safetyTiming_t *st,
+                            uint32_t rxTimestamp_us,
+                            uint32_t pair_us,
+                            uint32_t limitDefault_us)
+{
+    uint32_t reaction_us = CO_timestamp_us() - rxTimestamp_us;
+    uint32_t limit_us = st->limit_us != 0 ? st->limit_us : limitDefault_us;
+    uint8_t i;
+
+    if (st->resetRequest) {
+        timingReset(st);
+        st->resetRequest = false;
+    }
+
+    st->count++;
+    st->rxTimestamp_us = rxTimestamp_us;
+    if (pair_us != NO_VALUE) {
+        if (pair_us < st->pairMin_us) st->pairMin_us = pair_us;
+        if (pair_us > st->pairMax_us) st->pairMax_us = pair_us;
+    }
+    st->reactionLast_us = reaction_us;
+    if (reaction_us < st->reactionMin_us) st->reactionMin_us = reaction_us;
+    if (reaction_us > st->reactionMax_us) st->reactionMax_us = reaction_us;
+
+    for (i = 0; i < (CO_SAFETY_TIMING_HIST_SIZE - 1); i++) {
+        if (reaction_us < ((uint32_t)CO_SAFETY_TIMING_HIST_BASE_US << i)) {
+            break;
+        }
+    }
+    st->hist[i]++;
+
+    if (limit_us != 0 && reaction_us > limit_us) {
+        st->violations++;
+        st->violationReaction_us = reaction_us;
+        CO_FLAG_SET(st->violationNew);
+    }
+}
+
+#endif /* CO_CONFIG_SRDO_TIMING || CO_CONFIG_GFC_TIMING */
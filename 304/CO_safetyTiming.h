@@ -0,0 +1,224 @@
+/**
+ * CANopen Safety timing statistics for SRDO and GFC.
+ *
+ * @file        CO_safetyTiming.h
+ * @ingroup     CO_safetyTiming
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CO_SAFETY_TIMING_H
+#define CO_SAFETY_TIMING_H
+
+#include "301/CO_driver.h"
+#include "301/CO_ODinterface.h"
+#include "301/CO_Emergency.h"
+
+/* default configuration, see CO_config.h */
+#ifndef CO_CONFIG_SRDO
+#define CO_CONFIG_SRDO (0)
+#endif
+#ifndef CO_CONFIG_GFC
+#define CO_CONFIG_GFC (0)
+#endif
+
+#if (((CO_CONFIG_SRDO) & CO_CONFIG_SRDO_ENABLE) \
+     && ((CO_CONFIG_SRDO) & CO_CONFIG_SRDO_TIMING)) \
+    || (((CO_CONFIG_GFC) & CO_CONFIG_GFC_ENABLE) \
+        && ((CO_CONFIG_GFC) & CO_CONFIG_GFC_TIMING)) \
+    || defined CO_DOXYGEN
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup CO_safetyTiming Safety timing
+ * @ingroup CO_CANopen_304
+ * @{
+ *
+ * Timing statistics of the safety related reception paths (non-standard).
+ *
+ * Statistics are collected for each SRDO (@ref CO_CONFIG_SRDO_TIMING) and for
+ * GFC (@ref CO_CONFIG_GFC_TIMING). Timestamps are taken with CO_timestamp_us(),
+ * which must be defined by the target. Recording is always on, costs a few
+ * timestamp reads and integer operations per event and uses no locks or
+ * dynamic memory.
+ *
+ * - Receive time is the time of the reception of the (normal) CAN message by
+ *   the driver, see CO_CANrxMsg_readTimestamp_us(). Without driver timestamps
+ *   it is the time of the CAN receive function.
+ * - Pair time (SRDO only) is the time from the normal to the inverted CAN
+ *   message.
+ * - Reaction time is the time from the reception to the end of the check. For
+ *   SRDO this is the end of the normal/inverted comparison in
+ *   CO_SRDO_process(), including the copy into the OD or the safe state
+ *   callback. For GFC this is the time, when the safe state callback
+ *   returns.
+ *
+ * If reaction time exceeds the limit, the violation is counted and emergency
+ * @ref CO_EM_SAFETY_LATENCY with @ref CO_EMC_MONITORING is reported, with
+ * reaction time in microseconds as info code. For SRDO, the default limit is
+ * safetyRelatedValidationTime. CO_safetyTiming_record() takes no locks, so it
+ * may run inside CAN receive function. Emergency is reported later, from
+ * CO_safetyTiming_process().
+ *
+ * OD object "safety timing" (@ref OD_INDEX_SRDO_TIMING + SRDO number or
+ * @ref OD_INDEX_GFC_TIMING), RECORD with IO extension, all UNSIGNED32. Object
+ * is optional, statistics are recorded also without it. All times are in
+ * microseconds:
+ * - sub 1, rw: number of events. Writing 0 resets the statistics and the
+ *   emergency. Reset is applied by the next event, statistics read as reset
+ *   meanwhile.
+ * - sub 2, ro: receive time of the last event, timestamp from
+ *   CO_timestamp_us().
+ * - sub 3, ro: minimum pair time, 0xFFFFFFFF if none.
+ * - sub 4, ro: maximum pair time.
+ * - sub 5, ro: last reaction time.
+ * - sub 6, ro: minimum reaction time, 0xFFFFFFFF if none.
+ * - sub 7, ro: maximum reaction time.
+ * - sub 8, rw: limit for the reaction time, 0 for default.
+ * - sub 9, ro: number of limit violations.
+ * - sub 10..17, ro: histogram of reaction times, see
+ *   @ref CO_SAFETY_TIMING_HIST_BASE_US.
+ *
+ * Objects can be read via SDO or locally via gateway, for example
+ * `[1] <own node-ID> r 0x2330 7 u32` with CO_CONFIG_SDO_CLI_LOCAL.
+ */
+
+
+/**
+ * Start index of safety timing objects in Object Dictionary.
+ */
+#ifndef OD_INDEX_SRDO_TIMING
+#define OD_INDEX_SRDO_TIMING    0x2330
+#define OD_INDEX_GFC_TIMING     0x2370
+#endif
+
+/** Number of histogram buckets */
+#define CO_SAFETY_TIMING_HIST_SIZE 8
+
+/**
+ * Upper bound of the first histogram bucket in microseconds. Bucket i counts
+ * reaction times below (base << i), the last bucket counts the rest.
+ */
+#ifndef CO_SAFETY_TIMING_HIST_BASE_US
+#define CO_SAFETY_TIMING_HIST_BASE_US 250
+#endif
+
+
+/**
+ * Safety timing object.
+ */
+typedef struct {
+    /** From CO_safetyTiming_init() */
+    CO_EM_t *em;
+    /** Number of events */
+    uint32_t count;
+    /** Receive time of the last event */
+    uint32_t rxTimestamp_us;
+    /** Minimum pair time */
+    uint32_t pairMin_us;
+    /** Maximum pair time */
+    uint32_t pairMax_us;
+    /** Last reaction time */
+    uint32_t reactionLast_us;
+    /** Minimum reaction time */
+    uint32_t reactionMin_us;
+    /** Maximum reaction time */
+    uint32_t reactionMax_us;
+    /** Limit for the reaction time, 0 for default */
+    uint32_t limit_us;
+    /** Number of limit violations */
+    uint32_t violations;
+    /** Histogram of reaction times */
+    uint32_t hist[CO_SAFETY_TIMING_HIST_SIZE];
+    /** Reset requested from OD, applied by the next event */
+    volatile bool_t resetRequest;
+    /** Set by CO_safetyTiming_record() on limit violation, cleared by
+     * CO_safetyTiming_process() */
+    volatile void *violationNew;
+    /** Reaction time of the last limit violation */
+    uint32_t violationReaction_us;
+} CO_safetyTiming_t;
+
+
+/**
+ * Initialize safety timing object.
+ *
+ * Function must be called in the communication reset section.
+ *
+ * @param st This object will be initialized.
+ * @param em Emergency object.
+ * @param OD_timing OD entry for "safety timing" object, may be NULL.
+ * @param [out] errInfo Index of erroneous OD object, may be NULL.
+ *
+ * @return CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT or CO_ERROR_OD_PARAMETERS.
+ */
+CO_ReturnError_t CO_safetyTiming_init(CO_safetyTiming_t *st,
+                                      CO_EM_t *em,
+                                      const OD_entry_t *OD_timing,
+                                      uint32_t *errInfo);
+
+
+/**
+ * Record one event.
+ *
+ * Function is called from the SRDO or GFC object, which owns the timestamps.
+ * It may be called from CAN receive function or from realtime thread, but
+ * only from one of them for the same object.
+ *
+ * @param st This object.
+ * @param rxTimestamp_us Receive time of the event.
+ * @param pair_us Pair time or 0xFFFFFFFF, if not used.
+ * @param limitDefault_us Limit for the reaction time, if not set in OD. If 0,
+ * limit is not checked.
+ */
+void CO_safetyTiming_record(CO_safetyTiming_t *st,
+                            uint32_t rxTimestamp_us,
+                            uint32_t pair_us,
+                            uint32_t limitDefault_us);
+
+
+/**
+ * Report emergency for the limit violation, recorded by
+ * CO_safetyTiming_record().
+ *
+ * Function is called cyclically from the processing function of the owner
+ * object, outside CAN receive function.
+ *
+ * @param st This object.
+ */
+static inline void CO_safetyTiming_process(CO_safetyTiming_t *st) {
+    if (CO_FLAG_READ(st->violationNew)) {
+        CO_FLAG_CLEAR(st->violationNew);
+        CO_errorReport(st->em, CO_EM_SAFETY_LATENCY, CO_EMC_MONITORING,
+                       st->violationReaction_us);
+    }
+}
+
+/** @} */ /* CO_safetyTiming */
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus*/
+
+#endif /* CO_CONFIG_SRDO_TIMING || CO_CONFIG_GFC_TIMING */
+
+#endif /* CO_SAFETY_TIMING_H */
@@ -82,14 +82,15 @@ static void CO_LSSmaster_receive(void *object, void *msg)
 
     LSSmaster = (CO_LSSmaster_t*)object;   /* this is the correct pointer type of the first argument */
 
-    /* verify message length and message overflow (previous message was not processed yet) */
-    if(DLC==8 && !CO_FLAG_READ(LSSmaster->CANrxNew) &&
-       LSSmaster->command!=CO_LSSmaster_COMMAND_WAITING){
-
-        /* copy data and set 'new message' flag */
-        memcpy(LSSmaster->CANrxData, data, sizeof(LSSmaster->CANrxData));
-
-        CO_FLAG_SET(LSSmaster->CANrxNew);
+    /* verify message length and if response is expected */
+    if(DLC==8 && LSSmaster->command!=CO_LSSmaster_COMMAND_WAITING){
+        /* copy data into receive queue, message is discarded if full */
+        int16_t i = CO_rxQueue_pushIndex(&LSSmaster->CANrxQueue);
+        if (i < 0) {
+            return;
+        }
+        memcpy(LSSmaster->CANrxData[i], data, sizeof(LSSmaster->CANrxData[i]));
+        CO_rxQueue_push(&LSSmaster->CANrxQueue);
 
 #if (CO_CONFIG_LSS) & CO_CONFIG_FLAG_CALLBACK_PRE
         /* Optional signal to RTOS, which can resume task, which handles further processing. */
@@ -145,7 +146,7 @@ CO_ReturnError_t CO_LSSmaster_init(
     LSSmaster->state = CO_LSSmaster_STATE_WAITING;
     LSSmaster->command = CO_LSSmaster_COMMAND_WAITING;
     LSSmaster->timeoutTimer = 0;
-    CO_FLAG_CLEAR(LSSmaster->CANrxNew);
+    CO_rxQueue_init(&LSSmaster->CANrxQueue);
     memset(LSSmaster->CANrxData, 0, sizeof(LSSmaster->CANrxData));
 #if (CO_CONFIG_LSS) & CO_CONFIG_FLAG_CALLBACK_PRE
     LSSmaster->pFunctSignal = NULL;
@@ -221,7 +222,7 @@ static CO_LSSmaster_return_t CO_LSSmaster_switchStateSelectInitiate(
       LSSmaster->command = CO_LSSmaster_COMMAND_SWITCH_STATE;
       LSSmaster->timeoutTimer = 0;
 
-      CO_FLAG_CLEAR(LSSmaster->CANrxNew);
+      CO_rxQueue_clear(&LSSmaster->CANrxQueue);
       memset(&LSSmaster->TXbuff->data[6], 0, sizeof(LSSmaster->TXbuff->data) - 6);
       LSSmaster->TXbuff->data[0] = CO_LSS_SWITCH_STATE_SEL_VENDOR;
       CO_setUint32(&LSSmaster->TXbuff->data[1], lssAddress->identity.vendorID);
@@ -242,7 +243,7 @@ static CO_LSSmaster_return_t CO_LSSmaster_switchStateSelectInitiate(
       /* switch state global */
       LSSmaster->state = CO_LSSmaster_STATE_CFG_GLOBAL;
 
-      CO_FLAG_CLEAR(LSSmaster->CANrxNew);
+      CO_rxQueue_clear(&LSSmaster->CANrxQueue);
       LSSmaster->TXbuff->data[0] = CO_LSS_SWITCH_STATE_GLOBAL;
       LSSmaster->TXbuff->data[1] = CO_LSS_STATE_CONFIGURATION;
       memset(&LSSmaster->TXbuff->data[2], 0, sizeof(LSSmaster->TXbuff->data) - 2);
@@ -263,9 +264,10 @@ static CO_LSSmaster_return_t CO_LSSmaster_switchStateSelectWait(
 {
     CO_LSSmaster_return_t ret;
 
-    if (CO_FLAG_READ(LSSmaster->CANrxNew)) {
-        uint8_t cs = LSSmaster->CANrxData[0];
-        CO_FLAG_CLEAR(LSSmaster->CANrxNew);
+    int16_t rxIdx = CO_rxQueue_peekIndex(&LSSmaster->CANrxQueue);
+    if (rxIdx >= 0) {
+        uint8_t cs = LSSmaster->CANrxData[rxIdx][0];
+        CO_rxQueue_drop(&LSSmaster->CANrxQueue);
 
         if (cs == CO_LSS_SWITCH_STATE_SEL) {
             /* confirmation received */
@@ -335,7 +337,7 @@ CO_LSSmaster_return_t CO_LSSmaster_switchStateDeselect(
     LSSmaster->timeoutTimer = 0;
 
     /* switch state global */
-    CO_FLAG_CLEAR(LSSmaster->CANrxNew);
+    CO_rxQueue_clear(&LSSmaster->CANrxQueue);
     LSSmaster->TXbuff->data[0] = CO_LSS_SWITCH_STATE_GLOBAL;
     LSSmaster->TXbuff->data[1] = CO_LSS_STATE_WAITING;
     memset(&LSSmaster->TXbuff->data[2], 0, sizeof(LSSmaster->TXbuff->data) - 2);
@@ -373,10 +375,11 @@ static CO_LSSmaster_return_t CO_LSSmaster_configureCheckWait(
 {
     CO_LSSmaster_return_t ret;
 
-    if (CO_FLAG_READ(LSSmaster->CANrxNew)) {
-        uint8_t cs = LSSmaster->CANrxData[0];
-        uint8_t errorCode = LSSmaster->CANrxData[1];
-        CO_FLAG_CLEAR(LSSmaster->CANrxNew);
+    int16_t rxIdx = CO_rxQueue_peekIndex(&LSSmaster->CANrxQueue);
+    if (rxIdx >= 0) {
+        uint8_t cs = LSSmaster->CANrxData[rxIdx][0];
+        uint8_t errorCode = LSSmaster->CANrxData[rxIdx][1];
+        CO_rxQueue_drop(&LSSmaster->CANrxQueue);
 
         if (cs == csWait) {
             if (errorCode == 0) {
@@ -438,7 +441,7 @@ CO_LSSmaster_return_t CO_LSSmaster_configureBitTiming(
         LSSmaster->command = CO_LSSmaster_COMMAND_CFG_BIT_TIMING;
         LSSmaster->timeoutTimer = 0;
 
-        CO_FLAG_CLEAR(LSSmaster->CANrxNew);
+        CO_rxQueue_clear(&LSSmaster->CANrxQueue);
         LSSmaster->TXbuff->data[0] = CO_LSS_CFG_BIT_TIMING;
         LSSmaster->TXbuff->data[1] = 0;
         LSSmaster->TXbuff->data[2] = bitTiming;
@@ -484,7 +487,7 @@ CO_LSSmaster_return_t CO_LSSmaster_configureNodeId(
         LSSmaster->command = CO_LSSmaster_COMMAND_CFG_NODE_ID;
         LSSmaster->timeoutTimer = 0;
 
-        CO_FLAG_CLEAR(LSSmaster->CANrxNew);
+        CO_rxQueue_clear(&LSSmaster->CANrxQueue);
         LSSmaster->TXbuff->data[0] = CO_LSS_CFG_NODE_ID;
         LSSmaster->TXbuff->data[1] = nodeId;
         memset(&LSSmaster->TXbuff->data[2], 0, sizeof(LSSmaster->TXbuff->data) - 2);
@@ -525,7 +528,7 @@ CO_LSSmaster_return_t CO_LSSmaster_configureStore(
         LSSmaster->command = CO_LSSmaster_COMMAND_CFG_STORE;
         LSSmaster->timeoutTimer = 0;
 
-        CO_FLAG_CLEAR(LSSmaster->CANrxNew);
+        CO_rxQueue_clear(&LSSmaster->CANrxQueue);
         LSSmaster->TXbuff->data[0] = CO_LSS_CFG_STORE;
         memset(&LSSmaster->TXbuff->data[1], 0, sizeof(LSSmaster->TXbuff->data) - 1);
         CO_CANsend(LSSmaster->CANdevTx, LSSmaster->TXbuff);
@@ -563,7 +566,7 @@ CO_LSSmaster_return_t CO_LSSmaster_ActivateBit(
     if (LSSmaster->state==CO_LSSmaster_STATE_CFG_GLOBAL &&
         LSSmaster->command==CO_LSSmaster_COMMAND_WAITING){
 
-        CO_FLAG_CLEAR(LSSmaster->CANrxNew);
+        CO_rxQueue_clear(&LSSmaster->CANrxQueue);
         LSSmaster->TXbuff->data[0] = CO_LSS_CFG_ACTIVATE_BIT_TIMING;
         CO_setUint16(&LSSmaster->TXbuff->data[1], switchDelay_ms);
         memset(&LSSmaster->TXbuff->data[3], 0, sizeof(LSSmaster->TXbuff->data) - 3);
@@ -583,7 +586,7 @@ static CO_LSSmaster_return_t CO_LSSmaster_inquireInitiate(
         CO_LSSmaster_t         *LSSmaster,
         uint8_t                 cs)
 {
-    CO_FLAG_CLEAR(LSSmaster->CANrxNew);
+    CO_rxQueue_clear(&LSSmaster->CANrxQueue);
     LSSmaster->TXbuff->data[0] = cs;
     memset(&LSSmaster->TXbuff->data[1], 0, sizeof(LSSmaster->TXbuff->data) - 1);
     CO_CANsend(LSSmaster->CANdevTx, LSSmaster->TXbuff);
@@ -602,10 +605,11 @@ static CO_LSSmaster_return_t CO_LSSmaster_inquireCheckWait(
 {
     CO_LSSmaster_return_t ret;
 
-    if (CO_FLAG_READ(LSSmaster->CANrxNew)) {
-        uint8_t cs = LSSmaster->CANrxData[0];
-        *value = CO_getUint32(&LSSmaster->CANrxData[1]);
-        CO_FLAG_CLEAR(LSSmaster->CANrxNew);
+    int16_t rxIdx = CO_rxQueue_peekIndex(&LSSmaster->CANrxQueue);
+    if (rxIdx >= 0) {
+        uint8_t cs = LSSmaster->CANrxData[rxIdx][0];
+        *value = CO_getUint32(&LSSmaster->CANrxData[rxIdx][1]);
+        CO_rxQueue_drop(&LSSmaster->CANrxQueue);
 
         if (cs == csWait) {
             ret = CO_LSSmaster_OK;
@@ -755,7 +759,7 @@ static void CO_LSSmaster_FsSendMsg(
 {
     LSSmaster->timeoutTimer = 0;
 
-    CO_FLAG_CLEAR(LSSmaster->CANrxNew);
+    CO_rxQueue_clear(&LSSmaster->CANrxQueue);
     LSSmaster->TXbuff->data[0] = CO_LSS_IDENT_FASTSCAN;
     CO_setUint32(&LSSmaster->TXbuff->data[1], idNumber);
     LSSmaster->TXbuff->data[5] = bitCheck;
@@ -778,9 +782,10 @@ static CO_LSSmaster_return_t CO_LSSmaster_FsCheckWait(
     if (ret == CO_LSSmaster_TIMEOUT) {
         ret = CO_LSSmaster_SCAN_NOACK;
 
-        if (CO_FLAG_READ(LSSmaster->CANrxNew)) {
-            uint8_t cs = LSSmaster->CANrxData[0];
-            CO_FLAG_CLEAR(LSSmaster->CANrxNew);
+        int16_t rxIdx = CO_rxQueue_peekIndex(&LSSmaster->CANrxQueue);
+        if (rxIdx >= 0) {
+            uint8_t cs = LSSmaster->CANrxData[rxIdx][0];
+            CO_rxQueue_drop(&LSSmaster->CANrxQueue);
 
             if (cs == CO_LSS_IDENT_SLAVE) {
                 /* At least one node is waiting for fastscan */
@@ -852,9 +857,10 @@ static CO_LSSmaster_return_t CO_LSSmaster_FsScanWait(
 
         ret = CO_LSSmaster_WAIT_SLAVE;
 
-        if (CO_FLAG_READ(LSSmaster->CANrxNew)) {
-            uint8_t cs = LSSmaster->CANrxData[0];
-            CO_FLAG_CLEAR(LSSmaster->CANrxNew);
+        int16_t rxIdx = CO_rxQueue_peekIndex(&LSSmaster->CANrxQueue);
+        if (rxIdx >= 0) {
+            uint8_t cs = LSSmaster->CANrxData[rxIdx][0];
+            CO_rxQueue_drop(&LSSmaster->CANrxQueue);
 
             if (cs != CO_LSS_IDENT_SLAVE) {
                 /* wrong response received. Can not continue */
@@ -938,9 +944,10 @@ static CO_LSSmaster_return_t CO_LSSmaster_FsVerifyWait(
         *idNumberRet = 0;
         ret = CO_LSSmaster_SCAN_NOACK;
 
-        if (CO_FLAG_READ(LSSmaster->CANrxNew)) {
-            uint8_t cs = LSSmaster->CANrxData[0];
-            CO_FLAG_CLEAR(LSSmaster->CANrxNew);
+        int16_t rxIdx = CO_rxQueue_peekIndex(&LSSmaster->CANrxQueue);
+        if (rxIdx >= 0) {
+            uint8_t cs = LSSmaster->CANrxData[rxIdx][0];
+            CO_rxQueue_drop(&LSSmaster->CANrxQueue);
 
             if (cs == CO_LSS_IDENT_SLAVE) {
                 *idNumberRet = LSSmaster->fsIdNumber;
@@ -28,6 +28,7 @@
 #define CO_LSSmaster_H
 
 #include "305/CO_LSS.h"
+#include "301/CO_rxQueue.h"
 
 #if ((CO_CONFIG_LSS) & CO_CONFIG_LSS_MASTER) || defined CO_DOXYGEN
 
@@ -117,8 +118,8 @@ typedef struct{
     uint8_t          fsBitChecked;     /**< Current scan bit position */
     uint32_t         fsIdNumber;       /**< Current scan result */
 
-    volatile void   *CANrxNew;         /**< Indication if new LSS message is received from CAN bus. It needs to be cleared when received message is completely processed. */
-    uint8_t          CANrxData[8];     /**< 8 data bytes of the received message */
+    CO_rxQueue_t     CANrxQueue;       /**< Queue of LSS messages received from CAN bus */
+    uint8_t          CANrxData[CO_CONFIG_RX_QUEUE_SIZE][8]; /**< 8 data bytes of the received messages, used by CANrxQueue */
 #if ((CO_CONFIG_LSS) & CO_CONFIG_FLAG_CALLBACK_PRE) || defined CO_DOXYGEN
     void           (*pFunctSignal)(void *object); /**< From CO_LSSmaster_initCallbackPre() or NULL */
     void            *functSignalObject;/**< Pointer to object */
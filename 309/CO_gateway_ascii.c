@@ -903,10 +903,31 @@ void CO_GTWA_process(CO_GTWA_t *gtwa,
                 break;
             }
 
+#if (CO_CONFIG_SDO_CLI) & CO_CONFIG_SDO_CLI_LOCAL
+            /* own node: read data directly into SDO client buffer, if they
+             * fit. CO_SDOclientUpload() then just finishes. */
+            SDO_ret = CO_SDO_RT_uploadDataBufferFull;
+            if (gtwa->node == gtwa->SDO_C->nodeId) {
+                CO_SDO_abortCode_t abortCode;
+                SDO_ret = CO_SDOclientUploadLocal(gtwa->SDO_C, idx, subidx,
+                                                  NULL, 0, NULL, &abortCode);
+                if (SDO_ret < 0) {
+                    responseWithErrorSDO(gtwa, abortCode, false);
+                    break;
+                }
+            }
+            /* initiate upload, data are transferred in parts */
+            if (SDO_ret == CO_SDO_RT_uploadDataBufferFull) {
+                SDO_ret = CO_SDOclientUploadInitiate(gtwa->SDO_C, idx, subidx,
+                                                  gtwa->SDOtimeoutTime,
+                                                  gtwa->SDOblockTransferEnable);
+            }
+#else
             /* initiate upload */
             SDO_ret = CO_SDOclientUploadInitiate(gtwa->SDO_C, idx, subidx,
                                                  gtwa->SDOtimeoutTime,
                                                  gtwa->SDOblockTransferEnable);
+#endif
             if (SDO_ret != CO_SDO_RT_ok_communicationEnd) {
                 respErrorCode = CO_GTWA_respErrorInternalState;
                 err = true;
@@ -1001,10 +1022,33 @@ void CO_GTWA_process(CO_GTWA_t *gtwa,
                 CO_SDOclientDownloadInitiateSize(gtwa->SDO_C, size);
             }
 
-            /* continue with state machine */
-            gtwa->stateTimeoutTmr = 0;
-            timeDifference_us = 0;
-            gtwa->state = CO_GTWA_ST_WRITE;
+#if (CO_CONFIG_SDO_CLI) & CO_CONFIG_SDO_CLI_LOCAL
+            /* own node: if all data fit into SDO client buffer, write them
+             * directly to Object Dictionary. Buffer was reset by
+             * CO_SDOclientDownloadInitiate(), so data are at its beginning. */
+            if (gtwa->node == gtwa->SDO_C->nodeId
+                && !gtwa->SDOdataCopyStatus
+            ) {
+                CO_SDO_abortCode_t abortCode;
+
+                SDO_ret = CO_SDOclientDownloadLocal(gtwa->SDO_C, idx, subidx,
+                                            (const uint8_t *)gtwa->SDO_C->buf,
+                                            size, &abortCode);
+                CO_SDOclientClose(gtwa->SDO_C);
+                if (SDO_ret < 0) {
+                    responseWithErrorSDO(gtwa, abortCode, false);
+                    break;
+                }
+                responseWithOK(gtwa);
+            }
+            else
+#endif
+            {
+                /* continue with state machine */
+                gtwa->stateTimeoutTmr = 0;
+                timeDifference_us = 0;
+                gtwa->state = CO_GTWA_ST_WRITE;
+            }
         }
 #endif /* (CO_CONFIG_GTW) & CO_CONFIG_GTW_ASCII_SDO */
 
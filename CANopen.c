@@ -536,6 +536,10 @@ CO_t *CO_new(CO_config_t *config, uint32_t *heapMemoryUsed) {
             if (p == NULL) break;
             else co->trace = (CO_trace_t *)p;
             mem += sizeof(CO_trace_t) * CO_GET_CNT(TRACE);
+            p = calloc(CO_GET_CNT(TRACE), CO_CONFIG_TRACE_BUFFER_SIZE);
+            if (p == NULL) break;
+            else co->traceBuffer = (uint8_t *)p;
+            mem += CO_CONFIG_TRACE_BUFFER_SIZE * CO_GET_CNT(TRACE);
         }
 #endif
 
@@ -647,6 +651,7 @@ void CO_delete(CO_t *co) {
     free(co->CANmodule);
 
 #if (CO_CONFIG_TRACE) & CO_CONFIG_TRACE_ENABLE
+    free(co->traceBuffer);
     free(co->trace);
 #endif
 
@@ -764,12 +769,8 @@ void CO_delete(CO_t *co) {
     static CO_GTWA_t COO_gtwa;
 #endif
 #if (CO_CONFIG_TRACE) & CO_CONFIG_TRACE_ENABLE
-  #ifndef CO_TRACE_BUFFER_SIZE_FIXED
-    #define CO_TRACE_BUFFER_SIZE_FIXED 100
-  #endif
     static CO_trace_t COO_trace[OD_CNT_TRACE];
-    static uint32_t COO_traceTimeBuffers[OD_CNT_TRACE][CO_TRACE_BUFFER_SIZE_FIXED];
-    static int32_t COO_traceValueBuffers[OD_CNT_TRACE][CO_TRACE_BUFFER_SIZE_FIXED];
+    static uint8_t COO_traceBuffer[OD_CNT_TRACE][CO_CONFIG_TRACE_BUFFER_SIZE];
 #endif
 
 CO_t *CO_new(CO_config_t *config, uint32_t *heapMemoryUsed) {
@@ -823,9 +824,7 @@ CO_t *CO_new(CO_config_t *config, uint32_t *heapMemoryUsed) {
 #endif
 #if (CO_CONFIG_TRACE) & CO_CONFIG_TRACE_ENABLE
     co->trace = &COO_trace[0];
-    co->traceTimeBuffers = &COO_traceTimeBuffers[0][0];
-    co->traceValueBuffers = &COO_traceValueBuffers[0][0];
-    co->traceBufferSize = CO_TRACE_BUFFER_SIZE_FIXED;
+    co->traceBuffer = &COO_traceBuffer[0][0];
 #endif
 
     return co;
@@ -1146,7 +1145,7 @@ CO_ReturnError_t CO_CANopenInit(CO_t *co,
 #if (CO_CONFIG_GFC) & CO_CONFIG_GFC_ENABLE
     if (CO_GET_CNT(GFC) == 1) {
         err = CO_GFC_init(co->GFC,
-                          &OD_globalFailSafeCommandParameter,
+                          OD_find(od, OD_H1300_GFC_PARAM),
                           co->CANmodule,
                           CO_GET_CO(RX_IDX_GFC),
                           CO_CAN_ID_GFC,
@@ -1154,17 +1153,29 @@ CO_ReturnError_t CO_CANopenInit(CO_t *co,
                           CO_GET_CO(TX_IDX_GFC),
                           CO_CAN_ID_GFC);
         if (err) return err;
+ #if (CO_CONFIG_GFC) & CO_CONFIG_GFC_TIMING
+        uint32_t errInfo = 0;
+        err = CO_safetyTiming_init(&co->GFC->timing,
+                                   em,
+                                   OD_find(od, OD_INDEX_GFC_TIMING),
+                                   &errInfo);
+        if (err == CO_ERROR_OD_PARAMETERS) {
+            CO_errinfo(co->CANmodule, (int32_t)errInfo);
+        }
+        if (err) return err;
+ #endif
     }
 #endif
 
 #if (CO_CONFIG_SRDO) & CO_CONFIG_SRDO_ENABLE
     if (CO_GET_CNT(SRDO) > 0) {
+        const OD_entry_t *SRDOvalid = OD_find(od, OD_H13FE_SRDO_VALID);
+        const OD_entry_t *SRDOchecksum = OD_find(od, OD_H13FF_SRDO_CHECKSUM);
         err = CO_SRDOGuard_init(co->SRDOGuard,
-                                co->SDO[0],
                                 &co->NMT->operatingState,
-                                &OD_configurationValid,
-                                OD_H13FE_SRDO_VALID,
-                                OD_H13FF_SRDO_CHECKSUM);
+                                SRDOvalid,
+                                SRDOchecksum,
+                                co->CANmodule);
         if (err) return err;
 
         const OD_entry_t *SRDOcomm;
@@ -1178,14 +1189,12 @@ CO_ReturnError_t CO_CANopenInit(CO_t *co,
             err = CO_SRDO_init(&co->SRDO[i],
                                co->SRDOGuard,
                                em,
-                               co->SDO[0],
+                               od,
                                nodeId,
                                ((i == 0) ? CO_CAN_ID_SRDO_1 : 0),
                                SRDOcomm,
                                SRDOmap,
-                               &OD_safetyConfigurationChecksum[i],
-                               OD_H1301_SRDO_1_PARAM + i,
-                               OD_H1381_SRDO_1_MAPPING + i,
+                               SRDOchecksum,
                                co->CANmodule,
                                CANdevRxIdx,
                                CANdevRxIdx + 1,
@@ -1193,6 +1202,17 @@ CO_ReturnError_t CO_CANopenInit(CO_t *co,
                                CANdevTxIdx,
                                CANdevTxIdx + 1);
             if (err) return err;
+ #if (CO_CONFIG_SRDO) & CO_CONFIG_SRDO_TIMING
+            uint32_t errInfo = 0;
+            err = CO_safetyTiming_init(&co->SRDO[i].timing,
+                                       em,
+                                       OD_find(od, OD_INDEX_SRDO_TIMING + i),
+                                       &errInfo);
+            if (err == CO_ERROR_OD_PARAMETERS) {
+                CO_errinfo(co->CANmodule, (int32_t)errInfo);
+            }
+            if (err) return err;
+ #endif
         }
     }
 #endif
@@ -1235,23 +1255,19 @@ CO_ReturnError_t CO_CANopenInit(CO_t *co,
 
 #if (CO_CONFIG_TRACE) & CO_CONFIG_TRACE_ENABLE
     if (CO_GET_CNT(TRACE) > 0) {
-        for (uint16_t i = 0; i < CO_GET_CNT(TRACE); i++) {
-            err = CO_trace_init(co->trace[i],
-                                co->SDO[0],
-                                OD_traceConfig[i].axisNo,
-                                CO_traceTimeBuffers[i],
-                                CO_traceValueBuffers[i],
-                                CO_traceBufferSize[i],
-                                &OD_traceConfig[i].map,
-                                &OD_traceConfig[i].format,
-                                &OD_traceConfig[i].trigger,
-                                &OD_traceConfig[i].threshold,
-                                &OD_trace[i].value,
-                                &OD_trace[i].min,
-                                &OD_trace[i].max,
-                                &OD_trace[i].triggerTime,
-                                OD_INDEX_TRACE_CONFIG + i,
-                                OD_INDEX_TRACE + i);
+        for (int16_t i = 0; i < CO_GET_CNT(TRACE); i++) {
+            uint32_t errInfo = 0;
+            err = CO_trace_init(&co->trace[i],
+                                OD_find(od, OD_INDEX_TRACE_CONFIG + i),
+                                OD_find(od, OD_INDEX_TRACE + i),
+                                od,
+                                &co->traceBuffer[(size_t)i
+                                                 * CO_CONFIG_TRACE_BUFFER_SIZE],
+                                CO_CONFIG_TRACE_BUFFER_SIZE,
+                                &errInfo);
+            if (err == CO_ERROR_OD_PARAMETERS) {
+                CO_errinfo(co->CANmodule, (int32_t)errInfo);
+            }
             if (err) return err;
         }
     }
@@ -1347,6 +1363,13 @@ CO_NMT_reset_cmd_t CO_process(CO_t *co,
     }
 #endif
 
+#if ((CO_CONFIG_GFC) & CO_CONFIG_GFC_ENABLE) \
+    && ((CO_CONFIG_GFC) & CO_CONFIG_GFC_TIMING)
+    if (CO_GET_CNT(GFC) == 1) {
+        CO_GFC_process(co->GFC);
+    }
+#endif
+
     /* Emergency */
     if (CO_GET_CNT(EM) == 1) {
         CO_EM_process(co->em,
@@ -1458,3 +1481,13 @@ void CO_process_SRDO(CO_t *co,
     }
 }
 #endif
+
+
+/******************************************************************************/
+#if (CO_CONFIG_TRACE) & CO_CONFIG_TRACE_ENABLE
+void CO_process_TRACE(CO_t *co, uint32_t timeDifference_us) {
+    for (int16_t i = 0; i < CO_GET_CNT(TRACE); i++) {
+        CO_trace_process(&co->trace[i], timeDifference_us);
+    }
+}
+#endif
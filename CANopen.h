@@ -83,6 +83,14 @@
 #include "extra/CO_trace.h"
 #endif
 
+#if ((CO_CONFIG_MBX) & CO_CONFIG_MBX_ENABLE) || defined CO_DOXYGEN
+#include "extra/CO_mailbox.h"
+#endif
+
+#if ((CO_CONFIG_MBX) & CO_CONFIG_MBX_PROCESS_IMAGE) || defined CO_DOXYGEN
+#include "extra/CO_processImage.h"
+#endif
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -423,6 +431,8 @@ typedef struct {
 #if ((CO_CONFIG_TRACE) & CO_CONFIG_TRACE_ENABLE) || defined CO_DOXYGEN
     /** Trace object, initialised by @ref CO_trace_init(). */
     CO_trace_t *trace;
+    /** Buffers for trace objects, CO_CONFIG_TRACE_BUFFER_SIZE bytes each. */
+    uint8_t *traceBuffer;
 #endif
 } CO_t;
 
@@ -649,6 +659,22 @@ void CO_process_SRDO(CO_t *co,
                      uint32_t *timerNext_us);
 #endif
 
+
+#if ((CO_CONFIG_TRACE) & CO_CONFIG_TRACE_ENABLE) || defined CO_DOXYGEN
+/**
+ * Process trace objects.
+ *
+ * Function must be called cyclically from the same place as
+ * @ref CO_process_RPDO(), after RPDOs. It samples variables, recorded by
+ * trace objects.
+ *
+ * @param co CANopen object.
+ * @param timeDifference_us Time difference from previous function call in
+ * microseconds.
+ */
+void CO_process_TRACE(CO_t *co, uint32_t timeDifference_us);
+#endif
+
 /** @} */ /* CO_CANopen */
 
 #ifdef __cplusplus
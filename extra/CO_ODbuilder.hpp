@@ -0,0 +1,490 @@
+/**
+ * Compile time builder of the Object Dictionary for C++17.
+ *
+ * @file        CO_ODbuilder.hpp
+ * @ingroup     CO_ODbuilder
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CO_OD_BUILDER_HPP
+#define CO_OD_BUILDER_HPP
+
+#if __cplusplus < 201703L
+#error CO_ODbuilder.hpp requires C++17
+#endif
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#ifndef OD_DEFINITION
+#define OD_DEFINITION
+#endif
+#include "301/CO_ODinterface.h"
+
+/**
+ * @defgroup CO_ODbuilder OD builder
+ * @ingroup CO_CANopen_extra
+ * @{
+ *
+ * Object Dictionary, declared with typed constexpr objects in C++17.
+ *
+ * Header only layer over @ref CO_ODinterface. OD objects are declared with
+ * @ref CO_OD::var(), @ref CO_OD::array() and @ref CO_OD::record() from
+ * application variables. Data length and @ref ODA_MB attribute are derived
+ * from the type of the variable. Entries are collected with
+ * @ref CO_OD::entry() into array in any order. @ref CO_OD::makeList() sorts
+ * them by index, as required by @ref OD_find(), and @ref CO_OD::makeOD()
+ * creates OD_t, which is used by the C stack directly.
+ *
+ * All results must be declared as constexpr variables, then everything is
+ * calculated by the compiler and placed into read-only memory, there is no
+ * initialization code. Errors are reported at compile time as a call to
+ * non-constexpr function, which name describes the error, for example
+ * "CO_OD::error::duplicateIndex()":
+ * - duplicate index,
+ * - @ref ODA_MB on variable, which is not 2 to 8 bytes long,
+ * - @ref ODA_STR on variable, which is not an array,
+ * - PDO or SRDO mappable variable longer than 8 bytes,
+ * - record without sub-index 0 of length 1 or with unordered sub-indexes,
+ * - extended OD object without @ref OD_obj_extended_t.
+ *
+ * Additionally @ref CO_OD::find() looks up OD entry at compile time and
+ * @ref CO_OD::pdoMappable() emits the table of all PDO mappable sub-entries
+ * in the form of PDO mapping parameters.
+ *
+ * Example:
+ * @code
+#include "extra/CO_ODbuilder.hpp"
+
+uint32_t deviceType;
+uint8_t errorRegister;
+uint8_t errorField_sub0;
+uint32_t errorField[8];
+uint16_t producerHeartbeatTime;
+struct { uint8_t sub0; uint32_t vendorId, productCode; } identity = {2};
+OD_obj_extended_t ext1003;
+OD_obj_extended_t ext1017;
+
+constexpr auto o1000 = CO_OD::var(deviceType, ODA_SDO_R);
+constexpr auto o1001 = CO_OD::var(errorRegister, ODA_SDO_R | ODA_TPDO);
+constexpr auto o1003 = CO_OD::array(errorField_sub0, errorField,
+                                    ODA_SDO_RW, ODA_SDO_R, &ext1003);
+constexpr auto o1017 = CO_OD::var(producerHeartbeatTime, ODA_SDO_RW,
+                                  &ext1017);
+constexpr auto o1018 = CO_OD::record(nullptr,
+    CO_OD::sub(0, identity.sub0, ODA_SDO_R),
+    CO_OD::sub(1, identity.vendorId, ODA_SDO_R),
+    CO_OD::sub(2, identity.productCode, ODA_SDO_R));
+
+constexpr CO_OD::Entry entries[] = {
+    CO_OD::entry(0x1018, o1018),
+    CO_OD::entry(0x1000, o1000),
+    CO_OD::entry(0x1001, o1001),
+    CO_OD::entry(0x1017, o1017),
+    CO_OD::entry(0x1003, o1003)
+};
+constexpr auto ODList = CO_OD::makeList(entries);
+constexpr OD_t ODcpp = CO_OD::makeOD(ODList);
+constexpr const OD_entry_t *ENTRY_H1017 = CO_OD::find(ODList, 0x1017);
+constexpr auto mappable = CO_OD::pdoMappable<
+    CO_OD::pdoMappableCount(entries)>(entries);
+ * @endcode
+ */
+
+/** Compile time Object Dictionary builder */
+namespace CO_OD {
+
+/**
+ * Compile time errors. Functions are not constexpr, so their call inside
+ * constant evaluation stops compilation with the name of the function.
+ */
+namespace error {
+inline void duplicateIndex() {}
+inline void multiByteAttributeOnWrongSize() {}
+inline void stringAttributeOnNonArray() {}
+inline void mappableVariableLongerThan8Bytes() {}
+inline void recordWithoutSubIndex0() {}
+inline void recordSubIndexesNotOrdered() {}
+inline void extendedObjectWithoutExtension() {}
+} /* namespace error */
+
+/** @cond internal */
+namespace detail {
+template<typename T>
+constexpr OD_attr_t attribute(unsigned attr) {
+    /* multi-byte numbers are swapped on big-endian machines */
+    if constexpr (std::is_arithmetic_v<T> && sizeof(T) > 1) {
+        attr |= ODA_MB;
+    }
+    return static_cast<OD_attr_t>(attr);
+}
+
+template<typename T>
+constexpr void check(OD_attr_t attr, std::size_t length) {
+    if ((attr & ODA_MB) != 0 && (length < 2 || length > 8)) {
+        error::multiByteAttributeOnWrongSize();
+    }
+    if ((attr & ODA_STR) != 0 && !std::is_array_v<T>) {
+        error::stringAttributeOnNonArray();
+    }
+    if ((attr & (ODA_TRPDO | ODA_TRSRDO)) != 0 && length > 8) {
+        error::mappableVariableLongerThan8Bytes();
+    }
+}
+} /* namespace detail */
+/** @endcond */
+
+/**
+ * OD object for ARRAY, from @ref CO_OD::array()
+ *
+ * @tparam N Number of array elements, without sub-index 0.
+ */
+template<std::size_t N>
+struct Array {
+    /** Object used by the C stack, must be the first member */
+    OD_obj_array_t obj;
+};
+
+/**
+ * OD object for RECORD, from @ref CO_OD::record()
+ *
+ * @tparam N Number of sub-elements, including sub-index 0.
+ */
+template<std::size_t N>
+struct Record {
+    /** Objects used by the C stack, must be the first member */
+    OD_obj_record_t subs[N];
+};
+
+/**
+ * OD entry with typed pointer to the OD object, from @ref CO_OD::entry()
+ *
+ * Typed pointers are used by compile time checks, because void pointer can
+ * not be converted back inside constant expression.
+ */
+struct Entry {
+    uint16_t index;
+    uint8_t subEntriesCount;
+    uint8_t odObjectType;
+    const OD_obj_var_t *var;
+    const OD_obj_array_t *arr;
+    const OD_obj_record_t *rec;
+};
+
+/**
+ * PDO mappable sub-entry, from @ref CO_OD::pdoMappable()
+ */
+struct PdoMappable {
+    /** Value for PDO mapping parameter: index (16 bit), sub-index (8 bit),
+     * length in bits (8 bit) */
+    uint32_t mapping;
+    /** Attribute of the sub-entry */
+    OD_attr_t attribute;
+};
+
+/**
+ * OD object for VAR
+ *
+ * @param data Variable, data length is sizeof(T).
+ * @param attr Attributes, see @ref OD_attributes_t. @ref ODA_MB is added for
+ * arithmetic types longer than one byte.
+ * @param ext Optional extension, then object type is ODT_EVAR.
+ *
+ * @return OD object, must be stored in constexpr variable.
+ */
+template<typename T>
+constexpr OD_obj_var_t var(T &data, unsigned attr,
+                           OD_obj_extended_t *ext = nullptr)
+{
+    OD_attr_t a = detail::attribute<T>(attr);
+
+    detail::check<T>(a, sizeof(T));
+    return OD_obj_var_t{&data, a, static_cast<OD_size_t>(sizeof(T)), ext};
+}
+
+/**
+ * OD object for VAR without data (DOMAIN), accessed via extension
+ *
+ * @param attr Attributes, see @ref OD_attributes_t.
+ * @param ext Extension, must not be NULL.
+ */
+constexpr OD_obj_var_t domain(unsigned attr, OD_obj_extended_t *ext) {
+    if (ext == nullptr) {
+        error::extendedObjectWithoutExtension();
+    }
+    return OD_obj_var_t{nullptr, static_cast<OD_attr_t>(attr), 0, ext};
+}
+
+/**
+ * OD object for ARRAY
+ *
+ * @param sub0 Variable for sub-index 0 (number of elements).
+ * @param data Array of elements.
+ * @param attr0 Attributes of sub-index 0.
+ * @param attr Attributes of elements. @ref ODA_MB is added automatically.
+ * @param ext Optional extension, then object type is ODT_EARR.
+ */
+template<typename T, std::size_t N>
+constexpr Array<N> array(uint8_t &sub0, T (&data)[N], unsigned attr0,
+                         unsigned attr, OD_obj_extended_t *ext = nullptr)
+{
+    static_assert(N >= 1 && N <= 254, "Array must have 1 to 254 elements");
+    OD_attr_t a = detail::attribute<T>(attr);
+
+    detail::check<T>(a, sizeof(T));
+    return Array<N>{OD_obj_array_t{
+        OD_obj_var_t{&sub0, static_cast<OD_attr_t>(attr0), 1, ext},
+        &data[0], a, static_cast<OD_size_t>(sizeof(T)),
+        static_cast<OD_size_t>(sizeof(T))
+    }};
+}
+
+/**
+ * Sub-element of OD RECORD
+ *
+ * @param subIndex Sub-index.
+ * @param data Variable, data length is sizeof(T).
+ * @param attr Attributes. @ref ODA_MB is added automatically.
+ */
+template<typename T>
+constexpr OD_obj_record_t sub(uint8_t subIndex, T &data, unsigned attr) {
+    OD_attr_t a = detail::attribute<T>(attr);
+
+    detail::check<T>(a, sizeof(T));
+    return OD_obj_record_t{
+        OD_obj_var_t{&data, a, static_cast<OD_size_t>(sizeof(T)), nullptr},
+        subIndex
+    };
+}
+
+/**
+ * OD object for RECORD
+ *
+ * @param ext Optional extension for all sub-elements (or nullptr), then object
+ * type is ODT_EREC.
+ * @param subs Sub-elements from @ref CO_OD::sub(), ordered by sub-index,
+ * starting with sub-index 0 of length 1.
+ */
+template<typename... S>
+constexpr Record<sizeof...(S)> record(OD_obj_extended_t *ext, S... subs) {
+    static_assert(sizeof...(S) >= 1 && sizeof...(S) <= 255,
+                  "Record must have 1 to 255 sub-elements");
+    Record<sizeof...(S)> r{{subs...}};
+
+    if (r.subs[0].subIndex != 0 || r.subs[0].base.dataLength != 1) {
+        error::recordWithoutSubIndex0();
+    }
+    for (std::size_t i = 0; i < sizeof...(S); i++) {
+        if (i > 0 && r.subs[i].subIndex <= r.subs[i - 1].subIndex) {
+            error::recordSubIndexesNotOrdered();
+        }
+        r.subs[i].base.ext = ext;
+    }
+    return r;
+}
+
+/** OD entry for VAR object */
+constexpr Entry entry(uint16_t index, const OD_obj_var_t &o) {
+    return Entry{index, 1,
+                 static_cast<uint8_t>(o.ext != nullptr ? ODT_EVAR : ODT_VAR),
+                 &o, nullptr, nullptr};
+}
+
+/** OD entry for ARRAY object */
+template<std::size_t N>
+constexpr Entry entry(uint16_t index, const Array<N> &o) {
+    return Entry{index, static_cast<uint8_t>(N + 1),
+                 static_cast<uint8_t>(o.obj.base.ext != nullptr
+                                      ? ODT_EARR : ODT_ARR),
+                 nullptr, &o.obj, nullptr};
+}
+
+/** OD entry for RECORD object */
+template<std::size_t N>
+constexpr Entry entry(uint16_t index, const Record<N> &o) {
+    return Entry{index, static_cast<uint8_t>(N),
+                 static_cast<uint8_t>(o.subs[0].base.ext != nullptr
+                                      ? ODT_EREC : ODT_REC),
+                 nullptr, nullptr, &o.subs[0]};
+}
+
+/** @cond internal */
+namespace detail {
+/* Entries sorted by index, duplicates are errors */
+template<std::size_t N>
+constexpr std::array<Entry, N> sorted(const Entry (&entries)[N]) {
+    std::array<Entry, N> s{};
+
+    for (std::size_t i = 0; i < N; i++) {
+        std::size_t j = i;
+
+        while (j > 0 && s[j - 1].index > entries[i].index) {
+            s[j] = s[j - 1];
+            j--;
+        }
+        if (j > 0 && s[j - 1].index == entries[i].index) {
+            error::duplicateIndex();
+        }
+        s[j] = entries[i];
+    }
+    return s;
+}
+
+constexpr const void *object(const Entry &e) {
+    if (e.var != nullptr) return e.var;
+    if (e.arr != nullptr) return e.arr;
+    return e.rec;
+}
+
+/* Call fn(subIndex, attribute, dataLength) for each sub-entry */
+template<typename F>
+constexpr void forEachSub(const Entry &e, F fn) {
+    if (e.var != nullptr) {
+        fn(0, e.var->attribute, e.var->dataLength);
+    }
+    else if (e.arr != nullptr) {
+        fn(0, e.arr->base.attribute, 1);
+        for (unsigned i = 1; i < e.subEntriesCount; i++) {
+            fn(i, e.arr->attribute, e.arr->dataElementLength);
+        }
+    }
+    else if (e.rec != nullptr) {
+        for (unsigned i = 0; i < e.subEntriesCount; i++) {
+            fn(e.rec[i].subIndex, e.rec[i].base.attribute,
+               e.rec[i].base.dataLength);
+        }
+    }
+}
+
+constexpr bool isPdoMappable(OD_attr_t attr, OD_size_t dataLength) {
+    return (attr & ODA_TRPDO) != 0 && dataLength > 0;
+}
+} /* namespace detail */
+/** @endcond */
+
+/**
+ * Create OD list, sorted by index and terminated with blank element
+ *
+ * @param entries Array of entries from @ref CO_OD::entry(), any order.
+ *
+ * @return List, must be stored in constexpr variable.
+ */
+template<std::size_t N>
+constexpr std::array<OD_entry_t, N + 1> makeList(const Entry (&entries)[N]) {
+    static_assert(N >= 1 && N < 0xFFFF, "Wrong number of OD entries");
+    std::array<Entry, N> s = detail::sorted(entries);
+    std::array<OD_entry_t, N + 1> list{};
+
+    for (std::size_t i = 0; i < N; i++) {
+        list[i] = OD_entry_t{s[i].index, s[i].subEntriesCount,
+                             s[i].odObjectType, detail::object(s[i])};
+    }
+    list[N] = OD_entry_t{0, 0, 0, nullptr};
+    return list;
+}
+
+/**
+ * Create Object Dictionary from the list
+ *
+ * @param list List from @ref CO_OD::makeList(), stored in constexpr variable.
+ */
+template<std::size_t N>
+constexpr OD_t makeOD(const std::array<OD_entry_t, N> &list) {
+    return OD_t{static_cast<uint16_t>(N - 1), list.data()};
+}
+
+/**
+ * Find OD entry at compile time
+ *
+ * @param list List from @ref CO_OD::makeList(), stored in constexpr variable.
+ * @param index OD index.
+ *
+ * @return Pointer to entry inside list or nullptr, if not found.
+ */
+template<std::size_t N>
+constexpr const OD_entry_t *find(const std::array<OD_entry_t, N> &list,
+                                 uint16_t index)
+{
+    std::size_t min = 0;
+    std::size_t max = N - 1;
+
+    while (min < max) {
+        std::size_t cur = (min + max) / 2;
+
+        if (list[cur].index < index) min = cur + 1;
+        else max = cur;
+    }
+    return (min < N - 1 && list[min].index == index) ? &list[min] : nullptr;
+}
+
+/**
+ * Number of PDO mappable sub-entries, template argument for
+ * @ref CO_OD::pdoMappable()
+ */
+template<std::size_t N>
+constexpr std::size_t pdoMappableCount(const Entry (&entries)[N]) {
+    std::size_t count = 0;
+
+    for (std::size_t i = 0; i < N; i++) {
+        detail::forEachSub(entries[i],
+            [&count](unsigned, OD_attr_t attr, OD_size_t len) {
+                if (detail::isPdoMappable(attr, len)) count++;
+            });
+    }
+    return count;
+}
+
+/**
+ * Table of PDO mappable sub-entries, ordered by index and sub-index
+ *
+ * @tparam M Number of mappable sub-entries, from
+ * @ref CO_OD::pdoMappableCount().
+ * @param entries Array of entries from @ref CO_OD::entry().
+ */
+template<std::size_t M, std::size_t N>
+constexpr std::array<PdoMappable, M> pdoMappable(const Entry (&entries)[N]) {
+    std::array<Entry, N> s = detail::sorted(entries);
+    std::array<PdoMappable, M> table{};
+    std::size_t count = 0;
+
+    for (std::size_t i = 0; i < N; i++) {
+        uint16_t index = s[i].index;
+
+        detail::forEachSub(s[i],
+            [&table, &count, index](unsigned subIndex, OD_attr_t attr,
+                                    OD_size_t len) {
+                if (detail::isPdoMappable(attr, len) && count < M) {
+                    table[count].mapping = (static_cast<uint32_t>(index) << 16)
+                                           | (subIndex << 8) | (len * 8);
+                    table[count].attribute = attr;
+                    count++;
+                }
+            });
+    }
+    return table;
+}
+
+} /* namespace CO_OD */
+
+/** @} */ /* CO_ODbuilder */
+
+#endif /* CO_OD_BUILDER_HPP */
@@ -0,0 +1,276 @@
+/*
+ * Lock-free mailboxes for exchange of process data with the application.
+ *
+ * @file        CO_mailbox.c
+ * @ingroup     CO_mailbox
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "extra/CO_mailbox.h"
+
+#if (CO_CONFIG_MBX) & CO_CONFIG_MBX_ENABLE
+
+/* SPSC QUEUE *****************************************************************/
+CO_ReturnError_t CO_spsc_init(CO_spsc_t *q, void *buf,
+                              uint16_t count, OD_size_t elementSize)
+{
+    if (q == NULL || buf == NULL || count < 2 || elementSize == 0) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    q->buf = (uint8_t *)buf;
+    q->count = count;
+    q->elementSize = elementSize;
+    q->head = 0;
+    q->tail = 0;
+    q->overflow = 0;
+
+    return CO_ERROR_NO;
+}
+
+
+bool_t CO_spsc_push(CO_spsc_t *q, const void *data) {
+    uint16_t head = q->head;
+    uint16_t headNext = (head + 1 == q->count) ? 0 : head + 1;
+
+    if (headNext == q->tail) {
+        q->overflow++;
+        return false;
+    }
+
+    /* slot is free, consumer released it before it moved the tail */
+    CO_MemoryBarrier();
+    memcpy(&q->buf[(size_t)head * q->elementSize], data, q->elementSize);
+
+    /* data must be visible before the new head */
+    CO_MemoryBarrier();
+    q->head = headNext;
+
+    return true;
+}
+
+
+bool_t CO_spsc_pop(CO_spsc_t *q, void *data) {
+    const void *element = CO_spsc_peek(q);
+
+    if (element == NULL) {
+        return false;
+    }
+
+    memcpy(data, element, q->elementSize);
+    CO_spsc_drop(q);
+
+    return true;
+}
+
+
+/* TRIPLE BUFFER **************************************************************/
+/*
+ * Writer owns 'latest' and 'writing', reader owns 'reading'. Writer always
+ * picks a buffer, which is neither latest nor used by reader. Reader marks
+ * latest buffer as its own and confirms, that it is still the latest, so writer
+ * can not pick it in between.
+ */
+CO_ReturnError_t CO_tribuf_init(CO_tribuf_t *tb, void *buf, OD_size_t size) {
+    if (tb == NULL || buf == NULL || size == 0) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    tb->buf = (uint8_t *)buf;
+    tb->size = size;
+    tb->latest = 0;
+    tb->reading = 0;
+    tb->writing = 1;
+    tb->seq[0] = tb->seq[1] = tb->seq[2] = 0;
+    tb->seqWr = 0;
+    tb->seqRd = 0;
+
+    return CO_ERROR_NO;
+}
+
+
+void CO_tribuf_publish(CO_tribuf_t *tb) {
+    uint8_t latest = tb->writing;
+    uint8_t reading;
+
+    tb->seq[latest] = ++tb->seqWr;
+
+    /* data and sequence must be visible before the buffer becomes latest */
+    CO_MemoryBarrier();
+    tb->latest = latest;
+
+    /* reader's choice must be read after latest is published */
+    CO_MemoryBarrier();
+    reading = tb->reading;
+
+    tb->writing = 0;
+    while (tb->writing == latest || tb->writing == reading) {
+        tb->writing++;
+    }
+}
+
+
+const void *CO_tribuf_read(CO_tribuf_t *tb, bool_t *isNew) {
+    uint8_t latest;
+    uint32_t seq;
+
+    do {
+        latest = tb->latest;
+        tb->reading = latest;
+        CO_MemoryBarrier();
+    } while (latest != tb->latest);
+
+    seq = tb->seq[latest];
+    if (isNew != NULL) {
+        *isNew = seq != tb->seqRd;
+    }
+    tb->seqRd = seq;
+
+    return &tb->buf[(size_t)latest * tb->size];
+}
+
+
+/* MAILBOX ********************************************************************/
+CO_ReturnError_t CO_mbx_init(CO_mbx_t *mbx,
+                             CO_mbx_t **list,
+                             const OD_entry_t *entry,
+                             uint8_t subIndex,
+                             CO_mbx_dir_t dir,
+                             void *buf,
+                             CO_spsc_t *queue)
+{
+    OD_size_t len;
+
+    if (mbx == NULL || list == NULL || buf == NULL) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    if (OD_getSub(entry, subIndex, NULL, &mbx->io, false) != ODR_OK) {
+        return CO_ERROR_OD_PARAMETERS;
+    }
+    len = mbx->io.stream.dataLength;
+    if (len == 0 || (queue != NULL && queue->elementSize != len)) {
+        return CO_ERROR_OD_PARAMETERS;
+    }
+
+    mbx->subIndex = subIndex;
+    mbx->dir = dir;
+    mbx->queue = queue;
+    CO_tribuf_init(&mbx->tb, buf, len);
+
+    /* initial value is the current value of OD variable */
+    if (dir == CO_MBX_FROM_OD) {
+        ODR_t odRet;
+
+        OD_rwRestart(&mbx->io.stream);
+        mbx->io.read(&mbx->io.stream, subIndex, buf, len, &odRet);
+    }
+
+    /* add to the beginning of the list */
+    mbx->next = *list;
+    CO_MemoryBarrier();
+    *list = mbx;
+
+    return CO_ERROR_NO;
+}
+
+
+bool_t CO_mbx_write(CO_mbx_t *mbx, const void *data, OD_size_t len) {
+    if (mbx == NULL || data == NULL || mbx->dir != CO_MBX_TO_OD
+        || len != mbx->tb.size
+    ) {
+        return false;
+    }
+
+    if (mbx->queue != NULL) {
+        return CO_spsc_push(mbx->queue, data);
+    }
+
+    memcpy(CO_tribuf_writeBuf(&mbx->tb), data, len);
+    CO_tribuf_publish(&mbx->tb);
+
+    return true;
+}
+
+
+bool_t CO_mbx_read(CO_mbx_t *mbx, void *data, OD_size_t len) {
+    bool_t isNew = false;
+
+    if (mbx == NULL || data == NULL || mbx->dir != CO_MBX_FROM_OD
+        || len != mbx->tb.size
+    ) {
+        return false;
+    }
+
+    memcpy(data, CO_tribuf_read(&mbx->tb, &isNew), len);
+
+    return isNew;
+}
+
+
+void CO_mbx_process(CO_mbx_t *list) {
+    CO_mbx_t *mbx;
+
+    for (mbx = list; mbx != NULL; mbx = mbx->next) {
+        OD_stream_t *stream = &mbx->io.stream;
+        OD_size_t len = mbx->tb.size;
+        ODR_t odRet;
+
+        if (mbx->dir == CO_MBX_TO_OD) {
+            const void *value;
+            bool_t isNew = false;
+
+            if (mbx->queue != NULL) {
+                value = CO_spsc_peek(mbx->queue);
+                isNew = value != NULL;
+            }
+            else {
+                value = CO_tribuf_read(&mbx->tb, &isNew);
+            }
+
+            if (isNew) {
+                OD_rwRestart(stream);
+                mbx->io.write(stream, mbx->subIndex, value, len, &odRet);
+                if (mbx->queue != NULL) {
+                    CO_spsc_drop(mbx->queue);
+                }
+            }
+        }
+        else {
+            uint8_t *wBuf = CO_tribuf_writeBuf(&mbx->tb);
+            const uint8_t *latest = &mbx->tb.buf[(size_t)mbx->tb.latest * len];
+
+            OD_rwRestart(stream);
+            mbx->io.read(stream, mbx->subIndex, wBuf, len, &odRet);
+
+            /* publish only changed values, writer may read latest buffer */
+            if (odRet == ODR_OK && memcmp(wBuf, latest, len) != 0) {
+                if (mbx->queue != NULL) {
+                    (void)CO_spsc_push(mbx->queue, wBuf);
+                }
+                CO_tribuf_publish(&mbx->tb);
+            }
+        }
+    }
+}
+
+#endif /* (CO_CONFIG_MBX) & CO_CONFIG_MBX_ENABLE */
@@ -0,0 +1,329 @@
+/**
+ * Lock-free mailboxes for exchange of process data with the application.
+ *
+ * @file        CO_mailbox.h
+ * @ingroup     CO_mailbox
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CO_MAILBOX_H
+#define CO_MAILBOX_H
+
+#include "301/CO_driver.h"
+#include "301/CO_ODinterface.h"
+
+/* default configuration, see CO_config.h */
+#ifndef CO_CONFIG_MBX
+#define CO_CONFIG_MBX (0)
+#endif
+
+#if ((CO_CONFIG_MBX) & CO_CONFIG_MBX_ENABLE) || defined CO_DOXYGEN
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup CO_mailbox Mailbox
+ * @ingroup CO_CANopen_extra
+ * @{
+ *
+ * Lock-free exchange of process data between application and CANopen stack.
+ *
+ * Realtime processing of the stack (SYNC, RPDO, TPDO) accesses Object
+ * Dictionary variables inside @ref CO_LOCK_OD() section. If application thread
+ * uses the same lock for own access to process data, then slow application
+ * delays realtime processing and vice versa.
+ *
+ * Mailbox connects one OD variable with application over lock-free single
+ * producer - single consumer structures:
+ * - @ref CO_tribuf_t - triple buffer, which always holds the latest value.
+ *   Writer and reader never wait for each other and reader never gets partially
+ *   written value.
+ * - @ref CO_spsc_t - optional queue, if each value must be delivered in order.
+ *
+ * Mailboxes are processed by @ref CO_mbx_process() at cycle boundary of the
+ * realtime thread, inside the same @ref CO_LOCK_OD() section, after RPDOs and
+ * before TPDOs are processed. So within one realtime cycle values from received
+ * RPDOs are published to the application and values from application are
+ * written to OD variables before TPDOs are built. Application thread itself
+ * never locks.
+ *
+ * OD variable is accessed with the same OD_IO_t handle as by SDO server, so
+ * IO extensions on OD objects are respected.
+ *
+ * Structures depend only on @ref CO_MemoryBarrier(), which must be a full
+ * memory barrier in multi-thread targets.
+ */
+
+/**
+ * Single producer - single consumer queue of fixed size elements
+ */
+typedef struct {
+    /** Buffer for (count * elementSize) bytes, from CO_spsc_init() */
+    uint8_t *buf;
+    /** Number of elements in buffer, one is unused, from CO_spsc_init() */
+    uint16_t count;
+    /** Size of one element in bytes, from CO_spsc_init() */
+    OD_size_t elementSize;
+    /** Index of element, which will be written next, only producer writes */
+    volatile uint16_t head;
+    /** Index of element, which will be read next, only consumer writes */
+    volatile uint16_t tail;
+    /** Number of elements, which didn't fit into queue, only producer writes */
+    volatile uint32_t overflow;
+} CO_spsc_t;
+
+/**
+ * Initialize queue
+ *
+ * @param q This object will be initialized.
+ * @param buf Externally defined buffer of size (count * elementSize) bytes.
+ * @param count Number of elements in buffer, usable is one less.
+ * @param elementSize Size of one element in bytes.
+ *
+ * @return CO_ERROR_NO or CO_ERROR_ILLEGAL_ARGUMENT.
+ */
+CO_ReturnError_t CO_spsc_init(CO_spsc_t *q, void *buf,
+                              uint16_t count, OD_size_t elementSize);
+
+/**
+ * Copy one element into the queue. Called only by producer.
+ *
+ * @param q This object
+ * @param data Element of size elementSize.
+ *
+ * @return true on success, false if queue is full.
+ */
+bool_t CO_spsc_push(CO_spsc_t *q, const void *data);
+
+/**
+ * Get pointer to oldest element in the queue. Called only by consumer.
+ *
+ * Element stays valid until @ref CO_spsc_drop() is called.
+ *
+ * @param q This object
+ *
+ * @return Pointer to element or NULL, if queue is empty.
+ */
+static inline const void *CO_spsc_peek(CO_spsc_t *q) {
+    uint16_t tail = q->tail;
+
+    if (tail == q->head) return NULL;
+    CO_MemoryBarrier();
+    return &q->buf[(size_t)tail * q->elementSize];
+}
+
+/**
+ * Remove oldest element from the queue. Called only by consumer.
+ *
+ * @param q This object
+ */
+static inline void CO_spsc_drop(CO_spsc_t *q) {
+    uint16_t tail = q->tail;
+
+    if (tail == q->head) return;
+    CO_MemoryBarrier();
+    q->tail = (tail + 1 == q->count) ? 0 : tail + 1;
+}
+
+/**
+ * Copy oldest element from the queue and remove it. Called only by consumer.
+ *
+ * @param q This object
+ * @param [out] data Element of size elementSize will be copied here.
+ *
+ * @return true on success, false if queue is empty.
+ */
+bool_t CO_spsc_pop(CO_spsc_t *q, void *data);
+
+
+/**
+ * Triple buffer for the latest value
+ *
+ * Writer always has own buffer to write into, reader always has own buffer to
+ * read from and third buffer holds the latest published value.
+ */
+typedef struct {
+    /** Buffer for (3 * size) bytes, from CO_tribuf_init() */
+    uint8_t *buf;
+    /** Size of one value in bytes, from CO_tribuf_init() */
+    OD_size_t size;
+    /** Index of buffer with the latest published value, only writer writes */
+    volatile uint8_t latest;
+    /** Index of buffer, which is used by reader, only reader writes */
+    volatile uint8_t reading;
+    /** Index of buffer, which is used by writer */
+    uint8_t writing;
+    /** Sequence number of each buffer, only writer writes */
+    volatile uint32_t seq[3];
+    /** Sequence number of the last published value */
+    uint32_t seqWr;
+    /** Sequence number of the last read value */
+    uint32_t seqRd;
+} CO_tribuf_t;
+
+/**
+ * Initialize triple buffer
+ *
+ * @param tb This object will be initialized.
+ * @param buf Externally defined buffer of size (3 * size) bytes. Initial
+ * value is the value in the first third of the buffer.
+ * @param size Size of one value in bytes.
+ *
+ * @return CO_ERROR_NO or CO_ERROR_ILLEGAL_ARGUMENT.
+ */
+CO_ReturnError_t CO_tribuf_init(CO_tribuf_t *tb, void *buf, OD_size_t size);
+
+/**
+ * Get buffer, into which writer prepares next value. Called only by writer.
+ *
+ * @param tb This object
+ *
+ * @return Pointer to buffer of size bytes.
+ */
+static inline void *CO_tribuf_writeBuf(CO_tribuf_t *tb) {
+    return &tb->buf[(size_t)tb->writing * tb->size];
+}
+
+/**
+ * Publish value prepared in @ref CO_tribuf_writeBuf(). Called only by writer.
+ *
+ * @param tb This object
+ */
+void CO_tribuf_publish(CO_tribuf_t *tb);
+
+/**
+ * Get the latest published value. Called only by reader.
+ *
+ * @param tb This object
+ * @param [out] isNew Set to true, if value was published after the previous
+ * call, may be NULL.
+ *
+ * @return Pointer to value of size bytes. It stays valid until next call.
+ */
+const void *CO_tribuf_read(CO_tribuf_t *tb, bool_t *isNew);
+
+
+/**
+ * Direction of the mailbox
+ */
+typedef enum {
+    /** Application writes, stack writes value to OD variable */
+    CO_MBX_TO_OD = 0,
+    /** Stack reads OD variable, application reads the value */
+    CO_MBX_FROM_OD = 1
+} CO_mbx_dir_t;
+
+/**
+ * Mailbox object for one OD variable
+ */
+typedef struct CO_mbx {
+    /** OD handle of the variable, from CO_mbx_init() */
+    OD_IO_t io;
+    /** Sub-index of the variable, from CO_mbx_init() */
+    uint8_t subIndex;
+    /** Direction, from CO_mbx_init() */
+    CO_mbx_dir_t dir;
+    /** Triple buffer with the latest value */
+    CO_tribuf_t tb;
+    /** Optional queue, from CO_mbx_init(). If used in CO_MBX_TO_OD direction,
+     * one value per cycle is written to OD from the queue, triple buffer is not
+     * used. If used in CO_MBX_FROM_OD direction, each changed value is also
+     * added to the queue. */
+    CO_spsc_t *queue;
+    /** Next mailbox in the list */
+    struct CO_mbx *next;
+} CO_mbx_t;
+
+/**
+ * Initialize mailbox and add it to the list
+ *
+ * Function should be called before realtime processing starts or inside
+ * @ref CO_LOCK_OD() section.
+ *
+ * @param mbx This object will be initialized.
+ * @param list Pointer to first mailbox in the list, processed by
+ * @ref CO_mbx_process(). Mailbox is added to the beginning of the list.
+ * @param entry OD entry of the variable.
+ * @param subIndex Sub-index of the variable.
+ * @param dir Direction of the mailbox.
+ * @param buf Buffer for triple buffer of size (3 * variable length) bytes.
+ * @param queue Optional initialized queue with elementSize equal to variable
+ * length or NULL.
+ *
+ * @return CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT or CO_ERROR_OD_PARAMETERS, if
+ * OD variable doesn't exist or has different length.
+ */
+CO_ReturnError_t CO_mbx_init(CO_mbx_t *mbx,
+                             CO_mbx_t **list,
+                             const OD_entry_t *entry,
+                             uint8_t subIndex,
+                             CO_mbx_dir_t dir,
+                             void *buf,
+                             CO_spsc_t *queue);
+
+/**
+ * Write the value from application, CO_MBX_TO_OD direction only
+ *
+ * @param mbx This object
+ * @param data Value to write.
+ * @param len Length of data, must equal to the length of OD variable.
+ *
+ * @return true on success.
+ */
+bool_t CO_mbx_write(CO_mbx_t *mbx, const void *data, OD_size_t len);
+
+/**
+ * Read the latest value into application, CO_MBX_FROM_OD direction only
+ *
+ * @param mbx This object
+ * @param [out] data Value will be copied here.
+ * @param len Length of data, must equal to the length of OD variable.
+ *
+ * @return true, if value has changed since previous read.
+ */
+bool_t CO_mbx_read(CO_mbx_t *mbx, void *data, OD_size_t len);
+
+/** Write typed variable with @ref CO_mbx_write(), size is verified. */
+#define CO_MBX_WRITE(mbx, var) CO_mbx_write((mbx), &(var), sizeof(var))
+
+/** Read typed variable with @ref CO_mbx_read(), size is verified. */
+#define CO_MBX_READ(mbx, var) CO_mbx_read((mbx), &(var), sizeof(var))
+
+/**
+ * Process all mailboxes in the list
+ *
+ * Function must be called from realtime thread inside @ref CO_LOCK_OD()
+ * section, after RPDOs and before TPDOs are processed.
+ *
+ * @param list First mailbox in the list.
+ */
+void CO_mbx_process(CO_mbx_t *list);
+
+/** @} */ /* CO_mailbox */
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus*/
+
+#endif /* (CO_CONFIG_MBX) & CO_CONFIG_MBX_ENABLE */
+
+#endif /* CO_MAILBOX_H */
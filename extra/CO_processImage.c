@@ -0,0 +1,266 @@
+/*
+ * PLC style process image, generated from PDO mapping.
+ *
+ * @file        CO_processImage.c
+ * @ingroup     CO_processImage
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "extra/CO_processImage.h"
+
+#if (CO_CONFIG_MBX) & CO_CONFIG_MBX_PROCESS_IMAGE
+
+/* OD indexes of PDO mapping parameters */
+#define OD_H1600_RPDO_1_MAPPING 0x1600
+#define OD_H1A00_TPDO_1_MAPPING 0x1A00
+
+/*
+ * Add variables mapped to PDO mapping objects into vars array
+ *
+ * Returns CO_ERROR_NO, CO_ERROR_OUT_OF_MEMORY or CO_ERROR_OD_PARAMETERS.
+ */
+static CO_ReturnError_t PI_addMapped(const OD_t *od,
+                                     uint16_t mappingIndex,
+                                     uint16_t PDOcount,
+                                     OD_attr_t attrRequired,
+                                     CO_PI_var_t *vars,
+                                     uint16_t *count,
+                                     uint16_t varsCount,
+                                     OD_size_t *size,
+                                     uint32_t *errInfo)
+{
+    uint16_t first = *count;
+    uint16_t i;
+
+    for (i = 0; i < PDOcount; i++) {
+        const OD_entry_t *entry = OD_find(od, mappingIndex + i);
+        uint8_t mappedCount = 0;
+        uint8_t j;
+
+        if (entry == NULL) {
+            continue;
+        }
+        if (OD_get_u8(entry, 0, &mappedCount, true) != ODR_OK) {
+            *errInfo = mappingIndex + i;
+            return CO_ERROR_OD_PARAMETERS;
+        }
+
+        for (j = 1; j <= mappedCount; j++) {
+            uint32_t map;
+            uint16_t index;
+            uint8_t subIndex, bitLength;
+            OD_subEntry_t subEntry;
+            CO_PI_var_t *var;
+            uint16_t k;
+            bool_t duplicate = false;
+
+            if (OD_get_u32(entry, j, &map, true) != ODR_OK) {
+                *errInfo = mappingIndex + i;
+                return CO_ERROR_OD_PARAMETERS;
+            }
+            index = (uint16_t)(map >> 16);
+            subIndex = (uint8_t)(map >> 8);
+            bitLength = (uint8_t)map;
+
+            /* skip dummy entries and non byte aligned variables */
+            if (index < 0x20 || (bitLength & 0x07) != 0 || bitLength == 0) {
+                continue;
+            }
+            for (k = first; k < *count; k++) {
+                if (vars[k].index == index && vars[k].subIndex == subIndex) {
+                    duplicate = true;
+                    break;
+                }
+            }
+            if (duplicate) {
+                continue;
+            }
+            if (*count >= varsCount) {
+                return CO_ERROR_OUT_OF_MEMORY;
+            }
+
+            var = &vars[*count];
+            if (OD_getSub(OD_find(od, index), subIndex, &subEntry,
+                          &var->io, false) != ODR_OK
+                || (subEntry.attribute & attrRequired) == 0
+                || var->io.stream.dataLength < (OD_size_t)(bitLength >> 3)
+            ) {
+                *errInfo = map;
+                return CO_ERROR_OD_PARAMETERS;
+            }
+            var->io.stream.dataLength = bitLength >> 3;
+            var->index = index;
+            var->subIndex = subIndex;
+            var->offset = *size;
+            *size += bitLength >> 3;
+            (*count)++;
+        }
+    }
+
+    return CO_ERROR_NO;
+}
+
+
+/******************************************************************************/
+CO_ReturnError_t CO_PI_init(CO_PI_t *pi,
+                            const OD_t *od,
+                            uint16_t RPDOcount,
+                            uint16_t TPDOcount,
+                            CO_PI_var_t *vars,
+                            uint16_t varsCount,
+                            void *buf,
+                            size_t bufSize,
+                            uint32_t *errInfo)
+{
+    CO_ReturnError_t ret;
+    uint32_t errInfoDummy;
+    uint16_t count = 0;
+    uint8_t *b = (uint8_t *)buf;
+    uint8_t *outInit;
+
+    if (pi == NULL || od == NULL || vars == NULL || buf == NULL) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+    if (errInfo == NULL) {
+        errInfo = &errInfoDummy;
+    }
+
+    memset(pi, 0, sizeof(CO_PI_t));
+    pi->vars = vars;
+
+    ret = PI_addMapped(od, OD_H1600_RPDO_1_MAPPING, RPDOcount, ODA_RPDO,
+                       vars, &count, varsCount, &pi->inSize, errInfo);
+    if (ret != CO_ERROR_NO) return ret;
+    pi->inCount = count;
+
+    ret = PI_addMapped(od, OD_H1A00_TPDO_1_MAPPING, TPDOcount, ODA_TPDO,
+                       vars, &count, varsCount, &pi->outSize, errInfo);
+    if (ret != CO_ERROR_NO) return ret;
+    pi->outCount = count - pi->inCount;
+
+    if (((size_t)pi->inSize + pi->outSize) * 3 > bufSize) {
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+    memset(buf, 0, ((size_t)pi->inSize + pi->outSize) * 3);
+
+    /* images with zero size use one byte, so pointers are valid */
+    CO_tribuf_init(&pi->in, b, pi->inSize > 0 ? pi->inSize : 1);
+    CO_tribuf_init(&pi->out, b + (size_t)pi->inSize * 3,
+                   pi->outSize > 0 ? pi->outSize : 1);
+
+    /* all output buffers start with current values of OD variables */
+    outInit = b + (size_t)pi->inSize * 3;
+    if (pi->outSize > 0) {
+        uint16_t i;
+
+        for (i = pi->inCount; i < count; i++) {
+            CO_PI_var_t *var = &vars[i];
+            ODR_t odRet;
+
+            OD_rwRestart(&var->io.stream);
+            var->io.read(&var->io.stream, var->subIndex, outInit + var->offset,
+                         var->io.stream.dataLength, &odRet);
+        }
+        memcpy(outInit + pi->outSize, outInit, pi->outSize);
+        memcpy(outInit + (size_t)pi->outSize * 2, outInit, pi->outSize);
+    }
+
+    return CO_ERROR_NO;
+}
+
+
+/******************************************************************************/
+int32_t CO_PI_find(CO_PI_t *pi, uint16_t index, uint8_t subIndex,
+                   bool_t output)
+{
+    uint16_t i, end;
+
+    if (pi == NULL) return -1;
+
+    i = output ? pi->inCount : 0;
+    end = output ? pi->inCount + pi->outCount : pi->inCount;
+    for (; i < end; i++) {
+        if (pi->vars[i].index == index && pi->vars[i].subIndex == subIndex) {
+            return (int32_t)pi->vars[i].offset;
+        }
+    }
+
+    return -1;
+}
+
+
+/******************************************************************************/
+bool_t CO_PI_cycleBegin(CO_PI_t *pi, const uint8_t **in, uint8_t **out) {
+    bool_t isNew = false;
+
+    *in = CO_tribuf_read(&pi->in, &isNew);
+    *out = CO_tribuf_writeBuf(&pi->out);
+
+    return isNew;
+}
+
+
+void CO_PI_commit(CO_PI_t *pi) {
+    CO_tribuf_publish(&pi->out);
+}
+
+
+/******************************************************************************/
+void CO_PI_process(CO_PI_t *pi) {
+    uint16_t i;
+    bool_t isNew = false;
+
+    if (pi == NULL) return;
+
+    /* freeze inputs, received by RPDOs */
+    if (pi->inCount > 0) {
+        uint8_t *in = CO_tribuf_writeBuf(&pi->in);
+
+        for (i = 0; i < pi->inCount; i++) {
+            CO_PI_var_t *var = &pi->vars[i];
+            ODR_t odRet;
+
+            OD_rwRestart(&var->io.stream);
+            var->io.read(&var->io.stream, var->subIndex, in + var->offset,
+                         var->io.stream.dataLength, &odRet);
+        }
+        CO_tribuf_publish(&pi->in);
+    }
+
+    /* write all outputs together, before TPDOs are processed */
+    if (pi->outCount > 0) {
+        const uint8_t *out = CO_tribuf_read(&pi->out, &isNew);
+
+        if (isNew) {
+            for (i = pi->inCount; i < pi->inCount + pi->outCount; i++) {
+                CO_PI_var_t *var = &pi->vars[i];
+                ODR_t odRet;
+
+                OD_rwRestart(&var->io.stream);
+                var->io.write(&var->io.stream, var->subIndex, out + var->offset,
+                              var->io.stream.dataLength, &odRet);
+            }
+        }
+    }
+}
+
+#endif /* (CO_CONFIG_MBX) & CO_CONFIG_MBX_PROCESS_IMAGE */
@@ -0,0 +1,196 @@
+/**
+ * PLC style process image, generated from PDO mapping.
+ *
+ * @file        CO_processImage.h
+ * @ingroup     CO_processImage
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CO_PROCESS_IMAGE_H
+#define CO_PROCESS_IMAGE_H
+
+#include "extra/CO_mailbox.h"
+
+#if ((CO_CONFIG_MBX) & CO_CONFIG_MBX_PROCESS_IMAGE) || defined CO_DOXYGEN
+
+#if !((CO_CONFIG_MBX) & CO_CONFIG_MBX_ENABLE)
+#error CO_CONFIG_MBX_ENABLE must be enabled.
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup CO_processImage Process image
+ * @ingroup CO_CANopen_extra
+ * @{
+ *
+ * PLC style cyclic process image.
+ *
+ * RPDOs write received data into OD variables whenever CAN messages arrive, so
+ * application, which reads OD variables directly, may see inputs changing
+ * during its computation. Process image gives the application PLC semantics:
+ * - @ref CO_PI_cycleBegin() freezes all RPDO mapped variables into input image.
+ *   Input image does not change until next cycle begins.
+ * - Application computes on input image and writes all variables of the
+ *   output image.
+ * - @ref CO_PI_commit() commits output image. All TPDO mapped variables are
+ *   then written together in the next realtime cycle, before TPDOs are
+ *   processed.
+ *
+ * Layout of the images is generated by @ref CO_PI_init() from PDO mapping
+ * parameters (OD objects 0x1600+ and 0x1A00+). Each mapped OD variable appears
+ * once, in the order of mapping. Use @ref CO_PI_find() to get its offset.
+ *
+ * Each image is a @ref CO_tribuf_t. On the application side begin and commit
+ * only exchange buffer indexes, data are not copied. So output buffer, which
+ * application gets in the next cycle, is not the last committed one, but holds
+ * the values of an earlier cycle (initial OD values after @ref CO_PI_init()).
+ * Application must write the complete output image in each cycle. Realtime side copies
+ * between OD variables and images in @ref CO_PI_process(), which runs inside
+ * @ref CO_LOCK_OD() section, after RPDOs and before TPDOs are processed. The
+ * third buffer guarantees, that neither side ever waits for the other.
+ */
+
+/**
+ * One OD variable in the process image
+ */
+typedef struct {
+    /** OD handle of the variable */
+    OD_IO_t io;
+    /** OD index of the variable */
+    uint16_t index;
+    /** OD sub-index of the variable */
+    uint8_t subIndex;
+    /** Offset of the variable inside the image */
+    OD_size_t offset;
+} CO_PI_var_t;
+
+/**
+ * Process image object
+ */
+typedef struct {
+    /** Array of variables, from CO_PI_init(). Input variables first, then
+     * output variables. */
+    CO_PI_var_t *vars;
+    /** Number of input variables */
+    uint16_t inCount;
+    /** Number of output variables */
+    uint16_t outCount;
+    /** Input image, written by realtime side */
+    CO_tribuf_t in;
+    /** Output image, written by application */
+    CO_tribuf_t out;
+    /** Size of input image in bytes */
+    OD_size_t inSize;
+    /** Size of output image in bytes */
+    OD_size_t outSize;
+} CO_PI_t;
+
+/**
+ * Initialize process image from PDO mapping
+ *
+ * Function must be called in communication reset section, after
+ * @ref CO_CANopenInit(), because PDO mapping may change with reset. It must not
+ * run concurrently with @ref CO_PI_process().
+ *
+ * Mapped variables with length in bits not multiple of 8 and dummy entries
+ * are skipped.
+ *
+ * @param pi This object will be initialized.
+ * @param od Object Dictionary.
+ * @param RPDOcount Number of RPDO mapping objects (starting at 0x1600).
+ * @param TPDOcount Number of TPDO mapping objects (starting at 0x1A00).
+ * @param vars Array of variables for the image.
+ * @param varsCount Size of vars array.
+ * @param buf Buffer for both images: (3 * input size + 3 * output size) bytes.
+ * @param bufSize Size of buf in bytes.
+ * @param [out] errInfo Index of erroneous OD object, may be NULL.
+ *
+ * @return CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT, CO_ERROR_OUT_OF_MEMORY if
+ * vars or buf is too small or CO_ERROR_OD_PARAMETERS.
+ */
+CO_ReturnError_t CO_PI_init(CO_PI_t *pi,
+                            const OD_t *od,
+                            uint16_t RPDOcount,
+                            uint16_t TPDOcount,
+                            CO_PI_var_t *vars,
+                            uint16_t varsCount,
+                            void *buf,
+                            size_t bufSize,
+                            uint32_t *errInfo);
+
+/**
+ * Find offset of OD variable inside the process image
+ *
+ * @param pi This object
+ * @param index OD index of the variable.
+ * @param subIndex OD sub-index of the variable.
+ * @param output If true, search in output image, otherwise in input image.
+ *
+ * @return Offset in bytes or -1 if variable is not mapped.
+ */
+int32_t CO_PI_find(CO_PI_t *pi, uint16_t index, uint8_t subIndex,
+                   bool_t output);
+
+/**
+ * Begin application cycle
+ *
+ * Latest input image is frozen for the application. Output image is not
+ * prepared, it holds the values of an earlier cycle, application must write
+ * all its variables. Called only from application thread.
+ *
+ * @param pi This object
+ * @param [out] in Pointer to frozen input image, valid until next call.
+ * @param [out] out Pointer to output image, valid until @ref CO_PI_commit().
+ *
+ * @return true, if inputs were refreshed since previous cycle.
+ */
+bool_t CO_PI_cycleBegin(CO_PI_t *pi, const uint8_t **in, uint8_t **out);
+
+/**
+ * Commit output image of the application cycle
+ *
+ * Called only from application thread.
+ *
+ * @param pi This object
+ */
+void CO_PI_commit(CO_PI_t *pi);
+
+/**
+ * Process image on the realtime side
+ *
+ * Function must be called from realtime thread inside @ref CO_LOCK_OD()
+ * section, after RPDOs and before TPDOs are processed.
+ *
+ * @param pi This object, may be NULL.
+ */
+void CO_PI_process(CO_PI_t *pi);
+
+/** @} */ /* CO_processImage */
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus*/
+
+#endif /* (CO_CONFIG_MBX) & CO_CONFIG_MBX_PROCESS_IMAGE */
+
+#endif /* CO_PROCESS_IMAGE_H */
@@ -22,485 +22,573 @@
  * limitations under the License.
  */
 
+#include <string.h>
+
 #include "extra/CO_trace.h"
 
 #if (CO_CONFIG_TRACE) & CO_CONFIG_TRACE_ENABLE
 
-#include <stdio.h>
-#include <string.h>
-#if !((CO_CONFIG_TRACE) & CO_CONFIG_TRACE_OWN_INTTYPES)
-#include <inttypes.h> /* for PRIu32("u" or "lu") and PRId32("d" or "ld") */
+#if CO_TRACE_BLOCK_SIZE < 128 || CO_TRACE_BLOCK_SIZE > 65535
+#error CO_TRACE_BLOCK_SIZE is not correct
 #endif
 
-/* Different functions for processing value for different data types. */
-static int32_t getValueI8 (void *OD_variable) { return (int32_t) *((int8_t*)   OD_variable);}
-static int32_t getValueI16(void *OD_variable) { return (int32_t) *((int16_t*)  OD_variable);}
-static int32_t getValueI32(void *OD_variable) { return           *((int32_t*)  OD_variable);}
-static int32_t getValueU8 (void *OD_variable) { return (int32_t) *((uint8_t*)  OD_variable);}
-static int32_t getValueU16(void *OD_variable) { return (int32_t) *((uint16_t*) OD_variable);}
-static int32_t getValueU32(void *OD_variable) { return           *((int32_t*)  OD_variable);}
-
-
-/* Different functions for printing points for different data types. */
-static uint32_t printPointCsv(char *s, uint32_t size, uint32_t timeStamp, int32_t value) {
-    return snprintf(s, size, "%" PRIu32 ";%" PRId32 "\n", timeStamp,              value);
+/* size of the block header: used, records, time */
+#define BLOCK_HDR 8
+/* maximum size of one record: time and all variables as varint */
+#define RECORD_MAX (5 + 10 * CO_TRACE_VARS_MAX)
+#define NO_BLOCK 0xFFFF
+
+/* sub-indexes of OD objects */
+#define SUB_CFG_SIZE 1
+#define SUB_CFG_CONTROL 2
+#define SUB_CFG_STATE 3
+#define SUB_CFG_TRIGGER 4
+#define SUB_CFG_THRESHOLD 5
+#define SUB_CFG_POST_TRIGGER 6
+#define SUB_CFG_PERIOD 7
+#define SUB_CFG_SIGNED 8
+#define SUB_CFG_MAP1 9
+#define SUB_TRACE_DATA 1
+#define SUB_TRACE_RECORDS 2
+#define SUB_TRACE_TRIGGER_TIME 3
+
+
+/* Helper functions ***********************************************************/
+static void setLE16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8);
+}
+static void setLE32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
 }
-static uint32_t printPointCsvUnsigned(char *s, uint32_t size, uint32_t timeStamp, int32_t value) {
-    return snprintf(s, size, "%" PRIu32 ";%" PRIu32 "\n", timeStamp, (uint32_t)   value);
+static uint16_t getLE16(const uint8_t *p) {
+    return (uint16_t)(p[0] | ((uint16_t)p[1] << 8));
 }
-static uint32_t printPointBinary(char *s, uint32_t size, uint32_t timeStamp, int32_t value) {
-    if(size < 8) return 0;
-    uint32_t timeStampSw = CO_SWAP_32(timeStamp);
-    int32_t valueSw = CO_SWAP_32(value);
-    memcpy(s, &timeStampSw, sizeof(timeStampSw));
-    memcpy(s+4, &valueSw, sizeof(valueSw));
-    return 8;
+
+static uint8_t putVarint(uint8_t *p, uint64_t v) {
+    uint8_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
 }
-static uint32_t printPointSvgStart(char *s, uint32_t size, uint32_t timeStamp, int32_t value) {
-    return snprintf(s, size, "M%" PRIu32 ",%" PRId32, timeStamp,             value);
+
+/* physical index of the n-th block, counted from the oldest */
+static uint16_t blockIndex(const CO_trace_t *trace, uint16_t n) {
+    uint32_t i = (uint32_t)trace->blockFirst + n;
+    if (i >= trace->blockCount) {
+        i -= trace->blockCount;
+    }
+    return (uint16_t)i;
 }
-static uint32_t printPointSvgStartUnsigned(char *s, uint32_t size, uint32_t timeStamp, int32_t value) {
-    return snprintf(s, size, "M%" PRIu32 ",%" PRIu32, timeStamp, (uint32_t)  value);
+
+static uint8_t *blockPtr(const CO_trace_t *trace, uint16_t n) {
+    return &trace->buf[(size_t)blockIndex(trace, n) * CO_TRACE_BLOCK_SIZE];
 }
-static uint32_t printPointSvg(char *s, uint32_t size, uint32_t timeStamp, int32_t value) {
-    return snprintf(s, size, "H%" PRIu32 "V%" PRId32, timeStamp,             value);
+
+/* Start new block at the end of the ring. If ring is full, discard the oldest
+ * block, except if it contains trigger and samples after trigger are still
+ * recorded. Return false in that case. */
+static bool_t newBlock(CO_trace_t *trace) {
+    if (trace->blockUsed < trace->blockCount) {
+        trace->blockUsed++;
+    }
+    else {
+        if (trace->blockTrigger == trace->blockFirst) {
+            if (trace->state == CO_TRACE_ST_TRIGGERED) {
+                trace->state = CO_TRACE_ST_COMPLETED;
+                return false;
+            }
+            trace->blockTrigger = NO_BLOCK;
+        }
+        trace->recordCount -= getLE16(blockPtr(trace, 0) + 2);
+        trace->blockFirst = blockIndex(trace, 1);
+    }
+
+    uint8_t *block = blockPtr(trace, trace->blockUsed - 1);
+    setLE16(block, 0);
+    setLE16(block + 2, 0);
+    setLE32(block + 4, trace->time_us);
+    trace->timePrev_us = trace->time_us;
+    memset(trace->base, 0, sizeof(trace->base));
+    return true;
 }
-static uint32_t printPointSvgUnsigned(char *s, uint32_t size, uint32_t timeStamp, int32_t value) {
-    return snprintf(s, size, "H%" PRIu32 "V%" PRIu32, timeStamp, (uint32_t)  value);
+
+static uint8_t encodeRecord(CO_trace_t *trace, uint8_t *rec) {
+    uint8_t len = putVarint(rec, trace->time_us - trace->timePrev_us);
+
+    for (uint8_t i = 0; i < trace->varCount; i++) {
+        /* zigzag of the difference, modulo 2^64 */
+        uint64_t d = (uint64_t)trace->values[i] - (uint64_t)trace->base[i];
+        uint64_t zz = (d << 1) ^ (uint64_t)(0 - (d >> 63));
+        len += putVarint(&rec[len], zz);
+    }
+    return len;
 }
 
+/* Write current values into the ring */
+static void writeRecord(CO_trace_t *trace) {
+    uint8_t rec[RECORD_MAX];
+    uint8_t len = encodeRecord(trace, rec);
+    uint8_t *block = blockPtr(trace, trace->blockUsed - 1);
+    uint16_t used = getLE16(block);
 
-/* Collection of function pointers for fast processing based on specific data type. */
-/* Rules for the array: There must be groups of six members (I8, I16, I32, U8, U16, U32)
- * in correct order and sequence, so findVariable() finds correct member. */
-static const CO_trace_dataType_t dataTypes[] = {
-    {getValueI8,  printPointCsv,              printPointCsv,         printPointCsv},
-    {getValueI16, printPointCsv,              printPointCsv,         printPointCsv},
-    {getValueI32, printPointCsv,              printPointCsv,         printPointCsv},
-    {getValueU8,  printPointCsvUnsigned,      printPointCsvUnsigned, printPointCsvUnsigned},
-    {getValueU16, printPointCsvUnsigned,      printPointCsvUnsigned, printPointCsvUnsigned},
-    {getValueU32, printPointCsvUnsigned,      printPointCsvUnsigned, printPointCsvUnsigned},
-    {getValueI8,  printPointBinary,           printPointBinary,      printPointBinary},
-    {getValueI16, printPointBinary,           printPointBinary,      printPointBinary},
-    {getValueI32, printPointBinary,           printPointBinary,      printPointBinary},
-    {getValueU8,  printPointBinary,           printPointBinary,      printPointBinary},
-    {getValueU16, printPointBinary,           printPointBinary,      printPointBinary},
-    {getValueU32, printPointBinary,           printPointBinary,      printPointBinary},
-    {getValueI8,  printPointSvgStart,         printPointSvg,         printPointSvg},
-    {getValueI16, printPointSvgStart,         printPointSvg,         printPointSvg},
-    {getValueI32, printPointSvgStart,         printPointSvg,         printPointSvg},
-    {getValueU8,  printPointSvgStartUnsigned, printPointSvgUnsigned, printPointSvgUnsigned},
-    {getValueU16, printPointSvgStartUnsigned, printPointSvgUnsigned, printPointSvgUnsigned},
-    {getValueU32, printPointSvgStartUnsigned, printPointSvgUnsigned, printPointSvgUnsigned}
-};
-
-
-/* Find variable in Object Dictionary *****************************************/
-static void findVariable(CO_trace_t *trace) {
-    bool_t err = false;
-    uint16_t index;
-    uint8_t subIndex;
-    uint8_t dataLen;
-    void *OdDataPtr = NULL;
-    unsigned dtIndex = 0;
-
-    /* parse mapping */
-    index = (uint16_t) ((*trace->map) >> 16);
-    subIndex = (uint8_t) ((*trace->map) >> 8);
-    dataLen = (uint8_t) (*trace->map);
-    if((dataLen & 0x07) != 0) { /* data length must be byte aligned */
-        err = true;
-    }
-    dataLen >>= 3;   /* in bytes now */
-    if(dataLen == 0) {
-        dataLen = 4;
-    }
-
-    /* find mapped variable, if map available */
-    if(!err && (index != 0 || subIndex != 0)) {
-        uint16_t entryNo = CO_OD_find(trace->SDO, index);
-
-        if(index >= 0x1000 && entryNo != 0xFFFF && subIndex <= trace->SDO->OD[entryNo].maxSubIndex) {
-            OdDataPtr = CO_OD_getDataPointer(trace->SDO, entryNo, subIndex);
+    if (BLOCK_HDR + used + len > CO_TRACE_BLOCK_SIZE) {
+        if (!newBlock(trace)) {
+            return;
         }
+        len = encodeRecord(trace, rec);
+        block = blockPtr(trace, trace->blockUsed - 1);
+        used = 0;
+    }
 
-        if(OdDataPtr != NULL) {
-            uint16_t len = CO_OD_getLength(trace->SDO, entryNo, subIndex);
+    memcpy(block + BLOCK_HDR + used, rec, len);
+    setLE16(block, used + len);
+    setLE16(block + 2, getLE16(block + 2) + 1);
+    memcpy(trace->base, trace->values, sizeof(trace->base));
+    trace->timePrev_us = trace->time_us;
+    trace->recordCount++;
+}
 
-            if(len < dataLen) {
-                dataLen = len;
-            }
-        }
-        else {
-            err = true;
+static int64_t readVar(CO_trace_var_t *var, bool_t isSigned) {
+    uint8_t b[8];
+    const void *p = var->data;
+
+    if (p == NULL) {
+        ODR_t odRet;
+        memset(b, 0, sizeof(b));
+        var->io.read(&var->io.stream, var->subIndex, b, sizeof(b), &odRet);
+        if (odRet == ODR_PARTIAL) {
+            OD_rwRestart(&var->io.stream);
         }
+        p = b;
     }
 
-    /* Get function pointers for correct data type */
-    if(!err) {
-        /* first sequence: data length */
-        switch(dataLen) {
-            case 1: dtIndex = 0; break;
-            case 2: dtIndex = 1; break;
-            case 4: dtIndex = 2; break;
-            default: err = true; break;
-        }
-        /* second sequence: signed or unsigned */
-        if(((*trace->format) & 1) == 1) {
-            dtIndex += 3;
+    switch (var->length) {
+    case 1: {
+        uint8_t v = CO_getUint8(p);
+        return isSigned ? (int64_t)(int8_t)v : (int64_t)v;
+    }
+    case 2: {
+        uint16_t v = CO_getUint16(p);
+        return isSigned ? (int64_t)(int16_t)v : (int64_t)v;
+    }
+    case 4: {
+        uint32_t v = CO_getUint32(p);
+        return isSigned ? (int64_t)(int32_t)v : (int64_t)v;
+    }
+    default: {
+        int64_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    }
+}
+
+/* Apply configuration from the Object Dictionary and start recording */
+static ODR_t traceStart(CO_trace_t *trace, uint8_t control) {
+    const OD_entry_t *cfg = trace->OD_traceConfig;
+    CO_trace_var_t vars[CO_TRACE_VARS_MAX];
+    uint32_t maps[CO_TRACE_VARS_MAX];
+    uint8_t varCount = 0;
+    uint8_t trigger = 0, signedMask = 0;
+    int32_t threshold = 0;
+    uint32_t postTrigger = 0, period_us = 0;
+
+    if (control == CO_TRACE_CTRL_OFF) {
+        /* stop, recorded data are kept for export */
+        trace->state = CO_TRACE_ST_OFF;
+        return ODR_OK;
+    }
+    if (control != CO_TRACE_CTRL_CONTINUOUS
+        && control != CO_TRACE_CTRL_TRIGGERED
+    ) {
+        return ODR_INVALID_VALUE;
+    }
+
+    if (OD_get_u8(cfg, SUB_CFG_TRIGGER, &trigger, true) != ODR_OK
+        || OD_get_i32(cfg, SUB_CFG_THRESHOLD, &threshold, true) != ODR_OK
+        || OD_get_u32(cfg, SUB_CFG_POST_TRIGGER, &postTrigger, true) != ODR_OK
+        || OD_get_u32(cfg, SUB_CFG_PERIOD, &period_us, true) != ODR_OK
+        || OD_get_u8(cfg, SUB_CFG_SIGNED, &signedMask, true) != ODR_OK
+    ) {
+        return ODR_DEV_INCOMPAT;
+    }
+
+    /* resolve mapped variables */
+    for (uint8_t i = 0; i < CO_TRACE_VARS_MAX; i++) {
+        CO_trace_var_t *var = &vars[varCount];
+        OD_subEntry_t subEntry;
+        uint32_t map;
+
+        if (OD_get_u32(cfg, SUB_CFG_MAP1 + i, &map, true) != ODR_OK
+            || map == 0
+        ) {
+            break;
         }
-        /* third sequence: Output type */
-        dtIndex += ((*trace->format) >> 1) * 6;
 
-        if(dtIndex > (sizeof(dataTypes) / sizeof(CO_trace_dataType_t))) {
-            err = true;
+        uint16_t index = (uint16_t)(map >> 16);
+        uint8_t bits = (uint8_t)map;
+        if (bits != 8 && bits != 16 && bits != 32 && bits != 64) {
+            return ODR_MAP_LEN;
         }
-    }
+        var->subIndex = (uint8_t)(map >> 8);
+        var->length = bits / 8;
 
-    /* set output variables */
-    if(!err) {
-        if(OdDataPtr != NULL) {
-            trace->OD_variable = OdDataPtr;
+        ODR_t odRet = OD_getSub(OD_find(trace->od, index), var->subIndex,
+                                &subEntry, &var->io, false);
+        if (odRet != ODR_OK) {
+            return odRet;
         }
-        else {
-            trace->OD_variable = trace->value;
+        if ((subEntry.attribute & (ODA_SDO_R | ODA_TPDO)) == 0) {
+            return ODR_WRITEONLY;
         }
-        trace->dt = &dataTypes[dtIndex];
+        if (var->io.stream.dataLength < var->length) {
+            return ODR_MAP_LEN;
+        }
+        /* variables without IO extension are read directly */
+        var->data = var->io.read == OD_readOriginal
+                  ? var->io.stream.data : NULL;
+        maps[varCount++] = map;
     }
-    else  {
-        trace->OD_variable = NULL;
-        trace->dt = NULL;
+
+    if (varCount == 0 || ((trigger & 0x30) != 0
+                          && (trigger & 0x0F) >= varCount)
+        || (control == CO_TRACE_CTRL_TRIGGERED && (trigger & 0x30) == 0)
+    ) {
+        return ODR_INVALID_VALUE;
     }
-}
 
+    /* configuration is valid, restart recording */
+    memcpy(trace->vars, vars, sizeof(vars[0]) * varCount);
+    memcpy(trace->maps, maps, sizeof(maps[0]) * varCount);
+    trace->varCount = varCount;
+    trace->trigger = trigger;
+    trace->threshold = threshold;
+    trace->postTrigger = postTrigger;
+    trace->period_us = period_us;
+    trace->signedMask = signedMask;
+
+    trace->blockFirst = 0;
+    trace->blockUsed = 0;
+    trace->blockTrigger = NO_BLOCK;
+    trace->recordCount = 0;
+    trace->periodTimer_us = period_us;
+    trace->postCount = 0;
+    trace->valid = false;
+    trace->state = control == CO_TRACE_CTRL_TRIGGERED
+                 ? CO_TRACE_ST_ARMED : CO_TRACE_ST_CONTINUOUS;
+    newBlock(trace);
+
+    return ODR_OK;
+}
 
-/* OD function for accessing _OD_traceConfig_ (index 0x2300+) from SDO server.
- * For more information see file CO_SDOserver.h. */
-static CO_SDO_abortCode_t CO_ODF_traceConfig(CO_ODF_arg_t *ODF_arg) {
-    CO_trace_t *trace;
-    CO_SDO_abortCode_t ret = CO_SDO_AB_NONE;
+/* Copy header and blocks into buf, see CO_trace.h for the format */
+static OD_size_t traceExport(CO_trace_t *trace, OD_stream_t *stream,
+                             uint8_t *buf, OD_size_t count,
+                             ODR_t *returnCode)
+{
+    uint8_t *hdr = trace->exportHeader;
 
-    trace = (CO_trace_t*) ODF_arg->object;
+    if (stream->dataOffset == 0) {
+        /* start of the export, pause recording */
+        uint16_t blockTrigger = NO_BLOCK;
 
-    switch(ODF_arg->subIndex) {
-    case 1:     /* size */
-        if(ODF_arg->reading) {
-            CO_setUint32(ODF_arg->data, trace->bufferSize);
+        if (trace->blockTrigger != NO_BLOCK) {
+            blockTrigger = trace->blockTrigger >= trace->blockFirst
+                ? trace->blockTrigger - trace->blockFirst
+                : trace->blockTrigger + trace->blockCount - trace->blockFirst;
         }
-        break;
+        memcpy(hdr, "COTR", 4);
+        hdr[4] = CO_TRACE_VERSION;
+        hdr[5] = trace->varCount;
+        hdr[6] = trace->signedMask;
+        hdr[7] = (uint8_t)trace->state;
+        setLE16(&hdr[8], CO_TRACE_BLOCK_SIZE);
+        setLE16(&hdr[10], trace->blockUsed);
+        setLE32(&hdr[12], trace->triggerTime_us);
+        setLE16(&hdr[16], blockTrigger);
+        setLE16(&hdr[18], 0);
+        for (uint8_t i = 0; i < trace->varCount; i++) {
+            setLE32(&hdr[20 + 4 * i], trace->maps[i]);
+        }
+        trace->exportHeaderLength = 20 + 4 * trace->varCount;
+        trace->exporting = true;
+        stream->dataLength = trace->exportHeaderLength
+                   + (OD_size_t)trace->blockUsed * CO_TRACE_BLOCK_SIZE;
+    }
+    trace->exportTimer_us = 0;
 
-    case 2:     /* axisNo (trace enabled if nonzero) */
-        if(ODF_arg->reading) {
-            uint8_t *value = (uint8_t*) ODF_arg->data;
-            if(!trace->enabled) {
-                *value = 0;
-            }
+    OD_size_t pos = stream->dataOffset;
+    OD_size_t n = 0;
+    while (n < count && pos < stream->dataLength) {
+        const uint8_t *src;
+        OD_size_t len;
+
+        if (pos < trace->exportHeaderLength) {
+            src = &hdr[pos];
+            len = trace->exportHeaderLength - pos;
         }
         else {
-            uint8_t *value = (uint8_t*) ODF_arg->data;
-
-            if(*value == 0) {
-                trace->enabled = false;
-            }
-            else if(!trace->enabled) {
-                if(trace->bufferSize == 0) {
-                    ret = CO_SDO_AB_OUT_OF_MEM;
-                }
-                else {
-                    /* set trace->OD_variable and trace->dt, based on 'map' and 'format' */
-                    findVariable(trace);
-
-                    if(trace->OD_variable != NULL) {
-                        *trace->value = 0;
-                        *trace->minValue = 0;
-                        *trace->maxValue = 0;
-                        *trace->triggerTime = 0;
-                        trace->valuePrev = 0;
-                        trace->readPtr = 0;
-                        trace->writePtr = 0;
-                        trace->enabled = true;
-                    }
-                    else {
-                        ret = CO_SDO_AB_NO_MAP;
-                    }
-                }
-            }
+            OD_size_t offset = pos - trace->exportHeaderLength;
+            OD_size_t inBlock = offset % CO_TRACE_BLOCK_SIZE;
+            src = blockPtr(trace, (uint16_t)(offset / CO_TRACE_BLOCK_SIZE))
+                  + inBlock;
+            len = CO_TRACE_BLOCK_SIZE - inBlock;
         }
-        break;
-
-    case 5:     /* map */
-    case 6:     /* format */
-        if(!ODF_arg->reading) {
-            if(trace->enabled) {
-                ret = CO_SDO_AB_INVALID_VALUE;
-            }
+        if (len > count - n) {
+            len = count - n;
         }
-        break;
+        memcpy(&buf[n], src, len);
+        n += len;
+        pos += len;
     }
 
-    return ret;
+    if (pos < stream->dataLength) {
+        stream->dataOffset = pos;
+        *returnCode = ODR_PARTIAL;
+    }
+    else {
+        stream->dataOffset = 0;
+        trace->exporting = false;
+        *returnCode = ODR_OK;
+    }
+    return n;
 }
 
 
-/* OD function for accessing _OD_trace_ (index 0x2400+) from SDO server.
- * For more information see file CO_SDOserver.h. */
-static CO_SDO_abortCode_t CO_ODF_trace(CO_ODF_arg_t *ODF_arg) {
-    CO_trace_t *trace;
-    CO_SDO_abortCode_t ret = CO_SDO_AB_NONE;
+/*
+ * Custom functions for read/write OD objects "traceConfig" and "trace"
+ *
+ * For more information see file CO_ODinterface.h, OD_IO_t.
+ */
+static OD_size_t OD_read_traceConfig(OD_stream_t *stream, uint8_t subIndex,
+                                     void *buf, OD_size_t count,
+                                     ODR_t *returnCode)
+{
+    if (stream == NULL || buf == NULL || returnCode == NULL) {
+        if (returnCode != NULL) *returnCode = ODR_DEV_INCOMPAT;
+        return 0;
+    }
 
-    trace = (CO_trace_t*) ODF_arg->object;
+    CO_trace_t *trace = (CO_trace_t *)stream->object;
+
+    switch (subIndex) {
+    case SUB_CFG_SIZE:
+        if (count < sizeof(uint32_t)) break;
+        *returnCode = ODR_OK;
+        return CO_setUint32(buf, (uint32_t)trace->blockCount
+                                 * CO_TRACE_BLOCK_SIZE);
+    case SUB_CFG_STATE:
+        *returnCode = ODR_OK;
+        return CO_setUint8(buf, (uint8_t)trace->state);
+    default:
+        return OD_readOriginal(stream, subIndex, buf, count, returnCode);
+    }
 
-    switch(ODF_arg->subIndex) {
-    case 1:     /* size */
-        if(ODF_arg->reading) {
-            uint32_t size = trace->bufferSize;
-            uint32_t wp = trace->writePtr;
-            uint32_t rp = trace->readPtr;
+    *returnCode = ODR_DEV_INCOMPAT;
+    return 0;
+}
 
-            if(wp >= rp) {
-                CO_setUint32(ODF_arg->data,  wp - rp);
-            }
-            else {
-                CO_setUint32(ODF_arg->data, size - rp + wp);
-            }
+static OD_size_t OD_write_traceConfig(OD_stream_t *stream, uint8_t subIndex,
+                                      const void *buf, OD_size_t count,
+                                      ODR_t *returnCode)
+{
+    if (stream == NULL || buf == NULL || returnCode == NULL) {
+        if (returnCode != NULL) *returnCode = ODR_DEV_INCOMPAT;
+        return 0;
+    }
+
+    CO_trace_t *trace = (CO_trace_t *)stream->object;
+
+    if (subIndex == SUB_CFG_CONTROL) {
+        if (count != 1) {
+            *returnCode = ODR_TYPE_MISMATCH;
+            return 0;
         }
-        else {
-            if(CO_getUint32(ODF_arg->data) == 0) {
-                /* clear buffer, handle race conditions */
-                while(trace->readPtr != 0 || trace->writePtr != 0) {
-                    trace->readPtr = 0;
-                    trace->writePtr = 0;
-                    *trace->triggerTime = 0;
-                }
-            }
-            else {
-                ret = CO_SDO_AB_INVALID_VALUE;
-            }
+        if (trace->exporting) {
+            *returnCode = ODR_DATA_DEV_STATE;
+            return 0;
         }
-        break;
-
-    case 5:     /* plot */
-        if(ODF_arg->reading) {
-            /* This plot will be transmitted as domain data type. String data
-             * will be printed directly to SDO buffer. If there is more data
-             * to print, than is the size of SDO buffer, then this function
-             * will be called multiple times until internal trace buffer is
-             * empty. Internal trace buffer is circular buffer. It is accessed
-             * by this function and by higher priority thread. If this buffer
-             * is full, there is a danger for race condition. First records
-             * from trace buffer may be overwritten somewhere between. If this
-             * is detected, then do{}while() loop tries printing again. */
-            if(trace->bufferSize == 0 || ODF_arg->dataLength < 100) {
-                ret = CO_SDO_AB_OUT_OF_MEM;
-            }
-            else if(trace->readPtr == trace->writePtr) {
-                ret = CO_SDO_AB_NO_DATA;
-            }
-            else {
-                uint32_t rp, t, v, len, freeLen;
-                char *s;
-                bool_t readPtrOverflowed; /* for handling race conditions */
-
-                /* repeat everything, if trace->readPtr was overflowed in CO_trace_process */
-                do {
-                    readPtrOverflowed = false;
-                    s = (char*) ODF_arg->data;
-                    freeLen = ODF_arg->dataLength;
-
-                    rp = trace->readPtr;
-
-                    /* start plot, increment variables, verify overflow */
-                    if(ODF_arg->firstSegment) {
-                        t = trace->timeBuffer[rp];
-                        v = trace->valueBuffer[rp];
-                        rp ++;
-                        if(++trace->readPtr == trace->bufferSize) {
-                            trace->readPtr = 0;
-                            if(rp != trace->bufferSize) {
-                                readPtrOverflowed = true;
-                                continue;
-                            }
-                            rp = 0;
-                        }
-                        if(rp != trace->readPtr) {
-                            readPtrOverflowed = true;
-                            continue;
-                        }
-                        len = trace->dt->printPointStart(s, freeLen, t, v);
-                        s += len;
-                        freeLen -= len;
-                    }
-
-                    /* print other points */
-                    if(rp != trace->writePtr) {
-                    for(;;) {
-                        t = trace->timeBuffer[rp];
-                        v = trace->valueBuffer[rp];
-                        rp ++;
-                        if(++trace->readPtr == trace->bufferSize) {
-                            trace->readPtr = 0;
-                            if(rp != trace->bufferSize && ODF_arg->firstSegment) {
-                                readPtrOverflowed = true;
-                                break;
-                            }
-                            rp = 0;
-                        }
-                        if(rp != trace->readPtr && ODF_arg->firstSegment) {
-                            readPtrOverflowed = true;
-                            break;
-                        }
-
-                        /* If internal buffer is empty, end transfer */
-                        if(rp == trace->writePtr) {
-                            /* If there is last time stamp, point will be printed at the end */
-                            if(t != trace->lastTimeStamp) {
-                                len = trace->dt->printPoint(s, freeLen, t, v);
-                                s += len;
-                                freeLen -= len;
-                            }
-                            ODF_arg->lastSegment = true;
-                            break;
-                        }
-                        len = trace->dt->printPoint(s, freeLen, t, v);
-                        s += len;
-                        freeLen -= len;
-
-                        /* if output buffer is full, next data will be sent later */
-                        if(freeLen < 50) {
-                            ODF_arg->lastSegment = false;
-                            break;
-                        }
-                    }
-                    }
-
-                    /* print last point */
-                    if(!readPtrOverflowed && ODF_arg->lastSegment) {
-                        v = trace->valuePrev;
-                        t = trace->lastTimeStamp;
-                        len = trace->dt->printPointEnd(s, freeLen, t, v);
-                        s += len;
-                        freeLen -= len;
-                    }
-                } while(readPtrOverflowed);
-
-                ODF_arg->dataLength -= freeLen;
-            }
+        ODR_t odRet = traceStart(trace, CO_getUint8(buf));
+        if (odRet != ODR_OK) {
+            *returnCode = odRet;
+            return 0;
         }
-        break;
     }
 
-    return ret;
+    /* write value to the original location in the Object Dictionary */
+    return OD_writeOriginal(stream, subIndex, buf, count, returnCode);
+}
+
+static OD_size_t OD_read_trace(OD_stream_t *stream, uint8_t subIndex,
+                               void *buf, OD_size_t count,
+                               ODR_t *returnCode)
+{
+    if (stream == NULL || buf == NULL || returnCode == NULL) {
+        if (returnCode != NULL) *returnCode = ODR_DEV_INCOMPAT;
+        return 0;
+    }
+
+    CO_trace_t *trace = (CO_trace_t *)stream->object;
+
+    switch (subIndex) {
+    case SUB_TRACE_DATA:
+        return traceExport(trace, stream, buf, count, returnCode);
+    case SUB_TRACE_RECORDS:
+        if (count < sizeof(uint32_t)) break;
+        *returnCode = ODR_OK;
+        return CO_setUint32(buf, trace->recordCount);
+    case SUB_TRACE_TRIGGER_TIME:
+        if (count < sizeof(uint32_t)) break;
+        *returnCode = ODR_OK;
+        return CO_setUint32(buf, trace->triggerTime_us);
+    default:
+        return OD_readOriginal(stream, subIndex, buf, count, returnCode);
+    }
+
+    *returnCode = ODR_DEV_INCOMPAT;
+    return 0;
 }
 
 
 /******************************************************************************/
-void CO_trace_init(
-        CO_trace_t             *trace,
-        CO_SDO_t               *SDO,
-        uint8_t                 enabled,
-        uint32_t               *timeBuffer,
-        int32_t                *valueBuffer,
-        uint32_t                bufferSize,
-        uint32_t               *map,
-        uint8_t                *format,
-        uint8_t                *trigger,
-        int32_t                *threshold,
-        int32_t                *value,
-        int32_t                *minValue,
-        int32_t                *maxValue,
-        uint32_t               *triggerTime,
-        uint16_t                idx_OD_traceConfig,
-        uint16_t                idx_OD_trace)
+CO_ReturnError_t CO_trace_init(CO_trace_t *trace,
+                               const OD_entry_t *OD_traceConfig,
+                               const OD_entry_t *OD_trace,
+                               const OD_t *od,
+                               uint8_t *buf,
+                               uint32_t bufSize,
+                               uint32_t *errInfo)
 {
-    trace->SDO = SDO;
-    trace->enabled = (enabled != 0) ? true : false;
-    trace->timeBuffer = timeBuffer;
-    trace->valueBuffer = valueBuffer;
-    trace->bufferSize = bufferSize;
-    trace->writePtr = 0;
-    trace->readPtr = 0;
-    trace->lastTimeStamp = 0;
-    trace->map = map;
-    trace->format = format;
-    trace->trigger = trigger;
-    trace->threshold = threshold;
-    trace->value = value;
-    trace->minValue = minValue;
-    trace->maxValue = maxValue;
-    trace->triggerTime = triggerTime;
-    *trace->value = 0;
-    *trace->minValue = 0;
-    *trace->maxValue = 0;
-    *trace->triggerTime = 0;
-    trace->valuePrev = 0;
+    uint8_t control = CO_TRACE_CTRL_OFF;
 
-    /* set trace->OD_variable and trace->dt, based on 'map' and 'format' */
-    findVariable(trace);
-
-    if(timeBuffer == NULL || valueBuffer == NULL) {
-        trace->bufferSize = 0;
+    /* verify arguments */
+    if (trace == NULL || OD_traceConfig == NULL || OD_trace == NULL
+        || od == NULL || buf == NULL || bufSize < 2 * CO_TRACE_BLOCK_SIZE
+    ) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
     }
 
-    if( trace->bufferSize == 0 || trace->OD_variable == NULL) {
-        trace->enabled = false;
+    /* clear the object */
+    memset(trace, 0, sizeof(CO_trace_t));
+
+    /* Configure object variables */
+    trace->OD_traceConfig = OD_traceConfig;
+    trace->od = od;
+    trace->buf = buf;
+    trace->blockCount = bufSize / CO_TRACE_BLOCK_SIZE > 0xFFFE
+                      ? 0xFFFE : (uint16_t)(bufSize / CO_TRACE_BLOCK_SIZE);
+    trace->blockTrigger = NO_BLOCK;
+    trace->state = CO_TRACE_ST_OFF;
+
+    /* Configure Object dictionary entries */
+    ODR_t odRet0 = OD_extensionIO_init(OD_traceConfig,
+                                       (void *)trace,
+                                       OD_read_traceConfig,
+                                       OD_write_traceConfig);
+    ODR_t odRet1 = OD_set_u8(OD_traceConfig, SUB_CFG_CONTROL, control, true);
+    if (odRet0 != ODR_OK || odRet1 != ODR_OK) {
+        if (errInfo != NULL) *errInfo = OD_getIndex(OD_traceConfig);
+        return CO_ERROR_OD_PARAMETERS;
+    }
+    odRet0 = OD_extensionIO_init(OD_trace,
+                                 (void *)trace,
+                                 OD_read_trace,
+                                 OD_writeOriginal);
+    if (odRet0 != ODR_OK) {
+        if (errInfo != NULL) *errInfo = OD_getIndex(OD_trace);
+        return CO_ERROR_OD_PARAMETERS;
     }
 
-    CO_OD_configure(SDO, idx_OD_traceConfig, CO_ODF_traceConfig, (void*)trace, 0, 0);
-    CO_OD_configure(SDO, idx_OD_trace, CO_ODF_trace, (void*)trace, 0, 0);
+    return CO_ERROR_NO;
 }
 
 
 /******************************************************************************/
-void CO_trace_process(CO_trace_t *trace, uint32_t timestamp) {
-    if(trace->enabled) {
+void CO_trace_process(CO_trace_t *trace, uint32_t timeDifference_us) {
+    trace->time_us += timeDifference_us;
 
-        int32_t val = trace->dt->pGetValue(trace->OD_variable);
+    if (trace->exporting) {
+        trace->exportTimer_us += timeDifference_us;
+        if (trace->exportTimer_us < CO_TRACE_EXPORT_TIMEOUT_US) {
+            return;
+        }
+        /* export was abandoned */
+        trace->exporting = false;
+    }
 
-        if(val != trace->valuePrev) {
-            /* Verify, if value passed threshold */
-            if((*trace->trigger & 1) != 0 && trace->valuePrev < *trace->threshold && val >= *trace->threshold) {
-                *trace->triggerTime = timestamp;
-            }
-            if((*trace->trigger & 2) != 0 && trace->valuePrev < *trace->threshold && val >= *trace->threshold) {
-                *trace->triggerTime = timestamp;
-            }
+    if (trace->state == CO_TRACE_ST_OFF
+        || trace->state == CO_TRACE_ST_COMPLETED
+    ) {
+        return;
+    }
 
-            /* Write value and verify min/max */
-            if(trace->value != trace->OD_variable) {
-                *trace->value = val;
-            }
-            trace->valuePrev = val;
-            if(*trace->minValue > val) {
-                *trace->minValue = val;
-            }
-            if(*trace->maxValue < val) {
-                *trace->maxValue = val;
-            }
+    if (trace->period_us > 0) {
+        trace->periodTimer_us += timeDifference_us;
+        if (trace->periodTimer_us < trace->period_us) {
+            return;
+        }
+        trace->periodTimer_us -= trace->period_us;
+        if (trace->periodTimer_us >= trace->period_us) {
+            /* missed samples are not recorded */
+            trace->periodTimer_us = 0;
+        }
+    }
 
-            /* write buffers and update pointers */
-            trace->timeBuffer[trace->writePtr] = timestamp;
-            trace->valueBuffer[trace->writePtr] = val;
-            if(++trace->writePtr == trace->bufferSize) {
-                trace->writePtr = 0;
-            }
-            if(trace->writePtr == trace->readPtr) {
-                if(++trace->readPtr == trace->bufferSize) {
-                    trace->readPtr = 0;
-                }
+    /* sample all variables */
+    bool_t changed = !trace->valid;
+    bool_t triggered = false;
+    uint8_t triggerVar = trace->trigger & 0x0F;
+    uint8_t edge = (trace->trigger >> 4) & 0x03;
+
+    for (uint8_t i = 0; i < trace->varCount; i++) {
+        int64_t value = readVar(&trace->vars[i],
+                                (trace->signedMask & (1 << i)) != 0);
+
+        if (i == triggerVar && edge != 0 && trace->valid) {
+            int64_t prev = trace->values[i];
+            if (((edge & 1) != 0 && prev < trace->threshold
+                                 && value >= trace->threshold)
+                || ((edge & 2) != 0 && prev >= trace->threshold
+                                    && value < trace->threshold)
+            ) {
+                triggered = true;
             }
         }
-        else {
-            /* if buffer is empty, make first record */
-            if(trace->writePtr == trace->readPtr) {
-                /* write buffers and update pointers */
-                trace->timeBuffer[trace->writePtr] = timestamp;
-                trace->valueBuffer[trace->writePtr] = val;
-                if(++trace->writePtr == trace->bufferSize) {
-                    trace->writePtr = 0;
-                }
-            }
+        if (value != trace->values[i]) {
+            changed = true;
+        }
+        trace->values[i] = value;
+    }
+    trace->valid = true;
+
+    /* last sample after trigger is always recorded, so end time is known */
+    bool_t last = false;
+    if (trace->state == CO_TRACE_ST_TRIGGERED) {
+        if (++trace->postCount >= trace->postTrigger) {
+            last = true;
+            changed = true;
         }
-        trace->lastTimeStamp = timestamp;
+    }
+
+    if (changed) {
+        writeRecord(trace);
+    }
+
+    if (triggered && trace->state != CO_TRACE_ST_TRIGGERED) {
+        trace->triggerTime_us = trace->time_us;
+        trace->blockTrigger = blockIndex(trace, trace->blockUsed - 1);
+        if (trace->state == CO_TRACE_ST_ARMED) {
+            trace->postCount = 0;
+            trace->state = trace->postTrigger == 0
+                         ? CO_TRACE_ST_COMPLETED : CO_TRACE_ST_TRIGGERED;
+        }
+    }
+    else if (last && trace->state == CO_TRACE_ST_TRIGGERED) {
+        trace->state = CO_TRACE_ST_COMPLETED;
     }
 }
 
@@ -27,12 +27,15 @@
 #define CO_TRACE_H
 
 #include "301/CO_driver.h"
-#include "301/CO_SDOserver.h"
+#include "301/CO_ODinterface.h"
 
 /* default configuration, see CO_config.h */
 #ifndef CO_CONFIG_TRACE
 #define CO_CONFIG_TRACE (0)
 #endif
+#ifndef CO_CONFIG_TRACE_BUFFER_SIZE
+#define CO_CONFIG_TRACE_BUFFER_SIZE 4096
+#endif
 
 #if ((CO_CONFIG_TRACE) & CO_CONFIG_TRACE_ENABLE) || defined CO_DOXYGEN
 
@@ -47,19 +50,66 @@ extern "C" {
  *
  * CANopen trace object for recording variables over time.
  *
- * In embedded systems there is often a need to monitor some variables over time.
- * Results are then displayed on graph, similar as in oscilloscope.
+ * In embedded systems there is often a need to monitor some variables over
+ * time. Results are then displayed on graph, similar as in oscilloscope.
+ *
+ * Trace is configured and read through the Object Dictionary. Each trace
+ * channel samples up to @ref CO_TRACE_VARS_MAX variables, mapped the same way
+ * as in PDO. @ref CO_trace_process() runs together with PDOs in the realtime
+ * part of the program and samples all variables at once. Record is stored only,
+ * if any value changes.
+ *
+ * Records are compressed into a ring of fixed size blocks. Block starts with a
+ * header (little endian): uint16 number of used bytes after the header,
+ * uint16 number of records and uint32 time of the block start in microseconds.
+ * Each record follows as: varint time difference in microseconds from the
+ * previous record (or from the block start), then for each variable a zigzag
+ * varint difference from its previous value. First record in the block is
+ * relative to zero, so each block is decoded independently. Varint is LEB128:
+ * seven bits per byte, least significant group first, bit 7 set, if more bytes
+ * follow. When ring is full, the oldest block is discarded.
+ *
+ * Trace runs in continuous mode or in triggered mode. In triggered mode data
+ * before the trigger event are kept in the ring, after the trigger
+ * "postTrigger" samples are recorded and then trace stops. If ring would
+ * discard the block with the trigger, trace stops earlier.
+ *
+ * Recording is exported as binary domain (sub-index 1 of the trace object), so
+ * it can be read with SDO block upload, or locally with @ref OD_getSub() and
+ * "read" function from @ref OD_IO_t, for example by a program, which copies it
+ * to shared memory. Export starts with the header (little endian):
+ * - "COTR", uint8 version (@ref CO_TRACE_VERSION), uint8 number of variables,
+ *   uint8 signedMask, uint8 @ref CO_trace_state_t,
+ * - uint16 block size, uint16 number of blocks, uint32 trigger time in
+ *   microseconds, uint16 number of the block with the trigger (0xFFFF if none),
+ *   uint16 reserved,
+ * - uint32 mapping for each variable.
+ *
+ * Blocks follow, from the oldest to the newest, each @ref CO_TRACE_BLOCK_SIZE
+ * bytes long. Recording is paused during the export, so exported data are
+ * consistent. It resumes, when export is finished or after
+ * @ref CO_TRACE_EXPORT_TIMEOUT_US of inactivity (if SDO transfer is aborted).
  *
- * CANopen trace is a configurable object, accessible via CANopen Object
- * Dictionary, which records chosen variable over time. It generates a curve,
- * which can be read via SDO and can then be displayed in a graph.
+ * OD object "traceConfig" (@ref OD_INDEX_TRACE_CONFIG + channel), RECORD with
+ * IO extension:
+ * - sub 1, UNSIGNED32, ro: size of the buffer in bytes.
+ * - sub 2, UNSIGNED8, rw: control, see @ref CO_trace_control_t. Writing
+ *   applies the configuration and restarts the recording.
+ * - sub 3, UNSIGNED8, ro: state, see @ref CO_trace_state_t.
+ * - sub 4, UNSIGNED8, rw: trigger: bits 0..3 number of the variable (0 is
+ *   first), bits 4..5 edge: 1 rising, 2 falling, 3 both.
+ * - sub 5, INTEGER32, rw: trigger threshold.
+ * - sub 6, UNSIGNED32, rw: number of samples recorded after the trigger.
+ * - sub 7, UNSIGNED32, rw: sample period in microseconds, 0 for each call.
+ * - sub 8, UNSIGNED8, rw: signedMask, bit is set for signed variable.
+ * - sub 9..16, UNSIGNED32, rw: mapped variables, PDO mapping format. Length
+ *   must be 8, 16, 32 or 64 bits. Variables are used up to the first zero.
  *
- * CO_trace_process() runs in 1 ms intervals and monitors one variable. If it
- * changes, it makes a record with timestamp into circular buffer. When trace is
- * accessed by CANopen SDO object, it reads latest points from the the circular
- * buffer, prints a SVG curve into string and sends it as a SDO response. If a
- * SDO request was received from the same device, then no traffic occupies CAN
- * network.
+ * OD object "trace" (@ref OD_INDEX_TRACE + channel), RECORD with IO
+ * extension, read only:
+ * - sub 1, DOMAIN: exported recording.
+ * - sub 2, UNSIGNED32: number of records in the buffer.
+ * - sub 3, UNSIGNED32: time of the last trigger in microseconds.
  */
 
 
@@ -71,102 +121,164 @@ extern "C" {
 #define OD_INDEX_TRACE          0x2401
 #endif
 
+/** Maximum number of variables in one trace channel */
+#define CO_TRACE_VARS_MAX 8
+
+/** Size of one block in the buffer, including block header, max 65535 */
+#ifndef CO_TRACE_BLOCK_SIZE
+#define CO_TRACE_BLOCK_SIZE 256
+#endif
+
+/** Recording resumes after this time, if export is not finished */
+#ifndef CO_TRACE_EXPORT_TIMEOUT_US
+#define CO_TRACE_EXPORT_TIMEOUT_US 5000000
+#endif
+
+/** Version of the export format */
+#define CO_TRACE_VERSION 1
+
+
+/**
+ * Trace control, written to traceConfig, sub 2
+ */
+typedef enum {
+    CO_TRACE_CTRL_OFF = 0, /**< Stop recording */
+    CO_TRACE_CTRL_CONTINUOUS = 1, /**< Record continuously, trigger only
+                                       updates trigger time */
+    CO_TRACE_CTRL_TRIGGERED = 2 /**< Arm trigger, stop after postTrigger */
+} CO_trace_control_t;
+
 
 /**
- *  structure for reading variables and printing points for specific data type.
+ * Trace state, traceConfig, sub 3
+ */
+typedef enum {
+    CO_TRACE_ST_OFF = 0, /**< Not recording */
+    CO_TRACE_ST_CONTINUOUS = 1, /**< Recording continuously */
+    CO_TRACE_ST_ARMED = 2, /**< Recording, waiting for trigger */
+    CO_TRACE_ST_TRIGGERED = 3, /**< Recording samples after trigger */
+    CO_TRACE_ST_COMPLETED = 4 /**< Triggered recording is finished */
+} CO_trace_state_t;
+
+
+/**
+ * Mapped variable
  */
 typedef struct {
-    /** Function pointer for getting the value from OD variable. **/
-    int32_t (*pGetValue) (void *OD_variable);
-    /** Function pointer for printing the start point to trace.plot */
-    uint32_t (*printPointStart)(char *s, uint32_t size, uint32_t timeStamp, int32_t value);
-    /** Function pointer for printing the point to trace.plot */
-    uint32_t (*printPoint)(char *s, uint32_t size, uint32_t timeStamp, int32_t value);
-    /** Function pointer for printing the end point to trace.plot */
-    uint32_t (*printPointEnd)(char *s, uint32_t size, uint32_t timeStamp, int32_t value);
-} CO_trace_dataType_t;
+    /** OD handle of the variable */
+    OD_IO_t io;
+    /** Pointer to data, if variable has no IO extension, NULL otherwise */
+    const void *data;
+    /** OD sub-index of the variable */
+    uint8_t subIndex;
+    /** Length of the variable in bytes */
+    uint8_t length;
+} CO_trace_var_t;
 
 
 /**
  * Trace object.
  */
 typedef struct {
-    bool_t              enabled;        /**< True, if trace is enabled. */
-    CO_SDO_t           *SDO;            /**< From CO_trace_init(). */
-    uint32_t           *timeBuffer;     /**< From CO_trace_init(). */
-    int32_t            *valueBuffer;    /**< From CO_trace_init(). */
-    uint32_t            bufferSize;     /**< From CO_trace_init(). */
-    volatile uint32_t   writePtr;       /**< Location in buffer, which will be next written. */
-    volatile uint32_t   readPtr;        /**< Location in buffer, which will be next read. */
-    uint32_t            lastTimeStamp;  /**< Last time stamp. If zero, then last point contains last timestamp. */
-    void               *OD_variable;    /**< Pointer to variable, which is monitored */
-    const CO_trace_dataType_t *dt;      /**< Data type specific function pointers. **/
-    int32_t             valuePrev;      /**< Previous value of value. */
-    uint32_t           *map;            /**< From CO_trace_init(). */
-    uint8_t            *format;         /**< From CO_trace_init(). */
-    int32_t            *value;          /**< From CO_trace_init(). */
-    int32_t            *minValue;       /**< From CO_trace_init(). */
-    int32_t            *maxValue;       /**< From CO_trace_init(). */
-    uint32_t           *triggerTime;    /**< From CO_trace_init(). */
-    uint8_t            *trigger;        /**< From CO_trace_init(). */
-    int32_t            *threshold;      /**< From CO_trace_init(). */
+    /** From CO_trace_init() */
+    const OD_entry_t *OD_traceConfig;
+    /** From CO_trace_init() */
+    const OD_t *od;
+    /** From CO_trace_init() */
+    uint8_t *buf;
+    /** Number of blocks in buf */
+    uint16_t blockCount;
+    /** Index of the oldest block in buf */
+    uint16_t blockFirst;
+    /** Number of used blocks, the last one is written */
+    uint16_t blockUsed;
+    /** Index of the block with the trigger or 0xFFFF */
+    uint16_t blockTrigger;
+    /** Current state */
+    CO_trace_state_t state;
+    /** True, if recording is paused, because export is in progress */
+    bool_t exporting;
+    /** Timer for export timeout */
+    uint32_t exportTimer_us;
+    /** Mapped variables */
+    CO_trace_var_t vars[CO_TRACE_VARS_MAX];
+    /** Number of mapped variables */
+    uint8_t varCount;
+    /** Mappings of the variables, copied at start */
+    uint32_t maps[CO_TRACE_VARS_MAX];
+    /** Signed variables, copied at start */
+    uint8_t signedMask;
+    /** Trigger variable and edge, copied at start */
+    uint8_t trigger;
+    /** Trigger threshold, copied at start */
+    int32_t threshold;
+    /** Number of samples after trigger, copied at start */
+    uint32_t postTrigger;
+    /** Sample period, copied at start */
+    uint32_t period_us;
+    /** Time, accumulated from CO_trace_process() */
+    uint32_t time_us;
+    /** Time of the previous record */
+    uint32_t timePrev_us;
+    /** Timer for sample period */
+    uint32_t periodTimer_us;
+    /** Number of samples after trigger */
+    uint32_t postCount;
+    /** Time of the last trigger */
+    uint32_t triggerTime_us;
+    /** Number of records in buf */
+    uint32_t recordCount;
+    /** True, if values[] contain previous sample */
+    bool_t valid;
+    /** Values from the previous sample */
+    int64_t values[CO_TRACE_VARS_MAX];
+    /** Values, from which next record in the block is encoded */
+    int64_t base[CO_TRACE_VARS_MAX];
+    /** Header of the export */
+    uint8_t exportHeader[20 + 4 * CO_TRACE_VARS_MAX];
+    /** Length of the exportHeader */
+    uint8_t exportHeaderLength;
 } CO_trace_t;
 
 
 /**
  * Initialize trace object.
  *
- * Function must be called in the communication reset section.
+ * Function must be called in the communication reset section. Trace is off
+ * after initialization. Configuration from the Object Dictionary is applied,
+ * when control is written.
  *
  * @param trace This object will be initialized.
- * @param SDO SDO server object.
- * @param enabled Is trace enabled.
- * @param timeBuffer Memory block for storing time records.
- * @param valueBuffer Memory block for storing value records.
- * @param bufferSize Size of the above buffers.
- * @param map Map to variable in Object Dictionary, which will be monitored. Same structure as in PDO.
- * @param format Format of the plot. If first bit is 1, above variable is unsigned. For more info see Object Dictionary.
- * @param trigger If different than zero, trigger time is recorded, when variable goes through threshold.
- * @param threshold Used with trigger.
- * @param value Pointer to variable, which will show last value of the variable.
- * @param minValue Pointer to variable, which will show minimum value of the variable.
- * @param maxValue Pointer to variable, which will show maximum value of the variable.
- * @param triggerTime Pointer to variable, which will show last trigger time of the variable.
- * @param idx_OD_traceConfig Index in Object Dictionary.
- * @param idx_OD_trace Index in Object Dictionary.
- *
- * @return 0 on success, -1 on error.
+ * @param OD_traceConfig OD entry for traceConfig object.
+ * @param OD_trace OD entry for trace object.
+ * @param od Object Dictionary, where mapped variables are searched.
+ * @param buf Memory block for the recording, at least two
+ * @ref CO_TRACE_BLOCK_SIZE blocks.
+ * @param bufSize Size of buf in bytes.
+ * @param [out] errInfo Index of erroneous OD object, may be NULL.
+ *
+ * @return CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT or CO_ERROR_OD_PARAMETERS.
  */
-void CO_trace_init(
-        CO_trace_t             *trace,
-        CO_SDO_t               *SDO,
-        uint8_t                 enabled,
-        uint32_t               *timeBuffer,
-        int32_t                *valueBuffer,
-        uint32_t                bufferSize,
-        uint32_t               *map,
-        uint8_t                *format,
-        uint8_t                *trigger,
-        int32_t                *threshold,
-        int32_t                *value,
-        int32_t                *minValue,
-        int32_t                *maxValue,
-        uint32_t               *triggerTime,
-        uint16_t                idx_OD_traceConfig,
-        uint16_t                idx_OD_trace);
+CO_ReturnError_t CO_trace_init(CO_trace_t *trace,
+                               const OD_entry_t *OD_traceConfig,
+                               const OD_entry_t *OD_trace,
+                               const OD_t *od,
+                               uint8_t *buf,
+                               uint32_t bufSize,
+                               uint32_t *errInfo);
 
 
 /**
  * Process trace object.
  *
- * Function must be called cyclically in 1ms intervals.
+ * Function must be called cyclically, inside @ref CO_LOCK_OD() section,
+ * typically from realtime thread after RPDOs are processed.
  *
  * @param trace This object.
- * @param timestamp Timestamp (usually in millisecond resolution).
- *
- * @return 0 on success, -1 on error.
+ * @param timeDifference_us Time difference from previous function call in
+ * microseconds.
  */
-void CO_trace_process(CO_trace_t *trace, uint32_t timestamp);
+void CO_trace_process(CO_trace_t *trace, uint32_t timeDifference_us);
 
 /** @} */ /* CO_trace */
 
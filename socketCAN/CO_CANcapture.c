@@ -0,0 +1,491 @@
+/*
+ * Capture of CAN traffic into rotating pcapng files on Linux.
+ *
+ * @file        CO_CANcapture.c
+ * @ingroup     CO_socketCAN_CANcapture
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <syslog.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+
+#include "CO_CANcapture.h"
+#include "CO_error.h"
+
+#if CO_DRIVER_CAPTURE > 0
+
+#if (CO_DRIVER_CAPTURE_RING_SIZE & (CO_DRIVER_CAPTURE_RING_SIZE - 1)) != 0
+#error CO_DRIVER_CAPTURE_RING_SIZE must be power of 2
+#endif
+
+/* pcapng block types, options and link type */
+#define PCAPNG_SHB              0x0A0D0D0AUL
+#define PCAPNG_IDB              0x00000001UL
+#define PCAPNG_ISB              0x00000005UL
+#define PCAPNG_EPB              0x00000006UL
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4DUL
+#define PCAPNG_OPT_END          0
+#define PCAPNG_OPT_COMMENT      1
+#define PCAPNG_SHB_USERAPPL     4
+#define PCAPNG_IF_NAME          2
+#define PCAPNG_IF_TSRESOL       9
+#define PCAPNG_EPB_FLAGS        2
+#define PCAPNG_ISB_IFDROP       5
+#define PCAPNG_EPB_INBOUND      1UL
+#define PCAPNG_EPB_OUTBOUND     2UL
+#define LINKTYPE_CAN_SOCKETCAN  227
+
+/* Largest blocks: EPB with comment and ISB, always reserved for file end */
+#define EPB_SIZE_MAX            (28 + CAN_MTU + 8 + 4 + 20 + 4 + 4)
+#define IDB_SIZE_MAX            (16 + 4 + IFNAMSIZ + 8 + 4 + 4)
+#define ISB_SIZE                40
+
+
+/* Block writer, buffer is large enough for any block ************************/
+typedef struct {
+    uint8_t buf[64 + IFNAMSIZ + CAN_MTU];
+    size_t len;
+} block_t;
+
+static void blockU16(block_t *b, uint16_t v) {
+    memcpy(&b->buf[b->len], &v, sizeof(v));
+    b->len += sizeof(v);
+}
+
+static void blockU32(block_t *b, uint32_t v) {
+    memcpy(&b->buf[b->len], &v, sizeof(v));
+    b->len += sizeof(v);
+}
+
+static void blockData(block_t *b, const void *data, size_t len) {
+    memcpy(&b->buf[b->len], data, len);
+    b->len += len;
+    while ((b->len & 3) != 0) {
+        b->buf[b->len++] = 0;
+    }
+}
+
+static void blockOption(block_t *b, uint16_t code, const void *data,
+                        uint16_t len)
+{
+    blockU16(b, code);
+    blockU16(b, len);
+    blockData(b, data, len);
+}
+
+static void blockBegin(block_t *b, uint32_t type) {
+    b->len = 0;
+    blockU32(b, type);
+    blockU32(b, 0); /* total length, set in blockEnd() */
+}
+
+static void blockEnd(block_t *b) {
+    uint32_t total = (uint32_t)b->len + 4;
+    memcpy(&b->buf[4], &total, sizeof(total));
+    blockU32(b, total);
+}
+
+
+/* Write block into the mapped file, background thread ***********************/
+static void writeBlock(CO_CANcapture_t *cap, const block_t *b) {
+    memcpy(&cap->map[cap->used], b->buf, b->len);
+    cap->used += b->len;
+}
+
+static void writeSHB(CO_CANcapture_t *cap) {
+    static const char userappl[] = "CANopenNode";
+    block_t b;
+
+    blockBegin(&b, PCAPNG_SHB);
+    blockU32(&b, PCAPNG_BYTE_ORDER_MAGIC);
+    blockU16(&b, 1);            /* major version */
+    blockU16(&b, 0);            /* minor version */
+    blockU32(&b, 0xFFFFFFFFUL); /* section length not specified */
+    blockU32(&b, 0xFFFFFFFFUL);
+    blockOption(&b, PCAPNG_SHB_USERAPPL, userappl, sizeof(userappl) - 1);
+    blockU32(&b, PCAPNG_OPT_END);
+    blockEnd(&b);
+    writeBlock(cap, &b);
+}
+
+static void writeIDB(CO_CANcapture_t *cap, int can_ifindex) {
+    char ifName[IFNAMSIZ];
+    uint8_t tsresol = 9; /* nanoseconds */
+    block_t b;
+
+    blockBegin(&b, PCAPNG_IDB);
+    blockU16(&b, LINKTYPE_CAN_SOCKETCAN);
+    blockU16(&b, 0);
+    blockU32(&b, CAN_MTU);      /* snap length */
+    if (if_indextoname((unsigned)can_ifindex, ifName) != NULL) {
+        blockOption(&b, PCAPNG_IF_NAME, ifName, (uint16_t)strlen(ifName));
+    }
+    blockOption(&b, PCAPNG_IF_TSRESOL, &tsresol, 1);
+    blockU32(&b, PCAPNG_OPT_END);
+    blockEnd(&b);
+    writeBlock(cap, &b);
+}
+
+static void writeISB(CO_CANcapture_t *cap) {
+    uint64_t drop = (uint32_t)(cap->overflow - cap->overflowFileStart);
+    struct timespec ts;
+    uint64_t t;
+    block_t b;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    t = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+
+    blockBegin(&b, PCAPNG_ISB);
+    blockU32(&b, 0);            /* first interface */
+    blockU32(&b, (uint32_t)(t >> 32));
+    blockU32(&b, (uint32_t)t);
+    blockOption(&b, PCAPNG_ISB_IFDROP, &drop, sizeof(drop));
+    blockU32(&b, PCAPNG_OPT_END);
+    blockEnd(&b);
+    writeBlock(cap, &b);
+}
+
+static void writeEPB(CO_CANcapture_t *cap, const CO_CANcaptureRec_t *rec,
+                     uint32_t ifId)
+{
+    uint64_t t = (uint64_t)rec->timestamp.tv_sec * 1000000000ULL
+               + (uint64_t)rec->timestamp.tv_nsec;
+    uint32_t epbFlags = (rec->flags & CO_CANCAPTURE_TX) != 0
+                      ? PCAPNG_EPB_OUTBOUND : PCAPNG_EPB_INBOUND;
+    uint8_t data[CAN_MTU];
+    uint32_t canIdBE = htonl(rec->frame.can_id);
+    char comment[20];
+    int commentLen = 0;
+    block_t b;
+
+    /* LINKTYPE_CAN_SOCKETCAN: can_id in network byte order, rest as is */
+    memcpy(data, &rec->frame, CAN_MTU);
+    memcpy(data, &canIdBE, sizeof(canIdBE));
+
+    if ((rec->flags & CO_CANCAPTURE_TX_FAILED) != 0) {
+        commentLen = snprintf(comment, sizeof(comment), "tx failed");
+    }
+    else if ((rec->flags & CO_CANCAPTURE_TX) == 0 && rec->dispatchIndex >= 0) {
+        commentLen = snprintf(comment, sizeof(comment), "dispatch %d",
+                              (int)rec->dispatchIndex);
+    }
+
+    blockBegin(&b, PCAPNG_EPB);
+    blockU32(&b, ifId);
+    blockU32(&b, (uint32_t)(t >> 32));
+    blockU32(&b, (uint32_t)t);
+    blockU32(&b, CAN_MTU);      /* captured length */
+    blockU32(&b, CAN_MTU);      /* original length */
+    blockData(&b, data, CAN_MTU);
+    blockOption(&b, PCAPNG_EPB_FLAGS, &epbFlags, sizeof(epbFlags));
+    if (commentLen > 0) {
+        blockOption(&b, PCAPNG_OPT_COMMENT, comment, (uint16_t)commentLen);
+    }
+    blockU32(&b, PCAPNG_OPT_END);
+    blockEnd(&b);
+    writeBlock(cap, &b);
+}
+
+
+/* Open, close and rotate files, background thread ****************************/
+static bool_t fileOpen(CO_CANcapture_t *cap) {
+    cap->fd = open(cap->filename, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                   0644);
+    if (cap->fd < 0) {
+        goto fail;
+    }
+    if (ftruncate(cap->fd, (off_t)cap->fileSize) != 0) {
+        goto fail;
+    }
+    cap->map = mmap(NULL, cap->fileSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    cap->fd, 0);
+    if (cap->map == MAP_FAILED) {
+        cap->map = NULL;
+        goto fail;
+    }
+
+    cap->used = 0;
+    cap->ifCount = 0;
+    cap->overflowFileStart = cap->overflow;
+    cap->fileNumber++;
+    cap->fileError = false;
+    writeSHB(cap);
+    return true;
+
+fail:
+    if (!cap->fileError) {
+        log_printf(LOG_ERR, DBG_CAN_CAPTURE, cap->filename, strerror(errno));
+        cap->fileError = true;
+    }
+    if (cap->fd >= 0) {
+        close(cap->fd);
+        cap->fd = -1;
+    }
+    return false;
+}
+
+static void fileClose(CO_CANcapture_t *cap) {
+    if (cap->map == NULL) {
+        return;
+    }
+    if (cap->ifCount > 0) {
+        writeISB(cap);
+    }
+    munmap(cap->map, cap->fileSize);
+    cap->map = NULL;
+    if (ftruncate(cap->fd, (off_t)cap->used) != 0) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "ftruncate(capture)");
+    }
+    close(cap->fd);
+    cap->fd = -1;
+}
+
+static void fileRotate(CO_CANcapture_t *cap) {
+    char from[PATH_MAX], to[PATH_MAX];
+    int i;
+
+    fileClose(cap);
+
+    if (cap->fileCount > 1) {
+        for (i = cap->fileCount - 1; i > 0; i--) {
+            if (i > 1) {
+                snprintf(from, sizeof(from), "%s.%d", cap->filename, i - 1);
+            }
+            else {
+                snprintf(from, sizeof(from), "%s", cap->filename);
+            }
+            snprintf(to, sizeof(to), "%s.%d", cap->filename, i);
+            /* missing older files are not an error */
+            (void)rename(from, to);
+        }
+    }
+
+    (void)fileOpen(cap);
+}
+
+
+/* Find interface in the current file or add its description ******************/
+static bool_t interfaceId(CO_CANcapture_t *cap, int can_ifindex,
+                          uint32_t *ifId)
+{
+    uint32_t i;
+
+    for (i = 0; i < cap->ifCount; i++) {
+        if (cap->ifindex[i] == can_ifindex) {
+            *ifId = i;
+            return true;
+        }
+    }
+    if (cap->ifCount >= CO_CANCAPTURE_IF_MAX) {
+        return false;
+    }
+    writeIDB(cap, can_ifindex);
+    cap->ifindex[cap->ifCount] = can_ifindex;
+    *ifId = cap->ifCount++;
+    return true;
+}
+
+
+/* Write one record, rotate file if necessary *********************************/
+static void writeRecord(CO_CANcapture_t *cap, const CO_CANcaptureRec_t *rec) {
+    uint32_t ifId;
+
+    if (cap->map == NULL && !fileOpen(cap)) {
+        return;
+    }
+    if (cap->used + IDB_SIZE_MAX + EPB_SIZE_MAX + ISB_SIZE > cap->fileSize) {
+        fileRotate(cap);
+        if (cap->map == NULL) {
+            return;
+        }
+    }
+    if (interfaceId(cap, rec->can_ifindex, &ifId)) {
+        writeEPB(cap, rec, ifId);
+        cap->written++;
+    }
+}
+
+
+static void *captureThread(void *arg) {
+    CO_CANcapture_t *cap = (CO_CANcapture_t *)arg;
+    struct timespec interval;
+    uint32_t overflowLogged = 0;
+    bool_t stop;
+
+    interval.tv_sec = CO_DRIVER_CAPTURE_INTERVAL_MS / 1000;
+    interval.tv_nsec = (CO_DRIVER_CAPTURE_INTERVAL_MS % 1000) * 1000000L;
+
+    do {
+        uint32_t overflow;
+
+        /* read stop flag before draining, so last records are written */
+        stop = __atomic_load_n(&cap->stop, __ATOMIC_ACQUIRE);
+
+        for (;;) {
+            CO_CANcaptureRec_t *rec =
+                &cap->ring[cap->tail & (CO_DRIVER_CAPTURE_RING_SIZE - 1)];
+
+            if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE)
+                != cap->tail + 1
+            ) {
+                break;
+            }
+            writeRecord(cap, rec);
+            /* release slot for the next lap */
+            __atomic_store_n(&rec->seq, cap->tail + CO_DRIVER_CAPTURE_RING_SIZE,
+                             __ATOMIC_RELEASE);
+            cap->tail++;
+        }
+
+        overflow = __atomic_load_n(&cap->overflow, __ATOMIC_RELAXED);
+        if (overflow != overflowLogged) {
+            log_printf(LOG_WARNING, DBG_CAN_CAPTURE_OVERFLOW, cap->filename,
+                       overflow - overflowLogged);
+            overflowLogged = overflow;
+        }
+
+        if (!stop) {
+            nanosleep(&interval, NULL);
+        }
+    } while (!stop);
+
+    return NULL;
+}
+
+
+/******************************************************************************/
+CO_ReturnError_t CO_CANcapture_start(CO_CANcapture_t *cap,
+                                     const char *filename,
+                                     size_t fileSize,
+                                     uint16_t fileCount)
+{
+    uint32_t i;
+
+    if (cap == NULL || filename == NULL || fileSize < 4096 || fileCount == 0) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    memset(cap, 0, sizeof(*cap));
+    for (i = 0; i < CO_DRIVER_CAPTURE_RING_SIZE; i++) {
+        cap->ring[i].seq = i;
+    }
+    cap->filename = filename;
+    cap->fileSize = fileSize;
+    cap->fileCount = fileCount;
+    cap->fd = -1;
+
+    if (!fileOpen(cap)) {
+        return CO_ERROR_SYSCALL;
+    }
+
+    if (pthread_create(&cap->thread, NULL, captureThread, cap) != 0) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "pthread_create(capture)");
+        fileClose(cap);
+        return CO_ERROR_SYSCALL;
+    }
+    cap->threadStarted = true;
+
+    return CO_ERROR_NO;
+}
+
+
+/******************************************************************************/
+void CO_CANcapture_attach(CO_CANcapture_t *cap, CO_CANmodule_t *CANmodule) {
+    if (CANmodule != NULL) {
+        __atomic_store_n(&CANmodule->capture, cap, __ATOMIC_RELEASE);
+    }
+}
+
+
+/******************************************************************************/
+void CO_CANcapture_frame(CO_CANcapture_t *cap,
+                         const struct can_frame *frame,
+                         const struct timespec *timestamp,
+                         int can_ifindex,
+                         int32_t dispatchIndex,
+                         uint8_t flags)
+{
+    CO_CANcaptureRec_t *rec;
+    uint32_t pos;
+
+    /* reserve slot at head position, the same as in CO_CANsendAsync() */
+    pos = __atomic_load_n(&cap->head, __ATOMIC_RELAXED);
+    for (;;) {
+        int32_t diff;
+
+        rec = &cap->ring[pos & (CO_DRIVER_CAPTURE_RING_SIZE - 1)];
+        diff = (int32_t)(__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&cap->head, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+            ) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            /* writer is behind, never wait for it */
+            __atomic_add_fetch(&cap->overflow, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        else {
+            pos = __atomic_load_n(&cap->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    rec->flags = flags;
+    rec->can_ifindex = can_ifindex;
+    rec->dispatchIndex = dispatchIndex;
+    if (timestamp != NULL && (timestamp->tv_sec != 0 || timestamp->tv_nsec != 0)) {
+        rec->timestamp = *timestamp;
+    }
+    else {
+        /* vDSO, no system call */
+        clock_gettime(CLOCK_REALTIME, &rec->timestamp);
+    }
+    memcpy(&rec->frame, frame, CAN_MTU);
+
+    __atomic_store_n(&rec->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+
+/******************************************************************************/
+void CO_CANcapture_stop(CO_CANcapture_t *cap) {
+    if (cap == NULL || !cap->threadStarted) {
+        return;
+    }
+
+    __atomic_store_n(&cap->stop, true, __ATOMIC_RELEASE);
+    pthread_join(cap->thread, NULL);
+    cap->threadStarted = false;
+
+    fileClose(cap);
+    log_printf(LOG_INFO, DBG_CAN_CAPTURE_STATS, cap->filename,
+               (unsigned long long)cap->written, cap->overflow,
+               cap->fileNumber);
+}
+
+#endif /* CO_DRIVER_CAPTURE > 0 */
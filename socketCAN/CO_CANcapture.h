@@ -0,0 +1,210 @@
+/**
+ * Capture of CAN traffic into rotating pcapng files on Linux.
+ *
+ * @file        CO_CANcapture.h
+ * @ingroup     CO_socketCAN_CANcapture
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CO_CAN_CAPTURE_H
+#define CO_CAN_CAPTURE_H
+
+#include "301/CO_driver.h"
+
+#if CO_DRIVER_CAPTURE > 0 || defined CO_DOXYGEN
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup CO_socketCAN_CANcapture CAN capture
+ * @ingroup CO_socketCAN
+ * @{
+ *
+ * Capture of received and transmitted CAN frames inside the driver.
+ *
+ * Driver passes each frame to @ref CO_CANcapture_frame(): received frames
+ * (also error frames) after they are read from the socket and dispatched,
+ * transmitted frames after send() on each interface. Function copies the
+ * frame, its timestamp, interface index and dispatch index (index in rxArray,
+ * -1 if not matched) into a bounded lock-free ring and returns. It makes no
+ * system call and never waits. If ring is full, the frame is counted in
+ * _overflow_ and discarded. See also @ref CO_DRIVER_CAPTURE.
+ *
+ * Background thread drains the ring every CO_DRIVER_CAPTURE_INTERVAL_MS and
+ * writes records into a memory mapped file in pcapng format, which can be
+ * opened directly with Wireshark or tshark:
+ * - Interface Description Block per CAN interface, LINKTYPE_CAN_SOCKETCAN,
+ *   interface name and nanosecond timestamp resolution.
+ * - Enhanced Packet Block per frame with 16-byte SocketCAN header (CAN
+ *   identifier in network byte order, including EFF/RTR/ERR flags), direction
+ *   in epb_flags (inbound/outbound) and comment "dispatch <index>" for matched
+ *   received frames or "tx failed" for frames, which socket didn't accept.
+ * - Interface Statistics Block at the end of each file with number of frames
+ *   dropped by the ring (isb_ifdrop, reported on the first interface).
+ *
+ * Timestamps of received frames are socket timestamps (system time), transmit
+ * timestamps are taken with CLOCK_REALTIME just after send().
+ *
+ * File is preallocated to _fileSize_. When it is full, it is truncated to the
+ * used size, closed and rotated: "filename" is renamed to "filename.1",
+ * "filename.1" to "filename.2" and so on, up to _fileCount_ files. If the
+ * process is killed, the current file ends with zero padding after the last
+ * complete block.
+ *
+ * Usage: start the capture object with @ref CO_CANcapture_start() and attach it
+ * to the CANmodule with @ref CO_CANcapture_attach() once, after CO_new().
+ * Attachment stays valid across communication resets.
+ */
+
+/** Record flag: frame was transmitted, received otherwise */
+#define CO_CANCAPTURE_TX 0x01U
+/** Record flag: transmission failed, frame was not accepted by the socket */
+#define CO_CANCAPTURE_TX_FAILED 0x02U
+
+/** Maximum number of different CAN interfaces in one capture file */
+#ifndef CO_CANCAPTURE_IF_MAX
+#define CO_CANCAPTURE_IF_MAX 8
+#endif
+
+/**
+ * One captured frame, slot in the ring
+ */
+typedef struct {
+    /** Sequence number of the slot, synchronizes producers with writer */
+    uint32_t seq;
+    /** CO_CANCAPTURE_TX and CO_CANCAPTURE_TX_FAILED flags */
+    uint8_t flags;
+    /** CAN interface index */
+    int can_ifindex;
+    /** Index in rxArray for received frame, -1 if not matched */
+    int32_t dispatchIndex;
+    /** Timestamp, system time */
+    struct timespec timestamp;
+    /** CAN frame, as received or sent */
+    struct can_frame frame;
+} CO_CANcaptureRec_t;
+
+/**
+ * CAN capture object
+ */
+typedef struct CO_CANcapture {
+    /** Ring position, reserved by producers */
+    volatile uint32_t head;
+    /** Ring position, written by background thread */
+    uint32_t tail;
+    /** Frames discarded, because ring was full */
+    volatile uint32_t overflow;
+    /** Frames written into files */
+    uint64_t written;
+    /** Number of files opened, including the first */
+    uint32_t fileNumber;
+    /** Name of the current file, from CO_CANcapture_start() */
+    const char *filename;
+    /** File size and count, from CO_CANcapture_start() */
+    size_t fileSize;
+    uint16_t fileCount;
+    /** Current file, used by background thread */
+    int fd;
+    uint8_t *map;
+    size_t used;
+    /** Value of _overflow_ when the current file was opened */
+    uint32_t overflowFileStart;
+    /** Interface indexes with Interface Description Block in current file */
+    int ifindex[CO_CANCAPTURE_IF_MAX];
+    uint32_t ifCount;
+    /** True, if the last open failed, used to limit logging */
+    bool_t fileError;
+    /** Request to stop background thread */
+    volatile bool_t stop;
+    /** True, after background thread is created */
+    bool_t threadStarted;
+    pthread_t thread;
+    /** Ring of CO_DRIVER_CAPTURE_RING_SIZE records */
+    CO_CANcaptureRec_t ring[CO_DRIVER_CAPTURE_RING_SIZE];
+} CO_CANcapture_t;
+
+
+/**
+ * Start capture
+ *
+ * Function creates the first file and the background thread. Object is large
+ * (ring is inside it), so it should be static or allocated.
+ *
+ * @param cap This object will be initialized.
+ * @param filename Name of the capture file. String must stay valid.
+ * @param fileSize Maximum size of one file in bytes, at least 4096.
+ * @param fileCount Number of files kept, including the current one, 1 or more.
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT or
+ * CO_ERROR_SYSCALL.
+ */
+CO_ReturnError_t CO_CANcapture_start(CO_CANcapture_t *cap,
+                                     const char *filename,
+                                     size_t fileSize,
+                                     uint16_t fileCount);
+
+/**
+ * Attach capture object to the CANmodule or detach it
+ *
+ * @param cap This object, started, or NULL to detach.
+ * @param CANmodule CAN module, zero initialized by CO_new().
+ */
+void CO_CANcapture_attach(CO_CANcapture_t *cap, CO_CANmodule_t *CANmodule);
+
+/**
+ * Copy one frame into the ring, called by the driver
+ *
+ * Function is lock-free and may be called from any thread, also concurrently.
+ *
+ * @param cap This object.
+ * @param frame CAN frame in socketCAN format.
+ * @param timestamp Time of the frame (system time) or NULL for current time.
+ * @param can_ifindex CAN interface index.
+ * @param dispatchIndex Index in rxArray or -1.
+ * @param flags CO_CANCAPTURE_TX and CO_CANCAPTURE_TX_FAILED flags.
+ */
+void CO_CANcapture_frame(CO_CANcapture_t *cap,
+                         const struct can_frame *frame,
+                         const struct timespec *timestamp,
+                         int can_ifindex,
+                         int32_t dispatchIndex,
+                         uint8_t flags);
+
+/**
+ * Stop capture
+ *
+ * Object must be detached first. Background thread writes remaining records,
+ * current file is truncated to the used size and closed.
+ *
+ * @param cap This object.
+ */
+void CO_CANcapture_stop(CO_CANcapture_t *cap);
+
+/** @} */ /* CO_socketCAN_CANcapture */
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus*/
+
+#endif /* CO_DRIVER_CAPTURE > 0 */
+
+#endif /* CO_CAN_CAPTURE_H */
@@ -0,0 +1,545 @@
+/*
+ * Replay of captured CAN traffic into CANopenNode on Linux.
+ *
+ * @file        CO_CANreplay.c
+ * @ingroup     CO_socketCAN_CANreplay
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <syslog.h>
+#include <byteswap.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "CO_CANreplay.h"
+#include "CO_error.h"
+
+#if CO_DRIVER_REPLAY > 0
+
+/* pcapng block types and options */
+#define PCAPNG_SHB              0x0A0D0D0AUL
+#define PCAPNG_IDB              0x00000001UL
+#define PCAPNG_EPB              0x00000006UL
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4DUL
+#define PCAPNG_OPT_END          0
+#define PCAPNG_IF_NAME          2
+#define PCAPNG_IF_TSRESOL       9
+#define PCAPNG_EPB_FLAGS        2
+#define PCAPNG_EPB_OUTBOUND     2UL
+#define LINKTYPE_CAN_SOCKETCAN  227
+
+/* longest candump log line, which is parsed */
+#define LINE_MAX_LEN            128
+
+
+/* pcapng input ***************************************************************/
+static uint16_t rd16(const CO_CANreplay_t *rp, size_t pos) {
+    uint16_t v;
+    memcpy(&v, &rp->map[pos], sizeof(v));
+    return rp->swap ? bswap_16(v) : v;
+}
+
+static uint32_t rd32(const CO_CANreplay_t *rp, size_t pos) {
+    uint32_t v;
+    memcpy(&v, &rp->map[pos], sizeof(v));
+    return rp->swap ? bswap_32(v) : v;
+}
+
+/* Find option in block options area, return its position or 0 */
+static size_t findOption(const CO_CANreplay_t *rp, size_t pos, size_t end,
+                         uint16_t code, uint16_t *len)
+{
+    while (pos + 4 <= end) {
+        uint16_t c = rd16(rp, pos);
+        uint16_t l = rd16(rp, pos + 2);
+
+        if (c == PCAPNG_OPT_END || pos + 4 + l > end) {
+            break;
+        }
+        if (c == code) {
+            *len = l;
+            return pos + 4;
+        }
+        pos += 4 + (((size_t)l + 3) & ~(size_t)3);
+    }
+    return 0;
+}
+
+static void parseIDB(CO_CANreplay_t *rp, size_t pos, size_t end) {
+    uint32_t i = rp->ifCount;
+    size_t opt;
+    uint16_t len;
+
+    if (i >= CO_CANREPLAY_IF_MAX) {
+        return;
+    }
+    rp->ifCount++;
+    rp->ifName[i][0] = '\0';
+    rp->ifTsExp[i] = 6;
+
+    if (rd16(rp, pos + 8) != LINKTYPE_CAN_SOCKETCAN) {
+        /* frames from this interface are skipped */
+        rp->ifTsExp[i] = -1;
+        return;
+    }
+    opt = findOption(rp, pos + 16, end, PCAPNG_IF_NAME, &len);
+    if (opt != 0) {
+        if (len >= IFNAMSIZ) len = IFNAMSIZ - 1;
+        memcpy(rp->ifName[i], &rp->map[opt], len);
+        rp->ifName[i][len] = '\0';
+    }
+    opt = findOption(rp, pos + 16, end, PCAPNG_IF_TSRESOL, &len);
+    if (opt != 0 && len >= 1) {
+        uint8_t tsresol = rp->map[opt];
+        /* only negative power of 10 is supported */
+        rp->ifTsExp[i] = ((tsresol & 0x80) == 0 && tsresol <= 18)
+                       ? (int8_t)tsresol : -1;
+    }
+}
+
+static bool_t parseEPB(CO_CANreplay_t *rp, size_t pos, size_t end) {
+    uint32_t ifId = rd32(rp, pos + 8);
+    uint64_t ts = ((uint64_t)rd32(rp, pos + 12) << 32) | rd32(rp, pos + 16);
+    uint32_t capLen = rd32(rp, pos + 20);
+    size_t data = pos + 28;
+    size_t opt;
+    uint16_t len;
+    uint32_t canIdBE;
+    int8_t exp;
+
+    if (ifId >= rp->ifCount || rp->ifTsExp[ifId] < 0
+        || capLen < 8 || data + capLen > end
+    ) {
+        return false;
+    }
+    opt = findOption(rp, data + ((capLen + 3) & ~3UL), end,
+                     PCAPNG_EPB_FLAGS, &len);
+    if (opt != 0 && len == 4 && (rd32(rp, opt) & 3) == PCAPNG_EPB_OUTBOUND) {
+        return false;
+    }
+
+    memset(&rp->next, 0, sizeof(rp->next));
+    memcpy(&canIdBE, &rp->map[data], sizeof(canIdBE));
+    rp->next.can_id = ntohl(canIdBE);
+    rp->next.can_dlc = rp->map[data + 4];
+    if (rp->next.can_dlc > CAN_MAX_DLEN) {
+        /* CAN FD */
+        return false;
+    }
+    if (capLen > 8) {
+        memcpy(rp->next.data, &rp->map[data + 8],
+               capLen - 8 < CAN_MAX_DLEN ? capLen - 8 : CAN_MAX_DLEN);
+    }
+
+    exp = rp->ifTsExp[ifId];
+    while (exp > 6) { ts /= 10; exp--; }
+    while (exp < 6) { ts *= 10; exp++; }
+    rp->next_us = ts;
+    strcpy(rp->nextIfName, rp->ifName[ifId]);
+
+    return true;
+}
+
+/* Read blocks until next frame */
+static bool_t nextPcapng(CO_CANreplay_t *rp) {
+    while (rp->pos + 12 <= rp->size) {
+        size_t pos = rp->pos;
+        uint32_t type, len;
+
+        memcpy(&type, &rp->map[pos], sizeof(type));
+        if (type == PCAPNG_SHB) {
+            uint32_t bom;
+
+            memcpy(&bom, &rp->map[pos + 8], sizeof(bom));
+            rp->swap = bom != PCAPNG_BYTE_ORDER_MAGIC;
+            rp->ifCount = 0;
+        }
+        type = rd32(rp, pos);
+        len = rd32(rp, pos + 4);
+        if (len < 12 || (len & 3) != 0 || pos + len > rp->size) {
+            /* truncated file, for example zero padding of the capture */
+            rp->pos = rp->size;
+            break;
+        }
+        rp->pos += len;
+
+        if (type == PCAPNG_IDB) {
+            parseIDB(rp, pos, pos + len - 4);
+        }
+        else if (type == PCAPNG_EPB && len >= 32) {
+            if (parseEPB(rp, pos, pos + len - 4)) {
+                return true;
+            }
+            rp->skipped++;
+        }
+    }
+    return false;
+}
+
+
+/* candump log input **********************************************************/
+static int hexVal(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+/* Parse "(1600000000.123456) can0 123#1122" */
+static bool_t parseLine(CO_CANreplay_t *rp, char *line) {
+    unsigned long long sec;
+    char frac[16], ifName[IFNAMSIZ], frame[64];
+    char *hash, *p;
+    unsigned long id;
+    size_t idLen, i;
+    uint64_t us = 0;
+
+    if (sscanf(line, " (%llu.%15[0-9]) %15s %63s", &sec, frac, ifName, frame)
+        != 4
+    ) {
+        return false;
+    }
+    /* fraction of seconds to microseconds, any number of digits */
+    for (i = 0, p = frac; i < 6; i++) {
+        us *= 10;
+        if (*p != '\0') {
+            us += (uint64_t)(*p++ - '0');
+        }
+    }
+
+    hash = strchr(frame, '#');
+    if (hash == NULL || hash[1] == '#') {
+        /* not a CAN frame or CAN FD frame */
+        return false;
+    }
+    idLen = (size_t)(hash - frame);
+    *hash = '\0';
+    id = strtoul(frame, &p, 16);
+    if (*p != '\0') {
+        return false;
+    }
+
+    memset(&rp->next, 0, sizeof(rp->next));
+    if (idLen == 3) {
+        rp->next.can_id = id & CAN_SFF_MASK;
+    }
+    else if (idLen == 8) {
+        /* error frames are logged with CAN_ERR_FLAG */
+        rp->next.can_id = (id & CAN_ERR_FLAG) != 0
+                        ? id : ((id & CAN_EFF_MASK) | CAN_EFF_FLAG);
+    }
+    else {
+        return false;
+    }
+
+    p = hash + 1;
+    if (*p == 'R') {
+        rp->next.can_id |= CAN_RTR_FLAG;
+        if (hexVal(p[1]) >= 0 && hexVal(p[1]) <= CAN_MAX_DLEN) {
+            rp->next.can_dlc = (uint8_t)hexVal(p[1]);
+        }
+    }
+    else {
+        while (*p != '\0' && rp->next.can_dlc < CAN_MAX_DLEN) {
+            if (*p == '.') {
+                p++;
+                continue;
+            }
+            if (hexVal(p[0]) < 0 || hexVal(p[1]) < 0) {
+                return false;
+            }
+            rp->next.data[rp->next.can_dlc++] =
+                (uint8_t)((hexVal(p[0]) << 4) | hexVal(p[1]));
+            p += 2;
+        }
+    }
+
+    rp->next_us = (uint64_t)sec * 1000000ULL + us;
+    strcpy(rp->nextIfName, ifName);
+    return true;
+}
+
+/* Read lines until next frame */
+static bool_t nextCandump(CO_CANreplay_t *rp) {
+    while (rp->pos < rp->size) {
+        const uint8_t *start = &rp->map[rp->pos];
+        const uint8_t *nl = memchr(start, '\n', rp->size - rp->pos);
+        size_t len = nl != NULL ? (size_t)(nl - start) : rp->size - rp->pos;
+        char line[LINE_MAX_LEN];
+
+        rp->pos += len + 1;
+        if (len == 0) {
+            continue;
+        }
+        if (len < sizeof(line)) {
+            memcpy(line, start, len);
+            line[len] = '\0';
+            if (parseLine(rp, line)) {
+                return true;
+            }
+        }
+        rp->skipped++;
+    }
+    return false;
+}
+
+static void readNext(CO_CANreplay_t *rp) {
+    rp->nextValid = rp->pcapng ? nextPcapng(rp) : nextCandump(rp);
+}
+
+
+/* Inject all frames, which are due *******************************************/
+static void injectDue(CO_CANreplay_t *rp, CO_CANmodule_t *CANmodule) {
+    while (rp->nextValid && rp->next_us <= rp->now_us) {
+        int can_ifindex = 0;
+        struct timespec ts;
+        uint32_t i;
+
+        for (i = 0; i < CANmodule->CANinterfaceCount; i++) {
+            if (strcmp(CANmodule->CANinterfaces[i].ifName,
+                       rp->nextIfName) == 0
+            ) {
+                can_ifindex = CANmodule->CANinterfaces[i].can_ifindex;
+                break;
+            }
+        }
+        if (can_ifindex == 0 && CANmodule->CANinterfaceCount > 0) {
+            can_ifindex = CANmodule->CANinterfaces[0].can_ifindex;
+        }
+
+        ts.tv_sec = (time_t)(rp->next_us / 1000000);
+        ts.tv_nsec = (long)(rp->next_us % 1000000) * 1000;
+        if (CO_CANrxInject(CANmodule, can_ifindex, &rp->next, &ts)
+            == CO_ERROR_NO
+        ) {
+            rp->rxCount++;
+        }
+        else {
+            rp->skipped++;
+        }
+        readNext(rp);
+    }
+}
+
+
+/******************************************************************************/
+CO_ReturnError_t CO_CANreplay_open(CO_CANreplay_t *rp,
+                                   const char *inFile,
+                                   const char *outFile,
+                                   uint32_t speed)
+{
+    struct stat st;
+    void *map;
+    int fd;
+
+    if (rp == NULL || inFile == NULL || outFile == NULL) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+    memset(rp, 0, sizeof(*rp));
+    rp->speed = speed;
+
+    fd = open(inFile, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < 12) {
+        log_printf(LOG_ERR, DBG_CAN_REPLAY, inFile, strerror(errno));
+        if (fd >= 0) close(fd);
+        return CO_ERROR_SYSCALL;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "mmap(replay)");
+        return CO_ERROR_SYSCALL;
+    }
+    (void)madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+    rp->map = (const uint8_t *)map;
+    rp->size = (size_t)st.st_size;
+
+    {
+        uint32_t type;
+        memcpy(&type, rp->map, sizeof(type));
+        rp->pcapng = type == PCAPNG_SHB;
+    }
+
+    readNext(rp);
+    if (!rp->nextValid) {
+        log_printf(LOG_ERR, DBG_CAN_REPLAY, inFile, "no CAN frames");
+        CO_CANreplay_close(rp);
+        return CO_ERROR_DATA_CORRUPT;
+    }
+    rp->now_us = rp->next_us;
+
+    rp->out = fopen(outFile, "w");
+    if (rp->out == NULL) {
+        log_printf(LOG_ERR, DBG_CAN_REPLAY, outFile, strerror(errno));
+        CO_CANreplay_close(rp);
+        return CO_ERROR_SYSCALL;
+    }
+
+    return CO_ERROR_NO;
+}
+
+
+/******************************************************************************/
+void CO_CANreplay_close(CO_CANreplay_t *rp) {
+    if (rp == NULL) {
+        return;
+    }
+    if (rp->out != NULL) {
+        fclose(rp->out);
+        rp->out = NULL;
+    }
+    if (rp->map != NULL) {
+        munmap((void *)rp->map, rp->size);
+        rp->map = NULL;
+    }
+}
+
+
+/******************************************************************************/
+void CO_CANreplay_attach(CO_CANreplay_t *rp, CO_CANmodule_t *CANmodule) {
+    if (CANmodule != NULL) {
+        CANmodule->replay = rp;
+    }
+}
+
+
+/******************************************************************************/
+bool_t CO_CANreplay_process(CO_CANreplay_t *rp,
+                            CO_CANmodule_t *CANmodule,
+                            uint32_t *timeDifference_us,
+                            uint32_t *timerNext_us)
+{
+    if (rp == NULL || CANmodule == NULL || timeDifference_us == NULL) {
+        return false;
+    }
+
+    if (rp->speed == 0) {
+        /* virtual time: step to the next frame or to the stack's timer */
+        uint64_t step = 0;
+
+        if (!rp->nextValid) {
+            *timeDifference_us = 0;
+            return false;
+        }
+        if (rp->next_us > rp->now_us) {
+            step = rp->next_us - rp->now_us;
+        }
+        if (timerNext_us != NULL && step > *timerNext_us) {
+            step = *timerNext_us;
+        }
+        rp->now_us += step;
+        *timeDifference_us = (uint32_t)step;
+    }
+    else {
+        uint64_t diff = (uint64_t)*timeDifference_us * rp->speed;
+
+        if (diff > UINT32_MAX) diff = UINT32_MAX;
+        rp->now_us += diff;
+        *timeDifference_us = (uint32_t)diff;
+    }
+
+    injectDue(rp, CANmodule);
+
+    if (rp->speed > 0 && rp->nextValid && timerNext_us != NULL) {
+        uint64_t wait_us = (rp->next_us - rp->now_us + rp->speed - 1)
+                         / rp->speed;
+        if (wait_us < *timerNext_us) {
+            *timerNext_us = (uint32_t)wait_us;
+        }
+    }
+
+    /* the last frame is still processed by the caller */
+    return true;
+}
+
+
+/******************************************************************************/
+bool_t CO_CANreplay_wait(CO_CANreplay_t *rp,
+                         CO_epoll_t *ep,
+                         CO_CANmodule_t *CANmodule)
+{
+    bool_t more;
+
+    if (rp == NULL || ep == NULL) {
+        return false;
+    }
+
+    if (rp->speed > 0) {
+        CO_epoll_wait(ep);
+        return CO_CANreplay_process(rp, CANmodule, &ep->timeDifference_us,
+                                    &ep->timerNext_us);
+    }
+
+    /* virtual time, no event, timer from the previous processing */
+    more = CO_CANreplay_process(rp, CANmodule, &ep->timeDifference_us,
+                                &ep->timerNext_us);
+    ep->epoll_new = false;
+    ep->timerEvent = true;
+    ep->timerNext_us = ep->timerInterval_us;
+    return more;
+}
+
+
+/******************************************************************************/
+void CO_CANreplay_output(CO_CANreplay_t *rp,
+                         const CO_CANtx_t *buffer,
+                         const char *ifName)
+{
+    uint32_t id = buffer->ident;
+    char frame[40];
+    int n;
+    uint8_t i;
+
+    if (rp->out == NULL) {
+        return;
+    }
+
+    if ((id & CAN_EFF_FLAG) != 0) {
+        n = sprintf(frame, "%08X#", (unsigned)(id & CAN_EFF_MASK));
+    }
+    else {
+        n = sprintf(frame, "%03X#", (unsigned)(id & CAN_SFF_MASK));
+    }
+    if ((id & CAN_RTR_FLAG) != 0) {
+        frame[n++] = 'R';
+        if (buffer->DLC > 0 && buffer->DLC <= CAN_MAX_DLEN) {
+            n += sprintf(&frame[n], "%X", buffer->DLC);
+        }
+    }
+    else {
+        for (i = 0; i < buffer->DLC && i < CAN_MAX_DLEN; i++) {
+            n += sprintf(&frame[n], "%02X", buffer->data[i]);
+        }
+    }
+    frame[n] = '\0';
+
+    fprintf(rp->out, "(%llu.%06llu) %s %s\n",
+            (unsigned long long)(rp->now_us / 1000000),
+            (unsigned long long)(rp->now_us % 1000000), ifName, frame);
+    rp->txCount++;
+}
+
+#endif /* CO_DRIVER_REPLAY > 0 */
@@ -0,0 +1,217 @@
+/**
+ * Replay of captured CAN traffic into CANopenNode on Linux.
+ *
+ * @file        CO_CANreplay.h
+ * @ingroup     CO_socketCAN_CANreplay
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CO_CAN_REPLAY_H
+#define CO_CAN_REPLAY_H
+
+#include <stdio.h>
+
+#include "301/CO_driver.h"
+#include "CO_epoll_interface.h"
+
+#if CO_DRIVER_REPLAY > 0 || defined CO_DOXYGEN
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup CO_socketCAN_CANreplay CAN replay
+ * @ingroup CO_socketCAN
+ * @{
+ *
+ * Replay of captured CAN traffic into the CANmodule, as if it was received.
+ *
+ * Input file is detected by its content:
+ * - candump log, as written by "candump -l": lines
+ *   "(seconds.fraction) interface ID#data", also "ID#R" for RTR frames and
+ *   8-digit identifiers for extended and error frames. CAN FD frames and other
+ *   lines are skipped.
+ * - pcapng with LINKTYPE_CAN_SOCKETCAN, as written by Wireshark, tshark or
+ *   @ref CO_socketCAN_CANcapture. Outbound frames (epb_flags) were sent by
+ *   the captured device and are skipped, so the stack generates them again.
+ *
+ * Frame is injected with CO_CANrxInject() on the CANmodule interface with the
+ * same name as in the log, or on the first interface. Replay clock runs in the
+ * time domain of the log and starts at the first frame. Speed is selectable:
+ * - speed 1 is real time, speed N is N times faster. Pacing is done by the
+ *   epoll timer, time differences passed to the stack are multiplied by N, so
+ *   stack timers run with the log.
+ * - speed 0 is as fast as possible with virtual time. There is no waiting.
+ *   Each step advances the replay clock to the next frame or to the time, the
+ *   stack requested with timerNext_us, whichever is first. Result does not
+ *   depend on the speed of the host.
+ *
+ * While replay object is attached, CANmodule doesn't write frames to the
+ * socket. Frames sent by the stack are recorded into the output file in
+ * candump log format with replay clock timestamps, so outputs of two runs (or
+ * of the run and the frames of the device in the original log) can be
+ * compared with diff. Frames, received from the real interface, are still
+ * processed with speed > 0; use vcan or a silent interface.
+ *
+ * Replay is processed in the thread, which receives CAN messages, for example
+ * in the mainline loop of a single-thread application:
+ * @code
+CO_CANreplay_open(&replay, "field.log", "field.out", 0);
+CO_CANreplay_attach(&replay, CO->CANmodule);
+while (reset == CO_RESET_NOT) {
+    if (!CO_CANreplay_wait(&replay, &epMain, CO->CANmodule)) break;
+    CO_epoll_processRT(&epMain, CO, false);
+    CO_epoll_processMain(&epMain, CO, false, &reset);
+    CO_epoll_processLast(&epMain);
+}
+CO_CANreplay_attach(NULL, CO->CANmodule);
+CO_CANreplay_close(&replay);
+ * @endcode
+ */
+
+/** Maximum number of interfaces in pcapng input */
+#ifndef CO_CANREPLAY_IF_MAX
+#define CO_CANREPLAY_IF_MAX 8
+#endif
+
+/**
+ * CAN replay object
+ */
+typedef struct CO_CANreplay {
+    /** Input file, mapped into memory */
+    const uint8_t *map;
+    size_t size;
+    /** Read position in the input file */
+    size_t pos;
+    /** True for pcapng input, candump log otherwise */
+    bool_t pcapng;
+    /** True, if pcapng section has opposite byte order */
+    bool_t swap;
+    /** Interfaces of the current pcapng section: name and timestamp
+     * resolution as negative power of 10, -1 if not supported */
+    char ifName[CO_CANREPLAY_IF_MAX][IFNAMSIZ];
+    int8_t ifTsExp[CO_CANREPLAY_IF_MAX];
+    uint32_t ifCount;
+    /** Output file for frames sent by the stack */
+    FILE *out;
+    /** Speed, from CO_CANreplay_open() */
+    uint32_t speed;
+    /** Replay clock in microseconds, time domain of the log */
+    uint64_t now_us;
+    /** Next frame to inject, valid if _nextValid_ */
+    bool_t nextValid;
+    struct can_frame next;
+    uint64_t next_us;
+    char nextIfName[IFNAMSIZ];
+    /** Number of injected, recorded and skipped frames */
+    uint32_t rxCount;
+    uint32_t txCount;
+    uint32_t skipped;
+} CO_CANreplay_t;
+
+
+/**
+ * Open input and output files
+ *
+ * @param rp This object will be initialized.
+ * @param inFile Name of candump log or pcapng file.
+ * @param outFile Name of the output file, overwritten.
+ * @param speed 0 for virtual time, 1 for real time, N for N times faster.
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT,
+ * CO_ERROR_SYSCALL or CO_ERROR_DATA_CORRUPT, if input contains no frames.
+ */
+CO_ReturnError_t CO_CANreplay_open(CO_CANreplay_t *rp,
+                                   const char *inFile,
+                                   const char *outFile,
+                                   uint32_t speed);
+
+/**
+ * Close files
+ *
+ * @param rp This object.
+ */
+void CO_CANreplay_close(CO_CANreplay_t *rp);
+
+/**
+ * Attach replay object to the CANmodule or detach it
+ *
+ * @param rp This object, opened, or NULL to detach.
+ * @param CANmodule CAN module, zero initialized by CO_new().
+ */
+void CO_CANreplay_attach(CO_CANreplay_t *rp, CO_CANmodule_t *CANmodule);
+
+/**
+ * Advance replay clock and inject frames, which are due
+ *
+ * @param rp This object.
+ * @param CANmodule CAN module, where frames are injected.
+ * @param [in,out] timeDifference_us With speed > 0: on input real time since
+ * the previous call, on output the time for the stack (multiplied by speed).
+ * With speed 0: only output, the virtual time step.
+ * @param [in,out] timerNext_us With speed > 0: lowered to the real time until
+ * the next frame. With speed 0: on input the maximum virtual step, requested
+ * by the stack. May be NULL.
+ *
+ * @return false, if there are no more frames in the input.
+ */
+bool_t CO_CANreplay_process(CO_CANreplay_t *rp,
+                            CO_CANmodule_t *CANmodule,
+                            uint32_t *timeDifference_us,
+                            uint32_t *timerNext_us);
+
+/**
+ * Replacement for CO_epoll_wait() in replay
+ *
+ * With speed > 0 it calls CO_epoll_wait() and CO_CANreplay_process(). With
+ * speed 0 it doesn't wait, it sets the time difference of _ep_ to the virtual
+ * step and injects frames.
+ *
+ * @param rp This object.
+ * @param ep Epoll object of the thread, which processes CAN receive.
+ * @param CANmodule CAN module, where frames are injected.
+ *
+ * @return false, if there are no more frames in the input.
+ */
+bool_t CO_CANreplay_wait(CO_CANreplay_t *rp,
+                         CO_epoll_t *ep,
+                         CO_CANmodule_t *CANmodule);
+
+/**
+ * Record frame sent by the stack, called by the driver
+ *
+ * @param rp This object.
+ * @param buffer Transmit buffer.
+ * @param ifName Name of the interface.
+ */
+void CO_CANreplay_output(CO_CANreplay_t *rp,
+                         const CO_CANtx_t *buffer,
+                         const char *ifName);
+
+/** @} */ /* CO_socketCAN_CANreplay */
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus*/
+
+#endif /* CO_DRIVER_REPLAY > 0 */
+
+#endif /* CO_CAN_REPLAY_H */
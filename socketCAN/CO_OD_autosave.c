@@ -0,0 +1,661 @@
+/*
+ * Incremental and asynchronous autosave of Object Dictionary data on Linux.
+ *
+ * @file        CO_OD_autosave.c
+ * @ingroup     CO_socketCAN_OD_autosave
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <syslog.h>
+#include <time.h>
+
+#include "CO_OD_autosave.h"
+
+#ifndef CO_SINGLE_THREAD
+
+#include "301/crc16-ccitt.h"
+#include "CO_error.h"
+
+#if !((CO_CONFIG_CRC16) & CO_CONFIG_CRC16_ENABLE)
+#error CO_CONFIG_CRC16_ENABLE must be enabled.
+#endif
+
+/* Data file: magic, generation, size, data, CRC of all before */
+#define AS_MAGIC_DATA 0x53414F43UL  /* "COAS" */
+#define AS_DATA_HDR 12
+/* Journal: magic, generation, then records */
+#define AS_MAGIC_JNL 0x4A414F43UL   /* "COAJ" */
+#define AS_JNL_HDR 8
+/* Journal record: offset, length, CRC of offset, length and data, data */
+#define AS_REC_HDR 8
+#define AS_REC_MAX 0xFFFFU
+
+
+static uint64_t timeUs(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static inline bool_t bitGet(const uint32_t *bitmap, uint32_t i) {
+    return (bitmap[i >> 5] & (1UL << (i & 0x1F))) != 0;
+}
+
+static inline void bitSet(uint32_t *bitmap, uint32_t i) {
+    bitmap[i >> 5] |= 1UL << (i & 0x1F);
+}
+
+static inline size_t bitmapSize(CO_OD_autosave_t *as) {
+    return ((as->blockCount + 31) / 32) * sizeof(uint32_t);
+}
+
+/* Length of the block, last one may be shorter */
+static inline size_t blockLen(CO_OD_autosave_t *as, uint32_t i) {
+    size_t offset = (size_t)i * as->blockSize;
+
+    return (as->size - offset) < as->blockSize
+           ? (as->size - offset) : as->blockSize;
+}
+
+static char *strcatDup(const char *s1, const char *s2) {
+    char *s = malloc(strlen(s1) + strlen(s2) + 1);
+
+    if (s != NULL) {
+        strcpy(s, s1);
+        strcat(s, s2);
+    }
+    return s;
+}
+
+/* write complete buffer, retry on partial write or signal */
+static bool_t writeAll(int fd, const void *buf, size_t len) {
+    const uint8_t *b = (const uint8_t *)buf;
+
+    while (len > 0) {
+        ssize_t n = write(fd, b, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        b += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/* read complete buffer, false on error or end of file */
+static bool_t readAll(int fd, void *buf, size_t len) {
+    uint8_t *b = (uint8_t *)buf;
+
+    while (len > 0) {
+        ssize_t n = read(fd, b, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        b += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/* sync directory of the file, so rename and create are durable */
+static void syncDir(const char *filename) {
+    char *dir = strcatDup(filename, "");
+    char *slash;
+    int fd;
+
+    if (dir == NULL) return;
+    slash = strrchr(dir, '/');
+    if (slash == NULL) {
+        strcpy(dir, ".");
+    }
+    else {
+        slash[slash == dir ? 1 : 0] = 0;
+    }
+    fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        (void)fsync(fd);
+        close(fd);
+    }
+    free(dir);
+}
+
+
+/* Write complete data file and restart journal ******************************/
+static bool_t saveFull(CO_OD_autosave_t *as, uint32_t *bytes) {
+    uint8_t hdr[AS_DATA_HDR];
+    uint32_t magic = AS_MAGIC_DATA;
+    uint32_t gen = as->gen + 1;
+    uint32_t size32 = (uint32_t)as->size;
+    uint16_t crc;
+    bool_t ok;
+    int fd;
+
+    memcpy(&hdr[0], &magic, 4);
+    memcpy(&hdr[4], &gen, 4);
+    memcpy(&hdr[8], &size32, 4);
+    crc = crc16_ccitt(hdr, sizeof(hdr), 0);
+    crc = crc16_ccitt(as->image, as->size, crc);
+
+    /* data file is replaced atomically */
+    fd = open(as->filenameTmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ok = fd >= 0
+         && writeAll(fd, hdr, sizeof(hdr))
+         && writeAll(fd, as->image, as->size)
+         && writeAll(fd, &crc, sizeof(crc))
+         && fsync(fd) == 0;
+    if (fd >= 0 && close(fd) != 0) {
+        ok = false;
+    }
+    if (!ok || rename(as->filenameTmp, as->filename) != 0) {
+        unlink(as->filenameTmp);
+        return false;
+    }
+    syncDir(as->filename);
+    as->gen = gen;
+    *bytes += sizeof(hdr) + as->size + sizeof(crc);
+
+    /* new journal. If it fails, old journal has old generation and is not
+     * used on startup. */
+    if (as->fdJnl >= 0) {
+        close(as->fdJnl);
+    }
+    magic = AS_MAGIC_JNL;
+    memcpy(&hdr[0], &magic, 4);
+    memcpy(&hdr[4], &gen, 4);
+    as->fdJnl = open(as->filenameJnl, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (as->fdJnl < 0
+        || !writeAll(as->fdJnl, hdr, AS_JNL_HDR)
+        || fsync(as->fdJnl) != 0
+    ) {
+        if (as->fdJnl >= 0) {
+            close(as->fdJnl);
+            as->fdJnl = -1;
+        }
+        return false;
+    }
+    syncDir(as->filenameJnl);
+    as->jnlSize = AS_JNL_HDR;
+    *bytes += AS_JNL_HDR;
+
+    return true;
+}
+
+
+/* Build journal records from changed blocks, return their size **************/
+static size_t buildRecords(CO_OD_autosave_t *as) {
+    size_t n = 0;
+    uint32_t i = 0;
+
+    while (i < as->blockCount) {
+        size_t offset, len = 0;
+        uint32_t offset32;
+        uint16_t len16, crc;
+        uint8_t *rec;
+
+        if (!bitGet(as->writeDirty, i)) {
+            i++;
+            continue;
+        }
+
+        /* merge adjacent changed blocks into one record */
+        offset = (size_t)i * as->blockSize;
+        while (i < as->blockCount && bitGet(as->writeDirty, i)
+               && len + blockLen(as, i) <= AS_REC_MAX
+        ) {
+            len += blockLen(as, i);
+            i++;
+        }
+
+        rec = &as->recBuf[n];
+        offset32 = (uint32_t)offset;
+        len16 = (uint16_t)len;
+        memcpy(&rec[0], &offset32, 4);
+        memcpy(&rec[4], &len16, 2);
+        crc = crc16_ccitt(rec, 6, 0);
+        crc = crc16_ccitt(&as->image[offset], len, crc);
+        memcpy(&rec[6], &crc, 2);
+        memcpy(&rec[AS_REC_HDR], &as->image[offset], len);
+        n += AS_REC_HDR + len;
+    }
+
+    return n;
+}
+
+
+/* Save changed blocks in background thread ***********************************/
+static bool_t save(CO_OD_autosave_t *as, uint32_t *bytes, bool_t *full) {
+    size_t n;
+
+    *full = as->fullSavePending;
+    if (!*full) {
+        n = buildRecords(as);
+        if (n == 0) {
+            return true;
+        }
+        if (as->fdJnl < 0 || as->jnlSize + n > as->journalLimit) {
+            *full = true;
+        }
+        else if (writeAll(as->fdJnl, as->recBuf, n)
+                 && fdatasync(as->fdJnl) == 0
+        ) {
+            as->jnlSize += n;
+            *bytes += (uint32_t)n;
+            return true;
+        }
+        else {
+            /* journal may end with torn record, start new one */
+            *full = true;
+        }
+    }
+
+    as->fullSavePending = !saveFull(as, bytes);
+    return !as->fullSavePending;
+}
+
+
+static void *autosaveThread(void *arg) {
+    CO_OD_autosave_t *as = (CO_OD_autosave_t *)arg;
+
+    pthread_mutex_lock(&as->mtx);
+    for (;;) {
+        uint32_t bytes = 0;
+        uint64_t t0;
+        bool_t ok, full;
+        uint32_t i;
+
+        while (!as->pendingAny && !as->fullSavePending && !as->stop) {
+            pthread_cond_wait(&as->cond, &as->mtx);
+        }
+        if (!as->pendingAny && !as->fullSavePending) {
+            break;
+        }
+
+        /* take pending blocks */
+        for (i = 0; i < as->blockCount; i++) {
+            if (bitGet(as->pendingDirty, i)) {
+                size_t offset = (size_t)i * as->blockSize;
+                memcpy(&as->image[offset], &as->pending[offset],
+                       blockLen(as, i));
+            }
+        }
+        memcpy(as->writeDirty, as->pendingDirty, bitmapSize(as));
+        memset(as->pendingDirty, 0, bitmapSize(as));
+        as->pendingAny = false;
+        as->busy = true;
+        pthread_mutex_unlock(&as->mtx);
+
+        t0 = timeUs();
+        ok = save(as, &bytes, &full);
+
+        pthread_mutex_lock(&as->mtx);
+        as->retryPending = !ok;
+        if (ok) {
+            as->stats.saveCount++;
+            if (full) as->stats.fullSaveCount++;
+        }
+        else {
+            as->stats.errorCount++;
+        }
+        as->stats.lastBytes = bytes;
+        as->stats.totalBytes += bytes;
+        as->stats.lastWrite_us = (uint32_t)(timeUs() - t0);
+        as->busy = false;
+        pthread_cond_broadcast(&as->condIdle);
+
+        /* don't retry failed full save in a loop, next snapshot requests it */
+        if (!ok) {
+            if (as->stop) break;
+            while (!as->pendingAny && !as->stop) {
+                pthread_cond_wait(&as->cond, &as->mtx);
+            }
+        }
+    }
+    pthread_mutex_unlock(&as->mtx);
+
+    return NULL;
+}
+
+
+/* Load data file and journal into image **************************************/
+static void loadJournal(CO_OD_autosave_t *as) {
+    uint8_t hdr[AS_JNL_HDR];
+    uint32_t magic, gen;
+    off_t valid = AS_JNL_HDR;
+    int fd;
+
+    fd = open(as->filenameJnl, O_RDWR);
+    if (fd < 0 || !readAll(fd, hdr, sizeof(hdr))) {
+        if (fd >= 0) close(fd);
+        as->fullSavePending = true;
+        return;
+    }
+    memcpy(&magic, &hdr[0], 4);
+    memcpy(&gen, &hdr[4], 4);
+    if (magic != AS_MAGIC_JNL || gen != as->gen) {
+        /* journal from other generation, data file is newer */
+        close(fd);
+        as->fullSavePending = true;
+        return;
+    }
+
+    /* apply valid records in order, stop at first invalid one */
+    for (;;) {
+        uint8_t rec[AS_REC_HDR];
+        uint32_t offset;
+        uint16_t len, crc, crcRec;
+
+        if (!readAll(fd, rec, sizeof(rec))) break;
+        memcpy(&offset, &rec[0], 4);
+        memcpy(&len, &rec[4], 2);
+        memcpy(&crcRec, &rec[6], 2);
+        if (len == 0 || offset > as->size || len > as->size - offset) break;
+        if (!readAll(fd, as->recBuf, len)) break;
+        crc = crc16_ccitt(rec, 6, 0);
+        crc = crc16_ccitt(as->recBuf, len, crc);
+        if (crc != crcRec) break;
+
+        memcpy(&as->image[offset], as->recBuf, len);
+        valid += AS_REC_HDR + len;
+    }
+
+    /* discard torn record, continue after the last valid one */
+    if (ftruncate(fd, valid) != 0 || lseek(fd, 0, SEEK_END) < 0) {
+        close(fd);
+        as->fullSavePending = true;
+        return;
+    }
+    as->fdJnl = fd;
+    as->jnlSize = (size_t)valid;
+}
+
+static CO_ReturnError_t load(CO_OD_autosave_t *as) {
+    uint8_t hdr[AS_DATA_HDR];
+    uint32_t magic, gen, size32;
+    uint16_t crc, crcFile;
+    bool_t ok;
+    int fd;
+
+    fd = open(as->filename, O_RDONLY);
+    if (fd < 0) {
+        /* first start, default values are saved */
+        as->fullSavePending = true;
+        return CO_ERROR_NO;
+    }
+
+    ok = readAll(fd, hdr, sizeof(hdr));
+    memcpy(&magic, &hdr[0], 4);
+    memcpy(&gen, &hdr[4], 4);
+    memcpy(&size32, &hdr[8], 4);
+    if (!ok || magic != AS_MAGIC_DATA || size32 != as->size) {
+        close(fd);
+        as->fullSavePending = true;
+        return CO_ERROR_DATA_CORRUPT;
+    }
+
+    /* image is copied to data block only if it is valid */
+    ok = readAll(fd, as->image, as->size)
+         && readAll(fd, &crcFile, sizeof(crcFile));
+    close(fd);
+    crc = crc16_ccitt(hdr, sizeof(hdr), 0);
+    crc = crc16_ccitt(as->image, as->size, crc);
+    if (!ok || crc != crcFile) {
+        as->fullSavePending = true;
+        return ok ? CO_ERROR_CRC : CO_ERROR_DATA_CORRUPT;
+    }
+    as->gen = gen;
+
+    loadJournal(as);
+    memcpy(as->addr, as->image, as->size);
+
+    return CO_ERROR_NO;
+}
+
+
+/* Release memory, thread must not run ****************************************/
+static void freeAll(CO_OD_autosave_t *as) {
+    free(as->filename);
+    free(as->filenameJnl);
+    free(as->filenameTmp);
+    free(as->shadow);
+    free(as->pending);
+    free(as->image);
+    free(as->recBuf);
+    free(as->dirty);
+    free(as->pendingDirty);
+    free(as->writeDirty);
+    as->filename = as->filenameJnl = as->filenameTmp = NULL;
+    as->shadow = as->pending = as->image = as->recBuf = NULL;
+    as->dirty = as->pendingDirty = as->writeDirty = NULL;
+    if (as->fdJnl >= 0) {
+        close(as->fdJnl);
+        as->fdJnl = -1;
+    }
+}
+
+
+/******************************************************************************/
+CO_ReturnError_t CO_OD_autosave_init(CO_OD_autosave_t *as,
+                                     void *addr,
+                                     size_t size,
+                                     const char *filename,
+                                     size_t blockSize,
+                                     size_t journalLimit)
+{
+    CO_ReturnError_t ret;
+    size_t bmSize;
+
+    if (as == NULL || addr == NULL || size == 0 || size > UINT32_MAX
+        || filename == NULL || blockSize == 0 || blockSize > AS_REC_MAX
+    ) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    memset(as, 0, sizeof(CO_OD_autosave_t));
+    as->addr = (uint8_t *)addr;
+    as->size = size;
+    as->blockSize = blockSize;
+    as->blockCount = (uint32_t)((size + blockSize - 1) / blockSize);
+    as->journalLimit = journalLimit > 0 ? journalLimit : size * 4;
+    as->fdJnl = -1;
+
+    bmSize = bitmapSize(as);
+    as->filename = strcatDup(filename, "");
+    as->filenameJnl = strcatDup(filename, ".jnl");
+    as->filenameTmp = strcatDup(filename, ".tmp");
+    as->shadow = malloc(size);
+    as->pending = malloc(size);
+    as->image = malloc(size);
+    as->recBuf = malloc(size + (size_t)as->blockCount * AS_REC_HDR);
+    as->dirty = calloc(1, bmSize);
+    as->pendingDirty = calloc(1, bmSize);
+    as->writeDirty = calloc(1, bmSize);
+    if (as->filename == NULL || as->filenameJnl == NULL
+        || as->filenameTmp == NULL || as->shadow == NULL
+        || as->pending == NULL || as->image == NULL || as->recBuf == NULL
+        || as->dirty == NULL || as->pendingDirty == NULL
+        || as->writeDirty == NULL
+    ) {
+        freeAll(as);
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+
+    ret = load(as);
+    memcpy(as->shadow, as->addr, size);
+    memcpy(as->image, as->addr, size);
+
+    if (pthread_mutex_init(&as->mtx, NULL) != 0
+        || pthread_cond_init(&as->cond, NULL) != 0
+        || pthread_cond_init(&as->condIdle, NULL) != 0
+    ) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "pthread_mutex_init(autosave)");
+        freeAll(as);
+        return CO_ERROR_SYSCALL;
+    }
+    /* initial full save, if required, is outstanding work for flush */
+    as->busy = as->fullSavePending;
+    if (pthread_create(&as->thread, NULL, autosaveThread, as) != 0) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "pthread_create(autosave)");
+        freeAll(as);
+        return CO_ERROR_SYSCALL;
+    }
+    as->threadStarted = true;
+
+    return ret;
+}
+
+
+/* Copy changed blocks, mainline thread ***************************************/
+static void snapshot(CO_OD_autosave_t *as, CO_CANmodule_t *CANmodule) {
+    uint64_t t0 = timeUs();
+    uint32_t stall;
+    bool_t changed = false;
+    uint32_t i;
+
+    CO_LOCK_OD(CANmodule);
+    for (i = 0; i < as->blockCount; i++) {
+        size_t offset = (size_t)i * as->blockSize;
+        size_t len = blockLen(as, i);
+
+        if (memcmp(&as->addr[offset], &as->shadow[offset], len) != 0) {
+            memcpy(&as->shadow[offset], &as->addr[offset], len);
+            bitSet(as->dirty, i);
+            changed = true;
+        }
+    }
+    CO_UNLOCK_OD(CANmodule);
+
+    /* background thread holds mtx only while it takes pending blocks */
+    pthread_mutex_lock(&as->mtx);
+    if (changed) {
+        for (i = 0; i < as->blockCount; i++) {
+            if (bitGet(as->dirty, i)) {
+                size_t offset = (size_t)i * as->blockSize;
+                memcpy(&as->pending[offset], &as->shadow[offset],
+                       blockLen(as, i));
+                bitSet(as->pendingDirty, i);
+            }
+        }
+    }
+    /* also retry failed save, its data would stay unsaved until next change */
+    if (changed || as->retryPending) {
+        as->pendingAny = true;
+        pthread_cond_signal(&as->cond);
+    }
+    stall = (uint32_t)(timeUs() - t0);
+    as->stats.lastStall_us = stall;
+    if (stall > as->stats.maxStall_us) {
+        as->stats.maxStall_us = stall;
+    }
+    pthread_mutex_unlock(&as->mtx);
+
+    if (changed) {
+        memset(as->dirty, 0, bitmapSize(as));
+    }
+}
+
+
+/******************************************************************************/
+void CO_OD_autosave_process(CO_OD_autosave_t *as,
+                            CO_CANmodule_t *CANmodule,
+                            uint32_t timeDifference_us,
+                            uint32_t delay_us)
+{
+    uint32_t errorCount;
+
+    if (as == NULL || !as->threadStarted || CANmodule == NULL) {
+        return;
+    }
+
+    as->timer_us += timeDifference_us;
+    if (as->timer_us < delay_us) {
+        return;
+    }
+    as->timer_us = 0;
+
+    snapshot(as, CANmodule);
+
+    /* report errors from background thread here, in mainline thread */
+    pthread_mutex_lock(&as->mtx);
+    errorCount = as->stats.errorCount;
+    pthread_mutex_unlock(&as->mtx);
+    if (errorCount != as->errorCountReported) {
+        as->errorCountReported = errorCount;
+        log_printf(LOG_ERR, DBG_OD_AUTOSAVE, as->filename, errorCount);
+    }
+}
+
+
+/******************************************************************************/
+void CO_OD_autosave_flush(CO_OD_autosave_t *as, CO_CANmodule_t *CANmodule) {
+    if (as == NULL || !as->threadStarted || CANmodule == NULL) {
+        return;
+    }
+
+    snapshot(as, CANmodule);
+
+    pthread_mutex_lock(&as->mtx);
+    while (as->pendingAny || as->busy) {
+        pthread_cond_wait(&as->condIdle, &as->mtx);
+    }
+    pthread_mutex_unlock(&as->mtx);
+}
+
+
+/******************************************************************************/
+void CO_OD_autosave_getStats(CO_OD_autosave_t *as,
+                             CO_OD_autosave_stats_t *stats)
+{
+    if (as == NULL || stats == NULL || !as->threadStarted) {
+        return;
+    }
+
+    pthread_mutex_lock(&as->mtx);
+    *stats = as->stats;
+    pthread_mutex_unlock(&as->mtx);
+}
+
+
+/******************************************************************************/
+void CO_OD_autosave_close(CO_OD_autosave_t *as) {
+    if (as == NULL || !as->threadStarted) {
+        return;
+    }
+
+    pthread_mutex_lock(&as->mtx);
+    as->stop = true;
+    pthread_cond_signal(&as->cond);
+    pthread_mutex_unlock(&as->mtx);
+    pthread_join(as->thread, NULL);
+    as->threadStarted = false;
+
+    pthread_cond_destroy(&as->condIdle);
+    pthread_cond_destroy(&as->cond);
+    pthread_mutex_destroy(&as->mtx);
+    freeAll(as);
+}
+
+#endif /* CO_SINGLE_THREAD */
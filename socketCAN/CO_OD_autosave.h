@@ -0,0 +1,232 @@
+/**
+ * Incremental and asynchronous autosave of Object Dictionary data on Linux.
+ *
+ * @file        CO_OD_autosave.h
+ * @ingroup     CO_socketCAN_OD_autosave
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CO_OD_AUTOSAVE_H
+#define CO_OD_AUTOSAVE_H
+
+#include "301/CO_driver.h"
+
+#if !defined CO_SINGLE_THREAD || defined CO_DOXYGEN
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup CO_socketCAN_OD_autosave OD autosave
+ * @ingroup CO_socketCAN
+ * @{
+ *
+ * Incremental and asynchronous autosave of Object Dictionary data block.
+ *
+ * Data block (for example OD_PERSIST_COMM) is divided into blocks of equal
+ * size. Mainline thread calls @ref CO_OD_autosave_process() cyclically. After
+ * each delay it compares data block with the copy from the previous snapshot,
+ * inside @ref CO_LOCK_OD() section, and hands changed blocks to the background
+ * thread. Mainline thread never does file I/O and never waits for it.
+ *
+ * Background thread stores data into two files:
+ * - "filename" contains the complete data block with header and CRC. It is
+ *   written to "filename.tmp", synced and renamed, so it is always complete.
+ * - "filename.jnl" is a journal. Changed blocks are appended to it as records
+ *   with own CRC, then journal is synced. Only changed blocks are written.
+ *
+ * When journal grows over the limit, complete data block is written again and
+ * journal is restarted. Journal is bound to the data file with generation
+ * number, so stale journal is never applied. On startup data file is loaded
+ * and valid journal records are applied in order. Torn record at the end of
+ * the journal (power loss during write) is discarded.
+ *
+ * Statistics (stall time in mainline thread, bytes written by each save) are
+ * available with @ref CO_OD_autosave_getStats().
+ *
+ * Module is available only in multi-thread operation.
+ */
+
+/**
+ * Autosave statistics
+ */
+typedef struct {
+    /** Number of completed saves */
+    uint32_t saveCount;
+    /** Number of saves, which wrote the complete data file */
+    uint32_t fullSaveCount;
+    /** Number of failed saves. Failed save is repeated as full save on next
+     * snapshot, even if Object Dictionary data did not change. */
+    uint32_t errorCount;
+    /** Bytes written to files by the last save */
+    uint32_t lastBytes;
+    /** Bytes written to files by all saves */
+    uint64_t totalBytes;
+    /** Duration of the last save in background thread, including sync */
+    uint32_t lastWrite_us;
+    /** Time, mainline thread spent in the last snapshot */
+    uint32_t lastStall_us;
+    /** Maximum time, mainline thread spent in one snapshot */
+    uint32_t maxStall_us;
+} CO_OD_autosave_stats_t;
+
+/**
+ * Autosave object
+ */
+typedef struct {
+    /** Data block, from CO_OD_autosave_init() */
+    uint8_t *addr;
+    /** Size of data block, from CO_OD_autosave_init() */
+    size_t size;
+    /** Size of one block, from CO_OD_autosave_init() */
+    size_t blockSize;
+    /** Number of blocks */
+    uint32_t blockCount;
+    /** Journal limit in bytes, from CO_OD_autosave_init() */
+    size_t journalLimit;
+    /** Names of data file, journal and temporary file */
+    char *filename, *filenameJnl, *filenameTmp;
+    /** Copy of data from the last snapshot, used by mainline thread */
+    uint8_t *shadow;
+    /** Changed blocks, waiting for background thread, protected by mtx */
+    uint8_t *pending;
+    /** Data as stored in files, used by background thread */
+    uint8_t *image;
+    /** Buffer for journal records, used by background thread */
+    uint8_t *recBuf;
+    /** Bitmaps of changed blocks: snapshot, pending and written */
+    uint32_t *dirty, *pendingDirty, *writeDirty;
+    /** True, if any pending block is waiting, protected by mtx */
+    bool_t pendingAny;
+    /** True, while background thread writes, protected by mtx */
+    bool_t busy;
+    /** Request to stop background thread, protected by mtx */
+    bool_t stop;
+    /** Next save must write complete data file, used by background thread */
+    bool_t fullSavePending;
+    /** True, if last save failed and must be retried, protected by mtx */
+    bool_t retryPending;
+    /** Generation of data file and journal, used by background thread */
+    uint32_t gen;
+    /** Journal file descriptor and size, used by background thread */
+    int fdJnl;
+    size_t jnlSize;
+    /** Timer for delay between snapshots, used by mainline thread */
+    uint32_t timer_us;
+    /** Error count, which was already reported, used by mainline thread */
+    uint32_t errorCountReported;
+    /** Statistics, protected by mtx */
+    CO_OD_autosave_stats_t stats;
+    pthread_t thread;
+    pthread_mutex_t mtx;
+    pthread_cond_t cond;
+    pthread_cond_t condIdle;
+    bool_t threadStarted;
+} CO_OD_autosave_t;
+
+/**
+ * Initialize autosave object, load data and start background thread
+ *
+ * Called after program startup, before @ref CO_CANopenInit(). Data from the
+ * data file and from the journal are copied into data block. If files don't
+ * exist, data block keeps its default values. If files are corrupt, data block
+ * also keeps its default values and they are saved with the first save.
+ * Object is usable in all cases, except if CO_ERROR_ILLEGAL_ARGUMENT,
+ * CO_ERROR_OUT_OF_MEMORY or CO_ERROR_SYSCALL is returned.
+ *
+ * @param as This object will be initialized.
+ * @param addr Address of the data block, for example &OD_PERSIST_COMM.
+ * @param size Size of the data block.
+ * @param filename Name of the data file. Journal and temporary file use the
+ * same name with ".jnl" and ".tmp" suffix.
+ * @param blockSize Size of one block in bytes, 64 for example.
+ * @param journalLimit If journal grows over this size in bytes, complete data
+ * file is written. If 0, four times the data block size is used.
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_DATA_CORRUPT (data file
+ * corrupt), CO_ERROR_CRC (wrong CRC of data file), CO_ERROR_ILLEGAL_ARGUMENT,
+ * CO_ERROR_OUT_OF_MEMORY or CO_ERROR_SYSCALL.
+ */
+CO_ReturnError_t CO_OD_autosave_init(CO_OD_autosave_t *as,
+                                     void *addr,
+                                     size_t size,
+                                     const char *filename,
+                                     size_t blockSize,
+                                     size_t journalLimit);
+
+/**
+ * Snapshot changed blocks after delay, called cyclically from mainline thread
+ *
+ * Function takes @ref CO_LOCK_OD() of the CANmodule only for the comparison
+ * and copy of changed blocks. Writing is done by background thread.
+ *
+ * @param as This object.
+ * @param CANmodule CAN module, which protects Object Dictionary.
+ * @param timeDifference_us Time difference from previous function call.
+ * @param delay_us Delay (inhibit) time between snapshots (60000000 for
+ * example).
+ */
+void CO_OD_autosave_process(CO_OD_autosave_t *as,
+                            CO_CANmodule_t *CANmodule,
+                            uint32_t timeDifference_us,
+                            uint32_t delay_us);
+
+/**
+ * Snapshot changed blocks now and wait, until they are written
+ *
+ * If previous save failed, it is retried once. If retry also fails, function
+ * returns and error is counted in statistics.
+ *
+ * Used before program exit or before power down.
+ *
+ * @param as This object.
+ * @param CANmodule CAN module, which protects Object Dictionary.
+ */
+void CO_OD_autosave_flush(CO_OD_autosave_t *as, CO_CANmodule_t *CANmodule);
+
+/**
+ * Get autosave statistics
+ *
+ * @param as This object.
+ * @param [out] stats Copy of statistics.
+ */
+void CO_OD_autosave_getStats(CO_OD_autosave_t *as,
+                             CO_OD_autosave_stats_t *stats);
+
+/**
+ * Stop background thread and release resources
+ *
+ * Pending blocks are written before thread stops. Call
+ * @ref CO_OD_autosave_flush() before, if last changes must be saved.
+ *
+ * @param as This object.
+ */
+void CO_OD_autosave_close(CO_OD_autosave_t *as);
+
+/** @} */ /* CO_socketCAN_OD_autosave */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* !defined CO_SINGLE_THREAD */
+
+#endif /* CO_OD_AUTOSAVE_H */
@@ -0,0 +1,174 @@
+/*
+ * Object Dictionary cloning for multiple CANopen networks in one process.
+ *
+ * @file        CO_OD_clone.c
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#define OD_DEFINITION
+#include "CO_OD_clone.h"
+
+/* All parts of the copy are aligned to this size */
+#define CO_OD_CLONE_ALIGN 8
+
+/* Memory arena. If base is NULL, only size is calculated. */
+typedef struct {
+    uint8_t *base;
+    size_t offset;
+} CO_OD_arena_t;
+
+static void *arenaGet(CO_OD_arena_t *arena, size_t size) {
+    void *p = arena->base != NULL ? &arena->base[arena->offset] : NULL;
+
+    arena->offset += (size + CO_OD_CLONE_ALIGN - 1)
+                     & ~((size_t)CO_OD_CLONE_ALIGN - 1);
+    return p;
+}
+
+/* Copy data, NULL data or data with zero length stays NULL */
+static void *cloneData(CO_OD_arena_t *arena, const void *data, size_t len) {
+    if (data == NULL || len == 0) return NULL;
+
+    void *p = arenaGet(arena, len);
+    if (p != NULL) memcpy(p, data, len);
+    return p;
+}
+
+static OD_obj_extended_t *cloneExt(CO_OD_arena_t *arena,
+                                   const OD_obj_extended_t *ext)
+{
+    if (ext == NULL) return NULL;
+
+    OD_obj_extended_t *e = arenaGet(arena, sizeof(OD_obj_extended_t));
+    OD_flagsPDO_t *flagsPDO = NULL;
+
+    if (ext->flagsPDO != NULL) {
+        flagsPDO = arenaGet(arena, sizeof(OD_flagsPDO_t));
+    }
+    if (e != NULL) {
+        e->object = NULL;
+        e->read = NULL;
+        e->write = NULL;
+        e->flagsPDO = flagsPDO;
+    }
+    return e;
+}
+
+/* Clone one OD object and return pointer to it (or NULL on first pass) */
+static void *cloneObject(CO_OD_arena_t *arena, const OD_entry_t *entry) {
+    uint8_t type = entry->odObjectType & ODT_TYPE_MASK;
+
+    if (entry->odObject == NULL) return NULL;
+
+    if (type == ODT_VAR) {
+        const OD_obj_var_t *src = entry->odObject;
+        OD_obj_var_t *dst = arenaGet(arena, sizeof(OD_obj_var_t));
+        void *data = cloneData(arena, src->data, src->dataLength);
+        OD_obj_extended_t *ext = cloneExt(arena, src->ext);
+
+        if (dst != NULL) {
+            *dst = *src;
+            dst->data = data;
+            dst->ext = ext;
+        }
+        return dst;
+    }
+    else if (type == ODT_ARR) {
+        const OD_obj_array_t *src = entry->odObject;
+        OD_obj_array_t *dst = arenaGet(arena, sizeof(OD_obj_array_t));
+        void *data0 = cloneData(arena, src->base.data, 1);
+        size_t dataLen = entry->subEntriesCount < 2 ? 0
+                       : src->dataElementSizeof * (entry->subEntriesCount - 1);
+        void *data = cloneData(arena, src->data, dataLen);
+        OD_obj_extended_t *ext = cloneExt(arena, src->base.ext);
+
+        if (dst != NULL) {
+            *dst = *src;
+            dst->base.data = data0;
+            dst->base.ext = ext;
+            dst->data = data;
+        }
+        return dst;
+    }
+    else if (type == ODT_REC) {
+        const OD_obj_record_t *src = entry->odObject;
+        OD_obj_record_t *dst = arenaGet(arena, sizeof(OD_obj_record_t)
+                                               * entry->subEntriesCount);
+        /* all sub-elements share the same extension */
+        OD_obj_extended_t *ext = cloneExt(arena, src[0].base.ext);
+        uint8_t i;
+
+        for (i = 0; i < entry->subEntriesCount; i++) {
+            void *data = cloneData(arena, src[i].base.data,
+                                   src[i].base.dataLength);
+            if (dst != NULL) {
+                dst[i] = src[i];
+                dst[i].base.data = data;
+                dst[i].base.ext = ext;
+            }
+        }
+        return dst;
+    }
+
+    return NULL;
+}
+
+/* Clone the whole OD into arena, returns new OD or NULL on first pass */
+static OD_t *cloneOD(CO_OD_arena_t *arena, const OD_t *od) {
+    OD_t *dst = arenaGet(arena, sizeof(OD_t));
+    /* list has one additional blank element at the end */
+    OD_entry_t *list = arenaGet(arena, sizeof(OD_entry_t) * (od->size + 1));
+    uint16_t i;
+
+    for (i = 0; i < od->size; i++) {
+        void *odObject = cloneObject(arena, &od->list[i]);
+        if (list != NULL) {
+            list[i] = od->list[i];
+            list[i].odObject = odObject;
+        }
+    }
+
+    if (dst != NULL) {
+        memset(&list[od->size], 0, sizeof(OD_entry_t));
+        dst->size = od->size;
+        dst->list = list;
+    }
+    return dst;
+}
+
+
+/******************************************************************************/
+OD_t *CO_OD_clone(const OD_t *od) {
+    CO_OD_arena_t arena = {NULL, 0};
+
+    if (od == NULL || od->list == NULL) return NULL;
+
+    /* first pass calculates size, second pass copies */
+    (void)cloneOD(&arena, od);
+
+    arena.base = calloc(1, arena.offset);
+    if (arena.base == NULL) return NULL;
+    arena.offset = 0;
+
+    return cloneOD(&arena, od);
+}
@@ -0,0 +1,71 @@
+/**
+ * Object Dictionary cloning for multiple CANopen networks in one process.
+ *
+ * @file        CO_OD_clone.h
+ * @ingroup     CO_socketCAN_OD_clone
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CO_OD_CLONE_H
+#define CO_OD_CLONE_H
+
+#include "301/CO_ODinterface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup CO_socketCAN_OD_clone OD clone
+ * @ingroup CO_socketCAN
+ * @{
+ *
+ * Deep copy of the Object Dictionary.
+ *
+ * Object Dictionary generated into OD.h/OD.c is a set of global variables.
+ * If several CANopen networks run inside one process, each of them needs own
+ * copy of the Object Dictionary, so networks do not share any mutable data.
+ * @ref CO_OD_clone() creates such copy from the template Object Dictionary.
+ * Copy is used together with @ref CO_MULTIPLE_OD configuration.
+ */
+
+/**
+ * Create deep copy of the Object Dictionary
+ *
+ * OD list, all OD objects and all data are copied into a single memory block.
+ * Initial values of the data are the values from the template at the time of
+ * the call. IO extensions are copied, but "object", "read" and "write" are
+ * cleared, so each network must call @ref OD_extensionIO_init() on own copy.
+ * PDO flags are allocated separately for each copy and cleared.
+ *
+ * @param od Template Object Dictionary, it is not modified.
+ *
+ * @return Pointer to new Object Dictionary or NULL if out of memory. Release
+ * it with free().
+ */
+OD_t *CO_OD_clone(const OD_t *od);
+
+/** @} */ /* CO_socketCAN_OD_clone */
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus*/
+
+#endif /* CO_OD_CLONE_H */
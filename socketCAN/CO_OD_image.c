@@ -0,0 +1,591 @@
+/*
+ * Binary Object Dictionary image, loaded at runtime on Linux.
+ *
+ * @file        CO_OD_image.c
+ * @ingroup     CO_socketCAN_OD_image
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define OD_DEFINITION
+#include "CO_OD_image.h"
+#include "301/crc16-ccitt.h"
+
+/* File layout: header, entry table (sorted by index), descriptor table, data.
+ * All offsets are relative to the start of the file, parts are aligned to 8.
+ * CRC covers header up to the crc field and everything after the header. */
+#define ODI_MAGIC "CODI"
+#define ODI_BYTE_ORDER 0x01020304UL
+#define ODI_ALIGN 8
+#define ODI_NONE 0xFFFFFFFFUL
+
+/* descriptor flags */
+#define ODI_FLAG_EXT 0x01
+#define ODI_FLAG_PDO 0x02
+
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t entryCount;
+    uint32_t byteOrder;
+    uint32_t descCount;
+    uint32_t entriesOffset;
+    uint32_t descOffset;
+    uint32_t dataOffset;
+    uint32_t dataSize;
+    uint32_t fileSize;
+    uint16_t crc;
+    uint16_t reserved;
+} ODI_header_t;
+
+typedef struct {
+    uint16_t index;
+    uint8_t subEntriesCount;
+    uint8_t odObjectType;
+    /* index of the first descriptor or ODI_NONE */
+    uint32_t firstDesc;
+} ODI_entry_t;
+
+/* VAR uses one descriptor, ARR two (sub-index 0 and elements), REC one per
+ * sub-element */
+typedef struct {
+    /* offset of data inside data part or ODI_NONE */
+    uint32_t dataOffset;
+    /* data length, for ARR elements length of one element */
+    uint32_t dataLength;
+    /* for ARR elements sizeof one element, otherwise 0 */
+    uint32_t elementSizeof;
+    uint8_t attribute;
+    uint8_t subIndex;
+    uint8_t flags;
+    uint8_t reserved;
+} ODI_desc_t;
+
+/* Memory block of one instance, copy of data, OD list and objects follow */
+typedef struct {
+    OD_t od;
+} ODI_instance_t;
+
+static inline size_t alignUp(size_t size) {
+    return (size + ODI_ALIGN - 1) & ~((size_t)ODI_ALIGN - 1);
+}
+
+/* Number of descriptors for OD entry */
+static uint32_t descCountOf(uint8_t odObjectType, uint8_t subEntriesCount) {
+    switch (odObjectType & ODT_TYPE_MASK) {
+        case ODT_VAR: return 1;
+        case ODT_ARR: return 2;
+        case ODT_REC: return subEntriesCount;
+        default: return 0;
+    }
+}
+
+/* Size of OD objects of one entry in the instance memory block */
+static size_t objectSizeOf(uint8_t odObjectType, uint8_t subEntriesCount,
+                           const ODI_desc_t *desc)
+{
+    size_t size;
+
+    switch (odObjectType & ODT_TYPE_MASK) {
+        case ODT_VAR: size = alignUp(sizeof(OD_obj_var_t)); break;
+        case ODT_ARR: size = alignUp(sizeof(OD_obj_array_t)); break;
+        case ODT_REC: size = alignUp(sizeof(OD_obj_record_t)
+                                     * subEntriesCount); break;
+        default: return 0;
+    }
+    if ((desc->flags & ODI_FLAG_EXT) != 0) {
+        size += alignUp(sizeof(OD_obj_extended_t));
+    }
+    if ((desc->flags & ODI_FLAG_PDO) != 0) {
+        size += alignUp(sizeof(OD_flagsPDO_t));
+    }
+    return size;
+}
+
+
+/* Writer *********************************************************************/
+/* Fill descriptor and copy data. If buf is NULL, only data size is counted. */
+static void writeDesc(ODI_desc_t *desc, uint8_t *data, uint32_t *dataSize,
+                      const void *src, size_t len, const OD_obj_extended_t *ext)
+{
+    ODI_desc_t d;
+
+    memset(&d, 0, sizeof(d));
+    d.dataOffset = ODI_NONE;
+    d.dataLength = (uint32_t)len;
+    if (src != NULL && len > 0) {
+        d.dataOffset = *dataSize;
+        if (data != NULL) {
+            memcpy(&data[*dataSize], src, len);
+        }
+        *dataSize += (uint32_t)alignUp(len);
+    }
+    if (ext != NULL) {
+        d.flags |= ODI_FLAG_EXT;
+        if (ext->flagsPDO != NULL) {
+            d.flags |= ODI_FLAG_PDO;
+        }
+    }
+    if (desc != NULL) {
+        *desc = d;
+    }
+}
+
+/* Serialize OD objects. If entries is NULL, only sizes are counted. */
+static void writeObjects(const OD_t *od, ODI_entry_t *entries,
+                         ODI_desc_t *descs, uint8_t *data,
+                         uint32_t *descCount, uint32_t *dataSize)
+{
+    uint16_t i;
+
+    *descCount = 0;
+    *dataSize = 0;
+    for (i = 0; i < od->size; i++) {
+        const OD_entry_t *entry = &od->list[i];
+        uint8_t type = entry->odObjectType & ODT_TYPE_MASK;
+        uint32_t n = entry->odObject != NULL
+                   ? descCountOf(type, entry->subEntriesCount) : 0;
+        ODI_desc_t *d = descs != NULL ? &descs[*descCount] : NULL;
+
+        if (entries != NULL) {
+            entries[i].index = entry->index;
+            entries[i].subEntriesCount = entry->subEntriesCount;
+            entries[i].odObjectType = entry->odObjectType;
+            entries[i].firstDesc = n > 0 ? *descCount : ODI_NONE;
+        }
+        if (n == 0) {
+            continue;
+        }
+
+        if (type == ODT_VAR) {
+            const OD_obj_var_t *o = entry->odObject;
+
+            writeDesc(d, data, dataSize, o->data, o->dataLength, o->ext);
+            if (d != NULL) d->attribute = o->attribute;
+        }
+        else if (type == ODT_ARR) {
+            const OD_obj_array_t *o = entry->odObject;
+            size_t len = entry->subEntriesCount < 2 ? 0
+                       : o->dataElementSizeof * (entry->subEntriesCount - 1);
+
+            writeDesc(d, data, dataSize, o->base.data, 1, o->base.ext);
+            writeDesc(d != NULL ? &d[1] : NULL, data, dataSize,
+                      o->data, len, o->base.ext);
+            if (d != NULL) {
+                d[0].attribute = o->base.attribute;
+                d[1].attribute = o->attribute;
+                d[1].dataLength = o->dataElementLength;
+                d[1].elementSizeof = o->dataElementSizeof;
+            }
+        }
+        else {
+            const OD_obj_record_t *o = entry->odObject;
+            uint32_t j;
+
+            for (j = 0; j < n; j++) {
+                /* all sub-elements share the extension of the first one */
+                writeDesc(d != NULL ? &d[j] : NULL, data, dataSize,
+                          o[j].base.data, o[j].base.dataLength, o[0].base.ext);
+                if (d != NULL) {
+                    d[j].attribute = o[j].base.attribute;
+                    d[j].subIndex = o[j].subIndex;
+                }
+            }
+        }
+        *descCount += n;
+    }
+}
+
+
+CO_ReturnError_t CO_OD_image_write(const OD_t *od, const char *filename) {
+    ODI_header_t *hdr;
+    uint32_t descCount, dataSize;
+    size_t entriesOffset, descOffset, dataOffset, fileSize, len;
+    uint8_t *buf;
+    char *filenameTmp;
+    FILE *f;
+    bool_t ok;
+
+    if (od == NULL || od->list == NULL || filename == NULL) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    /* first pass calculates sizes, second pass fills the buffer */
+    writeObjects(od, NULL, NULL, NULL, &descCount, &dataSize);
+    entriesOffset = alignUp(sizeof(ODI_header_t));
+    descOffset = entriesOffset + alignUp(sizeof(ODI_entry_t) * od->size);
+    dataOffset = descOffset + alignUp(sizeof(ODI_desc_t) * descCount);
+    fileSize = dataOffset + dataSize;
+    if (fileSize > 0xFFFFFFF0UL) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    buf = calloc(1, fileSize);
+    if (buf == NULL) {
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+    writeObjects(od, (ODI_entry_t *)&buf[entriesOffset],
+                 (ODI_desc_t *)&buf[descOffset], &buf[dataOffset],
+                 &descCount, &dataSize);
+
+    hdr = (ODI_header_t *)buf;
+    memcpy(hdr->magic, ODI_MAGIC, sizeof(hdr->magic));
+    hdr->version = CO_OD_IMAGE_VERSION;
+    hdr->entryCount = od->size;
+    hdr->byteOrder = ODI_BYTE_ORDER;
+    hdr->descCount = descCount;
+    hdr->entriesOffset = (uint32_t)entriesOffset;
+    hdr->descOffset = (uint32_t)descOffset;
+    hdr->dataOffset = (uint32_t)dataOffset;
+    hdr->dataSize = dataSize;
+    hdr->fileSize = (uint32_t)fileSize;
+    hdr->crc = crc16_ccitt(buf, offsetof(ODI_header_t, crc), 0);
+    hdr->crc = crc16_ccitt(&buf[sizeof(ODI_header_t)],
+                           fileSize - sizeof(ODI_header_t), hdr->crc);
+
+    len = strlen(filename);
+    filenameTmp = malloc(len + 5);
+    if (filenameTmp == NULL) {
+        free(buf);
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+    memcpy(filenameTmp, filename, len);
+    memcpy(&filenameTmp[len], ".tmp", 5);
+
+    f = fopen(filenameTmp, "wb");
+    ok = f != NULL && fwrite(buf, 1, fileSize, f) == fileSize;
+    if (f != NULL && fclose(f) != 0) {
+        ok = false;
+    }
+    if (ok && rename(filenameTmp, filename) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        unlink(filenameTmp);
+    }
+    free(filenameTmp);
+    free(buf);
+
+    return ok ? CO_ERROR_NO : CO_ERROR_SYSCALL;
+}
+
+
+/* Loader *********************************************************************/
+static inline const ODI_header_t *imgHeader(const CO_OD_image_t *img) {
+    return (const ODI_header_t *)img->map;
+}
+
+static inline const ODI_entry_t *imgEntries(const CO_OD_image_t *img) {
+    return (const ODI_entry_t *)&img->map[imgHeader(img)->entriesOffset];
+}
+
+static inline const ODI_desc_t *imgDescs(const CO_OD_image_t *img) {
+    return (const ODI_desc_t *)&img->map[imgHeader(img)->descOffset];
+}
+
+/* Verify data range of the descriptor */
+static bool_t descValid(const ODI_desc_t *d, size_t len, uint32_t dataSize) {
+    if (d->dataOffset == ODI_NONE) {
+        return true;
+    }
+    return (d->dataOffset % ODI_ALIGN) == 0 && d->dataOffset <= dataSize
+           && len <= dataSize - d->dataOffset;
+}
+
+/* Validate structure of the image and calculate size of the instance */
+static bool_t validate(CO_OD_image_t *img) {
+    const ODI_header_t *hdr = imgHeader(img);
+    const ODI_entry_t *entries;
+    const ODI_desc_t *descs;
+    size_t instanceSize;
+    uint16_t crc;
+    uint32_t i;
+
+    if (memcmp(hdr->magic, ODI_MAGIC, sizeof(hdr->magic)) != 0
+        || hdr->version != CO_OD_IMAGE_VERSION
+        || hdr->byteOrder != ODI_BYTE_ORDER
+        || hdr->fileSize != img->size
+        || (hdr->entriesOffset % ODI_ALIGN) != 0
+        || (hdr->descOffset % ODI_ALIGN) != 0
+        || (hdr->dataOffset % ODI_ALIGN) != 0
+        || hdr->entriesOffset < sizeof(ODI_header_t)
+        || hdr->entriesOffset + (size_t)hdr->entryCount * sizeof(ODI_entry_t)
+           > hdr->descOffset
+        || hdr->descOffset + (size_t)hdr->descCount * sizeof(ODI_desc_t)
+           > hdr->dataOffset
+        || (size_t)hdr->dataOffset + hdr->dataSize != img->size
+    ) {
+        return false;
+    }
+
+    entries = imgEntries(img);
+    descs = imgDescs(img);
+    instanceSize = alignUp(sizeof(ODI_instance_t)) + alignUp(hdr->dataSize)
+                   + alignUp(sizeof(OD_entry_t) * (hdr->entryCount + 1U));
+
+    for (i = 0; i < hdr->entryCount; i++) {
+        const ODI_entry_t *e = &entries[i];
+        uint8_t type = e->odObjectType & ODT_TYPE_MASK;
+        uint32_t n, j;
+        const ODI_desc_t *d;
+
+        /* entry list must be sorted for OD_find() */
+        if ((i > 0 && e->index <= entries[i - 1].index)
+            || (e->odObjectType & ~(ODT_TYPE_MASK | ODT_EXTENSION_MASK)) != 0
+        ) {
+            return false;
+        }
+        if (e->firstDesc == ODI_NONE) {
+            continue;
+        }
+        n = descCountOf(type, e->subEntriesCount);
+        if (n == 0 || e->firstDesc > hdr->descCount
+            || n > hdr->descCount - e->firstDesc
+        ) {
+            return false;
+        }
+
+        d = &descs[e->firstDesc];
+        if (type == ODT_ARR) {
+            size_t len = e->subEntriesCount < 2 ? 0
+                       : (size_t)d[1].elementSizeof * (e->subEntriesCount - 1);
+
+            if (d[0].dataLength > 1 || d[1].dataLength > d[1].elementSizeof
+                || !descValid(&d[0], d[0].dataLength, hdr->dataSize)
+                || !descValid(&d[1], len, hdr->dataSize)
+            ) {
+                return false;
+            }
+        }
+        else {
+            for (j = 0; j < n; j++) {
+                if (!descValid(&d[j], d[j].dataLength, hdr->dataSize)) {
+                    return false;
+                }
+            }
+        }
+        instanceSize += objectSizeOf(type, e->subEntriesCount, d);
+    }
+
+    crc = crc16_ccitt(img->map, offsetof(ODI_header_t, crc), 0);
+    crc = crc16_ccitt(&img->map[sizeof(ODI_header_t)],
+                      img->size - sizeof(ODI_header_t), crc);
+    if (crc != hdr->crc) {
+        return false;
+    }
+
+    img->entryCount = hdr->entryCount;
+    img->descCount = hdr->descCount;
+    img->instanceSize = instanceSize;
+    return true;
+}
+
+
+CO_ReturnError_t CO_OD_image_open(CO_OD_image_t *img, const char *filename) {
+    struct stat st;
+    void *map;
+    int fd;
+
+    if (img == NULL || filename == NULL) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+    memset(img, 0, sizeof(CO_OD_image_t));
+
+    fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return CO_ERROR_SYSCALL;
+    }
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return CO_ERROR_SYSCALL;
+    }
+    if (st.st_size < (off_t)sizeof(ODI_header_t)) {
+        close(fd);
+        return CO_ERROR_DATA_CORRUPT;
+    }
+
+    /* one read-only shared mapping for all instances, mapping stays valid
+     * after the file is closed */
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return CO_ERROR_SYSCALL;
+    }
+    img->map = map;
+    img->size = (size_t)st.st_size;
+
+    if (!validate(img)) {
+        const ODI_header_t *hdr = imgHeader(img);
+        bool_t crcOnly = memcmp(hdr->magic, ODI_MAGIC, 4) == 0
+                         && hdr->fileSize == img->size;
+
+        CO_OD_image_close(img);
+        return crcOnly ? CO_ERROR_CRC : CO_ERROR_DATA_CORRUPT;
+    }
+
+    return CO_ERROR_NO;
+}
+
+
+/* Build extension of the OD object in the instance memory block */
+static OD_obj_extended_t *buildExt(uint8_t **p, const ODI_desc_t *d) {
+    OD_obj_extended_t *ext;
+
+    if ((d->flags & ODI_FLAG_EXT) == 0) {
+        return NULL;
+    }
+    ext = (OD_obj_extended_t *)*p;
+    *p += alignUp(sizeof(OD_obj_extended_t));
+    if ((d->flags & ODI_FLAG_PDO) != 0) {
+        ext->flagsPDO = (OD_flagsPDO_t *)*p;
+        *p += alignUp(sizeof(OD_flagsPDO_t));
+    }
+    return ext;
+}
+
+static inline void *dataPtr(uint8_t *data, const ODI_desc_t *d) {
+    return d->dataOffset == ODI_NONE ? NULL : &data[d->dataOffset];
+}
+
+
+OD_t *CO_OD_image_instance(const CO_OD_image_t *img) {
+    const ODI_entry_t *entries;
+    const ODI_desc_t *descs;
+    const ODI_header_t *hdr;
+    ODI_instance_t *inst;
+    OD_entry_t *list;
+    uint8_t *p, *data;
+    uint16_t i;
+
+    if (img == NULL || img->map == NULL) {
+        return NULL;
+    }
+
+    inst = calloc(1, img->instanceSize);
+    if (inst == NULL) {
+        return NULL;
+    }
+    hdr = imgHeader(img);
+    entries = imgEntries(img);
+    descs = imgDescs(img);
+    p = (uint8_t *)inst + alignUp(sizeof(ODI_instance_t));
+
+    /* variables of this instance, initialized with default data. Entry table
+     * and descriptors are only read from the shared mapping. */
+    data = p;
+    memcpy(data, &img->map[hdr->dataOffset], hdr->dataSize);
+    p += alignUp(hdr->dataSize);
+
+    list = (OD_entry_t *)p;
+    p += alignUp(sizeof(OD_entry_t) * (img->entryCount + 1U));
+
+    for (i = 0; i < img->entryCount; i++) {
+        const ODI_entry_t *e = &entries[i];
+        const ODI_desc_t *d;
+        uint8_t type = e->odObjectType & ODT_TYPE_MASK;
+
+        list[i].index = e->index;
+        list[i].subEntriesCount = e->subEntriesCount;
+        list[i].odObjectType = e->odObjectType;
+        list[i].odObject = NULL;
+        if (e->firstDesc == ODI_NONE) {
+            continue;
+        }
+        d = &descs[e->firstDesc];
+
+        if (type == ODT_VAR) {
+            OD_obj_var_t *o = (OD_obj_var_t *)p;
+
+            p += alignUp(sizeof(OD_obj_var_t));
+            o->data = dataPtr(data, d);
+            o->attribute = d->attribute;
+            o->dataLength = d->dataLength;
+            o->ext = buildExt(&p, d);
+            list[i].odObject = o;
+        }
+        else if (type == ODT_ARR) {
+            OD_obj_array_t *o = (OD_obj_array_t *)p;
+
+            p += alignUp(sizeof(OD_obj_array_t));
+            o->base.data = dataPtr(data, &d[0]);
+            o->base.attribute = d[0].attribute;
+            o->base.dataLength = d[0].dataLength;
+            o->base.ext = buildExt(&p, d);
+            o->data = dataPtr(data, &d[1]);
+            o->attribute = d[1].attribute;
+            o->dataElementLength = d[1].dataLength;
+            o->dataElementSizeof = d[1].elementSizeof;
+            list[i].odObject = o;
+        }
+        else if (type == ODT_REC) {
+            OD_obj_record_t *o = (OD_obj_record_t *)p;
+            OD_obj_extended_t *ext;
+            uint8_t j;
+
+            p += alignUp(sizeof(OD_obj_record_t) * e->subEntriesCount);
+            ext = buildExt(&p, d);
+            for (j = 0; j < e->subEntriesCount; j++) {
+                o[j].base.data = dataPtr(data, &d[j]);
+                o[j].base.attribute = d[j].attribute;
+                o[j].base.dataLength = d[j].dataLength;
+                o[j].base.ext = ext;
+                o[j].subIndex = d[j].subIndex;
+            }
+            list[i].odObject = o;
+        }
+    }
+
+    /* list has one additional blank element at the end */
+    memset(&list[img->entryCount], 0, sizeof(OD_entry_t));
+    inst->od.size = img->entryCount;
+    inst->od.list = list;
+
+    return &inst->od;
+}
+
+
+void CO_OD_image_instanceFree(OD_t *od) {
+    ODI_instance_t *inst;
+
+    if (od == NULL) {
+        return;
+    }
+    inst = (ODI_instance_t *)((uint8_t *)od - offsetof(ODI_instance_t, od));
+    free(inst);
+}
+
+
+void CO_OD_image_close(CO_OD_image_t *img) {
+    if (img == NULL) {
+        return;
+    }
+    if (img->map != NULL) {
+        munmap((void *)img->map, img->size);
+        img->map = NULL;
+    }
+}
@@ -0,0 +1,141 @@
+/**
+ * Binary Object Dictionary image, loaded at runtime on Linux.
+ *
+ * @file        CO_OD_image.h
+ * @ingroup     CO_socketCAN_OD_image
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CO_OD_IMAGE_H
+#define CO_OD_IMAGE_H
+
+#include "301/CO_driver.h"
+#include "301/CO_ODinterface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup CO_socketCAN_OD_image OD image
+ * @ingroup CO_socketCAN
+ * @{
+ *
+ * Object Dictionary from binary image file, without rebuilding the program.
+ *
+ * Image is a compact and relocatable form of the Object Dictionary. It
+ * contains entry table, sorted by index, descriptors of all sub-entries
+ * (attribute, length, offset of data) and default data. It does not contain
+ * pointers, so the same file is used at any address. Image is created offline
+ * with @ref CO_OD_image_write() from the Object Dictionary, generated from
+ * the device description (OD.h/OD.c), so one program per device profile
+ * produces the image and any program can load it.
+ *
+ * @ref CO_OD_image_open() maps the file once with PROT_READ and MAP_SHARED
+ * and validates it. Entry table, descriptors and default data stay in that
+ * mapping and are shared by all instances. @ref CO_OD_image_instance() then
+ * creates Object Dictionary for one CANopen device in one small memory block:
+ * copy of the data part (variables of the device, initialized with default
+ * data), entry list and OD objects. All variables are copied, because
+ * application and stack may write also read-only objects, for example
+ * serial number or error register.
+ *
+ * File format uses byte order of the host. IO extensions of the instance are
+ * not initialized, see @ref OD_extensionIO_init().
+ */
+
+/** Version of the image file format */
+#define CO_OD_IMAGE_VERSION 1
+
+/**
+ * Opened Object Dictionary image
+ */
+typedef struct {
+    /** Read-only shared mapping of the file */
+    const uint8_t *map;
+    /** Size of the file */
+    size_t size;
+    /** Number of OD entries */
+    uint16_t entryCount;
+    /** Number of descriptors */
+    uint32_t descCount;
+    /** Size of memory block for one instance, including variables */
+    size_t instanceSize;
+} CO_OD_image_t;
+
+/**
+ * Write Object Dictionary into image file
+ *
+ * Data are written with their current values. File is written to
+ * "filename.tmp" and renamed.
+ *
+ * @param od Object Dictionary.
+ * @param filename Name of the image file.
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT,
+ * CO_ERROR_OUT_OF_MEMORY or CO_ERROR_SYSCALL.
+ */
+CO_ReturnError_t CO_OD_image_write(const OD_t *od, const char *filename);
+
+/**
+ * Open and validate image file
+ *
+ * Image must stay opened, while any of its instances is used.
+ *
+ * @param img This object will be initialized.
+ * @param filename Name of the image file.
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT,
+ * CO_ERROR_SYSCALL, CO_ERROR_DATA_CORRUPT (wrong format or inconsistent
+ * content) or CO_ERROR_CRC.
+ */
+CO_ReturnError_t CO_OD_image_open(CO_OD_image_t *img, const char *filename);
+
+/**
+ * Create Object Dictionary instance from the image
+ *
+ * @param img Opened image.
+ *
+ * @return Pointer to new Object Dictionary or NULL on error. Release it with
+ * @ref CO_OD_image_instanceFree().
+ */
+OD_t *CO_OD_image_instance(const CO_OD_image_t *img);
+
+/**
+ * Release Object Dictionary instance
+ *
+ * @param od Object Dictionary from @ref CO_OD_image_instance(), may be NULL.
+ */
+void CO_OD_image_instanceFree(OD_t *od);
+
+/**
+ * Close image file
+ *
+ * @param img This object.
+ */
+void CO_OD_image_close(CO_OD_image_t *img);
+
+/** @} */ /* CO_socketCAN_OD_image */
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus*/
+
+#endif /* CO_OD_IMAGE_H */
@@ -0,0 +1,586 @@
+/*
+ * Decoding of PDO signals of remote nodes, configured from EDS or DCF files.
+ *
+ * @file        CO_PDOdecoder.c
+ * @ingroup     CO_socketCAN_PDOdecoder
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <endian.h>
+
+#include "CO_PDOdecoder.h"
+
+/* CANopen data types */
+#define DT_INTEGER8     0x0002
+#define DT_INTEGER32    0x0004
+#define DT_REAL32       0x0008
+#define DT_INTEGER24    0x0010
+#define DT_REAL64       0x0011
+#define DT_INTEGER40    0x0012
+#define DT_INTEGER64    0x0015
+
+
+/* EDS file in memory *********************************************************/
+typedef struct {
+    const char *section;
+    const char *key;
+    const char *value;
+} edsEntry_t;
+
+typedef struct {
+    char *text;
+    edsEntry_t *entries;
+    size_t count;
+} eds_t;
+
+static char *trim(char *s) {
+    char *end;
+
+    while (isspace((unsigned char)*s)) s++;
+    end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) end--;
+    *end = 0;
+    return s;
+}
+
+/* Read file and split it into section, key and value strings */
+static CO_ReturnError_t edsRead(eds_t *eds, const char *filename) {
+    FILE *f;
+    long size;
+    char *line, *next;
+    const char *section = "";
+    size_t capacity = 0;
+
+    memset(eds, 0, sizeof(*eds));
+    f = fopen(filename, "rb");
+    if (f == NULL) {
+        return CO_ERROR_SYSCALL;
+    }
+    if (fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < 0
+        || fseek(f, 0, SEEK_SET) != 0
+    ) {
+        fclose(f);
+        return CO_ERROR_SYSCALL;
+    }
+    eds->text = malloc((size_t)size + 1);
+    if (eds->text == NULL) {
+        fclose(f);
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+    if (fread(eds->text, 1, (size_t)size, f) != (size_t)size) {
+        fclose(f);
+        return CO_ERROR_SYSCALL;
+    }
+    fclose(f);
+    eds->text[size] = 0;
+
+    for (line = eds->text; line != NULL; line = next) {
+        char *eq;
+
+        next = strchr(line, '\n');
+        if (next != NULL) {
+            *next++ = 0;
+        }
+        line = trim(line);
+        if (line[0] == ';' || line[0] == 0) {
+            continue;
+        }
+        if (line[0] == '[') {
+            char *end = strchr(line, ']');
+            if (end != NULL) {
+                *end = 0;
+                section = trim(line + 1);
+            }
+            continue;
+        }
+        eq = strchr(line, '=');
+        if (eq == NULL) {
+            continue;
+        }
+        *eq = 0;
+        if (eds->count == capacity) {
+            edsEntry_t *e;
+
+            capacity = capacity == 0 ? 256 : capacity * 2;
+            e = realloc(eds->entries, capacity * sizeof(*e));
+            if (e == NULL) {
+                return CO_ERROR_OUT_OF_MEMORY;
+            }
+            eds->entries = e;
+        }
+        eds->entries[eds->count].section = section;
+        eds->entries[eds->count].key = trim(line);
+        eds->entries[eds->count].value = trim(eq + 1);
+        eds->count++;
+    }
+
+    return CO_ERROR_NO;
+}
+
+static void edsFree(eds_t *eds) {
+    free(eds->entries);
+    free(eds->text);
+    memset(eds, 0, sizeof(*eds));
+}
+
+static const char *edsGet(const eds_t *eds, const char *section,
+                          const char *key)
+{
+    for (size_t i = 0; i < eds->count; i++) {
+        if (strcasecmp(eds->entries[i].section, section) == 0
+            && strcasecmp(eds->entries[i].key, key) == 0
+        ) {
+            return eds->entries[i].value;
+        }
+    }
+    return NULL;
+}
+
+static bool_t edsHasSection(const eds_t *eds, const char *section) {
+    for (size_t i = 0; i < eds->count; i++) {
+        if (strcasecmp(eds->entries[i].section, section) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Get value of the object: ParameterValue (DCF) or DefaultValue, with
+ * "$NODEID" added. Return false, if there is no value. */
+static bool_t edsValue(const eds_t *eds, const char *section, uint8_t nodeId,
+                       uint32_t *value)
+{
+    const char *str = edsGet(eds, section, "ParameterValue");
+    char buf[64];
+    char *p, *end;
+    uint32_t add = 0;
+
+    if (str == NULL || str[0] == 0) {
+        str = edsGet(eds, section, "DefaultValue");
+    }
+    if (str == NULL || str[0] == 0 || strlen(str) >= sizeof(buf)) {
+        return false;
+    }
+    strcpy(buf, str);
+
+    /* "$NODEID+0x180" or "0x180+$NODEID" */
+    p = strcasestr(buf, "$NODEID");
+    if (p != NULL) {
+        memset(p, ' ', 7);
+        add = nodeId;
+        p = strchr(buf, '+');
+        if (p != NULL) {
+            *p = ' ';
+        }
+    }
+    p = trim(buf);
+    if (*p == 0) {
+        *value = add;
+        return true;
+    }
+    *value = (uint32_t)strtoul(p, &end, 0) + add;
+    return *trim(end) == 0;
+}
+
+
+/* Add signals of one transmit PDO of the node ********************************/
+static CO_ReturnError_t addPDO(CO_PDOdecoder_t *dec, const eds_t *eds,
+                               uint8_t nodeId, uint16_t pdo)
+{
+    char section[32];
+    uint32_t cobId, count, bitOffset = 0;
+
+    snprintf(section, sizeof(section), "%Xsub1", 0x1800 + pdo);
+    if (!edsValue(eds, section, nodeId, &cobId)
+        || (cobId & 0x80000000UL) != 0 || (cobId & 0x20000000UL) != 0
+        || (cobId & 0x7FF) == 0
+    ) {
+        /* PDO doesn't exist, is not valid or uses 29-bit COB-ID */
+        return CO_ERROR_NO;
+    }
+    snprintf(section, sizeof(section), "%Xsub0", 0x1A00 + pdo);
+    if (!edsValue(eds, section, nodeId, &count) || count > 64) {
+        return CO_ERROR_NO;
+    }
+    /* each COB-ID may be produced by one PDO only, so decode plan never has
+     * more than 64 steps */
+    for (uint32_t i = 0; i < dec->signalCount; i++) {
+        if (dec->signals[i].cobId == (cobId & 0x7FF)) {
+            return CO_ERROR_OD_PARAMETERS;
+        }
+    }
+
+    for (uint32_t i = 1; i <= count; i++) {
+        uint32_t map, dataType;
+        uint16_t index;
+        uint8_t subIndex, length;
+        const char *name, *dt;
+        CO_PDOsignal_t *sig;
+
+        snprintf(section, sizeof(section), "%Xsub%X", 0x1A00 + pdo, i);
+        if (!edsValue(eds, section, nodeId, &map)) {
+            return CO_ERROR_OD_PARAMETERS;
+        }
+        index = (uint16_t)(map >> 16);
+        subIndex = (uint8_t)(map >> 8);
+        length = (uint8_t)map;
+        if (bitOffset + length > 64 || length == 0) {
+            return CO_ERROR_OD_PARAMETERS;
+        }
+        if (index < 0x20) {
+            /* dummy mapping */
+            bitOffset += length;
+            continue;
+        }
+
+        /* mapped object is a sub-object or a variable */
+        snprintf(section, sizeof(section), "%Xsub%X", index, subIndex);
+        if (!edsHasSection(eds, section)) {
+            if (subIndex != 0) {
+                return CO_ERROR_OD_PARAMETERS;
+            }
+            snprintf(section, sizeof(section), "%X", index);
+        }
+        name = edsGet(eds, section, "ParameterName");
+        dt = edsGet(eds, section, "DataType");
+        if (dt == NULL) {
+            return CO_ERROR_OD_PARAMETERS;
+        }
+        dataType = (uint32_t)strtoul(dt, NULL, 0);
+
+        if ((dec->signalCount & 63) == 0) {
+            CO_PDOsignal_t *s = realloc(dec->signals, (dec->signalCount + 64)
+                                                      * sizeof(*s));
+            if (s == NULL) {
+                return CO_ERROR_OUT_OF_MEMORY;
+            }
+            dec->signals = s;
+        }
+        sig = &dec->signals[dec->signalCount];
+        memset(sig, 0, sizeof(*sig));
+        snprintf(sig->name, sizeof(sig->name), "%s", name != NULL ? name : "");
+        sig->nodeId = nodeId;
+        sig->index = index;
+        sig->subIndex = subIndex;
+        sig->dataType = (uint16_t)dataType;
+        sig->cobId = (uint16_t)(cobId & 0x7FF);
+        sig->bitOffset = (uint8_t)bitOffset;
+        sig->bitLength = length;
+        sig->scale = 1.0;
+        sig->offset = 0.0;
+        if (dataType == DT_REAL32 && length == 32) {
+            sig->type = CO_PDO_SIGNAL_REAL32;
+        }
+        else if (dataType == DT_REAL64 && length == 64) {
+            sig->type = CO_PDO_SIGNAL_REAL64;
+        }
+        else if ((dataType >= DT_INTEGER8 && dataType <= DT_INTEGER32)
+                 || dataType == DT_INTEGER24
+                 || (dataType >= DT_INTEGER40 && dataType <= DT_INTEGER64)
+        ) {
+            sig->type = CO_PDO_SIGNAL_SIGNED;
+        }
+        else {
+            /* BOOLEAN, UNSIGNEDxx and other types as raw bits */
+            sig->type = CO_PDO_SIGNAL_UNSIGNED;
+        }
+        dec->signalCount++;
+        dec->compiled = false;
+        bitOffset += length;
+    }
+
+    return CO_ERROR_NO;
+}
+
+
+/******************************************************************************/
+CO_ReturnError_t CO_PDOdecoder_init(CO_PDOdecoder_t *dec) {
+    if (dec == NULL) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+    memset(dec, 0, sizeof(*dec));
+    return CO_ERROR_NO;
+}
+
+
+/******************************************************************************/
+void CO_PDOdecoder_close(CO_PDOdecoder_t *dec) {
+    if (dec == NULL) {
+        return;
+    }
+    free(dec->signals);
+    free(dec->steps);
+    memset(dec, 0, sizeof(*dec));
+}
+
+
+/******************************************************************************/
+CO_ReturnError_t CO_PDOdecoder_loadEDS(CO_PDOdecoder_t *dec,
+                                       const char *filename,
+                                       uint8_t nodeId)
+{
+    eds_t eds;
+    CO_ReturnError_t err;
+    uint32_t signalCount;
+
+    if (dec == NULL || filename == NULL || nodeId < 1 || nodeId > 127) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    signalCount = dec->signalCount;
+    err = edsRead(&eds, filename);
+    for (uint16_t pdo = 0; err == CO_ERROR_NO && pdo < 512; pdo++) {
+        err = addPDO(dec, &eds, nodeId, pdo);
+    }
+    edsFree(&eds);
+
+    /* file is loaded completely or not at all */
+    if (err != CO_ERROR_NO && dec->signalCount != signalCount) {
+        dec->signalCount = signalCount;
+        dec->compiled = false;
+    }
+
+    return err;
+}
+
+
+/******************************************************************************/
+CO_ReturnError_t CO_PDOdecoder_setScale(CO_PDOdecoder_t *dec,
+                                        uint8_t nodeId,
+                                        uint16_t index,
+                                        uint8_t subIndex,
+                                        double scale,
+                                        double offset)
+{
+    CO_ReturnError_t err = CO_ERROR_ILLEGAL_ARGUMENT;
+
+    if (dec == NULL) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    /* object may be mapped into more PDOs */
+    for (uint32_t i = 0; i < dec->signalCount; i++) {
+        CO_PDOsignal_t *sig = &dec->signals[i];
+
+        if (sig->nodeId == nodeId && sig->index == index
+            && sig->subIndex == subIndex
+        ) {
+            sig->scale = scale;
+            sig->offset = offset;
+            dec->compiled = false;
+            err = CO_ERROR_NO;
+        }
+    }
+
+    return err;
+}
+
+
+/******************************************************************************/
+CO_ReturnError_t CO_PDOdecoder_compile(CO_PDOdecoder_t *dec) {
+    CO_PDOdecodeStep_t *steps;
+    uint32_t pos = 0;
+
+    if (dec == NULL) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    steps = realloc(dec->steps, (dec->signalCount > 0 ? dec->signalCount : 1)
+                                * sizeof(*steps));
+    if (steps == NULL) {
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+    dec->steps = steps;
+    memset(dec->plans, 0, sizeof(dec->plans));
+
+    /* count signals per COB-ID, then place steps of each COB-ID together,
+     * in order of loading */
+    for (uint32_t i = 0; i < dec->signalCount; i++) {
+        CO_PDOdecodePlan_t *plan = &dec->plans[dec->signals[i].cobId];
+
+        /* all samples of one frame must fit into the batch */
+        if (plan->count >= CO_PDO_DECODER_BATCH) {
+            memset(dec->plans, 0, sizeof(dec->plans));
+            dec->compiled = false;
+            return CO_ERROR_OD_PARAMETERS;
+        }
+        plan->count++;
+    }
+    for (uint32_t cobId = 0; cobId < CO_CAN_MSG_SFF_MAX_COB_ID; cobId++) {
+        dec->plans[cobId].first = pos;
+        pos += dec->plans[cobId].count;
+        dec->plans[cobId].count = 0;
+    }
+    for (uint32_t i = 0; i < dec->signalCount; i++) {
+        const CO_PDOsignal_t *sig = &dec->signals[i];
+        CO_PDOdecodePlan_t *plan = &dec->plans[sig->cobId];
+        CO_PDOdecodeStep_t *step = &steps[plan->first + plan->count];
+        uint8_t end = (uint8_t)((sig->bitOffset + sig->bitLength + 7) / 8);
+
+        step->signal = i;
+        step->shift = sig->bitOffset;
+        step->mask = sig->bitLength >= 64
+                   ? UINT64_MAX : ((uint64_t)1 << sig->bitLength) - 1;
+        step->signShift = (uint8_t)(64 - sig->bitLength);
+        step->type = (uint8_t)sig->type;
+        step->scale = sig->scale;
+        step->offset = sig->offset;
+        plan->count++;
+        if (end > plan->length) {
+            plan->length = end;
+        }
+    }
+    dec->compiled = true;
+
+    return CO_ERROR_NO;
+}
+
+
+/******************************************************************************/
+CO_ReturnError_t CO_PDOdecoder_subscribe(CO_PDOdecoder_t *dec,
+                                         CO_PDOdecoder_subscriber_t subscriber,
+                                         void *object)
+{
+    if (dec == NULL || subscriber == NULL) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+    if (dec->subscriberCount >= CO_PDO_DECODER_SUBSCRIBERS) {
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+    dec->subscriber[dec->subscriberCount] = subscriber;
+    dec->subscriberObject[dec->subscriberCount] = object;
+    dec->subscriberCount++;
+
+    return CO_ERROR_NO;
+}
+
+
+/******************************************************************************/
+const CO_PDOsignal_t *CO_PDOdecoder_getSignal(CO_PDOdecoder_t *dec,
+                                              uint32_t signal)
+{
+    if (dec == NULL || signal >= dec->signalCount) {
+        return NULL;
+    }
+    return &dec->signals[signal];
+}
+
+
+/* Pass collected samples to subscribers **************************************/
+static void publish(CO_PDOdecoder_t *dec) {
+    for (uint32_t i = 0; i < dec->subscriberCount; i++) {
+        dec->subscriber[i](dec->subscriberObject[i], dec->samples,
+                           dec->sampleCount);
+    }
+    dec->sampleCount = 0;
+}
+
+
+/******************************************************************************/
+size_t CO_PDOdecoder_decode(CO_PDOdecoder_t *dec,
+                            const struct can_frame *frames,
+                            const struct timespec *timestamps,
+                            size_t count)
+{
+    size_t decoded = 0;
+
+    if (dec == NULL || frames == NULL || !dec->compiled) {
+        return 0;
+    }
+
+    for (size_t f = 0; f < count; f++) {
+        const struct can_frame *frame = &frames[f];
+        const CO_PDOdecodePlan_t *plan;
+        const CO_PDOdecodeStep_t *step;
+        uint64_t data;
+
+        if ((frame->can_id & (CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_ERR_FLAG))
+            != 0
+        ) {
+            continue;
+        }
+        plan = &dec->plans[frame->can_id & CAN_SFF_MASK];
+        if (plan->count == 0) {
+            continue;
+        }
+        if (frame->can_dlc < plan->length) {
+            dec->lengthErrors++;
+            continue;
+        }
+        if (dec->sampleCount + plan->count > CO_PDO_DECODER_BATCH) {
+            publish(dec);
+        }
+
+        /* PDO data is little endian, all signals are extracted from one
+         * 64-bit word */
+        memcpy(&data, frame->data, sizeof(data));
+        data = le64toh(data);
+        step = &dec->steps[plan->first];
+        for (uint16_t i = 0; i < plan->count; i++, step++) {
+            CO_PDOsample_t *sample = &dec->samples[dec->sampleCount++];
+            uint64_t raw = (data >> step->shift) & step->mask;
+            double value;
+
+            switch (step->type) {
+                case CO_PDO_SIGNAL_SIGNED:
+                    value = (double)((int64_t)(raw << step->signShift)
+                                     >> step->signShift);
+                    break;
+                case CO_PDO_SIGNAL_REAL32: {
+                    uint32_t r32 = (uint32_t)raw;
+                    float f32;
+                    memcpy(&f32, &r32, sizeof(f32));
+                    value = f32;
+                    break;
+                }
+                case CO_PDO_SIGNAL_REAL64:
+                    memcpy(&value, &raw, sizeof(value));
+                    break;
+                default:
+                    value = (double)raw;
+                    break;
+            }
+            sample->signal = step->signal;
+            sample->value = value * step->scale + step->offset;
+            if (timestamps != NULL) {
+                sample->timestamp = timestamps[f];
+            }
+            else {
+                sample->timestamp.tv_sec = 0;
+                sample->timestamp.tv_nsec = 0;
+            }
+        }
+        decoded += plan->count;
+        dec->frameCount++;
+    }
+    if (dec->sampleCount > 0) {
+        publish(dec);
+    }
+    dec->decodedCount += decoded;
+
+    return decoded;
+}
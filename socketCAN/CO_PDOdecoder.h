@@ -0,0 +1,302 @@
+/**
+ * Decoding of PDO signals of remote nodes, configured from EDS or DCF files.
+ *
+ * @file        CO_PDOdecoder.h
+ * @ingroup     CO_socketCAN_PDOdecoder
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CO_PDO_DECODER_H
+#define CO_PDO_DECODER_H
+
+#include "301/CO_driver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup CO_socketCAN_PDOdecoder PDO decoder
+ * @ingroup CO_socketCAN
+ * @{
+ *
+ * Decoding of PDO signals of remote nodes into physical values.
+ *
+ * Decoder reads mapping of the transmit PDOs (objects 0x1800 to 0x19FF and
+ * 0x1A00 to 0x1BFF) from the EDS or DCF file of each remote node, see
+ * CO_PDOdecoder_loadEDS(). For DCF files ParameterValue is used, otherwise
+ * DefaultValue, "$NODEID" is replaced with the node-ID. For each mapped object
+ * signal is created with name (ParameterName), index, subindex, data type,
+ * position in the PDO and scale (1 by default, see CO_PDOdecoder_setScale()).
+ * Dummy mapping entries only advance the position.
+ *
+ * CO_PDOdecoder_compile() then builds decode plan for each 11-bit COB-ID:
+ * consecutive signals with precomputed shift, mask and sign extension. Plans
+ * are looked up by table indexed with COB-ID, so decoding of a frame has no
+ * search and no string operation.
+ *
+ * CO_PDOdecoder_decode() processes a batch of frames, for example frames from
+ * recvmmsg(), from @ref CO_socketCAN_CANcapture ring or from a candump log.
+ * Frames with unknown COB-ID are skipped, frames shorter than the mapped
+ * length are counted as length errors. Decoded samples are collected into an
+ * array and passed to all subscribers (gateway, shared memory, logger) with
+ * one call per up to @ref CO_PDO_DECODER_BATCH samples.
+ *
+ * Decoder is not thread safe, one thread loads, compiles and decodes.
+ * Subscribers are called from that thread.
+ */
+
+/** Maximum number of samples passed to subscribers at once. */
+#ifndef CO_PDO_DECODER_BATCH
+#define CO_PDO_DECODER_BATCH 256
+#endif
+
+/** Maximum number of subscribers. */
+#ifndef CO_PDO_DECODER_SUBSCRIBERS
+#define CO_PDO_DECODER_SUBSCRIBERS 8
+#endif
+
+/** Maximum length of the signal name, including terminating zero. */
+#ifndef CO_PDO_DECODER_NAME_LEN
+#define CO_PDO_DECODER_NAME_LEN 64
+#endif
+
+/**
+ * Encoding of the signal in the PDO
+ */
+typedef enum {
+    CO_PDO_SIGNAL_UNSIGNED, /**< BOOLEAN, UNSIGNEDxx */
+    CO_PDO_SIGNAL_SIGNED,   /**< INTEGERxx */
+    CO_PDO_SIGNAL_REAL32,   /**< REAL32 */
+    CO_PDO_SIGNAL_REAL64    /**< REAL64 */
+} CO_PDOsignalType_t;
+
+/**
+ * Signal, one mapped object of the PDO
+ */
+typedef struct {
+    /** ParameterName from EDS */
+    char name[CO_PDO_DECODER_NAME_LEN];
+    /** Node-ID of the producer */
+    uint8_t nodeId;
+    /** Mapped object */
+    uint16_t index;
+    uint8_t subIndex;
+    /** DataType from EDS */
+    uint16_t dataType;
+    /** COB-ID of the PDO */
+    uint16_t cobId;
+    /** Position and length in the PDO in bits */
+    uint8_t bitOffset;
+    uint8_t bitLength;
+    /** Encoding */
+    CO_PDOsignalType_t type;
+    /** Physical value is raw value * scale + offset */
+    double scale;
+    double offset;
+} CO_PDOsignal_t;
+
+/**
+ * Decoded sample
+ */
+typedef struct {
+    /** Index of the signal, see CO_PDOdecoder_getSignal() */
+    uint32_t signal;
+    /** Physical value */
+    double value;
+    /** Reception time of the frame */
+    struct timespec timestamp;
+} CO_PDOsample_t;
+
+/**
+ * Subscriber callback
+ *
+ * @param object Object from CO_PDOdecoder_subscribe().
+ * @param samples Decoded samples, valid only during the call.
+ * @param count Number of samples.
+ */
+typedef void (*CO_PDOdecoder_subscriber_t)(void *object,
+                                           const CO_PDOsample_t *samples,
+                                           size_t count);
+
+/**
+ * Decode step, one signal of the plan
+ */
+typedef struct {
+    uint64_t mask;          /**< mask of the raw value after shift */
+    uint32_t signal;        /**< index of the signal */
+    uint8_t shift;          /**< bit offset */
+    uint8_t signShift;      /**< 64 - bit length for signed values */
+    uint8_t type;           /**< CO_PDOsignalType_t */
+    double scale;
+    double offset;
+} CO_PDOdecodeStep_t;
+
+/**
+ * Decode plan of one COB-ID
+ */
+typedef struct {
+    uint32_t first;         /**< index of the first step */
+    uint16_t count;         /**< number of steps, 0 if COB-ID is not known */
+    uint8_t length;         /**< minimum length of the frame in bytes */
+} CO_PDOdecodePlan_t;
+
+/**
+ * PDO decoder object
+ */
+typedef struct {
+    /** Signals, from CO_PDOdecoder_loadEDS() */
+    CO_PDOsignal_t *signals;
+    uint32_t signalCount;
+    /** Decode plans, from CO_PDOdecoder_compile() */
+    CO_PDOdecodeStep_t *steps;
+    CO_PDOdecodePlan_t plans[CO_CAN_MSG_SFF_MAX_COB_ID];
+    bool_t compiled;
+    /** Subscribers */
+    CO_PDOdecoder_subscriber_t subscriber[CO_PDO_DECODER_SUBSCRIBERS];
+    void *subscriberObject[CO_PDO_DECODER_SUBSCRIBERS];
+    uint32_t subscriberCount;
+    /** Samples, not yet passed to subscribers */
+    CO_PDOsample_t samples[CO_PDO_DECODER_BATCH];
+    uint32_t sampleCount;
+    /** Statistics: decoded frames and samples, frames with wrong length */
+    uint64_t frameCount;
+    uint64_t decodedCount;
+    uint32_t lengthErrors;
+} CO_PDOdecoder_t;
+
+
+/**
+ * Initialize decoder
+ *
+ * @param dec This object will be initialized.
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO or CO_ERROR_ILLEGAL_ARGUMENT.
+ */
+CO_ReturnError_t CO_PDOdecoder_init(CO_PDOdecoder_t *dec);
+
+/**
+ * Release memory of the decoder
+ *
+ * @param dec This object.
+ */
+void CO_PDOdecoder_close(CO_PDOdecoder_t *dec);
+
+/**
+ * Add signals from transmit PDOs of the remote node
+ *
+ * PDOs with invalid COB-ID (bit 31) or 29-bit COB-ID are skipped. COB-ID
+ * may be used by one PDO only, also among different nodes. If loading fails,
+ * no signal from the file is added. Decoder must be compiled again after this
+ * function.
+ *
+ * @param dec This object.
+ * @param filename EDS or DCF file of the node.
+ * @param nodeId Node-ID of the node, used for "$NODEID".
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT,
+ * CO_ERROR_SYSCALL, CO_ERROR_OUT_OF_MEMORY or CO_ERROR_OD_PARAMETERS, if
+ * mapping exceeds 64 bits, mapped object is not found or COB-ID is already
+ * used by other PDO.
+ */
+CO_ReturnError_t CO_PDOdecoder_loadEDS(CO_PDOdecoder_t *dec,
+                                       const char *filename,
+                                       uint8_t nodeId);
+
+/**
+ * Set scale of the signals of the mapped object
+ *
+ * Decoder must be compiled again after this function.
+ *
+ * @param dec This object.
+ * @param nodeId Node-ID of the producer.
+ * @param index Index of the mapped object.
+ * @param subIndex Subindex of the mapped object.
+ * @param scale Physical value is raw value * scale + offset.
+ * @param offset See above.
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO or CO_ERROR_ILLEGAL_ARGUMENT, if
+ * signal is not found.
+ */
+CO_ReturnError_t CO_PDOdecoder_setScale(CO_PDOdecoder_t *dec,
+                                        uint8_t nodeId,
+                                        uint16_t index,
+                                        uint8_t subIndex,
+                                        double scale,
+                                        double offset);
+
+/**
+ * Build decode plans from signals
+ *
+ * @param dec This object.
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT,
+ * CO_ERROR_OUT_OF_MEMORY or CO_ERROR_OD_PARAMETERS, if one COB-ID has more
+ * than @ref CO_PDO_DECODER_BATCH signals.
+ */
+CO_ReturnError_t CO_PDOdecoder_compile(CO_PDOdecoder_t *dec);
+
+/**
+ * Add subscriber for decoded samples
+ *
+ * @param dec This object.
+ * @param subscriber Callback.
+ * @param object Passed to callback.
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT or
+ * CO_ERROR_OUT_OF_MEMORY, if there are too many subscribers.
+ */
+CO_ReturnError_t CO_PDOdecoder_subscribe(CO_PDOdecoder_t *dec,
+                                         CO_PDOdecoder_subscriber_t subscriber,
+                                         void *object);
+
+/**
+ * Get signal information
+ *
+ * @param dec This object.
+ * @param signal Index of the signal, from CO_PDOsample_t.
+ *
+ * @return Signal or NULL, if index is out of range.
+ */
+const CO_PDOsignal_t *CO_PDOdecoder_getSignal(CO_PDOdecoder_t *dec,
+                                              uint32_t signal);
+
+/**
+ * Decode batch of frames and pass samples to subscribers
+ *
+ * @param dec This object, compiled.
+ * @param frames Received frames.
+ * @param timestamps Reception time of each frame or NULL.
+ * @param count Number of frames.
+ *
+ * @return Number of decoded samples.
+ */
+size_t CO_PDOdecoder_decode(CO_PDOdecoder_t *dec,
+                            const struct can_frame *frames,
+                            const struct timespec *timestamps,
+                            size_t count);
+
+/** @} */ /* CO_socketCAN_PDOdecoder */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* CO_PDO_DECODER_H */
@@ -0,0 +1,589 @@
+/*
+ * Streaming of SDO download into a file with write-behind and atomic commit.
+ *
+ * @file        CO_domainSink.c
+ * @ingroup     CO_socketCAN_domainSink
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <syslog.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "CO_domainSink.h"
+
+#ifndef CO_SINGLE_THREAD
+
+#include "CO_error.h"
+
+
+static uint64_t timeUs(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static char *strcatDup(const char *s1, const char *s2) {
+    char *s = malloc(strlen(s1) + strlen(s2) + 1);
+
+    if (s != NULL) {
+        strcpy(s, s1);
+        strcat(s, s2);
+    }
+    return s;
+}
+
+/* write complete buffer, retry on partial write or signal */
+static bool_t writeAll(int fd, const void *buf, size_t len) {
+    const uint8_t *b = (const uint8_t *)buf;
+
+    while (len > 0) {
+        ssize_t n = write(fd, b, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        b += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/* sync directory of the file, so rename is durable */
+static void syncDir(const char *filename) {
+    char *dir = strcatDup(filename, "");
+    char *slash;
+    int fd;
+
+    if (dir == NULL) return;
+    slash = strrchr(dir, '/');
+    if (slash == NULL) {
+        strcpy(dir, ".");
+    }
+    else {
+        slash[slash == dir ? 1 : 0] = 0;
+    }
+    fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        (void)fsync(fd);
+        close(fd);
+    }
+    free(dir);
+}
+
+/* close and remove temporary file, background thread */
+static void discardTmp(CO_domainSink_t *sink) {
+    if (sink->fd >= 0) {
+        close(sink->fd);
+        sink->fd = -1;
+    }
+    (void)unlink(sink->filenameTmp);
+}
+
+
+/* true, if transfer was aborted meanwhile, background thread */
+static bool_t isCancelled(CO_domainSink_t *sink) {
+    bool_t cancelled;
+
+    pthread_mutex_lock(&sink->mtx);
+    cancelled = sink->cancelRequest;
+    pthread_mutex_unlock(&sink->mtx);
+    return cancelled;
+}
+
+
+/* Sync, validate and rename temporary file, background thread ***************/
+static ODR_t commit(CO_domainSink_t *sink, bool_t ok, uint32_t size,
+                    bool_t *rejected)
+{
+    ODR_t odRet;
+
+    *rejected = false;
+    if (ok && fsync(sink->fd) != 0) {
+        ok = false;
+    }
+    if (close(sink->fd) != 0) {
+        ok = false;
+    }
+    sink->fd = -1;
+    if (!ok) {
+        log_printf(LOG_ERR, DBG_DOMAIN_SINK, sink->filenameTmp, "write failed");
+        (void)unlink(sink->filenameTmp);
+        return ODR_HW;
+    }
+
+    if (isCancelled(sink)) {
+        (void)unlink(sink->filenameTmp);
+        return ODR_DATA_DEV_STATE;
+    }
+
+    if (sink->validate != NULL) {
+        odRet = sink->validate(sink->validateObject, sink->filenameTmp, size);
+        if (odRet != ODR_OK) {
+            log_printf(LOG_NOTICE, DBG_DOMAIN_SINK, sink->filename,
+                       "validation failed, transfer discarded");
+            (void)unlink(sink->filenameTmp);
+            *rejected = true;
+            return odRet;
+        }
+    }
+
+    /* last point, where aborted transfer leaves the target file unchanged */
+    if (isCancelled(sink)) {
+        (void)unlink(sink->filenameTmp);
+        return ODR_DATA_DEV_STATE;
+    }
+    if (rename(sink->filenameTmp, sink->filename) != 0) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "rename(domainSink)");
+        (void)unlink(sink->filenameTmp);
+        return ODR_HW;
+    }
+    syncDir(sink->filename);
+
+    return ODR_OK;
+}
+
+
+/* Background thread, drains the ring into temporary file *********************/
+static void *sinkThread(void *arg) {
+    CO_domainSink_t *sink = (CO_domainSink_t *)arg;
+
+    pthread_mutex_lock(&sink->mtx);
+    for (;;) {
+        while (!sink->startRequest && sink->fill == 0
+               && !sink->commitRequest && !sink->cancelRequest && !sink->stop
+        ) {
+            pthread_cond_wait(&sink->cond, &sink->mtx);
+        }
+
+        if (sink->cancelRequest) {
+            /* transfer aborted, drop the data and the temporary file */
+            sink->cancelRequest = false;
+            sink->commitRequest = false;
+            sink->head = sink->tail = sink->fill = 0;
+            sink->busy = true;
+            pthread_mutex_unlock(&sink->mtx);
+
+            discardTmp(sink);
+
+            pthread_mutex_lock(&sink->mtx);
+        }
+        else if (sink->startRequest) {
+            int fd;
+
+            sink->startRequest = false;
+            sink->busy = true;
+            pthread_mutex_unlock(&sink->mtx);
+
+            discardTmp(sink);
+            fd = open(sink->filenameTmp,
+                      O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                log_printf(LOG_DEBUG, DBG_ERRNO, "open(domainSink)");
+            }
+
+            pthread_mutex_lock(&sink->mtx);
+            sink->fd = fd;
+            if (fd < 0) sink->ioError = true;
+        }
+        else if (sink->fill > 0) {
+            /* contiguous part of the ring, producer writes only after it */
+            size_t len = sink->ringSize - sink->tail;
+            const uint8_t *data = &sink->ring[sink->tail];
+            bool_t ok = !sink->ioError;
+
+            if (len > sink->fill) len = sink->fill;
+            sink->busy = true;
+            pthread_mutex_unlock(&sink->mtx);
+
+            if (ok) ok = writeAll(sink->fd, data, len);
+
+            pthread_mutex_lock(&sink->mtx);
+            if (!ok) sink->ioError = true;
+            sink->tail = (sink->tail + len) % sink->ringSize;
+            sink->fill -= len;
+        }
+        else if (sink->commitRequest) {
+            bool_t ok = !sink->ioError;
+            uint32_t size = sink->size;
+            bool_t rejected;
+            ODR_t odRet;
+
+            sink->busy = true;
+            pthread_mutex_unlock(&sink->mtx);
+
+            odRet = commit(sink, ok, size, &rejected);
+
+            pthread_mutex_lock(&sink->mtx);
+            if (odRet == ODR_OK) sink->stats.commitCount++;
+            else if (sink->cancelRequest) { /* counted as abort */ }
+            else if (rejected) sink->stats.rejectCount++;
+            else sink->stats.errorCount++;
+            sink->commitResult = odRet;
+            sink->commitRequest = false;
+        }
+        else {
+            break; /* stop */
+        }
+        sink->busy = false;
+        pthread_cond_broadcast(&sink->condIdle);
+    }
+    pthread_mutex_unlock(&sink->mtx);
+
+    return NULL;
+}
+
+
+/* OD IO extension ************************************************************/
+static OD_size_t OD_read_domainSink(OD_stream_t *stream, uint8_t subIndex,
+                                    void *buf, OD_size_t count,
+                                    ODR_t *returnCode)
+{
+    if (stream == NULL || buf == NULL || returnCode == NULL) {
+        if (returnCode != NULL) *returnCode = ODR_DEV_INCOMPAT;
+        return 0;
+    }
+
+    CO_domainSink_t *sink = (CO_domainSink_t *)stream->object;
+    struct stat st;
+    OD_size_t remaining, len;
+    ssize_t n;
+    int fd;
+
+    (void)subIndex;
+
+    /* committed file, nothing is uploaded if it doesn't exist yet */
+    fd = open(sink->filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        stream->dataOffset = 0;
+        *returnCode = (errno == ENOENT) ? ODR_OK : ODR_HW;
+        return 0;
+    }
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size > (OD_size_t)-1) {
+        close(fd);
+        *returnCode = ODR_HW;
+        return 0;
+    }
+
+    remaining = (OD_size_t)st.st_size > stream->dataOffset
+              ? (OD_size_t)st.st_size - stream->dataOffset : 0;
+    len = remaining < count ? remaining : count;
+    do {
+        n = pread(fd, buf, len, (off_t)stream->dataOffset);
+    } while (n < 0 && errno == EINTR);
+    close(fd);
+    if (n != (ssize_t)len) {
+        stream->dataOffset = 0;
+        *returnCode = ODR_HW;
+        return 0;
+    }
+
+    if (len < remaining) {
+        stream->dataOffset += len;
+        *returnCode = ODR_PARTIAL;
+    }
+    else {
+        stream->dataOffset = 0;
+        *returnCode = ODR_OK;
+    }
+    return len;
+}
+
+static OD_size_t OD_write_domainSink(OD_stream_t *stream, uint8_t subIndex,
+                                     const void *buf, OD_size_t count,
+                                     ODR_t *returnCode)
+{
+    if (stream == NULL || (buf == NULL && count > 0) || returnCode == NULL) {
+        if (returnCode != NULL) *returnCode = ODR_DEV_INCOMPAT;
+        return 0;
+    }
+
+    CO_domainSink_t *sink = (CO_domainSink_t *)stream->object;
+    const uint8_t *data = (const uint8_t *)buf;
+    OD_size_t left = count;
+    ODR_t odRet;
+    CO_domainSink_stats_t stats;
+
+    (void)subIndex;
+
+    /* SDO server aborted the transfer, see OD_IO_t */
+    if (buf == NULL) {
+        pthread_mutex_lock(&sink->mtx);
+        if (sink->active) {
+            sink->stats.abortCount++;
+            sink->active = false;
+            sink->commitPending = false;
+            sink->cancelRequest = true;
+            pthread_cond_signal(&sink->cond);
+        }
+        pthread_mutex_unlock(&sink->mtx);
+        stream->dataOffset = 0;
+        *returnCode = ODR_OK;
+        return 0;
+    }
+
+    /* SDO server indicates the size with the last data at the latest, after
+     * it has verified the transfer size and CRC */
+    if (stream->dataLength > 0 && stream->dataOffset + count > stream->dataLength) {
+        *returnCode = ODR_DATA_LONG;
+        return 0;
+    }
+
+    pthread_mutex_lock(&sink->mtx);
+
+    /* SDO server polls the commit, requested by the last data */
+    if (sink->commitPending && stream->dataOffset > 0) {
+        if (sink->commitRequest) {
+            pthread_mutex_unlock(&sink->mtx);
+            *returnCode = ODR_PARTIAL;
+            return 0;
+        }
+        sink->commitPending = false;
+        sink->active = false;
+        odRet = sink->commitResult;
+        if (odRet == ODR_OK) {
+            uint64_t now = timeUs();
+            sink->stats.lastBytes = sink->size;
+            sink->stats.lastTransfer_us = (uint32_t)(now - sink->start_us);
+            sink->stats.lastCommit_us = (uint32_t)(now - sink->commit_us);
+            sink->stats.lastWait_us = (uint32_t)sink->wait_us;
+            sink->stats.totalBytes += sink->size;
+        }
+        stats = sink->stats;
+        pthread_mutex_unlock(&sink->mtx);
+
+        stream->dataOffset = 0;
+        *returnCode = odRet;
+        if (odRet == ODR_OK) {
+            log_printf(LOG_INFO, DBG_DOMAIN_SINK_COMMIT, sink->filename,
+                       stats.lastBytes, stats.lastTransfer_us,
+                       stats.lastCommit_us, stats.lastWait_us);
+        }
+        return 0;
+    }
+
+    if (stream->dataOffset == 0) {
+        /* New transfer. Background thread may still work on the previous
+         * one, SDO server calls again later. */
+        if (sink->busy || sink->commitRequest || sink->cancelRequest) {
+            pthread_mutex_unlock(&sink->mtx);
+            *returnCode = ODR_PARTIAL;
+            return 0;
+        }
+        /* discard unfinished transfer */
+        if (sink->active && !sink->commitPending) sink->stats.abortCount++;
+        sink->commitPending = false;
+        sink->head = sink->tail = sink->fill = 0;
+        sink->ioError = false;
+        sink->size = 0;
+        sink->active = true;
+        sink->startRequest = true;
+        sink->start_us = timeUs();
+        sink->wait_us = 0;
+        sink->waitStart_us = 0;
+        pthread_cond_signal(&sink->cond);
+    }
+    else if (!sink->active || sink->commitPending) {
+        pthread_mutex_unlock(&sink->mtx);
+        *returnCode = ODR_DATA_DEV_STATE;
+        return 0;
+    }
+
+    /* abort early on file error and remove temporary file */
+    if (sink->ioError) {
+        sink->active = false;
+        sink->stats.errorCount++;
+        sink->cancelRequest = true;
+        pthread_cond_signal(&sink->cond);
+        pthread_mutex_unlock(&sink->mtx);
+        *returnCode = ODR_HW;
+        return 0;
+    }
+
+    /* time, SDO server waited since the ring was full */
+    if (sink->waitStart_us != 0) {
+        uint64_t now = timeUs();
+        sink->wait_us += now - sink->waitStart_us;
+        sink->waitStart_us = 0;
+    }
+
+    /* copy into the ring as much as fits */
+    while (left > 0 && sink->fill < sink->ringSize) {
+        size_t len = sink->ringSize - sink->fill;
+
+        if (len > sink->ringSize - sink->head) len = sink->ringSize - sink->head;
+        if (len > left) len = left;
+        memcpy(&sink->ring[sink->head], data, len);
+        sink->head = (sink->head + len) % sink->ringSize;
+        sink->fill += len;
+        data += len;
+        left -= (OD_size_t)len;
+    }
+    if (left < count) {
+        pthread_cond_signal(&sink->cond);
+    }
+    sink->size += count - left;
+    stream->dataOffset += count - left;
+
+    if (left > 0) {
+        /* ring is full, SDO server passes the rest later */
+        sink->waitStart_us = timeUs();
+        pthread_mutex_unlock(&sink->mtx);
+        *returnCode = ODR_PARTIAL;
+        return count - left;
+    }
+
+    if (stream->dataLength == 0 || stream->dataOffset < stream->dataLength) {
+        pthread_mutex_unlock(&sink->mtx);
+        *returnCode = ODR_PARTIAL;
+        return count;
+    }
+
+    /* last data, transfer is verified by SDO server, request commit. Commit
+     * is pending, until SDO server polls it with dataOffset at dataLength. */
+    sink->commit_us = timeUs();
+    sink->commitRequest = true;
+    sink->commitPending = true;
+    pthread_cond_signal(&sink->cond);
+    pthread_mutex_unlock(&sink->mtx);
+
+    *returnCode = ODR_PARTIAL;
+    return count;
+}
+
+
+/******************************************************************************/
+static void freeAll(CO_domainSink_t *sink) {
+    free(sink->filename);
+    free(sink->filenameTmp);
+    free(sink->ring);
+    sink->filename = sink->filenameTmp = NULL;
+    sink->ring = NULL;
+}
+
+
+/******************************************************************************/
+CO_ReturnError_t CO_domainSink_init(CO_domainSink_t *sink,
+                                    CO_CANmodule_t *CANmodule,
+                                    const OD_entry_t *OD_domain,
+                                    const char *filename,
+                                    size_t ringSize,
+                                    CO_domainSink_validate_t validate,
+                                    void *validateObject)
+{
+    if (sink == NULL || OD_domain == NULL || filename == NULL
+        || ringSize == 0
+    ) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    memset(sink, 0, sizeof(CO_domainSink_t));
+    sink->CANmodule = CANmodule;
+    sink->validate = validate;
+    sink->validateObject = validateObject;
+    sink->ringSize = ringSize;
+    sink->fd = -1;
+
+    sink->filename = strcatDup(filename, "");
+    sink->filenameTmp = strcatDup(filename, ".tmp");
+    sink->ring = malloc(ringSize);
+    if (sink->filename == NULL || sink->filenameTmp == NULL
+        || sink->ring == NULL
+    ) {
+        freeAll(sink);
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+
+    /* leftover of a transfer, interrupted by program exit */
+    (void)unlink(sink->filenameTmp);
+
+    if (pthread_mutex_init(&sink->mtx, NULL) != 0
+        || pthread_cond_init(&sink->cond, NULL) != 0
+        || pthread_cond_init(&sink->condIdle, NULL) != 0
+    ) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "pthread_mutex_init(domainSink)");
+        freeAll(sink);
+        return CO_ERROR_SYSCALL;
+    }
+    if (pthread_create(&sink->thread, NULL, sinkThread, sink) != 0) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "pthread_create(domainSink)");
+        freeAll(sink);
+        return CO_ERROR_SYSCALL;
+    }
+    sink->threadStarted = true;
+
+    if (OD_extensionIO_init(OD_domain, sink, OD_read_domainSink,
+                            OD_write_domainSink) != ODR_OK
+    ) {
+        CO_domainSink_close(sink);
+        return CO_ERROR_OD_PARAMETERS;
+    }
+
+    return CO_ERROR_NO;
+}
+
+
+/******************************************************************************/
+void CO_domainSink_getStats(CO_domainSink_t *sink,
+                            CO_domainSink_stats_t *stats)
+{
+    if (sink == NULL || stats == NULL || !sink->threadStarted) {
+        return;
+    }
+
+    pthread_mutex_lock(&sink->mtx);
+    *stats = sink->stats;
+    pthread_mutex_unlock(&sink->mtx);
+}
+
+
+/******************************************************************************/
+void CO_domainSink_close(CO_domainSink_t *sink) {
+    if (sink == NULL || !sink->threadStarted) {
+        return;
+    }
+
+    pthread_mutex_lock(&sink->mtx);
+    if (sink->active) {
+        sink->stats.abortCount++;
+        sink->active = false;
+        sink->cancelRequest = true;
+    }
+    sink->stop = true;
+    pthread_cond_signal(&sink->cond);
+    pthread_mutex_unlock(&sink->mtx);
+    pthread_join(sink->thread, NULL);
+    sink->threadStarted = false;
+
+    discardTmp(sink);
+    pthread_cond_destroy(&sink->condIdle);
+    pthread_cond_destroy(&sink->cond);
+    pthread_mutex_destroy(&sink->mtx);
+    freeAll(sink);
+}
+
+#endif /* CO_SINGLE_THREAD */
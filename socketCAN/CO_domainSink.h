@@ -0,0 +1,226 @@
+/**
+ * Streaming of SDO download into a file with write-behind and atomic commit.
+ *
+ * @file        CO_domainSink.h
+ * @ingroup     CO_socketCAN_domainSink
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CO_DOMAIN_SINK_H
+#define CO_DOMAIN_SINK_H
+
+#include "301/CO_driver.h"
+#include "301/CO_ODinterface.h"
+
+#if !defined CO_SINGLE_THREAD || defined CO_DOXYGEN
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup CO_socketCAN_domainSink Domain sink
+ * @ingroup CO_socketCAN
+ * @{
+ *
+ * Streaming of large SDO downloads (firmware, configuration blobs) into a file.
+ *
+ * Domain sink is attached to an OD entry of type DOMAIN as IO extension. SDO
+ * server passes each segment (or each sub-block) to the write function, which
+ * copies it into a ring buffer and returns. Background thread drains the ring
+ * into "filename.tmp" (write-behind), so SDO server never waits for the disk.
+ *
+ * SDO server calls the write function for the last data after it has verified
+ * the transfer: size against the indicated size and CRC of the block transfer.
+ * Only then the sink requests the commit from background thread:
+ * - waits until all data are written and synced to "filename.tmp",
+ * - calls the _validate_ callback with the complete temporary file, for example
+ *   to check a signature or a header of the firmware,
+ * - renames "filename.tmp" to "filename" and syncs the directory.
+ *
+ * If validation fails, temporary file is removed and SDO transfer is aborted
+ * with the returned code. Aborted or failed transfer leaves "filename"
+ * unchanged. SDO server informs the sink about the abort or timeout (see
+ * @ref OD_IO_t), then pending commit is cancelled, if it has not renamed the
+ * file yet, and temporary file is removed. Transfer, which was not finished
+ * otherwise, is discarded with the start of the next transfer or with
+ * @ref CO_domainSink_close().
+ *
+ * Upload of the same OD entry reads the committed file.
+ *
+ * Write function is called by the SDO server inside @ref CO_LOCK_OD() of the
+ * CANmodule and never blocks on the disk. If the ring is full, it accepts only
+ * part of the data and returns ODR_PARTIAL. With the last data it returns
+ * ODR_PARTIAL while the commit is in progress. SDO server calls the write
+ * function again later (see @ref OD_IO_t) and sends the response only after
+ * the final result, so the SDO client sees the result of the commit. SDO
+ * server timeout must be longer than the commit. Other writers (OD_set_value(),
+ * local SDO client) don't repeat the call and get an error. Only one transfer
+ * into the same sink may be active at a time.
+ *
+ * Statistics (commits, aborts, duration and size of the last transfer, time,
+ * SDO server waited for the ring) are available with
+ * @ref CO_domainSink_getStats().
+ *
+ * Module is available only in multi-thread operation.
+ */
+
+/**
+ * Validate callback, called from background thread without locks
+ *
+ * @param object Object from @ref CO_domainSink_init().
+ * @param filenameTmp Name of the complete and synced temporary file.
+ * @param size Size of the transfer in bytes.
+ *
+ * @return ODR_OK to commit, otherwise the reason to abort the transfer, for
+ * example ODR_INVALID_VALUE or ODR_DEV_INCOMPAT.
+ */
+typedef ODR_t (*CO_domainSink_validate_t)(void *object,
+                                          const char *filenameTmp,
+                                          uint32_t size);
+
+/**
+ * Domain sink statistics
+ */
+typedef struct {
+    /** Number of committed transfers */
+    uint32_t commitCount;
+    /** Number of transfers, which were not finished */
+    uint32_t abortCount;
+    /** Number of transfers, rejected by validate callback */
+    uint32_t rejectCount;
+    /** Number of transfers, failed because of file error */
+    uint32_t errorCount;
+    /** Size of the last committed transfer */
+    uint32_t lastBytes;
+    /** Duration of the last committed transfer, from the first write to the
+     * end of the commit */
+    uint32_t lastTransfer_us;
+    /** Duration of the commit of the last transfer (drain, sync, validate,
+     * rename) */
+    uint32_t lastCommit_us;
+    /** Time, SDO server waited for space in the ring in the last transfer */
+    uint32_t lastWait_us;
+    /** Bytes in all committed transfers */
+    uint64_t totalBytes;
+} CO_domainSink_stats_t;
+
+/**
+ * Domain sink object
+ */
+typedef struct {
+    /** CAN module, which protects Object Dictionary */
+    CO_CANmodule_t *CANmodule;
+    /** Names of the target file and temporary file */
+    char *filename, *filenameTmp;
+    /** From CO_domainSink_init() */
+    CO_domainSink_validate_t validate;
+    void *validateObject;
+    /** Ring buffer, its size, positions and number of bytes in it, protected
+     * by mtx */
+    uint8_t *ring;
+    size_t ringSize;
+    size_t head, tail, fill;
+    /** True, while transfer is in progress, protected by mtx */
+    bool_t active;
+    /** Requests to background thread, protected by mtx */
+    bool_t startRequest, commitRequest, cancelRequest, stop;
+    /** True, while background thread works outside mtx, protected by mtx */
+    bool_t busy;
+    /** Result of the commit, protected by mtx */
+    ODR_t commitResult;
+    /** File error in current transfer, protected by mtx */
+    bool_t ioError;
+    /** Bytes received in current transfer, protected by mtx */
+    uint32_t size;
+    /** Temporary file, used by background thread */
+    int fd;
+    /** True from the commit request by the last data until SDO server gets
+     * the result, protected by mtx */
+    bool_t commitPending;
+    /** Start time, wait time, start of the wait for the ring and start of the
+     * commit of current transfer, protected by mtx */
+    uint64_t start_us;
+    uint64_t wait_us;
+    uint64_t waitStart_us;
+    uint64_t commit_us;
+    /** Statistics, protected by mtx */
+    CO_domainSink_stats_t stats;
+    pthread_t thread;
+    pthread_mutex_t mtx;
+    pthread_cond_t cond;
+    pthread_cond_t condIdle;
+    bool_t threadStarted;
+} CO_domainSink_t;
+
+/**
+ * Initialize domain sink, attach it to the OD entry and start background thread
+ *
+ * Called once after CO_new(), before or after @ref CO_CANopenInit(). OD entry
+ * keeps the extension across communication resets.
+ *
+ * @param sink This object will be initialized.
+ * @param CANmodule CAN module, which protects Object Dictionary.
+ * @param OD_domain OD entry of type DOMAIN, variable with IO extension.
+ * @param filename Name of the target file. Temporary file uses the same name
+ * with ".tmp" suffix, so it is on the same file system.
+ * @param ringSize Size of the ring buffer in bytes, 65536 for example.
+ * @param validate Validate callback, may be NULL.
+ * @param validateObject Object passed to validate callback.
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT,
+ * CO_ERROR_OD_PARAMETERS, CO_ERROR_OUT_OF_MEMORY or CO_ERROR_SYSCALL.
+ */
+CO_ReturnError_t CO_domainSink_init(CO_domainSink_t *sink,
+                                    CO_CANmodule_t *CANmodule,
+                                    const OD_entry_t *OD_domain,
+                                    const char *filename,
+                                    size_t ringSize,
+                                    CO_domainSink_validate_t validate,
+                                    void *validateObject);
+
+/**
+ * Get domain sink statistics
+ *
+ * @param sink This object.
+ * @param [out] stats Copy of statistics.
+ */
+void CO_domainSink_getStats(CO_domainSink_t *sink,
+                            CO_domainSink_stats_t *stats);
+
+/**
+ * Stop background thread and release resources
+ *
+ * Unfinished transfer is discarded and its temporary file removed. OD entry
+ * must not be accessed after this call, before program exit.
+ *
+ * @param sink This object.
+ */
+void CO_domainSink_close(CO_domainSink_t *sink);
+
+/** @} */ /* CO_socketCAN_domainSink */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* !defined CO_SINGLE_THREAD */
+
+#endif /* CO_DOMAIN_SINK_H */
@@ -24,6 +24,9 @@
  * limitations under the License.
  */
 
+/* following macro is necessary for pthread_setaffinity_np() */
+#define _GNU_SOURCE
+
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -40,9 +43,76 @@
 #include "301/CO_driver.h"
 #include "CO_error.h"
 
+#if CO_DRIVER_RX_THREADS > 0
+#include <poll.h>
+#include <sched.h>
+
+#if (CO_DRIVER_RX_THREADS_QUEUE_SIZE & (CO_DRIVER_RX_THREADS_QUEUE_SIZE - 1)) != 0
+#error CO_DRIVER_RX_THREADS_QUEUE_SIZE must be power of 2
+#endif
+#endif
+
+#if CO_DRIVER_CAPTURE > 0
+#include "CO_CANcapture.h"
+#endif
+#if CO_DRIVER_REPLAY > 0
+#include "CO_CANreplay.h"
+#endif
+
+#if CO_DRIVER_TX_CONFIRM > 0
+#if (CO_DRIVER_TX_CONFIRM_PENDING & (CO_DRIVER_TX_CONFIRM_PENDING - 1)) != 0
+#error CO_DRIVER_TX_CONFIRM_PENDING must be power of 2
+#endif
 #ifndef CO_SINGLE_THREAD
-pthread_mutex_t CO_EMCY_mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t CO_OD_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define CO_LOCK_TXCONF(m)   pthread_mutex_lock(&(m)->txConfirm_mutex)
+#define CO_UNLOCK_TXCONF(m) pthread_mutex_unlock(&(m)->txConfirm_mutex)
+#else
+#define CO_LOCK_TXCONF(m)
+#define CO_UNLOCK_TXCONF(m)
+#endif
+static void CO_CANtxConfirm(CO_CANmodule_t *CANmodule,
+                            CO_CANinterface_t *interface,
+                            const struct can_frame *msg,
+                            const struct timespec *timestamp);
+static uint32_t CO_CANtimeDiff_us(const struct timespec *later,
+                                  const struct timespec *earlier);
+#endif
+
+#if CO_DRIVER_TX_QUEUE > 0
+/* CO_CANsend() from mainline and realtime thread and dispatching of the
+ * transmit queue share interface state (error handler, socket), so they are
+ * serialized. */
+#define CO_LOCK_TXSEND(m)   pthread_mutex_lock(&(m)->txSend_mutex)
+#define CO_UNLOCK_TXSEND(m) pthread_mutex_unlock(&(m)->txSend_mutex)
+#else
+#define CO_LOCK_TXSEND(m)
+#define CO_UNLOCK_TXSEND(m)
+#endif
+
+#if CO_DRIVER_ROUTING > 0
+/* Maximum number of socket filters for one identifier range */
+#define CO_CAN_ROUTE_FILTERS 58
+#if CO_DRIVER_ROUTING_SIZE > 256
+#error CO_DRIVER_ROUTING_SIZE must not be larger than 256
+#endif
+static int CO_CANrouteFilters(CO_CANmodule_t *CANmodule,
+                              CO_CANinterface_t *interface,
+                              struct can_filter *filters);
+#endif
+
+#if CO_DRIVER_TX_QUEUE > 0
+#if (CO_DRIVER_TX_QUEUE_SIZE & (CO_DRIVER_TX_QUEUE_SIZE - 1)) != 0
+#error CO_DRIVER_TX_QUEUE_SIZE must be power of 2
+#endif
+static CO_ReturnError_t CO_CANtxQueue_init(CO_CANmodule_t *CANmodule);
+static void CO_CANtxQueue_notify(CO_CANtxQueue_t *q);
+#endif
+
+#if CO_DRIVER_RX_THREADS > 0
+static CO_ReturnError_t CO_CANrxThread_start(CO_CANmodule_t *CANmodule,
+                                             CO_CANinterface_t *interface);
+static void CO_CANrxThread_stop(CO_CANmodule_t *CANmodule,
+                                CO_CANinterface_t *interface);
 #endif
 
 #if CO_DRIVER_MULTI_INTERFACE == 0
@@ -133,7 +203,14 @@ static CO_ReturnError_t setRxFilters(CO_CANmodule_t *CANmodule)
     int count;
     CO_ReturnError_t retval;
 
-    struct can_filter rxFiltersCpy[CANmodule->rxSize];
+    size_t filtersSize = CANmodule->rxSize;
+#if CO_DRIVER_TX_CONFIRM > 0
+    filtersSize += CANmodule->txSize;
+#endif
+#if CO_DRIVER_ROUTING > 0
+    filtersSize += CANmodule->routeCount * CO_CAN_ROUTE_FILTERS;
+#endif
+    struct can_filter rxFiltersCpy[filtersSize > 0 ? filtersSize : 1];
 
     count = 0;
     /* remove unused entries ( id == 0 and mask == 0 ) as they would act as
@@ -148,6 +225,46 @@ static CO_ReturnError_t setRxFilters(CO_CANmodule_t *CANmodule)
         }
     }
 
+#if CO_DRIVER_TX_CONFIRM > 0
+    /* filters apply also to echo of own messages, install them also without
+     * rx filters, else tx buffers stay full until confirmation timeout.
+     * Skip unused tx buffers (ident 0), echo of NMT command passes the NMT
+     * rx filter. */
+    for (i = 0; i < CANmodule->txSize; i ++) {
+        if (CANmodule->txArray[i].ident != 0) {
+            rxFiltersCpy[count].can_id = CANmodule->txArray[i].ident;
+            rxFiltersCpy[count].can_mask = CAN_SFF_MASK | CAN_EFF_FLAG
+                                         | CAN_RTR_FLAG;
+            count ++;
+        }
+    }
+#endif
+
+#if CO_DRIVER_ROUTING > 0
+    if (CANmodule->routeCount > 0) {
+        /* frames for routes are received only on their source interface */
+        int countCommon = count;
+
+        retval = CO_ERROR_NO;
+        for (i = 0; i < CANmodule->CANinterfaceCount; i ++) {
+            CO_CANinterface_t *interface = &CANmodule->CANinterfaces[i];
+
+            count = countCommon + CO_CANrouteFilters(CANmodule, interface,
+                                                     &rxFiltersCpy[countCommon]);
+            /* no filter disables RX */
+            ret = setsockopt(interface->fd, SOL_CAN_RAW, CAN_RAW_FILTER,
+                             count > 0 ? rxFiltersCpy : NULL,
+                             sizeof(struct can_filter) * count);
+            if(ret < 0){
+                log_printf(LOG_ERR, CAN_FILTER_FAILED, interface->ifName);
+                log_printf(LOG_DEBUG, DBG_ERRNO, "setsockopt()");
+                retval = CO_ERROR_SYSCALL;
+            }
+        }
+        return retval;
+    }
+#endif
+
     if (count == 0) {
         /* No filter is set, disable RX */
         return disableRx(CANmodule);
@@ -182,14 +299,21 @@ void CO_CANsetNormalMode(CO_CANmodule_t *CANmodule)
 {
     CO_ReturnError_t ret;
 
-    CANmodule->CANnormal = false;
-
     if(CANmodule != NULL) {
+        CO_LOCK_TXSEND(CANmodule);
+        CANmodule->CANnormal = false;
         ret = setRxFilters(CANmodule);
         if (ret == CO_ERROR_NO) {
             /* Put CAN module in normal mode */
             CANmodule->CANnormal = true;
         }
+        CO_UNLOCK_TXSEND(CANmodule);
+#if CO_DRIVER_TX_QUEUE > 0
+        /* send messages, queued while CAN module was not in normal mode */
+        if (CANmodule->CANnormal && CANmodule->txQueue.initialized) {
+            CO_CANtxQueue_notify(&CANmodule->txQueue);
+        }
+#endif
     }
 }
 
@@ -204,7 +328,9 @@ CO_ReturnError_t CO_CANmodule_init(
         uint16_t                txSize,
         uint16_t                CANbitRate)
 {
+#if CO_DRIVER_MULTI_INTERFACE == 0
     int32_t ret;
+#endif
     uint16_t i;
     (void)CANbitRate;
 
@@ -215,6 +341,26 @@ CO_ReturnError_t CO_CANmodule_init(
 
     CO_CANptrSocketCan_t *CANptrReal = (CO_CANptrSocketCan_t *)CANptr;
 
+#ifndef CO_SINGLE_THREAD
+    /* CANmodule is zero initialized by CO_new(). Mutexes are initialized only
+     * once, because other threads may hold them during communication reset. */
+    if (!CANmodule->mutexesInitialized) {
+        if (pthread_mutex_init(&CANmodule->emcy_mutex, NULL) != 0
+            || pthread_mutex_init(&CANmodule->od_mutex, NULL) != 0
+#if CO_DRIVER_TX_CONFIRM > 0
+            || pthread_mutex_init(&CANmodule->txConfirm_mutex, NULL) != 0
+#endif
+#if CO_DRIVER_TX_QUEUE > 0
+            || pthread_mutex_init(&CANmodule->txSend_mutex, NULL) != 0
+#endif
+        ) {
+            log_printf(LOG_DEBUG, DBG_ERRNO, "pthread_mutex_init()");
+            return CO_ERROR_SYSCALL;
+        }
+        CANmodule->mutexesInitialized = true;
+    }
+#endif
+
     /* Configure object variables */
     CANmodule->epoll_fd = CANptrReal->epoll_fd;
     CANmodule->CANinterfaces = NULL;
@@ -225,6 +371,17 @@ CO_ReturnError_t CO_CANmodule_init(
     CANmodule->txSize = txSize;
     CANmodule->CANerrorStatus = 0;
     CANmodule->CANnormal = false;
+#if CO_DRIVER_REDUNDANCY > 0
+    memset(&CANmodule->redundancy, 0, sizeof(CANmodule->redundancy));
+#endif
+#if CO_DRIVER_TX_QUEUE > 0
+    {
+        CO_ReturnError_t err = CO_CANtxQueue_init(CANmodule);
+        if (err != CO_ERROR_NO) {
+            return err;
+        }
+    }
+#endif
 #if CO_DRIVER_MULTI_INTERFACE > 0
     for (i = 0; i < CO_CAN_MSG_SFF_MAX_COB_ID; i++) {
         CANmodule->rxIdentToIndex[i] = CO_INVALID_COB_ID;
@@ -297,6 +454,17 @@ CO_ReturnError_t CO_CANmodule_addInterface(CO_CANmodule_t *CANmodule,
         return CO_ERROR_OUT_OF_MEMORY;
     }
     interface = &CANmodule->CANinterfaces[CANmodule->CANinterfaceCount - 1];
+#if CO_DRIVER_RX_THREADS > 0
+    interface->rxThread = NULL;
+#endif
+#if CO_DRIVER_TX_CONFIRM > 0
+    interface->txPendingHead = 0;
+    interface->txPendingTail = 0;
+#endif
+#if CO_DRIVER_ROUTING > 0
+    interface->routeFd = -1;
+    interface->routeBatch.count = 0;
+#endif
 
     interface->can_ifindex = can_ifindex;
     ifName = if_indextoname(can_ifindex, interface->ifName);
@@ -330,6 +498,17 @@ CO_ReturnError_t CO_CANmodule_addInterface(CO_CANmodule_t *CANmodule,
         return CO_ERROR_SYSCALL;
     }
 
+#if CO_DRIVER_TX_CONFIRM > 0
+    /* receive own messages after they are sent on the bus */
+    tmp = 1;
+    ret = setsockopt(interface->fd, SOL_CAN_RAW, CAN_RAW_RECV_OWN_MSGS,
+                     &tmp, sizeof(tmp));
+    if (ret < 0) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "setsockopt(recv_own_msgs)");
+        return CO_ERROR_SYSCALL;
+    }
+#endif
+
     //todo - modify rx buffer size? first one needs root
     //ret = setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, (void *)&bytes, sLen);
     //ret = setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (void *)&bytes, sLen);
@@ -354,6 +533,25 @@ CO_ReturnError_t CO_CANmodule_addInterface(CO_CANmodule_t *CANmodule,
         return CO_ERROR_SYSCALL;
     }
 
+#if CO_DRIVER_ROUTING > 0
+    /* socket for forwarded frames, it receives nothing */
+    interface->routeFd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (interface->routeFd < 0) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "socket(route)");
+        return CO_ERROR_SYSCALL;
+    }
+    tmp = CO_DRIVER_ROUTING_LOOPBACK;
+    if (setsockopt(interface->routeFd, SOL_CAN_RAW, CAN_RAW_FILTER, NULL, 0) < 0
+        || setsockopt(interface->routeFd, SOL_CAN_RAW, CAN_RAW_LOOPBACK,
+                      &tmp, sizeof(tmp)) < 0
+        || bind(interface->routeFd, (struct sockaddr*)&sockAddr,
+                sizeof(sockAddr)) < 0
+    ) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "setsockopt/bind(route)");
+        return CO_ERROR_SYSCALL;
+    }
+#endif
+
 #if CO_DRIVER_ERROR_REPORTING > 0
     CO_CANerror_init(&interface->errorhandler, interface->fd, interface->ifName);
     /* set up error frame generation. What actually is available depends on your
@@ -372,6 +570,14 @@ CO_ReturnError_t CO_CANmodule_addInterface(CO_CANmodule_t *CANmodule,
     }
 #endif /* CO_DRIVER_ERROR_REPORTING */
 
+#if CO_DRIVER_RX_THREADS > 0
+    /* Socket is read by own thread, which notifies epoll */
+    (void)ev;
+    ret = CO_CANrxThread_start(CANmodule, interface);
+    if (ret != CO_ERROR_NO) {
+        return ret;
+    }
+#else
     /* Add socket to epoll */
     ev.events = EPOLLIN;
     ev.data.fd = interface->fd;
@@ -380,6 +586,7 @@ CO_ReturnError_t CO_CANmodule_addInterface(CO_CANmodule_t *CANmodule,
         log_printf(LOG_DEBUG, DBG_ERRNO, "epoll_ctl(can)");
         return CO_ERROR_SYSCALL;
     }
+#endif
 
     /* rx is started by calling #CO_CANsetNormalMode() */
     ret = disableRx(CANmodule);
@@ -397,12 +604,18 @@ void CO_CANmodule_disable(CO_CANmodule_t *CANmodule)
         return;
     }
 
+    /* dispatching of the transmit queue stops after this */
+    CO_LOCK_TXSEND(CANmodule);
     CANmodule->CANnormal = false;
+    CO_UNLOCK_TXSEND(CANmodule);
 
     /* clear interfaces */
     for (i = 0; i < CANmodule->CANinterfaceCount; i++) {
         CO_CANinterface_t *interface = &CANmodule->CANinterfaces[i];
 
+#if CO_DRIVER_RX_THREADS > 0
+        CO_CANrxThread_stop(CANmodule, interface);
+#endif
 #if CO_DRIVER_ERROR_REPORTING > 0
         CO_CANerror_disable(&interface->errorhandler);
 #endif
@@ -410,6 +623,12 @@ void CO_CANmodule_disable(CO_CANmodule_t *CANmodule)
         epoll_ctl(CANmodule->epoll_fd, EPOLL_CTL_DEL, interface->fd, NULL);
         close(interface->fd);
         interface->fd = -1;
+#if CO_DRIVER_ROUTING > 0
+        if (interface->routeFd >= 0) {
+            close(interface->routeFd);
+            interface->routeFd = -1;
+        }
+#endif
     }
     CANmodule->CANinterfaceCount = 0;
     if (CANmodule->CANinterfaces != NULL) {
@@ -417,6 +636,14 @@ void CO_CANmodule_disable(CO_CANmodule_t *CANmodule)
     }
     CANmodule->CANinterfaces = NULL;
 
+#if CO_DRIVER_TX_QUEUE > 0
+    /* queue and eventfd stay valid, only epoll stops waiting on it */
+    if (CANmodule->txQueue.notify_fd > 0) {
+        epoll_ctl(CANmodule->epoll_fd, EPOLL_CTL_DEL,
+                  CANmodule->txQueue.notify_fd, NULL);
+    }
+#endif
+
     if (CANmodule->rxFilter != NULL) {
         free(CANmodule->rxFilter);
     }
@@ -535,6 +762,11 @@ CO_CANtx_t *CO_CANtxBufferInit(
 #endif
 
         buffer->can_ifindex = 0;
+#if CO_DRIVER_TX_CONFIRM > 0
+        uint32_t identPrev = buffer->ident;
+        buffer->txTimestamp.tv_sec = 0;
+        buffer->txTimestamp.tv_nsec = 0;
+#endif
 
         /* CAN identifier and rtr */
         buffer->ident = ident & CAN_SFF_MASK;
@@ -544,11 +776,57 @@ CO_CANtx_t *CO_CANtxBufferInit(
         buffer->DLC = noOfBytes;
         buffer->bufferFull = false;
         buffer->syncFlag = syncFlag;
+        buffer->deadline_us = 0;
+        buffer->busyRetry = false;
+
+#if CO_DRIVER_TX_CONFIRM > 0
+        /* echo of the message must pass socket filters */
+        if (CANmodule->CANnormal && buffer->ident != identPrev) {
+            (void)setRxFilters(CANmodule);
+        }
+#endif
     }
 
     return buffer;
 }
 
+
+/* Get monotonic time in microseconds *****************************************/
+static inline uint64_t CO_CANtime_us(void) {
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+
+/******************************************************************************/
+void CO_CANtxBuffer_setDeadline(CO_CANtx_t *buffer, uint32_t timeout_us) {
+    if (buffer != NULL) {
+        buffer->deadline_us = timeout_us > 0
+                            ? CO_CANtime_us() + timeout_us : 0;
+    }
+}
+
+
+/* Count and report message, dropped because of passed deadline ***************/
+static void CO_CANtxLate(CO_CANmodule_t *CANmodule, const CO_CANtx_t *buffer) {
+    __atomic_add_fetch(&CANmodule->txLateCount, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&CANmodule->txLateCycle, 1, __ATOMIC_RELAXED);
+#if CO_DRIVER_ERROR_REPORTING > 0
+    for (uint32_t i = 0; i < CANmodule->CANinterfaceCount; i++) {
+        CO_CANinterface_t *interface = &CANmodule->CANinterfaces[i];
+
+        if (buffer->can_ifindex == 0
+            || buffer->can_ifindex == interface->can_ifindex
+        ) {
+            interface->errorhandler.CANerrorStatus |= CO_CAN_ERRTX_PDO_LATE;
+        }
+    }
+#endif
+    log_printf(LOG_DEBUG, DBG_CAN_TX_LATE, buffer->ident);
+}
+
 #if CO_DRIVER_MULTI_INTERFACE > 0
 
 /******************************************************************************/
@@ -589,6 +867,14 @@ static CO_ReturnError_t CO_CANCheckSendInterface(
         return CO_ERROR_ILLEGAL_ARGUMENT;
     }
 
+#if CO_DRIVER_REPLAY > 0
+    if (CANmodule->replay != NULL) {
+        /* stack output is recorded instead of sent */
+        CO_CANreplay_output(CANmodule->replay, buffer, interface->ifName);
+        return CO_ERROR_NO;
+    }
+#endif
+
 #if CO_DRIVER_ERROR_REPORTING > 0
     ifState = CO_CANerror_txMsg(&interface->errorhandler);
     switch (ifState) {
@@ -603,6 +889,11 @@ static CO_ReturnError_t CO_CANCheckSendInterface(
     }
 #endif
 
+#if CO_DRIVER_TX_CONFIRM > 0
+    /* Echo frames come back in the order of send(), so send and FIFO push
+     * are done under the same lock. */
+    CO_LOCK_TXCONF(CANmodule);
+#endif
     do {
         errno = 0;
         n = send(interface->fd, buffer, CAN_MTU, MSG_DONTWAIT);
@@ -610,24 +901,67 @@ static CO_ReturnError_t CO_CANCheckSendInterface(
             /* try again */
             continue;
         }
-        else if (errno == EAGAIN) {
-            /* socket queue full */
+        else if (errno == EAGAIN || errno == ENOBUFS) {
+            /* socket queue or interface queue (txqueuelen) full. socketCAN
+             * doesn't support blocking write. This is temporary, caller may
+             * try again later, after some messages are sent on the bus. */
+            err = CO_ERROR_TX_BUSY;
             break;
         }
-        else if (errno == ENOBUFS) {
-            /* socketCAN doesn't support blocking write. You can wait here for
-             * a few hundred us and then try again */
-#if CO_DRIVER_ERROR_REPORTING > 0
-            interface->errorhandler.CANerrorStatus |= CO_CAN_ERRTX_OVERFLOW;
-#endif
-            return CO_ERROR_TX_BUSY;
-        }
         else if (n != CAN_MTU) {
             break;
         }
     } while (errno != 0);
+#if CO_DRIVER_TX_CONFIRM > 0
+    if (n == CAN_MTU) {
+        CO_CANtxPending_t *pending;
+
+        if ((interface->txPendingHead - interface->txPendingTail)
+            >= CO_DRIVER_TX_CONFIRM_PENDING
+        ) {
+            /* FIFO full, the oldest frame will not be matched */
+            pending = &interface->txPending[interface->txPendingTail
+                                    & (CO_DRIVER_TX_CONFIRM_PENDING - 1)];
+            if (pending->buffer != NULL) {
+                pending->buffer->bufferFull = false;
+            }
+            CANmodule->txConfirmStats.unconfirmed++;
+            interface->txPendingTail++;
+        }
+        pending = &interface->txPending[interface->txPendingHead
+                                        & (CO_DRIVER_TX_CONFIRM_PENDING - 1)];
+        pending->ident = buffer->ident;
+        pending->syncFlag = buffer->syncFlag;
+        pending->buffer = NULL;
+        if (buffer >= &CANmodule->txArray[0]
+            && buffer < &CANmodule->txArray[CANmodule->txSize]
+        ) {
+            /* CO_CANsendAsync() copies are not tracked */
+            pending->buffer = buffer;
+            buffer->bufferFull = true;
+        }
+        clock_gettime(CLOCK_REALTIME, &pending->sent);
+        interface->txPendingHead++;
+    }
+    CO_UNLOCK_TXCONF(CANmodule);
+#endif
 
-    if(n != CAN_MTU){
+    if (err == CO_ERROR_TX_BUSY) {
+        if (buffer->busyRetry) {
+            /* caller sends the message again, see CO_CANtxBuffer_busyRetry() */
+            log_printf(LOG_DEBUG, DBG_CAN_TX_BUSY, buffer->ident,
+                       interface->ifName);
+        }
+        else {
+#if CO_DRIVER_ERROR_REPORTING > 0
+            interface->errorhandler.CANerrorStatus |= CO_CAN_ERRTX_OVERFLOW;
+#endif
+            log_printf(LOG_ERR, DBG_CAN_TX_FAILED, buffer->ident,
+                       interface->ifName);
+            log_printf(LOG_DEBUG, DBG_ERRNO, "send()");
+        }
+    }
+    else if (n != CAN_MTU) {
 #if CO_DRIVER_ERROR_REPORTING > 0
         interface->errorhandler.CANerrorStatus |= CO_CAN_ERRTX_OVERFLOW;
 #endif
@@ -636,6 +970,20 @@ static CO_ReturnError_t CO_CANCheckSendInterface(
         err = CO_ERROR_TX_OVERFLOW;
     }
 
+#if CO_DRIVER_CAPTURE > 0
+    {
+        CO_CANcapture_t *cap = __atomic_load_n(&CANmodule->capture,
+                                               __ATOMIC_ACQUIRE);
+        if (cap != NULL) {
+            /* CO_CANtx_t is binary compatible to struct can_frame */
+            CO_CANcapture_frame(cap, (const struct can_frame *)buffer, NULL,
+                                interface->can_ifindex, -1,
+                                n == CAN_MTU ? CO_CANCAPTURE_TX
+                                : (CO_CANCAPTURE_TX | CO_CANCAPTURE_TX_FAILED));
+        }
+    }
+#endif
+
     return err;
 }
 
@@ -664,23 +1012,265 @@ CO_ReturnError_t CO_CANCheckSend(CO_CANmodule_t *CANmodule, CO_CANtx_t *buffer);
 CO_ReturnError_t CO_CANsend(CO_CANmodule_t *CANmodule, CO_CANtx_t *buffer)
 {
     CO_ReturnError_t err;
+    CO_LOCK_TXSEND(CANmodule);
     err = CO_CANCheckSend(CANmodule, buffer);
+    CO_UNLOCK_TXSEND(CANmodule);
     if (err == CO_ERROR_TX_BUSY) {
-        /* send doesn't have "busy" */
-        log_printf(LOG_ERR, DBG_CAN_TX_FAILED, buffer->ident, "CANx");
-        log_printf(LOG_DEBUG, DBG_ERRNO, "send()");
-        err = CO_ERROR_TX_OVERFLOW;
+        /* message was not sent, transmit queue is full */
+        __atomic_add_fetch(&CANmodule->txBusyCount, 1, __ATOMIC_RELAXED);
+        if (!buffer->busyRetry) {
+            /* caller doesn't send it again, message is lost */
+            err = CO_ERROR_TX_OVERFLOW;
+        }
+    }
+    return err;
+}
+
+
+#if CO_DRIVER_REDUNDANCY > 0
+/* Verify, if line is able to communicate *************************************/
+static bool_t CO_CANredundancy_lineUsable(CO_CANinterface_t *interface) {
+#if CO_DRIVER_ERROR_REPORTING > 0
+    return interface->errorhandler.listenOnly == 0
+        && (interface->errorhandler.CANerrorStatus & CO_CAN_ERRTX_BUS_OFF) == 0;
+#else
+    (void)interface;
+    return true;
+#endif
+}
+
+
+/* Mark line as failed and switch to the other line, if it is active.
+ * Function is called from mainline, realtime, transmit queue and receive
+ * threads, so line state is changed with compare and exchange: only the first
+ * caller marks the line as failed and only one switches the line. ***********/
+static void CO_CANredundancy_fail(CO_CANmodule_t *CANmodule,
+                                  uint32_t line,
+                                  const char *reason)
+{
+    CO_CANredundancy_t *red = &CANmodule->redundancy;
+    uint32_t other = line ^ 1;
+    bool_t failed = false;
+    uint8_t active = (uint8_t)line;
+    uint64_t start_us = 0;
+
+    if (CANmodule->CANinterfaceCount < 2 || line > 1) {
+        return;
+    }
+    if (!__atomic_compare_exchange_n(&red->lineFailed[line], &failed, true,
+                                     false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+    ) {
+        /* already failed */
+        return;
+    }
+    log_printf(LOG_WARNING, CAN_LINE_FAILED,
+               CANmodule->CANinterfaces[line].ifName, reason);
+
+    if (!__atomic_load_n(&red->lineFailed[other], __ATOMIC_ACQUIRE)
+        && __atomic_compare_exchange_n(&red->activeLine, &active,
+                                       (uint8_t)other, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+    ) {
+        /* keep the first failure indication, until a frame is sent */
+        (void)__atomic_compare_exchange_n(&red->failStart_us, &start_us,
+                                          CO_CANtime_us(), false,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&red->failoverCount, 1, __ATOMIC_RELAXED);
+        log_printf(LOG_WARNING, CAN_LINE_SWITCHED,
+                   CANmodule->CANinterfaces[other].ifName);
+    }
+}
+
+
+/* Update line health and suppress copy of the frame from the other line.
+ * Return false, if frame is a copy. */
+static bool_t CO_CANredundancy_rx(CO_CANmodule_t *CANmodule,
+                                  CO_CANinterface_t *interface,
+                                  const struct can_frame *msg,
+                                  const struct timespec *timestamp)
+{
+    CO_CANredundancy_t *red = &CANmodule->redundancy;
+    uint32_t line = interface - CANmodule->CANinterfaces;
+    uint32_t other = line ^ 1;
+    uint32_t ident = msg->can_id & CAN_SFF_MASK;
+    uint64_t now_us;
+    CO_CANredundancyId_t *id;
+    uint32_t time_us;
+
+    if (CANmodule->CANinterfaceCount < 2 || line > 1) {
+        return true;
+    }
+
+    now_us = CO_CANtime_us();
+    __atomic_store_n(&red->lastRx_us[line], now_us, __ATOMIC_RELAXED);
+    if ((msg->can_id & CAN_EFF_FLAG) != 0) {
+        return true;
+    }
+    if (ident > CO_CAN_ID_HEARTBEAT && ident <= CO_CAN_ID_HEARTBEAT + 0x7F) {
+        __atomic_store_n(&red->lastHb_us[line], now_us, __ATOMIC_RELAXED);
+    }
+    if (__atomic_load_n(&red->lineFailed[line], __ATOMIC_ACQUIRE)
+        && CO_CANredundancy_lineUsable(interface)
+    ) {
+        bool_t failed = true;
+
+        if (__atomic_compare_exchange_n(&red->lineFailed[line], &failed, false,
+                                        false, __ATOMIC_ACQ_REL,
+                                        __ATOMIC_RELAXED)
+        ) {
+            log_printf(LOG_NOTICE, CAN_LINE_RECOVERED, interface->ifName);
+        }
+    }
+
+    /* Frame is a copy, if the other line already delivered the same number
+     * of frames with this CAN-ID in the window. Counters are compared modulo
+     * 256, difference is limited, so a silent line can not wrap it. */
+    id = &red->ids[ident];
+    time_us = (uint32_t)((uint64_t)timestamp->tv_sec * 1000000
+                         + timestamp->tv_nsec / 1000);
+    if ((uint32_t)(time_us - id->time_us) > CO_DRIVER_REDUNDANCY_WINDOW_US) {
+        id->count[0] = 0;
+        id->count[1] = 0;
+    }
+    if ((int8_t)(id->count[line] - id->count[other]) < 0) {
+        id->count[line]++;
+        __atomic_add_fetch(&red->duplicates, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    id->count[line]++;
+    if ((int8_t)(id->count[line] - id->count[other]) > 16) {
+        id->count[other] = id->count[line] - 16;
+    }
+    id->time_us = time_us;
+    return true;
+}
+
+
+/* Send message on the active line, switch line, if send fails ****************/
+static CO_ReturnError_t CO_CANredundancy_send(CO_CANmodule_t *CANmodule,
+                                              CO_CANtx_t *buffer)
+{
+    CO_CANredundancy_t *red = &CANmodule->redundancy;
+    uint32_t line = __atomic_load_n(&red->activeLine, __ATOMIC_ACQUIRE);
+    uint64_t start_us;
+    CO_ReturnError_t err;
+
+    err = CO_CANCheckSendInterface(CANmodule, buffer,
+                                   &CANmodule->CANinterfaces[line]);
+    if (err == CO_ERROR_INVALID_STATE || err == CO_ERROR_TX_OVERFLOW) {
+        uint32_t active;
+
+        CO_CANredundancy_fail(CANmodule, line, "transmit");
+        active = __atomic_load_n(&red->activeLine, __ATOMIC_ACQUIRE);
+        if (active != line) {
+            line = active;
+            err = CO_CANCheckSendInterface(CANmodule, buffer,
+                                           &CANmodule->CANinterfaces[line]);
+        }
+    }
+    start_us = __atomic_load_n(&red->failStart_us, __ATOMIC_RELAXED);
+    if (err == CO_ERROR_NO && start_us != 0
+        && __atomic_compare_exchange_n(&red->failStart_us, &start_us, 0, false,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+    ) {
+        /* the first frame sent after the switch */
+        __atomic_store_n(&red->failoverLatency_us,
+                         (uint32_t)(CO_CANtime_us() - start_us),
+                         __ATOMIC_RELAXED);
     }
+
+    /* heartbeat is sent on both lines, so both can be monitored */
+    if (buffer->ident > CO_CAN_ID_HEARTBEAT
+        && buffer->ident <= CO_CAN_ID_HEARTBEAT + 0x7F
+    ) {
+        CO_ReturnError_t err2;
+
+        err2 = CO_CANCheckSendInterface(CANmodule, buffer,
+                                        &CANmodule->CANinterfaces[line ^ 1]);
+        if (err2 == CO_ERROR_INVALID_STATE || err2 == CO_ERROR_TX_OVERFLOW) {
+            CO_CANredundancy_fail(CANmodule, line ^ 1, "transmit");
+        }
+    }
+
     return err;
 }
 
 
+/******************************************************************************/
+void CO_CANmodule_getRedundancy(CO_CANmodule_t *CANmodule,
+                                CO_CANredundancyStats_t *stats)
+{
+    CO_CANredundancy_t *red;
+
+    if (CANmodule == NULL || stats == NULL) {
+        return;
+    }
+
+    red = &CANmodule->redundancy;
+    memset(stats, 0, sizeof(*stats));
+    if (CANmodule->CANinterfaceCount > 0) {
+        uint8_t line = __atomic_load_n(&red->activeLine, __ATOMIC_ACQUIRE);
+
+        if (line < CANmodule->CANinterfaceCount) {
+            stats->activeIfindex = CANmodule->CANinterfaces[line].can_ifindex;
+        }
+    }
+    stats->lineFailed[0] = red->lineFailed[0];
+    stats->lineFailed[1] = red->lineFailed[1];
+    stats->failoverCount = __atomic_load_n(&red->failoverCount,
+                                           __ATOMIC_RELAXED);
+    stats->failoverLatency_us = __atomic_load_n(&red->failoverLatency_us,
+                                                __ATOMIC_RELAXED);
+    stats->duplicates = __atomic_load_n(&red->duplicates, __ATOMIC_RELAXED);
+}
+
+
+/******************************************************************************/
+CO_ReturnError_t CO_CANmodule_setActiveLine(CO_CANmodule_t *CANmodule,
+                                            int can_ifindex)
+{
+    if (CANmodule == NULL) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    for (uint32_t i = 0; i < CANmodule->CANinterfaceCount && i < 2; i++) {
+        if (CANmodule->CANinterfaces[i].can_ifindex == can_ifindex) {
+            /* failover may switch the line concurrently, log only own
+             * switch */
+            uint8_t prev = __atomic_exchange_n(
+                               &CANmodule->redundancy.activeLine, (uint8_t)i,
+                               __ATOMIC_ACQ_REL);
+            if (prev != i) {
+                log_printf(LOG_NOTICE, CAN_LINE_SWITCHED,
+                           CANmodule->CANinterfaces[i].ifName);
+            }
+            return CO_ERROR_NO;
+        }
+    }
+
+    return CO_ERROR_ILLEGAL_ARGUMENT;
+}
+#endif /* CO_DRIVER_REDUNDANCY > 0 */
+
+
 /******************************************************************************/
 CO_ReturnError_t CO_CANCheckSend(CO_CANmodule_t *CANmodule, CO_CANtx_t *buffer)
 {
     uint32_t i;
     CO_ReturnError_t err = CO_ERROR_NO;
 
+    /* drop message, if its deadline passed */
+    if (buffer->deadline_us != 0 && CO_CANtime_us() >= buffer->deadline_us) {
+        CO_CANtxLate(CANmodule, buffer);
+        return CO_ERROR_TX_PDO_WINDOW;
+    }
+
+#if CO_DRIVER_REDUNDANCY > 0
+    if (buffer->can_ifindex == 0 && CANmodule->CANinterfaceCount >= 2) {
+        return CO_CANredundancy_send(CANmodule, buffer);
+    }
+#endif
+
     /* check on which interfaces to send this messages */
     for (i = 0; i < CANmodule->CANinterfaceCount; i++) {
         CO_CANinterface_t *interface = &CANmodule->CANinterfaces[i];
@@ -706,8 +1296,33 @@ CO_ReturnError_t CO_CANCheckSend(CO_CANmodule_t *CANmodule, CO_CANtx_t *buffer)
 /******************************************************************************/
 void CO_CANclearPendingSyncPDOs(CO_CANmodule_t *CANmodule)
 {
-    (void)CANmodule;
-    /* Messages are either written to the socket queue or dropped */
+    uint32_t late;
+
+    if (CANmodule == NULL) {
+        return;
+    }
+
+    /* Messages, written to the socket queue, can not be removed. Synchronous
+     * messages, still in the transmit queue, will be dropped as late. */
+#if CO_DRIVER_TX_QUEUE > 0
+    if (CANmodule->txQueue.initialized) {
+        CANmodule->txQueue.syncClearPos =
+            __atomic_load_n(&CANmodule->txQueue.head, __ATOMIC_ACQUIRE);
+        CANmodule->txQueue.syncClearPending = true;
+    }
+#endif
+
+    /* end of the SYNC cycle, latch the number of late messages */
+    late = __atomic_exchange_n(&CANmodule->txLateCycle, 0, __ATOMIC_RELAXED);
+    CANmodule->txLateLastCycle = late;
+#if CO_DRIVER_ERROR_REPORTING > 0
+    if (late == 0) {
+        for (uint32_t i = 0; i < CANmodule->CANinterfaceCount; i++) {
+            CANmodule->CANinterfaces[i].errorhandler.CANerrorStatus &=
+                0xFFFF ^ CO_CAN_ERRTX_PDO_LATE;
+        }
+    }
+#endif
 }
 
 
@@ -726,23 +1341,88 @@ void CO_CANmodule_process(CO_CANmodule_t *CANmodule)
             CANmodule->CANinterfaces[0].errorhandler.CANerrorStatus;
     }
 #endif
+
+#if CO_DRIVER_REDUNDANCY > 0
+    if (CANmodule->CANinterfaceCount >= 2) {
+        CO_CANredundancy_t *red = &CANmodule->redundancy;
+        uint64_t now_us = CO_CANtime_us();
+        uint64_t timeout_us = CO_DRIVER_REDUNDANCY_TIMEOUT_MS * 1000;
+
+        /* line is silent, while heartbeats are received on the other line */
+        for (uint32_t line = 0; line < 2; line++) {
+            uint64_t lastRx_us = __atomic_load_n(&red->lastRx_us[line],
+                                                 __ATOMIC_RELAXED);
+            uint64_t lastHbOther_us = __atomic_load_n(&red->lastHb_us[line ^ 1],
+                                                      __ATOMIC_RELAXED);
+
+            if (lastRx_us == 0) {
+                /* start monitoring */
+                __atomic_store_n(&red->lastRx_us[line], now_us,
+                                 __ATOMIC_RELAXED);
+                continue;
+            }
+            if (lastHbOther_us != 0 && now_us - lastHbOther_us < timeout_us
+                && (int64_t)(now_us - lastRx_us) > (int64_t)timeout_us
+            ) {
+                CO_CANredundancy_fail(CANmodule, line, "silent");
+            }
+        }
+#if CO_DRIVER_ERROR_REPORTING > 0
+        /* status of the active line */
+        uint8_t active = __atomic_load_n(&red->activeLine, __ATOMIC_ACQUIRE);
+        CANmodule->CANerrorStatus =
+            CANmodule->CANinterfaces[active].errorhandler.CANerrorStatus;
+#endif
+    }
+#endif
+
+#if CO_DRIVER_TX_CONFIRM > 0
+    /* frames without confirmation in time (bus off, no acknowledge) */
+    struct timespec now;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    CO_LOCK_TXCONF(CANmodule);
+    for (uint32_t i = 0; i < CANmodule->CANinterfaceCount; i++) {
+        CO_CANinterface_t *interface = &CANmodule->CANinterfaces[i];
+
+        while (interface->txPendingTail != interface->txPendingHead) {
+            CO_CANtxPending_t *pending;
+
+            pending = &interface->txPending[interface->txPendingTail
+                                        & (CO_DRIVER_TX_CONFIRM_PENDING - 1)];
+            if (CO_CANtimeDiff_us(&now, &pending->sent)
+                < CO_DRIVER_TX_CONFIRM_TIMEOUT_MS * 1000
+            ) {
+                break;
+            }
+            if (pending->buffer != NULL) {
+                pending->buffer->bufferFull = false;
+            }
+            CANmodule->txConfirmStats.unconfirmed++;
+            interface->txPendingTail++;
+        }
+    }
+    CO_UNLOCK_TXCONF(CANmodule);
+#endif
 }
 
 
-/* Read CAN message from socket and verify some errors ************************/
-static CO_ReturnError_t CO_CANread(
-        CO_CANmodule_t         *CANmodule,
-        CO_CANinterface_t      *interface,
+/* Read CAN message from socket, get timestamp and socket drop counter ********/
+static CO_ReturnError_t CO_CANreadSocket(
+        int                     fd,
         struct can_frame       *msg,        /* CAN message, return value */
-        struct timespec        *timestamp)  /* timestamp of CAN message, return value */
+        struct timespec        *timestamp,  /* timestamp of CAN message, return value */
+        uint32_t               *dropped,    /* unchanged, if not received */
+        bool_t                 *confirm)    /* echo of own message, may be NULL */
 {
     int32_t n;
-    uint32_t dropped;
     /* recvmsg - like read, but generates statistics about the socket
      * example in berlios candump.c */
     struct iovec iov;
     struct msghdr msghdr;
-    char ctrlmsg[CMSG_SPACE(sizeof(struct timeval)) + CMSG_SPACE(sizeof(dropped))];
+    /* SO_TIMESTAMPING returns three timespecs: software, legacy, hardware */
+    char ctrlmsg[CMSG_SPACE(3 * sizeof(struct timespec))
+                 + CMSG_SPACE(sizeof(*dropped))];
     struct cmsghdr *cmsg;
 
     iov.iov_base = msg;
@@ -756,17 +1436,17 @@ static CO_ReturnError_t CO_CANread(
     msghdr.msg_controllen = sizeof(ctrlmsg);
     msghdr.msg_flags = 0;
 
-    n = recvmsg(interface->fd, &msghdr, 0);
+    n = recvmsg(fd, &msghdr, 0);
     if (n != CAN_MTU) {
-#if CO_DRIVER_ERROR_REPORTING > 0
-        interface->errorhandler.CANerrorStatus |= CO_CAN_ERRRX_OVERFLOW;
-#endif
-        log_printf(LOG_DEBUG, DBG_CAN_RX_FAILED, interface->ifName);
-        log_printf(LOG_DEBUG, DBG_ERRNO, "recvmsg()");
         return CO_ERROR_SYSCALL;
     }
+    if (confirm != NULL) {
+        *confirm = (msghdr.msg_flags & MSG_CONFIRM) != 0;
+    }
 
     /* check for rx queue overflow, get rx time */
+    timestamp->tv_sec = 0;
+    timestamp->tv_nsec = 0;
     for (cmsg = CMSG_FIRSTHDR(&msghdr);
          cmsg && (cmsg->cmsg_level == SOL_SOCKET);
          cmsg = CMSG_NXTHDR(&msghdr, cmsg)) {
@@ -775,16 +1455,7 @@ static CO_ReturnError_t CO_CANread(
             *timestamp = ((struct timespec*)CMSG_DATA(cmsg))[0];
         }
         else if (cmsg->cmsg_type == SO_RXQ_OVFL) {
-            dropped = *(uint32_t*)CMSG_DATA(cmsg);
-            if (dropped > CANmodule->rxDropCount) {
-#if CO_DRIVER_ERROR_REPORTING > 0
-                interface->errorhandler.CANerrorStatus |= CO_CAN_ERRRX_OVERFLOW;
-#endif
-                log_printf(LOG_ERR, CAN_RX_SOCKET_QUEUE_OVERFLOW,
-                           interface->ifName, dropped);
-            }
-            CANmodule->rxDropCount = dropped;
-            //todo use this info!
+            *dropped = *(uint32_t*)CMSG_DATA(cmsg);
         }
     }
 
@@ -792,12 +1463,88 @@ static CO_ReturnError_t CO_CANread(
 }
 
 
-/* find msg inside rxArray and call corresponding CANrx_callback **************/
-static int32_t CO_CANrxMsg(                 /* return index of received message in rxArray or -1 */
-        CO_CANmodule_t        *CANmodule,
-        struct can_frame      *msg,         /* CAN message input */
-        CO_CANrxMsg_t         *buffer)      /* If not NULL, msg will be copied to buffer */
-{
+/* Verify socket rx queue drop counter ****************************************/
+static void CO_CANrxDropped(
+        CO_CANmodule_t         *CANmodule,
+        CO_CANinterface_t      *interface,
+        uint32_t                dropped)
+{
+    if (dropped > CANmodule->rxDropCount) {
+#if CO_DRIVER_ERROR_REPORTING > 0
+        interface->errorhandler.CANerrorStatus |= CO_CAN_ERRRX_OVERFLOW;
+#endif
+        log_printf(LOG_ERR, CAN_RX_SOCKET_QUEUE_OVERFLOW,
+                   interface->ifName, dropped);
+    }
+    CANmodule->rxDropCount = dropped;
+    //todo use this info!
+}
+
+
+/* Read CAN message from socket and verify some errors ************************/
+static CO_ReturnError_t CO_CANread(
+        CO_CANmodule_t         *CANmodule,
+        CO_CANinterface_t      *interface,
+        struct can_frame       *msg,        /* CAN message, return value */
+        struct timespec        *timestamp,  /* timestamp of CAN message, return value */
+        bool_t                 *confirm)    /* echo of own message, return value */
+{
+    uint32_t dropped = CANmodule->rxDropCount;
+    CO_ReturnError_t err;
+
+    err = CO_CANreadSocket(interface->fd, msg, timestamp, &dropped, confirm);
+    if (err != CO_ERROR_NO) {
+#if CO_DRIVER_ERROR_REPORTING > 0
+        interface->errorhandler.CANerrorStatus |= CO_CAN_ERRRX_OVERFLOW;
+#endif
+        log_printf(LOG_DEBUG, DBG_CAN_RX_FAILED, interface->ifName);
+        log_printf(LOG_DEBUG, DBG_ERRNO, "recvmsg()");
+        return err;
+    }
+
+    CO_CANrxDropped(CANmodule, interface, dropped);
+
+    return CO_ERROR_NO;
+}
+
+
+/* Reception time of the message, which is processed by CANrx_callback in this
+ * thread, NULL outside of callback. See CO_CANrxMsg_readTimestamp_linux(). */
+static __thread const struct timespec *CO_CANrxTimestamp = NULL;
+
+
+/******************************************************************************/
+uint32_t CO_CANrxMsg_readTimestamp_linux(void *rxMsg)
+{
+    const struct timespec *ts = CO_CANrxTimestamp;
+    uint32_t now_us = CO_timestamp_us();
+    struct timespec now;
+    int64_t age_us;
+
+    (void)rxMsg;
+    if (ts == NULL) {
+        return now_us;
+    }
+
+    /* socket timestamp is system time, CO_timestamp_us() is monotonic time */
+    clock_gettime(CLOCK_REALTIME, &now);
+    age_us = (int64_t)(now.tv_sec - ts->tv_sec) * 1000000
+             + (now.tv_nsec - ts->tv_nsec) / 1000;
+    if (age_us < 0 || age_us > 1000000) {
+        /* frame without timestamp or system time was changed */
+        return now_us;
+    }
+    return now_us - (uint32_t)age_us;
+}
+
+
+/* find msg inside rxArray and call corresponding CANrx_callback **************/
+static int32_t CO_CANrxMsg(                 /* return index of received message in rxArray or -1 */
+        CO_CANmodule_t        *CANmodule,
+        struct can_frame      *msg,         /* CAN message input */
+        const struct timespec *timestamp,   /* reception time of msg */
+        CO_CANrxMsg_t         *buffer)      /* If not NULL, msg will be copied to buffer */
+{
     int32_t retval;
     const CO_CANrxMsg_t *rcvMsg;  /* pointer to received message in CAN module */
     uint16_t index;               /* index of received message */
@@ -822,7 +1569,9 @@ static int32_t CO_CANrxMsg(                 /* return index of received message
     if(msgMatched) {
         /* Call specific function, which will process the message */
         if ((rcvMsgObj != NULL) && (rcvMsgObj->CANrx_callback != NULL)){
+            CO_CANrxTimestamp = timestamp;
             rcvMsgObj->CANrx_callback(rcvMsgObj->object, (void *)rcvMsg);
+            CO_CANrxTimestamp = NULL;
         }
         /* return message */
         if (buffer != NULL) {
@@ -838,12 +1587,987 @@ static int32_t CO_CANrxMsg(                 /* return index of received message
 }
 
 
+/* Process error message or pass data message to CANopen objects *************/
+static void CO_CANrxDispatch(
+        CO_CANmodule_t        *CANmodule,
+        CO_CANinterface_t     *interface,
+        struct can_frame      *msg,
+        struct timespec       *timestamp,
+        CO_CANrxMsg_t         *buffer,
+        int32_t               *msgIndex)
+{
+    int32_t idx = -1;
+#if CO_DRIVER_CAPTURE > 0
+    /* CO_CANrxMsg() clears flags in can_id, capture keeps the original */
+    canid_t can_id = msg->can_id;
+#endif
+
+    if (msg->can_id & CAN_ERR_FLAG) {
+        /* error msg */
+#if CO_DRIVER_ERROR_REPORTING > 0
+        CO_CANerror_rxMsgError(&interface->errorhandler, msg);
+#endif
+#if CO_DRIVER_REDUNDANCY > 0
+        if (!CO_CANredundancy_lineUsable(interface)) {
+            CO_CANredundancy_fail(CANmodule,
+                                  interface - CANmodule->CANinterfaces,
+                                  "bus off or no acknowledge");
+        }
+#endif
+    }
+#if CO_DRIVER_REDUNDANCY > 0
+    else if (!CO_CANredundancy_rx(CANmodule, interface, msg, timestamp)) {
+        /* copy of the frame from the other line */
+        if (msgIndex != NULL) {
+            *msgIndex = -1;
+        }
+    }
+#endif
+    else {
+        /* data msg */
+#if CO_DRIVER_ERROR_REPORTING > 0
+        /* clear listenOnly and noackCounter if necessary */
+        CO_CANerror_rxMsg(&interface->errorhandler);
+#endif
+        idx = CO_CANrxMsg(CANmodule, msg, timestamp, buffer);
+        if (idx > -1) {
+            /* Store message info */
+            CANmodule->rxArray[idx].timestamp = *timestamp;
+            CANmodule->rxArray[idx].can_ifindex = interface->can_ifindex;
+        }
+        if (msgIndex != NULL) {
+            *msgIndex = idx;
+        }
+    }
+
+#if CO_DRIVER_CAPTURE > 0
+    {
+        CO_CANcapture_t *cap = __atomic_load_n(&CANmodule->capture,
+                                               __ATOMIC_ACQUIRE);
+        if (cap != NULL) {
+            msg->can_id = can_id;
+            CO_CANcapture_frame(cap, msg, timestamp, interface->can_ifindex,
+                                idx, 0);
+        }
+    }
+#endif
+}
+
+
+#if CO_DRIVER_ROUTING > 0
+/* Socket filters for routes from the interface, return number of filters *****/
+static int CO_CANrouteFilters(CO_CANmodule_t *CANmodule,
+                              CO_CANinterface_t *interface,
+                              struct can_filter *filters)
+{
+    int count = 0;
+
+    for (uint32_t i = 0; i < CANmodule->routeCount; i++) {
+        const CO_CANroute_t *route = &CANmodule->routes[i].route;
+        bool_t eff = (route->identFirst & CAN_EFF_FLAG) != 0;
+        uint64_t identMask = eff ? CAN_EFF_MASK : CAN_SFF_MASK;
+        uint64_t first = route->identFirst & identMask;
+        uint64_t last = route->identLast & identMask;
+
+        if (route->srcIfindex != interface->can_ifindex) {
+            continue;
+        }
+
+        /* Split the range into aligned blocks of power of 2 size, each is
+         * one identifier/mask pair. RTR flag is not in the mask. */
+        while (first <= last) {
+            uint64_t size = 1;
+
+            while ((first & (size * 2 - 1)) == 0
+                   && first + size * 2 - 1 <= last
+            ) {
+                size *= 2;
+            }
+            filters[count].can_id = (canid_t)first | (eff ? CAN_EFF_FLAG : 0);
+            filters[count].can_mask = (canid_t)(~(size - 1) & identMask)
+                                    | CAN_EFF_FLAG;
+            count++;
+            first += size;
+        }
+    }
+
+    return count;
+}
+
+
+/* Send frames, collected for the interface, with one system call *************/
+static void CO_CANrouteFlush(CO_CANmodule_t *CANmodule,
+                             CO_CANinterface_t *interface)
+{
+    CO_CANrouteBatch_t *batch = &interface->routeBatch;
+    struct mmsghdr msgs[CO_DRIVER_ROUTING_BATCH];
+    struct iovec iov[CO_DRIVER_ROUTING_BATCH];
+    struct timespec now;
+    int n, i;
+
+    if (batch->count == 0) {
+        return;
+    }
+
+    memset(msgs, 0, sizeof(msgs[0]) * batch->count);
+    for (i = 0; i < batch->count; i++) {
+        iov[i].iov_base = &batch->frames[i];
+        iov[i].iov_len = CAN_MTU;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    n = sendmmsg(interface->routeFd, msgs, batch->count, MSG_DONTWAIT);
+    if (n < 0) {
+        log_printf(LOG_DEBUG, DBG_CAN_TX_FAILED,
+                   batch->frames[0].can_id, interface->ifName);
+        log_printf(LOG_DEBUG, DBG_ERRNO, "sendmmsg()");
+        n = 0;
+    }
+
+    /* reception time is system time */
+    clock_gettime(CLOCK_REALTIME, &now);
+    for (i = 0; i < batch->count; i++) {
+        CO_CANrouteStats_t *stats = &CANmodule->routes[batch->route[i]].stats;
+
+        if (i >= n) {
+            __atomic_add_fetch(&stats->txDropped, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        int64_t latency = (int64_t)(now.tv_sec - batch->timestamp[i]->tv_sec)
+                          * 1000000
+                        + (now.tv_nsec - batch->timestamp[i]->tv_nsec) / 1000;
+        uint32_t latency_us = latency < 0 ? 0 : (uint32_t)latency;
+
+        __atomic_store_n(&stats->latencyLast_us, latency_us, __ATOMIC_RELAXED);
+        if (latency_us > stats->latencyMax_us) {
+            __atomic_store_n(&stats->latencyMax_us, latency_us,
+                             __ATOMIC_RELAXED);
+        }
+        __atomic_add_fetch(&stats->forwarded, 1, __ATOMIC_RELAXED);
+    }
+    batch->count = 0;
+}
+
+
+/* Send frames, collected for all interfaces **********************************/
+static void CO_CANrouteFlushAll(CO_CANmodule_t *CANmodule) {
+    for (uint32_t i = 0; i < CANmodule->CANinterfaceCount; i++) {
+        CO_CANrouteFlush(CANmodule, &CANmodule->CANinterfaces[i]);
+    }
+}
+
+
+/* Match received frame against routing table and collect it for sending ******/
+static void CO_CANroute(CO_CANmodule_t *CANmodule,
+                        CO_CANinterface_t *interface,
+                        const struct can_frame *msg,
+                        const struct timespec *timestamp)
+{
+    uint32_t ident = msg->can_id & (CAN_EFF_FLAG | CAN_EFF_MASK);
+    uint64_t now_us = 0;
+
+    if ((msg->can_id & CAN_ERR_FLAG) != 0) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < CANmodule->routeCount; i++) {
+        CO_CANrouteEntry_t *entry = &CANmodule->routes[i];
+        const CO_CANroute_t *route = &entry->route;
+        CO_CANinterface_t *dst = NULL;
+        CO_CANrouteBatch_t *batch;
+        struct can_frame *fwd;
+
+        if (route->srcIfindex != interface->can_ifindex
+            || ident < route->identFirst || ident > route->identLast
+        ) {
+            continue;
+        }
+
+        if (route->rateLimit > 0) {
+            /* Generic cell rate algorithm: frame conforms, if it is not
+             * earlier than its theoretical arrival time minus tolerance */
+            uint64_t tolerance_us = (uint64_t)entry->interval_us
+                                  * (route->rateBurst - 1);
+
+            if (now_us == 0) {
+                now_us = CO_CANtime_us();
+            }
+            if (entry->tat_us > now_us + tolerance_us) {
+                __atomic_add_fetch(&entry->stats.rateDropped, 1,
+                                   __ATOMIC_RELAXED);
+                continue;
+            }
+            entry->tat_us = (entry->tat_us > now_us ? entry->tat_us : now_us)
+                          + entry->interval_us;
+        }
+
+        for (uint32_t j = 0; j < CANmodule->CANinterfaceCount; j++) {
+            if (CANmodule->CANinterfaces[j].can_ifindex == route->dstIfindex) {
+                dst = &CANmodule->CANinterfaces[j];
+                break;
+            }
+        }
+        if (dst == NULL) {
+            /* destination interface was not added */
+            __atomic_add_fetch(&entry->stats.txDropped, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        batch = &dst->routeBatch;
+        if (batch->count >= CO_DRIVER_ROUTING_BATCH) {
+            CO_CANrouteFlush(CANmodule, dst);
+        }
+        fwd = &batch->frames[batch->count];
+        *fwd = *msg;
+        if (route->rewriteMask != 0) {
+            fwd->can_id = (msg->can_id & ~route->rewriteMask)
+                        | (route->rewriteValue & route->rewriteMask);
+        }
+        batch->timestamp[batch->count] = timestamp;
+        batch->route[batch->count] = (uint8_t)i;
+        batch->count++;
+    }
+}
+
+
+/******************************************************************************/
+CO_ReturnError_t CO_CANmodule_addRoute(CO_CANmodule_t *CANmodule,
+                                       const CO_CANroute_t *route)
+{
+    CO_CANrouteEntry_t *entry;
+    uint32_t identMask;
+
+    if (CANmodule == NULL || route == NULL
+        || route->srcIfindex == 0 || route->dstIfindex == 0
+        || route->srcIfindex == route->dstIfindex
+        || ((route->identFirst ^ route->identLast) & CAN_EFF_FLAG) != 0
+    ) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+    identMask = (route->identFirst & CAN_EFF_FLAG) != 0
+              ? CAN_EFF_MASK : CAN_SFF_MASK;
+    if ((route->identFirst & ~(CAN_EFF_FLAG | identMask)) != 0
+        || (route->identLast & ~(CAN_EFF_FLAG | identMask)) != 0
+        || route->identFirst > route->identLast
+        || (route->rewriteMask & ~identMask) != 0
+    ) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+    if (CANmodule->CANnormal) {
+        return CO_ERROR_INVALID_STATE;
+    }
+    if (CANmodule->routeCount >= CO_DRIVER_ROUTING_SIZE) {
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+
+    entry = &CANmodule->routes[CANmodule->routeCount];
+    memset(entry, 0, sizeof(*entry));
+    entry->route = *route;
+    if (route->rateLimit > 0) {
+        entry->interval_us = 1000000 / route->rateLimit;
+        if (entry->interval_us == 0) {
+            entry->interval_us = 1;
+        }
+        if (entry->route.rateBurst == 0) {
+            entry->route.rateBurst = 1;
+        }
+    }
+    CANmodule->routeCount++;
+
+    return CO_ERROR_NO;
+}
+
+
+/******************************************************************************/
+CO_ReturnError_t CO_CANmodule_getRouteStats(CO_CANmodule_t *CANmodule,
+                                            uint32_t index,
+                                            CO_CANrouteStats_t *stats)
+{
+    CO_CANrouteStats_t *src;
+
+    if (CANmodule == NULL || stats == NULL || index >= CANmodule->routeCount) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    src = &CANmodule->routes[index].stats;
+    stats->forwarded = __atomic_load_n(&src->forwarded, __ATOMIC_RELAXED);
+    stats->rateDropped = __atomic_load_n(&src->rateDropped, __ATOMIC_RELAXED);
+    stats->txDropped = __atomic_load_n(&src->txDropped, __ATOMIC_RELAXED);
+    stats->latencyLast_us = __atomic_load_n(&src->latencyLast_us,
+                                            __ATOMIC_RELAXED);
+    stats->latencyMax_us = __atomic_load_n(&src->latencyMax_us,
+                                           __ATOMIC_RELAXED);
+
+    return CO_ERROR_NO;
+}
+#endif /* CO_DRIVER_ROUTING > 0 */
+
+
+#if CO_DRIVER_TX_CONFIRM > 0
+/* Time difference in microseconds, 0 if negative *****************************/
+static uint32_t CO_CANtimeDiff_us(const struct timespec *later,
+                                  const struct timespec *earlier)
+{
+    int64_t diff = (int64_t)(later->tv_sec - earlier->tv_sec) * 1000000
+                 + (later->tv_nsec - earlier->tv_nsec) / 1000;
+
+    if (diff < 0) {
+        return 0;
+    }
+    return diff > UINT32_MAX ? UINT32_MAX : (uint32_t)diff;
+}
+
+
+/* Add value to latency statistics ********************************************/
+static void CO_CANtxLatency_add(CO_CANtxLatency_t *lat, uint32_t value_us) {
+    if (lat->count == 0 || value_us < lat->min_us) {
+        lat->min_us = value_us;
+    }
+    if (value_us > lat->max_us) {
+        lat->max_us = value_us;
+    }
+    lat->last_us = value_us;
+    lat->sum_us += value_us;
+    lat->count++;
+}
+
+
+/* Match echo of own message with sent frame **********************************/
+static void CO_CANtxConfirm(CO_CANmodule_t *CANmodule,
+                            CO_CANinterface_t *interface,
+                            const struct can_frame *msg,
+                            const struct timespec *timestamp)
+{
+    uint32_t ident = msg->can_id & (CAN_SFF_MASK | CAN_RTR_FLAG);
+    CO_CANtxConfirmStats_t *stats = &CANmodule->txConfirmStats;
+
+    CO_LOCK_TXCONF(CANmodule);
+    while (interface->txPendingTail != interface->txPendingHead) {
+        CO_CANtxPending_t *pending;
+
+        pending = &interface->txPending[interface->txPendingTail
+                                        & (CO_DRIVER_TX_CONFIRM_PENDING - 1)];
+        interface->txPendingTail++;
+        if (pending->buffer != NULL) {
+            pending->buffer->bufferFull = false;
+        }
+        if (pending->ident != ident) {
+            /* echo of this frame was lost */
+            stats->unconfirmed++;
+            continue;
+        }
+
+        uint32_t latency_us = CO_CANtimeDiff_us(timestamp, &pending->sent);
+        CO_CANtxLatency_add(&stats->latency, latency_us);
+        if (pending->syncFlag) {
+            CO_CANtxLatency_add(&stats->latencySync, latency_us);
+        }
+        if (pending->buffer != NULL) {
+            pending->buffer->txTimestamp = *timestamp;
+        }
+        if (ident == CO_CAN_ID_SYNC) {
+            if (CANmodule->syncLast.tv_sec != 0) {
+                CO_CANtxLatency_add(&stats->syncInterval,
+                    CO_CANtimeDiff_us(timestamp, &CANmodule->syncLast));
+            }
+            CANmodule->syncLast = *timestamp;
+        }
+        break;
+    }
+    CO_UNLOCK_TXCONF(CANmodule);
+}
+
+
+/******************************************************************************/
+void CO_CANmodule_getTxConfirmStats(CO_CANmodule_t *CANmodule,
+                                    CO_CANtxConfirmStats_t *stats,
+                                    bool_t reset)
+{
+    if (CANmodule == NULL || stats == NULL) {
+        return;
+    }
+
+    CO_LOCK_TXCONF(CANmodule);
+    *stats = CANmodule->txConfirmStats;
+    if (reset) {
+        memset(&CANmodule->txConfirmStats, 0,
+               sizeof(CANmodule->txConfirmStats));
+        CANmodule->syncLast.tv_sec = 0;
+        CANmodule->syncLast.tv_nsec = 0;
+    }
+    CO_UNLOCK_TXCONF(CANmodule);
+}
+#endif /* CO_DRIVER_TX_CONFIRM > 0 */
+
+
+#if CO_DRIVER_REPLAY > 0
+/******************************************************************************/
+CO_ReturnError_t CO_CANrxInject(CO_CANmodule_t *CANmodule,
+                                int can_ifindex,
+                                struct can_frame *msg,
+                                struct timespec *timestamp)
+{
+    uint32_t i;
+
+    if (CANmodule == NULL || msg == NULL || timestamp == NULL) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+    if (!CANmodule->CANnormal) {
+        return CO_ERROR_INVALID_STATE;
+    }
+
+    for (i = 0; i < CANmodule->CANinterfaceCount; i++) {
+        CO_CANinterface_t *interface = &CANmodule->CANinterfaces[i];
+
+        if (interface->can_ifindex == can_ifindex) {
+            CO_CANrxDispatch(CANmodule, interface, msg, timestamp, NULL, NULL);
+            return CO_ERROR_NO;
+        }
+    }
+
+    return CO_ERROR_ILLEGAL_ARGUMENT;
+}
+#endif /* CO_DRIVER_REPLAY > 0 */
+
+
+#if CO_DRIVER_RX_THREADS > 0
+/* Signal dispatching thread, if not already signaled ************************/
+static void CO_CANrxThread_notify(CO_CANrxThread_t *rxThread) {
+    if (__atomic_exchange_n(&rxThread->notifyPending, 1, __ATOMIC_SEQ_CST)
+        == 0
+    ) {
+        uint64_t u = 1;
+        if (write(rxThread->notify_fd, &u, sizeof(u)) != sizeof(u)) {
+            log_printf(LOG_DEBUG, DBG_ERRNO, "write(notify_fd)");
+        }
+    }
+}
+
+
+/* Receive thread, one per CAN interface **************************************/
+static void *CO_CANrxThread(void *arg) {
+    CO_CANrxThread_t *rxThread = (CO_CANrxThread_t *)arg;
+    struct pollfd fds[2];
+
+    fds[0].fd = rxThread->stop_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = rxThread->fd;
+    fds[1].events = POLLIN;
+
+    for (;;) {
+        uint32_t head = rxThread->head;
+        uint32_t tail = __atomic_load_n(&rxThread->tail, __ATOMIC_ACQUIRE);
+        bool_t full = (head - tail) >= CO_DRIVER_RX_THREADS_QUEUE_SIZE;
+        int ret;
+
+        /* If queue is full, leave messages in the socket queue and only wait
+         * for stop event for a short time. */
+        fds[1].revents = 0;
+        ret = poll(fds, full ? 1 : 2, full ? 1 : -1);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log_printf(LOG_DEBUG, DBG_ERRNO, "poll(rxThread)");
+            break;
+        }
+        if (fds[0].revents != 0) {
+            /* stop requested */
+            break;
+        }
+
+        if ((fds[1].revents & (POLLERR | POLLHUP)) != 0) {
+            struct can_frame msg;
+            /* poll detected close/error on socket. Try to pull event */
+            errno = 0;
+            recv(rxThread->fd, &msg, sizeof(msg), MSG_DONTWAIT);
+            log_printf(LOG_DEBUG, DBG_CAN_RX_EPOLL,
+                       fds[1].revents, strerror(errno));
+        }
+        else if ((fds[1].revents & POLLIN) != 0) {
+            CO_CANrxThreadMsg_t *qMsg;
+            uint32_t dropped = rxThread->dropped;
+
+            qMsg = &rxThread->queue[head & (CO_DRIVER_RX_THREADS_QUEUE_SIZE-1)];
+#if CO_DRIVER_TX_CONFIRM > 0
+            bool_t *confirm = &qMsg->confirm;
+#else
+            bool_t *confirm = NULL;
+#endif
+            if (CO_CANreadSocket(rxThread->fd, &qMsg->msg, &qMsg->timestamp,
+                                 &dropped, confirm) != CO_ERROR_NO
+            ) {
+                __atomic_add_fetch(&rxThread->readErrors, 1, __ATOMIC_RELEASE);
+                continue;
+            }
+            __atomic_store_n(&rxThread->dropped, dropped, __ATOMIC_RELAXED);
+
+            /* publish message, then notify */
+            __atomic_store_n(&rxThread->head, head + 1, __ATOMIC_SEQ_CST);
+            CO_CANrxThread_notify(rxThread);
+        }
+    }
+
+    return NULL;
+}
+
+
+/* Create receive thread for interface and register its eventfd in epoll ******/
+static CO_ReturnError_t CO_CANrxThread_start(CO_CANmodule_t *CANmodule,
+                                             CO_CANinterface_t *interface)
+{
+    CO_CANrxThread_t *rxThread;
+    struct epoll_event ev;
+
+    rxThread = calloc(1, sizeof(*rxThread));
+    if (rxThread == NULL) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "malloc()");
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+    interface->rxThread = rxThread;
+    rxThread->fd = interface->fd;
+    rxThread->stop_fd = eventfd(0, EFD_NONBLOCK);
+    rxThread->notify_fd = eventfd(0, EFD_NONBLOCK);
+    if (rxThread->stop_fd < 0 || rxThread->notify_fd < 0) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "eventfd(rxThread)");
+        return CO_ERROR_SYSCALL;
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.fd = rxThread->notify_fd;
+    if (epoll_ctl(CANmodule->epoll_fd, EPOLL_CTL_ADD, ev.data.fd, &ev) < 0) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "epoll_ctl(rxThread)");
+        return CO_ERROR_SYSCALL;
+    }
+
+    if (pthread_create(&rxThread->thread, NULL, CO_CANrxThread, rxThread)
+        != 0
+    ) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "pthread_create(rxThread)");
+        return CO_ERROR_SYSCALL;
+    }
+    rxThread->started = true;
+
+    return CO_ERROR_NO;
+}
+
+
+/* Terminate receive thread and release its resources ************************/
+static void CO_CANrxThread_stop(CO_CANmodule_t *CANmodule,
+                                CO_CANinterface_t *interface)
+{
+    CO_CANrxThread_t *rxThread = interface->rxThread;
+
+    if (rxThread == NULL) {
+        return;
+    }
+
+    if (rxThread->started) {
+        uint64_t u = 1;
+        if (write(rxThread->stop_fd, &u, sizeof(u)) != sizeof(u)) {
+            log_printf(LOG_DEBUG, DBG_ERRNO, "write(stop_fd)");
+        }
+        pthread_join(rxThread->thread, NULL);
+    }
+    if (rxThread->notify_fd > 0) {
+        epoll_ctl(CANmodule->epoll_fd, EPOLL_CTL_DEL, rxThread->notify_fd, NULL);
+        close(rxThread->notify_fd);
+    }
+    if (rxThread->stop_fd > 0) {
+        close(rxThread->stop_fd);
+    }
+    free(rxThread);
+    interface->rxThread = NULL;
+}
+
+
+#if CO_DRIVER_RX_THREADS_PRIORITY > 0
+/* Number of priority classes for batch dispatching */
+#define CO_CAN_RX_PRIORITY_CLASSES 3
+
+/* Get priority class of received message, 0 is the highest ******************/
+static uint8_t CO_CANrxThread_priority(const struct can_frame *msg) {
+    canid_t ident = msg->can_id;
+
+    if ((ident & CAN_ERR_FLAG) != 0) {
+        return 0;
+    }
+    if ((ident & CAN_EFF_FLAG) != 0) {
+        return 2;
+    }
+    ident &= CAN_SFF_MASK;
+    if (ident <= CO_CAN_ID_TPDO_1) {
+        /* NMT, GFC, SYNC, EMCY, TIME, SRDO */
+        return 0;
+    }
+    if (ident < CO_CAN_ID_SDO_SRV) {
+        /* PDO */
+        return 1;
+    }
+    return 2;
+}
+#endif
+
+
+/* Dispatch batch of messages from receive thread queue ***********************/
+static void CO_CANrxThread_dispatch(CO_CANmodule_t *CANmodule,
+                                    CO_CANinterface_t *interface,
+                                    CO_CANrxMsg_t *buffer,
+                                    int32_t *msgIndex)
+{
+    CO_CANrxThread_t *rxThread = interface->rxThread;
+    uint32_t head, tail, count, i, readErrors;
+    uint64_t u;
+
+    /* clear notification before reading the queue, so any later message
+     * triggers new notification */
+    if (read(rxThread->notify_fd, &u, sizeof(u)) < 0 && errno != EAGAIN) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "read(notify_fd)");
+    }
+    __atomic_store_n(&rxThread->notifyPending, 0, __ATOMIC_SEQ_CST);
+
+    CO_CANrxDropped(CANmodule, interface,
+                    __atomic_load_n(&rxThread->dropped, __ATOMIC_RELAXED));
+    readErrors = __atomic_load_n(&rxThread->readErrors, __ATOMIC_ACQUIRE);
+    if (readErrors != rxThread->readErrorsPrev) {
+        rxThread->readErrorsPrev = readErrors;
+#if CO_DRIVER_ERROR_REPORTING > 0
+        interface->errorhandler.CANerrorStatus |= CO_CAN_ERRRX_OVERFLOW;
+#endif
+        log_printf(LOG_DEBUG, DBG_CAN_RX_FAILED, interface->ifName);
+    }
+
+    tail = rxThread->tail;
+    head = __atomic_load_n(&rxThread->head, __ATOMIC_SEQ_CST);
+    count = head - tail;
+    if (count > CO_DRIVER_RX_THREADS_BATCH) {
+        count = CO_DRIVER_RX_THREADS_BATCH;
+    }
+
+#if CO_DRIVER_ROUTING > 0
+    /* Forward frames first, with one system call per destination, then
+     * dispatch them. CO_CANrxDispatch() modifies can_id. */
+    if (CANmodule->routeCount > 0 && CANmodule->CANnormal) {
+        for (i = 0; i < count; i++) {
+            CO_CANrxThreadMsg_t *qMsg;
+
+            qMsg = &rxThread->queue[(tail + i)
+                                    & (CO_DRIVER_RX_THREADS_QUEUE_SIZE-1)];
+#if CO_DRIVER_TX_CONFIRM > 0
+            if (qMsg->confirm) {
+                continue;
+            }
+#endif
+            CO_CANroute(CANmodule, interface, &qMsg->msg, &qMsg->timestamp);
+        }
+        CO_CANrouteFlushAll(CANmodule);
+    }
+#endif
+
+#if CO_DRIVER_RX_THREADS_PRIORITY > 0
+    /* Classify the batch first, CO_CANrxDispatch() modifies can_id. Then
+     * dispatch class by class, each in reception order. Messages stay in the
+     * queue, until whole batch is dispatched. */
+    uint8_t priority[CO_DRIVER_RX_THREADS_BATCH];
+    uint8_t classUsed = 0;
+
+    for (i = 0; i < count; i++) {
+        uint32_t qIdx = (tail + i) & (CO_DRIVER_RX_THREADS_QUEUE_SIZE-1);
+#if CO_DRIVER_TX_CONFIRM > 0
+        if (rxThread->queue[qIdx].confirm) {
+            /* echo of own message is not dispatched */
+            CO_CANtxConfirm(CANmodule, interface, &rxThread->queue[qIdx].msg,
+                            &rxThread->queue[qIdx].timestamp);
+            priority[i] = CO_CAN_RX_PRIORITY_CLASSES;
+            continue;
+        }
+#endif
+        priority[i] = CO_CANrxThread_priority(&rxThread->queue[qIdx].msg);
+        classUsed |= 1 << priority[i];
+    }
+    for (uint8_t prio = 0; prio < CO_CAN_RX_PRIORITY_CLASSES; prio++) {
+        if ((classUsed & (1 << prio)) == 0) {
+            continue;
+        }
+        for (i = 0; i < count && CANmodule->CANnormal; i++) {
+            CO_CANrxThreadMsg_t *qMsg;
+
+            if (priority[i] != prio) {
+                continue;
+            }
+            qMsg = &rxThread->queue[(tail + i)
+                                    & (CO_DRIVER_RX_THREADS_QUEUE_SIZE-1)];
+            CO_CANrxDispatch(CANmodule, interface, &qMsg->msg,
+                             &qMsg->timestamp, buffer, msgIndex);
+        }
+    }
+#else
+    for (i = 0; i < count && CANmodule->CANnormal; i++) {
+        CO_CANrxThreadMsg_t *qMsg;
+
+        qMsg = &rxThread->queue[(tail + i)
+                                & (CO_DRIVER_RX_THREADS_QUEUE_SIZE-1)];
+#if CO_DRIVER_TX_CONFIRM > 0
+        if (qMsg->confirm) {
+            /* echo of own message is not dispatched */
+            CO_CANtxConfirm(CANmodule, interface, &qMsg->msg,
+                            &qMsg->timestamp);
+            continue;
+        }
+#endif
+        CO_CANrxDispatch(CANmodule, interface, &qMsg->msg,
+                         &qMsg->timestamp, buffer, msgIndex);
+    }
+#endif
+    tail += count;
+    __atomic_store_n(&rxThread->tail, tail, __ATOMIC_RELEASE);
+
+    /* batch limit reached, let other interfaces run, then continue */
+    if (tail != head) {
+        CO_CANrxThread_notify(rxThread);
+    }
+}
+
+
+/******************************************************************************/
+CO_ReturnError_t CO_CANmodule_setRxThreadAffinity(CO_CANmodule_t *CANmodule,
+                                                  int can_ifindex,
+                                                  int cpu,
+                                                  int priority)
+{
+    CO_CANrxThread_t *rxThread = NULL;
+    uint32_t i;
+
+    if (CANmodule == NULL) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+    for (i = 0; i < CANmodule->CANinterfaceCount; i++) {
+        if (CANmodule->CANinterfaces[i].can_ifindex == can_ifindex) {
+            rxThread = CANmodule->CANinterfaces[i].rxThread;
+            break;
+        }
+    }
+    if (rxThread == NULL || !rxThread->started) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    if (cpu >= 0) {
+        cpu_set_t cpuset;
+
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpu, &cpuset);
+        errno = pthread_setaffinity_np(rxThread->thread,
+                                       sizeof(cpuset), &cpuset);
+        if (errno != 0) {
+            log_printf(LOG_DEBUG, DBG_ERRNO, "pthread_setaffinity_np()");
+            return CO_ERROR_SYSCALL;
+        }
+    }
+    if (priority > 0) {
+        struct sched_param param;
+
+        param.sched_priority = priority;
+        errno = pthread_setschedparam(rxThread->thread, SCHED_FIFO, &param);
+        if (errno != 0) {
+            log_printf(LOG_DEBUG, DBG_ERRNO, "pthread_setschedparam()");
+            return CO_ERROR_SYSCALL;
+        }
+    }
+
+    return CO_ERROR_NO;
+}
+#endif /* CO_DRIVER_RX_THREADS > 0 */
+
+
+#if CO_DRIVER_TX_QUEUE > 0
+/* Create transmit queue on first call and register its eventfd in epoll *****/
+static CO_ReturnError_t CO_CANtxQueue_init(CO_CANmodule_t *CANmodule) {
+    CO_CANtxQueue_t *q = &CANmodule->txQueue;
+    struct epoll_event ev;
+
+    /* CANmodule is zero initialized by CO_new(). Queue is initialized only
+     * once, because other threads may use it during communication reset. */
+    if (!q->initialized) {
+        uint32_t i;
+
+        for (i = 0; i < CO_DRIVER_TX_QUEUE_SIZE; i++) {
+            q->slots[i].seq = i;
+        }
+        q->head = 0;
+        q->tail = 0;
+        q->notifyPending = 0;
+        q->overflow = 0;
+        q->syncClearPos = 0;
+        q->syncClearPending = false;
+        q->notify_fd = eventfd(0, EFD_NONBLOCK);
+        if (q->notify_fd < 0) {
+            log_printf(LOG_DEBUG, DBG_ERRNO, "eventfd(txQueue)");
+            return CO_ERROR_SYSCALL;
+        }
+        q->initialized = true;
+    }
+
+    /* eventfd may already be signaled, epoll is level triggered */
+    ev.events = EPOLLIN;
+    ev.data.fd = q->notify_fd;
+    if (epoll_ctl(CANmodule->epoll_fd, EPOLL_CTL_ADD, ev.data.fd, &ev) < 0
+        && errno != EEXIST
+    ) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "epoll_ctl(txQueue)");
+        return CO_ERROR_SYSCALL;
+    }
+
+    return CO_ERROR_NO;
+}
+
+
+/* Signal eventfd, if not already signaled ************************************/
+static void CO_CANtxQueue_notify(CO_CANtxQueue_t *q) {
+    if (__atomic_exchange_n(&q->notifyPending, 1, __ATOMIC_SEQ_CST) == 0) {
+        uint64_t u = 1;
+
+        if (write(q->notify_fd, &u, sizeof(u)) != sizeof(u)) {
+            log_printf(LOG_DEBUG, DBG_ERRNO, "write(txQueue)");
+        }
+    }
+}
+
+
+/******************************************************************************/
+CO_ReturnError_t CO_CANsendAsync(CO_CANmodule_t *CANmodule,
+                                 const CO_CANtx_t *buffer)
+{
+    CO_CANtxQueue_t *q;
+    CO_CANtxQueueSlot_t *slot;
+    uint32_t pos;
+
+    if (CANmodule == NULL || buffer == NULL
+        || !__atomic_load_n(&CANmodule->txQueue.initialized, __ATOMIC_ACQUIRE)
+    ) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+    q = &CANmodule->txQueue;
+
+    /* reserve slot at head position */
+    pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    for (;;) {
+        int32_t diff;
+
+        slot = &q->slots[pos & (CO_DRIVER_TX_QUEUE_SIZE - 1)];
+        diff = (int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0) {
+            /* slot is free, on failure pos is updated to the current head */
+            if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+            ) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            /* slot still holds message from previous lap, queue is full */
+            __atomic_add_fetch(&q->overflow, 1, __ATOMIC_RELAXED);
+            return CO_ERROR_TX_OVERFLOW;
+        }
+        else {
+            /* other producer took the slot */
+            pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->msg.ident = buffer->ident;
+    slot->msg.DLC = buffer->DLC;
+    memcpy(slot->msg.data, buffer->data, sizeof(slot->msg.data));
+    slot->msg.syncFlag = buffer->syncFlag;
+    slot->msg.can_ifindex = buffer->can_ifindex;
+    slot->msg.deadline_us = buffer->deadline_us;
+    slot->msg.busyRetry = false;
+
+    /* message is ready for the consumer */
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_SEQ_CST);
+    CO_CANtxQueue_notify(q);
+
+    return CO_ERROR_NO;
+}
+
+
+/* Send batch of messages from transmit queue *********************************/
+static void CO_CANtxQueue_dispatch(CO_CANmodule_t *CANmodule) {
+    CO_CANtxQueue_t *q = &CANmodule->txQueue;
+    uint32_t tail = q->tail;
+    uint64_t u;
+    int n;
+
+    /* clear notification before reading the queue, so any later message
+     * triggers new notification */
+    if (read(q->notify_fd, &u, sizeof(u)) < 0 && errno != EAGAIN) {
+        log_printf(LOG_DEBUG, DBG_ERRNO, "read(txQueue)");
+    }
+    __atomic_store_n(&q->notifyPending, 0, __ATOMIC_SEQ_CST);
+
+    /* During communication reset there are no interfaces. Messages stay in
+     * the queue, CO_CANsetNormalMode() notifies again. */
+    CO_LOCK_TXSEND(CANmodule);
+    if (!CANmodule->CANnormal || CANmodule->CANinterfaceCount == 0) {
+        CO_UNLOCK_TXSEND(CANmodule);
+        return;
+    }
+
+    for (n = 0; n < CO_DRIVER_TX_QUEUE_BATCH; n++) {
+        CO_CANtxQueueSlot_t *slot;
+
+        slot = &q->slots[tail & (CO_DRIVER_TX_QUEUE_SIZE - 1)];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_SEQ_CST) != tail + 1) {
+            /* queue is empty or producer didn't finish the slot yet. It
+             * will notify again, when it does. */
+            break;
+        }
+
+        /* messages are either written to the socket queue or dropped. Drop
+         * also late messages: past deadline (in CO_CANCheckSend()) or
+         * synchronous, queued before the end of the synchronous window. */
+        if (q->syncClearPending && (int32_t)(tail - q->syncClearPos) >= 0) {
+            q->syncClearPending = false;
+        }
+        if (q->syncClearPending && slot->msg.syncFlag) {
+            CO_CANtxLate(CANmodule, &slot->msg);
+        }
+        else {
+            (void)CO_CANCheckSend(CANmodule, &slot->msg);
+        }
+
+        /* release the slot for the producers of the next lap */
+        __atomic_store_n(&slot->seq, tail + CO_DRIVER_TX_QUEUE_SIZE,
+                         __ATOMIC_RELEASE);
+        tail++;
+    }
+    q->tail = tail;
+    CO_UNLOCK_TXSEND(CANmodule);
+
+    /* batch limit reached, let other events run, then continue */
+    if (n == CO_DRIVER_TX_QUEUE_BATCH) {
+        CO_CANtxQueue_notify(q);
+    }
+}
+#endif /* CO_DRIVER_TX_QUEUE > 0 */
+
+
 /******************************************************************************/
 bool_t CO_CANrxFromEpoll(CO_CANmodule_t *CANmodule,
                          struct epoll_event *ev,
                          CO_CANrxMsg_t *buffer,
                          int32_t *msgIndex)
 {
+#if CO_DRIVER_TX_QUEUE > 0
+    if (CANmodule != NULL && ev != NULL
+        && CANmodule->txQueue.initialized
+        && ev->data.fd == CANmodule->txQueue.notify_fd
+    ) {
+        CO_CANtxQueue_dispatch(CANmodule);
+        return true;
+    }
+#endif
+
     if (CANmodule == NULL || ev == NULL || CANmodule->CANinterfaceCount == 0) {
         return false;
     }
@@ -852,6 +2576,14 @@ bool_t CO_CANrxFromEpoll(CO_CANmodule_t *CANmodule,
     for (uint32_t i = 0; i < CANmodule->CANinterfaceCount; i ++) {
         CO_CANinterface_t *interface = &CANmodule->CANinterfaces[i];
 
+#if CO_DRIVER_RX_THREADS > 0
+        if (interface->rxThread != NULL
+            && ev->data.fd == interface->rxThread->notify_fd
+        ) {
+            CO_CANrxThread_dispatch(CANmodule, interface, buffer, msgIndex);
+            return true;
+        }
+#endif
         if (ev->data.fd == interface->fd) {
             if ((ev->events & (EPOLLERR | EPOLLHUP)) != 0) {
                 struct can_frame msg;
@@ -860,40 +2592,35 @@ bool_t CO_CANrxFromEpoll(CO_CANmodule_t *CANmodule,
                 recv(ev->data.fd, &msg, sizeof(msg), MSG_DONTWAIT);
                 log_printf(LOG_DEBUG, DBG_CAN_RX_EPOLL,
                            ev->events, strerror(errno));
+#if CO_DRIVER_REDUNDANCY > 0
+                CO_CANredundancy_fail(CANmodule, i, "socket error");
+#endif
             }
             else if ((ev->events & EPOLLIN) != 0) {
                 struct can_frame msg;
                 struct timespec timestamp;
+                bool_t confirm = false;
 
                 /* get message */
                 CO_ReturnError_t err = CO_CANread(CANmodule, interface,
-                                                  &msg, &timestamp);
-
-                if(err == CO_ERROR_NO && CANmodule->CANnormal) {
+                                                  &msg, &timestamp, &confirm);
 
-                    if (msg.can_id & CAN_ERR_FLAG) {
-                        /* error msg */
-#if CO_DRIVER_ERROR_REPORTING > 0
-                        CO_CANerror_rxMsgError(&interface->errorhandler, &msg);
+#if CO_DRIVER_TX_CONFIRM > 0
+                if (err == CO_ERROR_NO && confirm) {
+                    /* echo of own message is not dispatched */
+                    CO_CANtxConfirm(CANmodule, interface, &msg, &timestamp);
+                }
+                else
 #endif
+                if(err == CO_ERROR_NO && CANmodule->CANnormal) {
+#if CO_DRIVER_ROUTING > 0
+                    if (CANmodule->routeCount > 0) {
+                        CO_CANroute(CANmodule, interface, &msg, &timestamp);
+                        CO_CANrouteFlushAll(CANmodule);
                     }
-                    else {
-                        /* data msg */
-#if CO_DRIVER_ERROR_REPORTING > 0
-                        /* clear listenOnly and noackCounter if necessary */
-                        CO_CANerror_rxMsg(&interface->errorhandler);
-#endif
-                        int32_t idx = CO_CANrxMsg(CANmodule, &msg, buffer);
-                        if (idx > -1) {
-                            /* Store message info */
-                            CANmodule->rxArray[idx].timestamp = timestamp;
-                            CANmodule->rxArray[idx].can_ifindex =
-                                                        interface->can_ifindex;
-                        }
-                        if (msgIndex != NULL) {
-                            *msgIndex = idx;
-                        }
-                    }
+#endif
+                    CO_CANrxDispatch(CANmodule, interface, &msg, &timestamp,
+                                     buffer, msgIndex);
                 }
             }
             else {
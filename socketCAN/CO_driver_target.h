@@ -37,6 +37,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <endian.h>
+#include <time.h>
 #ifndef CO_SINGLE_THREAD
 #include <pthread.h>
 #endif
@@ -160,7 +161,7 @@ extern "C" {
                        CO_CONFIG_GTW_ASCII_ERROR_DESC | \
                        CO_CONFIG_GTW_ASCII_PRINT_HELP | \
                        CO_CONFIG_GTW_ASCII_PRINT_LEDS)
-#define CO_CONFIG_GTW_BLOCK_DL_LOOP 3
+#define CO_CONFIG_GTW_BLOCK_DL_LOOP 1
 #define CO_CONFIG_GTWA_COMM_BUF_SIZE 2000
 #define CO_CONFIG_GTWA_LOG_BUF_SIZE 10000
 #endif
@@ -181,6 +182,11 @@ extern "C" {
 #define CO_CONFIG_TRACE (CO_CONFIG_TRACE_ENABLE)
 #endif
 
+#ifndef CO_CONFIG_MBX
+#define CO_CONFIG_MBX (CO_CONFIG_MBX_ENABLE | \
+                       CO_CONFIG_MBX_PROCESS_IMAGE)
+#endif
+
 
 /* Print debug info from some internal parts of the stack */
 #if (CO_CONFIG_DEBUG) & CO_CONFIG_DEBUG_COMMON
@@ -216,7 +222,8 @@ extern "C" {
  *
  * Macro is set to 0 (disabled) by default. It can be overridden.
  *
- * This is not intended to realize interface redundancy!!!
+ * This alone does not realize interface redundancy, see
+ * @ref CO_DRIVER_REDUNDANCY.
  */
 #ifndef CO_DRIVER_MULTI_INTERFACE
 #define CO_DRIVER_MULTI_INTERFACE 0
@@ -243,6 +250,317 @@ extern "C" {
 #define CO_DRIVER_ERROR_REPORTING 1
 #endif
 
+/**
+ * Receive threads
+ *
+ * If CO_DRIVER_RX_THREADS is set to 1, then each socketCAN interface added to
+ * the CANmodule gets its own receive thread. Thread blocks on its socket, reads
+ * CAN messages and pushes them together with the reception timestamp into a
+ * lock-free single-producer/single-consumer queue. Socket itself is not
+ * registered into the epoll. Instead, an eventfd per interface is registered
+ * and signaled, when queue becomes non-empty.
+ *
+ * Messages are then dispatched to CANopen objects by the thread, which calls
+ * CO_CANrxFromEpoll() (realtime thread in CO_epoll_processRT()). It takes at
+ * most CO_DRIVER_RX_THREADS_BATCH messages from one interface per call, so one
+ * saturated bus can not starve the others. Dispatching is always done from
+ * single thread, so CANrx_callback functions are never called concurrently.
+ *
+ * Ordering: messages received on the same interface are dispatched in
+ * reception order, so order is preserved for each COB-ID on each interface.
+ * There is no ordering guarantee between messages from different interfaces.
+ *
+ * If CO_DRIVER_RX_THREADS_PRIORITY is set to 1 (default), messages inside one
+ * batch are dispatched by priority class, based on CAN-ID ranges of the
+ * predefined connection set: first error frames, NMT, GFC, SYNC, EMCY, TIME
+ * and SRDO (CAN-ID up to 0x180), then PDO (up to 0x57F), then the rest (SDO,
+ * heartbeat, LSS, extended frames). So a burst of SDO segments does not delay
+ * SYNC or NMT, received in the same batch. Reception order is still preserved
+ * within each class, so also for each COB-ID.
+ *
+ * If queue is full, receive thread stops reading the socket until there is
+ * space again, so messages are buffered inside the kernel socket queue and
+ * drops are reported as before (SO_RXQ_OVFL).
+ *
+ * Thread can be pinned to a CPU core and set to realtime priority with
+ * CO_CANmodule_setRxThreadAffinity(). Option requires multi-thread operation
+ * and is intended for use together with @ref CO_DRIVER_MULTI_INTERFACE.
+ *
+ * Macro is set to 0 (disabled) by default. It can be overridden.
+ */
+#ifndef CO_DRIVER_RX_THREADS
+#define CO_DRIVER_RX_THREADS 0
+#endif
+
+#if CO_DRIVER_RX_THREADS > 0 || defined CO_DOXYGEN
+#ifdef CO_SINGLE_THREAD
+#error CO_DRIVER_RX_THREADS can not be used with CO_SINGLE_THREAD
+#endif
+/** Size of the receive queue for each interface, must be power of 2. */
+#ifndef CO_DRIVER_RX_THREADS_QUEUE_SIZE
+#define CO_DRIVER_RX_THREADS_QUEUE_SIZE 256
+#endif
+/** Maximum number of messages dispatched from one interface at once. */
+#ifndef CO_DRIVER_RX_THREADS_BATCH
+#define CO_DRIVER_RX_THREADS_BATCH 16
+#endif
+/** Dispatch messages inside batch by priority class. */
+#ifndef CO_DRIVER_RX_THREADS_PRIORITY
+#define CO_DRIVER_RX_THREADS_PRIORITY 1
+#endif
+#endif
+
+/**
+ * Thread-safe transmit queue
+ *
+ * CO_CANsend() is not thread safe in this driver and must be called only from
+ * threads, which process CANopen objects. If CO_DRIVER_TX_QUEUE is set to 1,
+ * then CO_CANsendAsync() is available for application-originated CAN messages.
+ * It may be called from any number of threads at the same time and never
+ * blocks.
+ *
+ * Messages are copied into a bounded lock-free multi-producer/single-consumer
+ * queue inside CANmodule. Producers reserve a slot with compare-and-swap and
+ * signal an eventfd, registered into the epoll of the CANmodule, when queue
+ * becomes non-empty. Thread, which calls CO_CANrxFromEpoll() (realtime thread
+ * in CO_epoll_processRT()), then sends at most CO_DRIVER_TX_QUEUE_BATCH
+ * messages at once, each on the interface selected by its can_ifindex (or on
+ * all interfaces, if 0). Messages from one producer are sent in order.
+ *
+ * Queue and its eventfd are created on first CO_CANmodule_init() and stay
+ * valid across communication resets, like the mutexes, so producers need not
+ * synchronize with the reset. Messages queued during reset stay in the queue
+ * and are sent after CO_CANsetNormalMode().
+ *
+ * Sending from the queue and CO_CANsend() (from mainline and realtime thread)
+ * are serialized by a mutex of the CANmodule, because they share the state of
+ * the interfaces.
+ *
+ * Macro is set to 0 (disabled) by default. It can be overridden.
+ */
+#ifndef CO_DRIVER_TX_QUEUE
+#define CO_DRIVER_TX_QUEUE 0
+#endif
+
+#if CO_DRIVER_TX_QUEUE > 0 || defined CO_DOXYGEN
+#ifdef CO_SINGLE_THREAD
+#error CO_DRIVER_TX_QUEUE can not be used with CO_SINGLE_THREAD
+#endif
+/** Size of the transmit queue of the CANmodule, must be power of 2. */
+#ifndef CO_DRIVER_TX_QUEUE_SIZE
+#define CO_DRIVER_TX_QUEUE_SIZE 256
+#endif
+/** Maximum number of messages sent from the transmit queue at once. */
+#ifndef CO_DRIVER_TX_QUEUE_BATCH
+#define CO_DRIVER_TX_QUEUE_BATCH 32
+#endif
+#endif
+
+/**
+ * Capture of CAN traffic
+ *
+ * If CO_DRIVER_CAPTURE is set to 1, then driver copies each received frame
+ * (after it is read and dispatched, also error frames) and each transmitted
+ * frame (after send()) into the ring of the CO_CANcapture_t object, attached
+ * to the CANmodule. Copy is lock-free, makes no system call and never waits;
+ * if ring is full, frame is counted and discarded. Background thread writes
+ * the ring every CO_DRIVER_CAPTURE_INTERVAL_MS into rotating pcapng files,
+ * see CO_CANcapture.h. Compared to candump next to the application there is no
+ * extra socket, and received frames carry the rxArray index, they were
+ * dispatched to.
+ *
+ * If no capture object is attached, cost is one pointer test per frame.
+ *
+ * Macro is set to 0 (disabled) by default. It can be overridden.
+ */
+#ifndef CO_DRIVER_CAPTURE
+#define CO_DRIVER_CAPTURE 0
+#endif
+
+#if CO_DRIVER_CAPTURE > 0 || defined CO_DOXYGEN
+#ifdef CO_SINGLE_THREAD
+#error CO_DRIVER_CAPTURE can not be used with CO_SINGLE_THREAD
+#endif
+/** Number of records in the capture ring, must be power of 2. */
+#ifndef CO_DRIVER_CAPTURE_RING_SIZE
+#define CO_DRIVER_CAPTURE_RING_SIZE 4096
+#endif
+/** Interval of the capture background thread in milliseconds. */
+#ifndef CO_DRIVER_CAPTURE_INTERVAL_MS
+#define CO_DRIVER_CAPTURE_INTERVAL_MS 10
+#endif
+#endif
+
+/**
+ * Replay of captured CAN traffic
+ *
+ * If CO_DRIVER_REPLAY is set to 1, then CO_CANrxInject() is available and a
+ * CO_CANreplay_t object can be attached to the CANmodule. Replay object reads
+ * candump log or pcapng file and injects frames into the CANmodule as if they
+ * were received, in real time, N times faster or as fast as possible with
+ * virtual time, see CO_CANreplay.h. While replay object is attached, frames
+ * sent by the stack are not written to the socket, they are recorded into the
+ * replay output file.
+ *
+ * Macro is set to 0 (disabled) by default. It can be overridden.
+ */
+#ifndef CO_DRIVER_REPLAY
+#define CO_DRIVER_REPLAY 0
+#endif
+
+/**
+ * Transmit confirmation
+ *
+ * Successful send() means only, that the frame is in the socket queue. If
+ * CO_DRIVER_TX_CONFIRM is set to 1, then each interface socket enables
+ * CAN_RAW_RECV_OWN_MSGS, so kernel returns each own frame after it was sent
+ * on the bus. Such echo frame is marked with MSG_CONFIRM and carries the
+ * receive software timestamp (SO_TIMESTAMPING), taken by the CAN driver on TX
+ * complete (with drivers, which use the standard echo mechanism). CAN_RAW
+ * filters also apply to echo frames, so identifiers of the txArray are added
+ * to the socket filters.
+ *
+ * Driver keeps a FIFO of sent frames per interface (echo frames come back in
+ * the same order) and matches echo frames against it. Echo frames are not
+ * dispatched to CANopen objects, the cost for them is a flag test. For matched
+ * frames:
+ * - _txTimestamp_ of the transmit buffer is set to the time of confirmation,
+ * - _bufferFull_ of the transmit buffer is true from send() to confirmation,
+ *   so objects, which test it (SDO, Emergency) wait for the bus, like with
+ *   microcontroller CAN drivers,
+ * - latency from send() to confirmation is added to statistics, separately
+ *   for synchronous messages (_syncFlag_, TPDO),
+ * - interval between consecutive confirmed SYNC messages (CAN-ID
+ *   CO_CAN_ID_SYNC) is added to statistics, its range is SYNC producer jitter.
+ *
+ * Frames without confirmation for CO_DRIVER_TX_CONFIRM_TIMEOUT_MS (bus off,
+ * no acknowledge) are counted as unconfirmed and their _bufferFull_ cleared by
+ * CO_CANmodule_process(). Statistics are available with
+ * CO_CANmodule_getTxConfirmStats().
+ *
+ * Macro is set to 0 (disabled) by default. It can be overridden.
+ */
+#ifndef CO_DRIVER_TX_CONFIRM
+#define CO_DRIVER_TX_CONFIRM 0
+#endif
+
+#if CO_DRIVER_TX_CONFIRM > 0 || defined CO_DOXYGEN
+/** Number of sent, not yet confirmed frames per interface, power of 2. */
+#ifndef CO_DRIVER_TX_CONFIRM_PENDING
+#define CO_DRIVER_TX_CONFIRM_PENDING 64
+#endif
+/** Time after which sent frame without echo is counted as unconfirmed. */
+#ifndef CO_DRIVER_TX_CONFIRM_TIMEOUT_MS
+#define CO_DRIVER_TX_CONFIRM_TIMEOUT_MS 100
+#endif
+#endif
+
+/**
+ * Routing between CAN interfaces
+ *
+ * If CO_DRIVER_ROUTING is set to 1, then CANmodule forwards received frames
+ * from one interface to another, as configured by the routing table, see
+ * CO_CANmodule_addRoute(). Each route has the source and the destination
+ * interface, range of CAN identifiers, optional rewrite of the identifier and
+ * optional rate limit. Frame, which matches more routes, is forwarded by each
+ * of them.
+ *
+ * Forwarding is done by the thread, which calls CO_CANrxFromEpoll(), inside
+ * the receive batch (see @ref CO_DRIVER_RX_THREADS): frames of the batch are
+ * routed first, then sent with one sendmmsg() per destination interface, and
+ * then dispatched to CANopen objects, as before. Frames are sent on a
+ * separate socket of the destination interface, so they don't interfere with
+ * messages of the CANopen stack (transmit confirmation, for example). Socket
+ * filters of the source interface are extended with the identifier ranges of
+ * the routes, decomposed into identifier/mask pairs.
+ *
+ * Routes are active only in normal mode of the CANmodule. Error frames and
+ * echo of own frames are never forwarded.
+ *
+ * Macro is set to 0 (disabled) by default. It can be overridden. It requires
+ * @ref CO_DRIVER_MULTI_INTERFACE.
+ */
+#ifndef CO_DRIVER_ROUTING
+#define CO_DRIVER_ROUTING 0
+#endif
+
+#if CO_DRIVER_ROUTING > 0 || defined CO_DOXYGEN
+#if CO_DRIVER_MULTI_INTERFACE == 0
+#error CO_DRIVER_ROUTING requires CO_DRIVER_MULTI_INTERFACE
+#endif
+/** Maximum number of routes. */
+#ifndef CO_DRIVER_ROUTING_SIZE
+#define CO_DRIVER_ROUTING_SIZE 16
+#endif
+/** Maximum number of frames sent to one interface with one sendmmsg(). */
+#ifndef CO_DRIVER_ROUTING_BATCH
+#define CO_DRIVER_ROUTING_BATCH 16
+#endif
+/** If set to 1, forwarded frames are also received by other sockets on the
+ * destination interface, including the socket of this CANmodule. This is
+ * required for testing with vcan. Routes in opposite directions must then not
+ * overlap, otherwise frames circulate. If set to 0, forwarded frames are only
+ * sent on the bus, like frames from a separate gateway. */
+#ifndef CO_DRIVER_ROUTING_LOOPBACK
+#define CO_DRIVER_ROUTING_LOOPBACK 0
+#endif
+#endif
+
+/**
+ * Redundant CAN (CiA 302-6)
+ *
+ * If CO_DRIVER_REDUNDANCY is set to 1, then the first two interfaces, added
+ * with CO_CANmodule_addInterface(), are the default line and the redundant
+ * line of the same CANopen network. Devices send their messages on both lines.
+ *
+ * Receive: frames are accepted from both lines. Copy of the standard frame,
+ * which arrives on the other line, is suppressed: driver counts frames per
+ * CAN-ID on each line and drops the frame, if the other line has already
+ * delivered the same number of frames with that CAN-ID within
+ * CO_DRIVER_REDUNDANCY_WINDOW_US. Extended frames are not suppressed.
+ *
+ * Transmit: messages for all interfaces (can_ifindex == 0) are sent only on
+ * the active line, except heartbeat, which is sent on both lines, so other
+ * devices can monitor both. Messages for specific interface are not changed.
+ *
+ * Line fails, when:
+ * - send() on the line fails (interface down, for example),
+ * - line is in bus off or in listen only mode (no acknowledge), see
+ *   @ref CO_DRIVER_ERROR_REPORTING,
+ * - socket of the line reports error,
+ * - nothing is received on the line for CO_DRIVER_REDUNDANCY_TIMEOUT_MS,
+ *   while heartbeats are received on the other line (checked in
+ *   CO_CANmodule_process()).
+ *
+ * If the active line fails and the other line is healthy, the other line
+ * becomes active at once and the message, which failed, is sent on it. Failed
+ * line recovers, when a frame is received on it again, but active line is not
+ * switched back automatically. CANerrorStatus of the CANmodule is taken from
+ * the active line. State and failover latency (from the first failure
+ * indication to the first frame sent on the other line) are available with
+ * CO_CANmodule_getRedundancy().
+ *
+ * Macro is set to 0 (disabled) by default. It can be overridden. It requires
+ * @ref CO_DRIVER_MULTI_INTERFACE.
+ */
+#ifndef CO_DRIVER_REDUNDANCY
+#define CO_DRIVER_REDUNDANCY 0
+#endif
+
+#if CO_DRIVER_REDUNDANCY > 0 || defined CO_DOXYGEN
+#if CO_DRIVER_MULTI_INTERFACE == 0
+#error CO_DRIVER_REDUNDANCY requires CO_DRIVER_MULTI_INTERFACE
+#endif
+/** Time window for the copy of the frame on the other line. */
+#ifndef CO_DRIVER_REDUNDANCY_WINDOW_US
+#define CO_DRIVER_REDUNDANCY_WINDOW_US 2000
+#endif
+/** Time without reception, after which line fails. */
+#ifndef CO_DRIVER_REDUNDANCY_TIMEOUT_MS
+#define CO_DRIVER_REDUNDANCY_TIMEOUT_MS 100
+#endif
+#endif
+
 /* skip this section for Doxygen, because it is documented in CO_driver.h */
 #ifndef CO_DOXYGEN
 
@@ -272,6 +590,16 @@ typedef char                    char_t;
 typedef unsigned char           oChar_t;
 typedef unsigned char           domain_t;
 
+/* Free running time stamp in microseconds, used for measurement of execution
+ * times */
+static inline uint32_t CO_timestamp_us_linux(void) {
+    struct timespec ts;
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000
+                      + (uint64_t)ts.tv_nsec / 1000);
+}
+#define CO_timestamp_us() CO_timestamp_us_linux()
+
 
 /* CAN receive message structure as aligned in socketCAN. */
 typedef struct {
@@ -294,6 +622,11 @@ static inline uint8_t *CO_CANrxMsg_readData(void *rxMsg) {
     CO_CANrxMsg_t *rxMsgCasted = (CO_CANrxMsg_t *)rxMsg;
     return (uint8_t *) (rxMsgCasted->data);
 }
+/* Reception time of the message, passed to CANrx_callback, in time base of
+ * CO_timestamp_us(). Socket timestamp of the frame is used. */
+uint32_t CO_CANrxMsg_readTimestamp_linux(void *rxMsg);
+#define CO_CANrxMsg_readTimestamp_us(rxMsg) \
+    CO_CANrxMsg_readTimestamp_linux(rxMsg)
 
 
 /* Received message object */
@@ -315,8 +648,20 @@ typedef struct {
     volatile bool_t bufferFull; /* not used */
     volatile bool_t syncFlag;   /* info about transmit message */
     int can_ifindex;            /* CAN Interface index to use */
+    uint64_t deadline_us;       /* CLOCK_MONOTONIC time, after which message
+                                   is dropped instead of sent, 0 if none. See
+                                   CO_CANtxBuffer_setDeadline() */
+    bool_t busyRetry;           /* caller sends the message again, if transmit
+                                   queue is full. See CO_CANtxBuffer_busyRetry */
+#if CO_DRIVER_TX_CONFIRM > 0
+    struct timespec txTimestamp;/* time of the last confirmation on the bus
+                                   (system time) */
+#endif
 } CO_CANtx_t;
 
+/* Caller resends the message on CO_ERROR_TX_BUSY, see CO_driver.h */
+#define CO_CANtxBuffer_busyRetry(buffer, retry) {(buffer)->busyRetry = (retry);}
+
 
 /* Max COB ID for standard frame format */
 #define CO_CAN_MSG_SFF_MAX_COB_ID (1 << CAN_SFF_ID_BITS)
@@ -328,6 +673,159 @@ typedef struct {
                                    CAN receive event */
 } CO_CANptrSocketCan_t;
 
+#if CO_DRIVER_RX_THREADS > 0
+/* CAN message with reception time, as stored in receive thread queue */
+typedef struct {
+    struct can_frame msg;
+    struct timespec timestamp;
+#if CO_DRIVER_TX_CONFIRM > 0
+    bool_t confirm;             /* echo of own transmitted frame */
+#endif
+} CO_CANrxThreadMsg_t;
+
+/* Receive thread object, one per CAN interface. Queue is written only by
+ * receive thread (head) and read only by dispatching thread (tail). */
+typedef struct {
+    pthread_t thread;
+    int fd;                     /* socketCAN file descriptor, read by thread */
+    int stop_fd;                /* eventfd, which terminates the thread */
+    int notify_fd;              /* eventfd in epoll, signals non-empty queue */
+    bool_t started;             /* true, if thread was created */
+    volatile uint32_t notifyPending; /* notify_fd was signaled */
+    volatile uint32_t head;     /* written by receive thread */
+    volatile uint32_t tail;     /* written by dispatching thread */
+    volatile uint32_t dropped;  /* from SO_RXQ_OVFL, written by thread */
+    volatile uint32_t readErrors; /* recvmsg failures, written by thread */
+    uint32_t readErrorsPrev;    /* used by dispatching thread */
+    CO_CANrxThreadMsg_t queue[CO_DRIVER_RX_THREADS_QUEUE_SIZE];
+} CO_CANrxThread_t;
+#endif
+
+#if CO_DRIVER_TX_QUEUE > 0
+/* Slot of the transmit queue. Sequence number tells, if slot is free for the
+ * producer at position seq (seq == pos) or holds message for the consumer at
+ * position pos (seq == pos + 1). */
+typedef struct {
+    volatile uint32_t seq;
+    CO_CANtx_t msg;
+} CO_CANtxQueueSlot_t;
+
+/* Transmit queue object, one per CANmodule. Producers reserve slots by
+ * compare-and-swap on head, only dispatching thread writes tail. */
+typedef struct {
+    volatile uint32_t head;     /* written by producers */
+    uint32_t tail;              /* written by dispatching thread */
+    int notify_fd;              /* eventfd in epoll, signals non-empty queue */
+    volatile uint32_t notifyPending; /* notify_fd was signaled */
+    volatile uint32_t overflow; /* messages, which didn't fit into queue */
+    uint32_t syncClearPos;      /* synchronous messages before this position
+                                   are late, see CO_CANclearPendingSyncPDOs() */
+    bool_t syncClearPending;    /* syncClearPos is valid */
+    bool_t initialized;         /* true after first CO_CANmodule_init() */
+    CO_CANtxQueueSlot_t slots[CO_DRIVER_TX_QUEUE_SIZE];
+} CO_CANtxQueue_t;
+#endif
+
+#if CO_DRIVER_TX_CONFIRM > 0
+/* Frame sent on the interface, waiting for confirmation */
+typedef struct {
+    uint32_t ident;
+    CO_CANtx_t *buffer;         /* buffer from txArray or NULL */
+    bool_t syncFlag;
+    struct timespec sent;       /* time of send() (system time) */
+} CO_CANtxPending_t;
+
+/* Latency or interval statistics */
+typedef struct {
+    uint32_t count;
+    uint32_t last_us;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;            /* average is sum_us / count */
+} CO_CANtxLatency_t;
+
+/* Transmit confirmation statistics, see CO_DRIVER_TX_CONFIRM */
+typedef struct {
+    uint32_t unconfirmed;       /* frames without confirmation */
+    CO_CANtxLatency_t latency;  /* send() to confirmation, all frames */
+    CO_CANtxLatency_t latencySync; /* the same for synchronous messages */
+    CO_CANtxLatency_t syncInterval; /* between SYNC messages on the bus */
+} CO_CANtxConfirmStats_t;
+#endif
+
+#if CO_DRIVER_ROUTING > 0
+/* Route between CAN interfaces, see CO_CANmodule_addRoute() */
+typedef struct {
+    int srcIfindex;             /* frames received on this interface */
+    int dstIfindex;             /* are sent on this interface */
+    uint32_t identFirst;        /* range of CAN identifiers, inclusive, */
+    uint32_t identLast;         /* with CAN_EFF_FLAG for extended frames */
+    uint32_t rewriteMask;       /* identifier bits replaced, 0 = no rewrite */
+    uint32_t rewriteValue;      /* new value of replaced identifier bits */
+    uint32_t rateLimit;         /* max frames per second, 0 = no limit */
+    uint32_t rateBurst;         /* frames allowed at once above rateLimit */
+} CO_CANroute_t;
+
+/* Route statistics, see CO_CANmodule_getRouteStats() */
+typedef struct {
+    uint32_t forwarded;         /* frames written to destination socket */
+    uint32_t rateDropped;       /* frames dropped by rate limit */
+    uint32_t txDropped;         /* frames not accepted by destination socket */
+    uint32_t latencyLast_us;    /* from reception to send, last frame */
+    uint32_t latencyMax_us;     /* the same, maximum */
+} CO_CANrouteStats_t;
+
+/* Entry of the routing table */
+typedef struct {
+    CO_CANroute_t route;
+    uint32_t interval_us;       /* 1s / rateLimit */
+    uint64_t tat_us;            /* theoretical arrival time of the next frame
+                                   for rate limit (CLOCK_MONOTONIC) */
+    CO_CANrouteStats_t stats;
+} CO_CANrouteEntry_t;
+
+/* Frames waiting for sendmmsg() on destination interface */
+typedef struct {
+    struct can_frame frames[CO_DRIVER_ROUTING_BATCH];
+    const struct timespec *timestamp[CO_DRIVER_ROUTING_BATCH];
+    uint8_t route[CO_DRIVER_ROUTING_BATCH];
+    uint16_t count;
+} CO_CANrouteBatch_t;
+#endif
+
+#if CO_DRIVER_REDUNDANCY > 0
+/* Duplicate suppression state of one standard CAN-ID */
+typedef struct {
+    uint8_t count[2];           /* frames received on each line */
+    uint32_t time_us;           /* reception time of the last accepted frame,
+                                   low 32 bits of system time */
+} CO_CANredundancyId_t;
+
+/* Redundancy state and statistics, see CO_CANmodule_getRedundancy() */
+typedef struct {
+    int activeIfindex;          /* interface index of the active line */
+    bool_t lineFailed[2];       /* default line and redundant line */
+    uint32_t failoverCount;     /* switches of the active line */
+    uint32_t failoverLatency_us;/* last switch, from the first failure
+                                   indication to the first frame sent */
+    uint32_t duplicates;        /* received frames suppressed as copies */
+} CO_CANredundancyStats_t;
+
+/* Redundancy object, one per CANmodule. It is accessed from several threads,
+ * line state is changed with atomic compare and exchange. */
+typedef struct {
+    volatile uint8_t activeLine;/* 0 or 1 */
+    volatile bool_t lineFailed[2];
+    uint64_t lastRx_us[2];      /* last reception on line (CLOCK_MONOTONIC) */
+    uint64_t lastHb_us[2];      /* last heartbeat on line */
+    uint64_t failStart_us;      /* first failure indication, 0 if none */
+    volatile uint32_t failoverCount;
+    volatile uint32_t failoverLatency_us;
+    volatile uint32_t duplicates;
+    CO_CANredundancyId_t ids[CO_CAN_MSG_SFF_MAX_COB_ID];
+} CO_CANredundancy_t;
+#endif
+
 /* socketCAN interface object */
 typedef struct {
     int can_ifindex;            /* CAN Interface index */
@@ -336,6 +834,19 @@ typedef struct {
 #if CO_DRIVER_ERROR_REPORTING > 0 || defined CO_DOXYGEN
     CO_CANinterfaceErrorhandler_t errorhandler;
 #endif
+#if CO_DRIVER_RX_THREADS > 0
+    CO_CANrxThread_t *rxThread; /* allocated in CO_CANmodule_addInterface() */
+#endif
+#if CO_DRIVER_TX_CONFIRM > 0
+    /* FIFO of sent frames, protected by txConfirm_mutex */
+    CO_CANtxPending_t txPending[CO_DRIVER_TX_CONFIRM_PENDING];
+    uint32_t txPendingHead;
+    uint32_t txPendingTail;
+#endif
+#if CO_DRIVER_ROUTING > 0
+    int routeFd;                /* socket for frames forwarded to interface */
+    CO_CANrouteBatch_t routeBatch;
+#endif
 } CO_CANinterface_t;
 
 /* CAN module object */
@@ -348,6 +859,10 @@ typedef struct {
     uint16_t rxSize;
     struct can_filter *rxFilter;/* socketCAN filter list, one per rx buffer */
     uint32_t rxDropCount;       /* messages dropped on rx socket queue */
+    uint32_t txBusyCount;       /* messages not sent, transmit queue full */
+    uint32_t txLateCount;       /* messages dropped, deadline passed */
+    uint32_t txLateCycle;       /* the same, in current SYNC cycle */
+    uint32_t txLateLastCycle;   /* the same, in last finished SYNC cycle */
     CO_CANtx_t *txArray;
     uint16_t txSize;
     uint16_t CANerrorStatus;
@@ -361,38 +876,76 @@ typedef struct {
     uint32_t rxIdentToIndex[CO_CAN_MSG_SFF_MAX_COB_ID];
     uint32_t txIdentToIndex[CO_CAN_MSG_SFF_MAX_COB_ID];
 #endif
+#ifndef CO_SINGLE_THREAD
+    /* Mutexes for critical sections, one set per CANopen network. They are
+     * initialized on first CO_CANmodule_init() and stay valid across
+     * communication resets. */
+    pthread_mutex_t emcy_mutex;
+    pthread_mutex_t od_mutex;
+#if CO_DRIVER_TX_CONFIRM > 0
+    pthread_mutex_t txConfirm_mutex;
+#endif
+#if CO_DRIVER_TX_QUEUE > 0
+    pthread_mutex_t txSend_mutex;
+#endif
+    bool_t mutexesInitialized;
+#endif
+#if CO_DRIVER_TX_CONFIRM > 0
+    /* Statistics, protected by txConfirm_mutex */
+    CO_CANtxConfirmStats_t txConfirmStats;
+    struct timespec syncLast;   /* confirmation time of the last SYNC */
+#endif
+#if CO_DRIVER_TX_QUEUE > 0
+    /* Queue for CO_CANsendAsync(), initialized once, like mutexes */
+    CO_CANtxQueue_t txQueue;
+#endif
+#if CO_DRIVER_REDUNDANCY > 0
+    /* Reset by CO_CANmodule_init() */
+    CO_CANredundancy_t redundancy;
+#endif
+#if CO_DRIVER_ROUTING > 0
+    /* From CO_CANmodule_addRoute(), not changed by CO_CANmodule_init() */
+    CO_CANrouteEntry_t routes[CO_DRIVER_ROUTING_SIZE];
+    uint32_t routeCount;
+#endif
+#if CO_DRIVER_CAPTURE > 0
+    /* From CO_CANcapture_attach(), not changed by CO_CANmodule_init() */
+    struct CO_CANcapture *capture;
+#endif
+#if CO_DRIVER_REPLAY > 0
+    /* From CO_CANreplay_attach(), not changed by CO_CANmodule_init() */
+    struct CO_CANreplay *replay;
+#endif
 } CO_CANmodule_t;
 
 #ifdef CO_SINGLE_THREAD
-#define CO_LOCK_CAN_SEND()
-#define CO_UNLOCK_CAN_SEND()
-#define CO_LOCK_EMCY()
-#define CO_UNLOCK_EMCY()
-#define CO_LOCK_OD()
-#define CO_UNLOCK_OD()
+#define CO_LOCK_CAN_SEND(CAN_MODULE)
+#define CO_UNLOCK_CAN_SEND(CAN_MODULE)
+#define CO_LOCK_EMCY(CAN_MODULE)
+#define CO_UNLOCK_EMCY(CAN_MODULE)
+#define CO_LOCK_OD(CAN_MODULE)
+#define CO_UNLOCK_OD(CAN_MODULE)
 #define CO_MemoryBarrier()
 #else
 
 /* (un)lock critical section in CO_CANsend() - unused */
-#define CO_LOCK_CAN_SEND()
-#define CO_UNLOCK_CAN_SEND()
+#define CO_LOCK_CAN_SEND(CAN_MODULE)
+#define CO_UNLOCK_CAN_SEND(CAN_MODULE)
 
 /* (un)lock critical section in CO_errorReport() or CO_errorReset() */
-extern pthread_mutex_t CO_EMCY_mutex;
-static inline int CO_LOCK_EMCY() {
-    return pthread_mutex_lock(&CO_EMCY_mutex);
+static inline int CO_LOCK_EMCY(CO_CANmodule_t *CANmodule) {
+    return pthread_mutex_lock(&CANmodule->emcy_mutex);
 }
-static inline void CO_UNLOCK_EMCY() {
-    (void)pthread_mutex_unlock(&CO_EMCY_mutex);
+static inline void CO_UNLOCK_EMCY(CO_CANmodule_t *CANmodule) {
+    (void)pthread_mutex_unlock(&CANmodule->emcy_mutex);
 }
 
 /* (un)lock critical section when accessing Object Dictionary */
-extern pthread_mutex_t CO_OD_mutex;
-static inline int CO_LOCK_OD() {
-    return pthread_mutex_lock(&CO_OD_mutex);
+static inline int CO_LOCK_OD(CO_CANmodule_t *CANmodule) {
+    return pthread_mutex_lock(&CANmodule->od_mutex);
 }
-static inline void CO_UNLOCK_OD() {
-    (void)pthread_mutex_unlock(&CO_OD_mutex);
+static inline void CO_UNLOCK_OD(CO_CANmodule_t *CANmodule) {
+    (void)pthread_mutex_unlock(&CANmodule->od_mutex);
 }
 
 /* Synchronization between CAN receive and message processing threads. */
@@ -428,7 +981,7 @@ CO_ReturnError_t CO_CANmodule_addInterface(CO_CANmodule_t *CANmodule,
  *
  * @param CANmodule This object.
  * @param ident 11-bit standard CAN Identifier.
- * @param [out] CANptrRx message was received on this interface
+ * @param [out] can_ifindexRx message was received on this interface
  * @param [out] timestamp message was received at this time (system clock)
  *
  * @retval false message has never been received, therefore no base address
@@ -437,7 +990,7 @@ CO_ReturnError_t CO_CANmodule_addInterface(CO_CANmodule_t *CANmodule,
  */
 bool_t CO_CANrxBuffer_getInterface(CO_CANmodule_t *CANmodule,
                                    uint16_t ident,
-                                   const void **const CANptrRx,
+                                   int *can_ifindexRx,
                                    struct timespec *timestamp);
 
 /**
@@ -446,21 +999,201 @@ bool_t CO_CANrxBuffer_getInterface(CO_CANmodule_t *CANmodule,
  * It is in the responsibility of the user to ensure that the correct interface
  * is used. Some messages need to be transmitted on all interfaces.
  *
- * If given interface is unknown or NULL is used, a message is transmitted on
+ * If given interface is unknown or 0 is used, a message is transmitted on
  * all available interfaces.
  *
  * @param CANmodule This object.
  * @param ident 11-bit standard CAN Identifier.
- * @param CANptrTx use this interface. NULL = not specified
+ * @param can_ifindexTx use this interface. 0 = not specified
  *
  * @return #CO_ReturnError_t: CO_ERROR_NO or CO_ERROR_ILLEGAL_ARGUMENT.
  */
 CO_ReturnError_t CO_CANtxBuffer_setInterface(CO_CANmodule_t *CANmodule,
                                              uint16_t ident,
-                                             const void *CANptrTx);
+                                             int can_ifindexTx);
 #endif /* CO_DRIVER_MULTI_INTERFACE */
 
 
+/**
+ * Set transmit deadline of the message buffer
+ *
+ * Message, sent with CO_CANsend() or queued with CO_CANsendAsync() after the
+ * deadline, is dropped before it reaches the socket. Drop is counted in
+ * _txLateCount_ and _txLateCycle_ of the CANmodule and reported with
+ * CO_CAN_ERRTX_PDO_LATE in CANerrorStatus.
+ *
+ * CO_CANclearPendingSyncPDOs(), called by the stack at the end of the
+ * synchronous window, copies _txLateCycle_ into _txLateLastCycle_ and clears
+ * CO_CAN_ERRTX_PDO_LATE, if there were no late messages in the cycle. With
+ * @ref CO_DRIVER_TX_QUEUE it also drops synchronous messages (_syncFlag_),
+ * which are still in the transmit queue, as late.
+ *
+ * Deadline stays set for all following transmissions of the buffer, so it is
+ * usually set each time before sending, for example to the end of the
+ * synchronous window for synchronous TPDO.
+ *
+ * @param buffer Transmit buffer, returned by CO_CANtxBufferInit().
+ * @param timeout_us Deadline relative to the current time in microseconds or
+ * 0 to clear the deadline.
+ */
+void CO_CANtxBuffer_setDeadline(CO_CANtx_t *buffer, uint32_t timeout_us);
+
+
+#if CO_DRIVER_TX_CONFIRM > 0 || defined CO_DOXYGEN
+/**
+ * Get transmit confirmation statistics
+ *
+ * See @ref CO_DRIVER_TX_CONFIRM. Function may be called from any thread.
+ *
+ * @param CANmodule This object.
+ * @param [out] stats Copy of statistics.
+ * @param reset If true, statistics are cleared after copy.
+ */
+void CO_CANmodule_getTxConfirmStats(CO_CANmodule_t *CANmodule,
+                                    CO_CANtxConfirmStats_t *stats,
+                                    bool_t reset);
+#endif /* CO_DRIVER_TX_CONFIRM */
+
+
+#if CO_DRIVER_ROUTING > 0 || defined CO_DOXYGEN
+/**
+ * Add route between CAN interfaces
+ *
+ * See @ref CO_DRIVER_ROUTING. Frame received on _srcIfindex_ with identifier
+ * inside the range from _identFirst_ to _identLast_ (RTR flag is ignored) is
+ * sent on _dstIfindex_. If _rewriteMask_ is not zero, identifier bits in the
+ * mask are replaced with the bits from _rewriteValue_, for example mask 0x7F
+ * maps node-ID. If _rateLimit_ is not zero, frames above _rateLimit_ per
+ * second (with _rateBurst_ frames tolerance) are dropped.
+ *
+ * Routing table is not changed by CO_CANmodule_init(), so routes are added
+ * once and stay across communication resets. Function must be called, while
+ * CANmodule is not in normal mode, for example before CO_CANopenInit() or
+ * after CO_CANmodule_addInterface(). Socket filters are set by
+ * CO_CANsetNormalMode().
+ *
+ * @param CANmodule This object.
+ * @param route Route configuration, copied.
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT,
+ * CO_ERROR_OUT_OF_MEMORY (table full) or CO_ERROR_INVALID_STATE.
+ */
+CO_ReturnError_t CO_CANmodule_addRoute(CO_CANmodule_t *CANmodule,
+                                       const CO_CANroute_t *route);
+
+/**
+ * Get statistics of the route
+ *
+ * Function may be called from any thread.
+ *
+ * @param CANmodule This object.
+ * @param index Index of the route, in order of CO_CANmodule_addRoute() calls.
+ * @param [out] stats Copy of statistics.
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO or CO_ERROR_ILLEGAL_ARGUMENT.
+ */
+CO_ReturnError_t CO_CANmodule_getRouteStats(CO_CANmodule_t *CANmodule,
+                                            uint32_t index,
+                                            CO_CANrouteStats_t *stats);
+#endif /* CO_DRIVER_ROUTING */
+
+
+#if CO_DRIVER_REDUNDANCY > 0 || defined CO_DOXYGEN
+/**
+ * Get state of redundant CAN lines
+ *
+ * See @ref CO_DRIVER_REDUNDANCY. Function may be called from any thread.
+ *
+ * @param CANmodule This object.
+ * @param [out] stats Copy of state and statistics.
+ */
+void CO_CANmodule_getRedundancy(CO_CANmodule_t *CANmodule,
+                                CO_CANredundancyStats_t *stats);
+
+/**
+ * Set active line
+ *
+ * Manual switchover, for example on command of the application. Function must
+ * be called from the thread, which sends CAN messages.
+ *
+ * @param CANmodule This object.
+ * @param can_ifindex Interface index of the default or the redundant line.
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO or CO_ERROR_ILLEGAL_ARGUMENT.
+ */
+CO_ReturnError_t CO_CANmodule_setActiveLine(CO_CANmodule_t *CANmodule,
+                                            int can_ifindex);
+#endif /* CO_DRIVER_REDUNDANCY */
+
+
+#if CO_DRIVER_RX_THREADS > 0 || defined CO_DOXYGEN
+/**
+ * Pin receive thread of the interface to CPU core and set its priority
+ *
+ * Function must be called after interface was added to the CANmodule, see
+ * @ref CO_DRIVER_RX_THREADS.
+ *
+ * @param CANmodule This object.
+ * @param can_ifindex CAN Interface index.
+ * @param cpu CPU core number or -1 to leave affinity unchanged.
+ * @param priority SCHED_FIFO priority or -1 to use normal scheduler.
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT or
+ * CO_ERROR_SYSCALL.
+ */
+CO_ReturnError_t CO_CANmodule_setRxThreadAffinity(CO_CANmodule_t *CANmodule,
+                                                  int can_ifindex,
+                                                  int cpu,
+                                                  int priority);
+#endif /* CO_DRIVER_RX_THREADS */
+
+
+#if CO_DRIVER_TX_QUEUE > 0 || defined CO_DOXYGEN
+/**
+ * Send CAN message from any thread
+ *
+ * Message is copied into the transmit queue of the CANmodule and sent later
+ * by the thread, which calls CO_CANrxFromEpoll(), see
+ * @ref CO_DRIVER_TX_QUEUE. Function is lock-free and may be called from any
+ * thread, also concurrently with CO_CANsend().
+ *
+ * @param CANmodule This object, initialized by CO_CANmodule_init().
+ * @param buffer Message to send. Only ident, DLC, data, syncFlag, can_ifindex
+ * and deadline_us are used. It may be a local variable, it is not used after
+ * function returns.
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT or
+ * CO_ERROR_TX_OVERFLOW, if queue is full.
+ */
+CO_ReturnError_t CO_CANsendAsync(CO_CANmodule_t *CANmodule,
+                                 const CO_CANtx_t *buffer);
+#endif /* CO_DRIVER_TX_QUEUE */
+
+
+#if CO_DRIVER_REPLAY > 0 || defined CO_DOXYGEN
+/**
+ * Pass CAN message to CANopen objects as if it was received
+ *
+ * Message is processed the same way as message read from the socket of the
+ * interface: error frames go to the error handler, data frames to the
+ * matching rx buffer, see @ref CO_DRIVER_REPLAY. Function must be called from
+ * the thread, which calls CO_CANrxFromEpoll().
+ *
+ * @param CANmodule This object.
+ * @param can_ifindex CAN Interface index, the message is received on.
+ * @param msg CAN message in socketCAN format, flags in can_id are cleared.
+ * @param timestamp Receive time of the message (system time).
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT or
+ * CO_ERROR_INVALID_STATE, if CANmodule is not in normal mode.
+ */
+CO_ReturnError_t CO_CANrxInject(CO_CANmodule_t *CANmodule,
+                                int can_ifindex,
+                                struct can_frame *msg,
+                                struct timespec *timestamp);
+#endif /* CO_DRIVER_REPLAY */
+
+
 /**
  * Receives CAN messages from matching epoll event
  *
@@ -468,6 +1201,14 @@ CO_ReturnError_t CO_CANtxBuffer_setInterface(CO_CANmodule_t *CANmodule,
  * In case of match, message is read from CAN and pre-processed for CANopenNode
  * objects. CAN error frames are also processed.
  *
+ * If @ref CO_DRIVER_RX_THREADS is enabled, epoll event is verified against
+ * notification events from receive threads and up to
+ * CO_DRIVER_RX_THREADS_BATCH queued messages are processed.
+ *
+ * If @ref CO_DRIVER_TX_QUEUE is enabled, epoll event is also verified against
+ * notification event from transmit queue and up to CO_DRIVER_TX_QUEUE_BATCH
+ * queued messages are sent.
+ *
  * In case of CAN message function searches _rxArray_ from CO_CANmodule_t and
  * if matched it calls the corresponding CANrx_callback, optionally copies
  * received CAN message to _buffer_ and returns index of matched _rxArray_.
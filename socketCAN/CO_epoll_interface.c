@@ -115,6 +115,12 @@ CO_ReturnError_t CO_epoll_create(CO_epoll_t *ep, uint32_t timerInterval_us) {
     ep->timerInterval_us = timerInterval_us;
     ep->previousTime_us = clock_gettime_us();
     ep->timeDifference_us = 0;
+#if (CO_CONFIG_MBX) & CO_CONFIG_MBX_ENABLE
+    ep->mbx = NULL;
+#endif
+#if (CO_CONFIG_MBX) & CO_CONFIG_MBX_PROCESS_IMAGE
+    ep->pi = NULL;
+#endif
 
     return CO_ERROR_NO;
 }
@@ -319,7 +325,7 @@ void CO_epoll_processRT(CO_epoll_t *ep,
     if (!realtime || ep->timerEvent) {
         uint32_t *pTimerNext_us = realtime ? NULL : &ep->timerNext_us;
 
-        CO_LOCK_OD();
+        CO_LOCK_OD(co->CANmodule);
         if (!co->nodeIdUnconfigured && co->CANmodule->CANnormal) {
             bool_t syncWas = false;
 
@@ -330,13 +336,22 @@ void CO_epoll_processRT(CO_epoll_t *ep,
 #if (CO_CONFIG_PDO) & CO_CONFIG_RPDO_ENABLE
             CO_process_RPDO(co, syncWas);
 #endif
+#if (CO_CONFIG_MBX) & CO_CONFIG_MBX_ENABLE
+            CO_mbx_process(ep->mbx);
+#endif
+#if (CO_CONFIG_MBX) & CO_CONFIG_MBX_PROCESS_IMAGE
+            CO_PI_process(ep->pi);
+#endif
+#if (CO_CONFIG_TRACE) & CO_CONFIG_TRACE_ENABLE
+            CO_process_TRACE(co, ep->timeDifference_us);
+#endif
 #if (CO_CONFIG_PDO) & CO_CONFIG_TPDO_ENABLE
             CO_process_TPDO(co, syncWas, ep->timeDifference_us,
                             pTimerNext_us);
 #endif
             (void) syncWas; (void) pTimerNext_us;
         }
-        CO_UNLOCK_OD();
+        CO_UNLOCK_OD(co->CANmodule);
     }
 }
 
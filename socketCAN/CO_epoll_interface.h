@@ -111,6 +111,17 @@ typedef struct {
     struct epoll_event ev;
     /** true, if new epoll event is necessary to process */
     bool_t epoll_new;
+#if ((CO_CONFIG_MBX) & CO_CONFIG_MBX_ENABLE) || defined CO_DOXYGEN
+    /** List of process data mailboxes, processed by @ref CO_epoll_processRT().
+     * Empty after @ref CO_epoll_create(), mailboxes are added with
+     * @ref CO_mbx_init(). */
+    CO_mbx_t *mbx;
+#endif
+#if ((CO_CONFIG_MBX) & CO_CONFIG_MBX_PROCESS_IMAGE) || defined CO_DOXYGEN
+    /** Process image, processed by @ref CO_epoll_processRT(). NULL after
+     * @ref CO_epoll_create(), set by application. */
+    CO_PI_t *pi;
+#endif
 } CO_epoll_t;
 
 /**
@@ -199,7 +210,10 @@ void CO_epoll_processMain(CO_epoll_t *ep,
  *
  * Function can be used in the mainline thread or in own realtime thread.
  *
- * Processing of CANopen realtime functions is protected with @ref CO_LOCK_OD.
+ * Processing of CANopen realtime functions is protected with @ref CO_LOCK_OD
+ * of the co->CANmodule. Process data mailboxes from ep->mbx and
+ * process image from ep->pi are processed inside the same section, between
+ * RPDO and TPDO processing.
  * Also Node-Id must be configured and CANmodule must be in CANnormal for
  * processing.
  *
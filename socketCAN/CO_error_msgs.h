@@ -52,6 +52,9 @@ extern "C" {
 #define CAN_TX_BUF_OVERFLOW       "CAN Interface \"%s\" Tx buffer overflow. Message dropped"
 #define CAN_RX_LEVEL_WARNING      "CAN Interface \"%s\" reached Rx Warning Level"
 #define CAN_TX_LEVEL_WARNING      "CAN Interface \"%s\" reached Tx Warning Level"
+#define CAN_LINE_FAILED           "CAN Interface \"%s\" redundant line failed (%s)"
+#define CAN_LINE_RECOVERED        "CAN Interface \"%s\" redundant line recovered"
+#define CAN_LINE_SWITCHED         "CAN Interface \"%s\" is now default line"
 
 
 /*
@@ -61,6 +64,8 @@ extern "C" {
 #define DBG_ERRNO                 "(%s) OS error \"%s\" in %s", __func__, strerror(errno)
 #define DBG_CO_DEBUG              "(%s) CO_DEBUG: %s", __func__
 #define DBG_CAN_TX_FAILED         "(%s) Transmitting CAN msg OID 0x%08x failed(%s)", __func__
+#define DBG_CAN_TX_BUSY           "(%s) CAN msg OID 0x%08x not sent, transmit queue full(%s)", __func__
+#define DBG_CAN_TX_LATE           "(%s) CAN msg OID 0x%08x not sent, deadline passed", __func__
 #define DBG_CAN_RX_PARAM_FAILED   "(%s) Setting CAN rx buffer failed (%s)", __func__
 #define DBG_CAN_RX_FAILED         "(%s) Receiving CAN msg failed (%s)", __func__
 #define DBG_CAN_ERROR_GENERAL     "(%s) Socket error msg ID: 0x%08x, Data[0..7]: 0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%02x (%s)", __func__
@@ -90,6 +95,26 @@ extern "C" {
 #define DBG_COMMAND_LOCAL_INFO    "CANopen command interface on local socket \"%s\" started"
 #define DBG_COMMAND_TCP_INFO      "CANopen command interface on tcp port \"%d\" started"
 
+/* CO_OD_autosave */
+#define DBG_OD_AUTOSAVE           "(%s) Autosave to \"%s\" failed, errors=%u", __func__
+#define DBG_OD_AUTOSAVE_STATS     "OD autosave \"%s\": %u saves (%u full), %llu bytes written, last stall %u us, max stall %u us"
+
+/* CO_fastResume */
+#define DBG_FAST_RESUME           "Fast resume snapshot \"%s\" %s"
+
+/* CO_CANcapture */
+#define DBG_CAN_CAPTURE           "CAN capture \"%s\": %s"
+#define DBG_CAN_CAPTURE_OVERFLOW  "CAN capture \"%s\": ring overflow, %u frames dropped"
+#define DBG_CAN_CAPTURE_STATS     "CAN capture \"%s\": %llu frames written, %u dropped, %u files"
+
+/* CO_CANreplay */
+#define DBG_CAN_REPLAY            "CAN replay \"%s\": %s"
+#define DBG_CAN_REPLAY_STATS      "CAN replay \"%s\": %u frames injected, %u recorded, %u skipped"
+
+/* CO_domainSink */
+#define DBG_DOMAIN_SINK           "Domain sink \"%s\": %s"
+#define DBG_DOMAIN_SINK_COMMIT    "Domain sink \"%s\": %u bytes committed, transfer %u us, commit %u us, waited %u us"
+
 
 #ifdef __cplusplus
 }
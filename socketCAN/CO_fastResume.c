@@ -0,0 +1,320 @@
+/*
+ * Fast-resume snapshot of runtime state for quick restarts on Linux.
+ *
+ * @file        CO_fastResume.c
+ * @ingroup     CO_socketCAN_fastResume
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "CO_fastResume.h"
+#include "301/crc16-ccitt.h"
+
+/* File layout (host byte order, snapshot is not portable between hosts):
+ * header, region table (id, size for each region), region data, crc16 of all
+ * preceding bytes. */
+#define FR_MAGIC "COFR"
+
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t regionsCount;
+    uint32_t odSignature;
+    uint32_t dataSize;
+    uint64_t time_s;
+} FR_header_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t size;
+} FR_regionInfo_t;
+
+
+/* FNV-1a hash of the Object Dictionary structure and of region sizes. It
+ * changes, if OD is regenerated with different objects. */
+static uint32_t FR_odSignature(const OD_t *od,
+                               const CO_fastResume_region_t regions[],
+                               uint16_t regionsCount)
+{
+    uint32_t h = 2166136261U;
+    uint32_t v[3];
+    uint16_t i;
+    size_t j;
+
+    for (i = 0; i < od->size; i++) {
+        const OD_entry_t *entry = &od->list[i];
+
+        v[0] = entry->index;
+        v[1] = entry->subEntriesCount;
+        v[2] = entry->odObjectType;
+        for (j = 0; j < sizeof(v); j++) {
+            h = (h ^ ((uint8_t *)v)[j]) * 16777619U;
+        }
+    }
+    for (i = 0; i < regionsCount; i++) {
+        for (j = 0; j < sizeof(regions[i].size); j++) {
+            h = (h ^ ((const uint8_t *)&regions[i].size)[j]) * 16777619U;
+        }
+    }
+
+    return h;
+}
+
+
+/* write complete buffer and update crc, retry on partial write or signal */
+static bool_t FR_writeAll(int fd, const void *buf, size_t len, uint16_t *crc) {
+    const uint8_t *b = (const uint8_t *)buf;
+
+    if (crc != NULL) {
+        *crc = crc16_ccitt(b, len, *crc);
+    }
+    while (len > 0) {
+        ssize_t n = write(fd, b, len);
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        b += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+
+/* sync directory of the file, so rename and create are durable */
+static void FR_syncDir(const char *filename) {
+    char *dir = strdup(filename);
+    char *slash;
+    int fd;
+
+    if (dir == NULL) return;
+    slash = strrchr(dir, '/');
+    if (slash == NULL) {
+        free(dir);
+        dir = strdup(".");
+        if (dir == NULL) return;
+    }
+    else {
+        slash[slash == dir ? 1 : 0] = 0;
+    }
+    fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        (void)fsync(fd);
+        close(fd);
+    }
+    free(dir);
+}
+
+
+/******************************************************************************/
+CO_ReturnError_t CO_fastResume_save(const char *filename,
+                                    const OD_t *od,
+                                    const CO_fastResume_region_t regions[],
+                                    uint16_t regionsCount)
+{
+    FR_header_t hdr;
+    char *filenameTmp;
+    uint16_t crc = 0;
+    uint16_t i;
+    int fd;
+    bool_t ok;
+
+    if (filename == NULL || od == NULL
+        || (regions == NULL && regionsCount > 0)
+    ) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, FR_MAGIC, sizeof(hdr.magic));
+    hdr.version = CO_FAST_RESUME_VERSION;
+    hdr.regionsCount = regionsCount;
+    hdr.odSignature = FR_odSignature(od, regions, regionsCount);
+    for (i = 0; i < regionsCount; i++) {
+        hdr.dataSize += regions[i].size;
+    }
+    hdr.time_s = (uint64_t)time(NULL);
+
+    filenameTmp = malloc(strlen(filename) + 5);
+    if (filenameTmp == NULL) {
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+    strcpy(filenameTmp, filename);
+    strcat(filenameTmp, ".tmp");
+
+    fd = open(filenameTmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        free(filenameTmp);
+        return CO_ERROR_SYSCALL;
+    }
+
+    ok = FR_writeAll(fd, &hdr, sizeof(hdr), &crc);
+    for (i = 0; ok && i < regionsCount; i++) {
+        FR_regionInfo_t info;
+
+        info.id = regions[i].id;
+        info.size = regions[i].size;
+        ok = FR_writeAll(fd, &info, sizeof(info), &crc);
+    }
+    for (i = 0; ok && i < regionsCount; i++) {
+        ok = FR_writeAll(fd, regions[i].addr, regions[i].size, &crc);
+    }
+    if (ok) {
+        ok = FR_writeAll(fd, &crc, sizeof(crc), NULL);
+    }
+    /* data must be on the disk before rename replaces the old snapshot */
+    if (ok && fsync(fd) != 0) {
+        ok = false;
+    }
+    if (close(fd) != 0) {
+        ok = false;
+    }
+    if (ok && rename(filenameTmp, filename) != 0) {
+        ok = false;
+    }
+    if (ok) {
+        FR_syncDir(filename);
+    }
+    else {
+        unlink(filenameTmp);
+    }
+    free(filenameTmp);
+
+    return ok ? CO_ERROR_NO : CO_ERROR_SYSCALL;
+}
+
+
+/******************************************************************************/
+CO_ReturnError_t CO_fastResume_load(const char *filename,
+                                    const OD_t *od,
+                                    const CO_fastResume_region_t regions[],
+                                    uint16_t regionsCount,
+                                    uint32_t maxAge_s)
+{
+    CO_ReturnError_t ret = CO_ERROR_NO;
+    FR_header_t hdr;
+    const uint8_t *map;
+    const uint8_t *data;
+    struct stat st;
+    size_t expected;
+    uint64_t now;
+    uint16_t crc;
+    uint16_t i;
+    int fd;
+
+    if (filename == NULL || od == NULL
+        || (regions == NULL && regionsCount > 0)
+    ) {
+        return CO_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return CO_ERROR_SYSCALL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(hdr)) {
+        close(fd);
+        return CO_ERROR_DATA_CORRUPT;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return CO_ERROR_SYSCALL;
+    }
+
+    /* validate everything, before any region is modified */
+    memcpy(&hdr, map, sizeof(hdr));
+    expected = sizeof(hdr) + sizeof(FR_regionInfo_t) * regionsCount
+               + hdr.dataSize + sizeof(crc);
+    now = (uint64_t)time(NULL);
+    if (memcmp(hdr.magic, FR_MAGIC, sizeof(hdr.magic)) != 0
+        || hdr.version != CO_FAST_RESUME_VERSION
+        || hdr.regionsCount != regionsCount
+        || hdr.odSignature != FR_odSignature(od, regions, regionsCount)
+        || (size_t)st.st_size != expected
+        || (maxAge_s > 0 && (now < hdr.time_s || now - hdr.time_s > maxAge_s))
+    ) {
+        ret = CO_ERROR_DATA_CORRUPT;
+    }
+    else {
+        const uint8_t *p = map + sizeof(hdr);
+        uint32_t dataSize = 0;
+
+        for (i = 0; i < regionsCount; i++) {
+            FR_regionInfo_t info;
+
+            memcpy(&info, p, sizeof(info));
+            p += sizeof(info);
+            dataSize += regions[i].size;
+            if (info.id != regions[i].id || info.size != regions[i].size) {
+                ret = CO_ERROR_DATA_CORRUPT;
+                break;
+            }
+        }
+        if (ret == CO_ERROR_NO && dataSize != hdr.dataSize) {
+            ret = CO_ERROR_DATA_CORRUPT;
+        }
+    }
+    if (ret == CO_ERROR_NO) {
+        memcpy(&crc, map + expected - sizeof(crc), sizeof(crc));
+        if (crc != crc16_ccitt(map, expected - sizeof(crc), 0)) {
+            ret = CO_ERROR_CRC;
+        }
+    }
+
+    /* restore regions */
+    if (ret == CO_ERROR_NO) {
+        data = map + sizeof(hdr) + sizeof(FR_regionInfo_t) * regionsCount;
+        for (i = 0; i < regionsCount; i++) {
+            memcpy(regions[i].addr, data, regions[i].size);
+            data += regions[i].size;
+        }
+    }
+    munmap((void *)map, (size_t)st.st_size);
+
+    /* consume the snapshot, it is used only once */
+    if (ret == CO_ERROR_NO) {
+        char *filenameUsed = malloc(strlen(filename) + 6);
+
+        if (filenameUsed != NULL) {
+            strcpy(filenameUsed, filename);
+            strcat(filenameUsed, ".used");
+            if (rename(filename, filenameUsed) != 0) {
+                unlink(filename);
+            }
+            free(filenameUsed);
+        }
+        else {
+            unlink(filename);
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,127 @@
+/**
+ * Fast-resume snapshot of runtime state for quick restarts on Linux.
+ *
+ * @file        CO_fastResume.h
+ * @ingroup     CO_socketCAN_fastResume
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CO_FAST_RESUME_H
+#define CO_FAST_RESUME_H
+
+#include "301/CO_driver.h"
+#include "301/CO_ODinterface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup CO_socketCAN_fastResume Fast resume
+ * @ingroup CO_socketCAN
+ * @{
+ *
+ * Snapshot of runtime state, which lets restarted process continue quickly.
+ *
+ * Application registers memory regions with runtime state, for example
+ * OD_RAM and a structure with NMT state and active node-id. Regions are
+ * written into a versioned binary file with @ref CO_fastResume_save() on clean
+ * shutdown and periodically. On startup @ref CO_fastResume_load() maps the file
+ * and validates it completely before any region is copied:
+ * - magic and format version,
+ * - signature of the Object Dictionary (index, type and number of sub-entries
+ *   of all OD entries and sizes of all regions), so snapshot from a different
+ *   build is rejected,
+ * - list of region ids and sizes,
+ * - age of the snapshot,
+ * - CRC of the complete file.
+ *
+ * If anything fails, no region is modified and application continues with
+ * the normal startup. Snapshot is consumed by successful load (file is renamed
+ * to "filename.used"), so a process, which crashes because of restored state,
+ * does not resume the same state again.
+ */
+
+/** Version of the snapshot file format */
+#define CO_FAST_RESUME_VERSION 1
+
+/**
+ * Memory region in the snapshot
+ */
+typedef struct {
+    /** Application specified unique id of the region */
+    uint32_t id;
+    /** Address of the region */
+    void *addr;
+    /** Size of the region in bytes */
+    uint32_t size;
+} CO_fastResume_region_t;
+
+/**
+ * Save regions into snapshot file
+ *
+ * File is written to "filename.tmp", synced, renamed and directory is synced,
+ * so existing snapshot is replaced atomically, also on power loss. Regions
+ * must not be changed during the call
+ * (use @ref CO_LOCK_OD(), if they are part of the Object Dictionary).
+ *
+ * @param filename Name of the snapshot file.
+ * @param od Object Dictionary, used for signature.
+ * @param regions Array of regions.
+ * @param regionsCount Number of regions.
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO, CO_ERROR_ILLEGAL_ARGUMENT,
+ * CO_ERROR_OUT_OF_MEMORY or CO_ERROR_SYSCALL.
+ */
+CO_ReturnError_t CO_fastResume_save(const char *filename,
+                                    const OD_t *od,
+                                    const CO_fastResume_region_t regions[],
+                                    uint16_t regionsCount);
+
+/**
+ * Load regions from snapshot file
+ *
+ * Called on startup, before CANopen objects are initialized. Regions are
+ * written only if complete file is valid.
+ *
+ * @param filename Name of the snapshot file.
+ * @param od Object Dictionary, used for signature.
+ * @param regions Array of regions, must be the same as on save.
+ * @param regionsCount Number of regions.
+ * @param maxAge_s Snapshot older than this is rejected, 0 for no limit.
+ *
+ * @return #CO_ReturnError_t: CO_ERROR_NO (regions are restored),
+ * CO_ERROR_ILLEGAL_ARGUMENT, CO_ERROR_SYSCALL (no snapshot),
+ * CO_ERROR_DATA_CORRUPT (different format, OD or regions, or too old) or
+ * CO_ERROR_CRC.
+ */
+CO_ReturnError_t CO_fastResume_load(const char *filename,
+                                    const OD_t *od,
+                                    const CO_fastResume_region_t regions[],
+                                    uint16_t regionsCount,
+                                    uint32_t maxAge_s);
+
+/** @} */ /* CO_socketCAN_fastResume */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* CO_FAST_RESUME_H */
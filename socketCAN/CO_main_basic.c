@@ -25,6 +25,14 @@
 #ifndef CO_OD_STORAGE
 #define CO_OD_STORAGE 0
 #endif
+/* Autosave of OD_PERSIST_COMM in background thread, see CO_OD_autosave.h */
+#ifndef CO_OD_AUTOSAVE
+#define CO_OD_AUTOSAVE 0
+#endif
+/* Snapshot of OD_RAM and NMT state for quick restarts, see CO_fastResume.h */
+#ifndef CO_FAST_RESUME
+#define CO_FAST_RESUME 0
+#endif
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -49,17 +57,31 @@
 #if CO_OD_STORAGE == 1
 #include "CO_OD_storage.h"
 #endif
+#if CO_OD_AUTOSAVE == 1
+#ifdef CO_SINGLE_THREAD
+#error CO_OD_AUTOSAVE can not be used with CO_SINGLE_THREAD
+#endif
+#include "CO_OD_autosave.h"
+#endif
+#if CO_FAST_RESUME == 1
+#include "CO_fastResume.h"
+#endif
+#if CO_DRIVER_CAPTURE > 0
+#include "CO_CANcapture.h"
+#endif
+#if CO_DRIVER_REPLAY > 0
+#ifndef CO_SINGLE_THREAD
+#error CO_DRIVER_REPLAY in CO_main_basic.c requires CO_SINGLE_THREAD
+#endif
+#include <limits.h>
+#include "CO_CANreplay.h"
+#endif
 
 /* Call external application functions. */
 #ifdef CO_USE_APPLICATION
 #include "CO_application.h"
 #endif
 
-/* Add trace functionality for recording variables over time */
-#if (CO_CONFIG_TRACE) & CO_CONFIG_TRACE_ENABLE
-#include "CO_time_trace.h"
-#endif
-
 /* Use DS309-3 standard - ASCII command interface to CANopen: NMT master,
  * LSS master and SDO client */
 #if (CO_CONFIG_GTW) & CO_CONFIG_GTW_ASCII
@@ -100,6 +122,18 @@
 #ifndef OD_STATUS_BITS
 #define OD_STATUS_BITS NULL
 #endif
+#ifndef FAST_RESUME_INTERVAL_US
+#define FAST_RESUME_INTERVAL_US 10000000
+#endif
+#ifndef FAST_RESUME_MAX_AGE_S
+#define FAST_RESUME_MAX_AGE_S 60
+#endif
+#ifndef CAPTURE_FILE_SIZE
+#define CAPTURE_FILE_SIZE (16 * 1024 * 1024)
+#endif
+#ifndef CAPTURE_FILE_COUNT
+#define CAPTURE_FILE_COUNT 4
+#endif
 
 /* Other variables and objects */
 #ifndef CO_SINGLE_THREAD
@@ -116,8 +150,52 @@ static CO_OD_storage_t      odStorAuto;         /* Object Dictionary storage obj
 static char                *odStorFile_rom    = "od_storage";       /* Name of the file */
 static char                *odStorFile_eeprom = "od_storage_auto";  /* Name of the file */
 #endif
-#if (CO_CONFIG_TRACE) & CO_CONFIG_TRACE_ENABLE
-static CO_time_t            CO_time;            /* Object for current time */
+#if CO_OD_AUTOSAVE == 1
+static CO_OD_autosave_t     odAutosave;         /* Autosave object for OD_PERSIST_COMM */
+static char                *odAutosaveFile = "od_persist_comm";     /* Name of the file */
+#endif
+#if CO_DRIVER_CAPTURE > 0
+static CO_CANcapture_t      canCapture;         /* Capture of CAN traffic */
+static char                *captureFile = NULL; /* Name of the file, -C argument */
+#endif
+#if CO_DRIVER_REPLAY > 0
+static CO_CANreplay_t       replay;             /* Replay of captured CAN traffic */
+static char                *replayFile = NULL;  /* Name of the input file, -P argument */
+static char                 replayOutFile[PATH_MAX]; /* Stack outputs, "<input>.out" */
+static uint32_t             replaySpeed = 0;    /* -X argument, 0 = virtual time */
+#endif
+#if CO_FAST_RESUME == 1
+/* Runtime state, which is not part of the Object Dictionary */
+typedef struct {
+    uint8_t nodeId;
+    uint8_t nmtState;
+} fastResumeState_t;
+static fastResumeState_t    frState;            /* State, restored from snapshot */
+static fastResumeState_t    frStateCopy;        /* Copies for periodic snapshot */
+static OD_RAM_t             frRAMcopy;
+static char                *frFile = "co_fast_resume"; /* Name of the file */
+static const CO_fastResume_region_t frRegions[] = {
+    {1, &OD_RAM, sizeof(OD_RAM)},
+    {2, &frState, sizeof(frState)}
+};
+static const CO_fastResume_region_t frRegionsCopy[] = {
+    {1, &frRAMcopy, sizeof(frRAMcopy)},
+    {2, &frStateCopy, sizeof(frStateCopy)}
+};
+
+/* Copy state inside lock, file is written outside, so RT thread is not
+ * blocked by file I/O. */
+static void fastResumeSave(CO_t *co) {
+    CO_LOCK_OD(co->CANmodule);
+    memcpy(&frRAMcopy, &OD_RAM, sizeof(frRAMcopy));
+    frStateCopy.nodeId = CO_activeNodeId;
+    frStateCopy.nmtState = (uint8_t)CO_NMT_getInternalState(co->NMT);
+    CO_UNLOCK_OD(co->CANmodule);
+
+    if (CO_fastResume_save(frFile, OD, frRegionsCopy, 2) != CO_ERROR_NO) {
+        log_printf(LOG_WARNING, DBG_ERRNO, "CO_fastResume_save()");
+    }
+}
 #endif
 
 /* Helper functions ***********************************************************/
@@ -242,6 +320,28 @@ printf(
 "  -a <ODstorageAuto>  Set Filename for automatic storage variables from\n"
 "                      Object dictionary. ('od_storage_auto' is default).\n");
 #endif
+#if CO_OD_AUTOSAVE == 1
+printf(
+"  -A <autosave file>  Set Filename for autosave of OD_PERSIST_COMM\n"
+"                      ('od_persist_comm' is default).\n");
+#endif
+#if CO_FAST_RESUME == 1
+printf(
+"  -R <resume file>    Set Filename for fast resume snapshot\n"
+"                      ('co_fast_resume' is default).\n");
+#endif
+#if CO_DRIVER_CAPTURE > 0
+printf(
+"  -C <capture file>   Capture CAN traffic into rotating pcapng files.\n");
+#endif
+#if CO_DRIVER_REPLAY > 0
+printf(
+"  -P <replay file>    Replay candump log or pcapng file as received traffic.\n"
+"                      Stack outputs are written to \"<replay file>.out\",\n"
+"                      not to CAN. Program ends with the end of the file.\n"
+"  -X <speed>          Replay speed: 1 is real time, N is N times faster,\n"
+"                      0 (default) is as fast as possible with virtual time.\n");
+#endif
 #if (CO_CONFIG_GTW) & CO_CONFIG_GTW_ASCII
 printf(
 "  -c <interface>      Enable command interface for master functionality.\n"
@@ -280,6 +380,10 @@ int main (int argc, char *argv[]) {
     CO_CANptrSocketCan_t CANptr = {0};
     int opt;
     bool_t firstRun = true;
+#if CO_FAST_RESUME == 1
+    bool_t fastResumed = false;
+    uint32_t frTimer_us = 0;
+#endif
 
     char* CANdevice = NULL;         /* CAN device, configurable by arguments. */
     bool_t nodeIdFromArgs = false;  /* True, if program arguments are used for CANopen Node Id */
@@ -305,7 +409,7 @@ int main (int argc, char *argv[]) {
         printUsage(argv[0]);
         exit(EXIT_SUCCESS);
     }
-    while((opt = getopt(argc, argv, "i:p:rc:T:s:a:")) != -1) {
+    while((opt = getopt(argc, argv, "i:p:rc:T:s:a:A:R:C:P:X:")) != -1) {
         switch (opt) {
             case 'i':
                 CO_pendingNodeId = (uint8_t)strtol(optarg, NULL, 0);
@@ -354,6 +458,24 @@ int main (int argc, char *argv[]) {
                 break;
             case 'a': odStorFile_eeprom = optarg;
                 break;
+#endif
+#if CO_OD_AUTOSAVE == 1
+            case 'A': odAutosaveFile = optarg;
+                break;
+#endif
+#if CO_FAST_RESUME == 1
+            case 'R': frFile = optarg;
+                break;
+#endif
+#if CO_DRIVER_CAPTURE > 0
+            case 'C': captureFile = optarg;
+                break;
+#endif
+#if CO_DRIVER_REPLAY > 0
+            case 'P': replayFile = optarg;
+                break;
+            case 'X': replaySpeed = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
 #endif
             default:
                 printUsage(argv[0]);
@@ -409,6 +531,34 @@ int main (int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
+#if CO_DRIVER_CAPTURE > 0
+    /* Attached once, stays valid across communication resets */
+    if (captureFile != NULL) {
+        err = CO_CANcapture_start(&canCapture, captureFile,
+                                  CAPTURE_FILE_SIZE, CAPTURE_FILE_COUNT);
+        if (err != CO_ERROR_NO) {
+            log_printf(LOG_CRIT, DBG_GENERAL, "CO_CANcapture_start(), err=",
+                       err);
+            exit(EXIT_FAILURE);
+        }
+        CO_CANcapture_attach(&canCapture, CO->CANmodule);
+    }
+#endif
+#if CO_DRIVER_REPLAY > 0
+    /* Attached once, stays valid across communication resets */
+    if (replayFile != NULL) {
+        snprintf(replayOutFile, sizeof(replayOutFile), "%s.out", replayFile);
+        err = CO_CANreplay_open(&replay, replayFile, replayOutFile,
+                                replaySpeed);
+        if (err != CO_ERROR_NO) {
+            log_printf(LOG_CRIT, DBG_GENERAL, "CO_CANreplay_open(), err=",
+                       err);
+            exit(EXIT_FAILURE);
+        }
+        CO_CANreplay_attach(&replay, CO->CANmodule);
+    }
+#endif
+
 
 #if CO_OD_STORAGE == 1
     /* Verify, if OD structures have proper alignment of initial values */
@@ -431,6 +581,36 @@ int main (int argc, char *argv[]) {
     odStorStatus_eeprom = CO_OD_storage_init(&odStorAuto, (uint8_t*) &CO_OD_EEPROM, sizeof(CO_OD_EEPROM), odStorFile_eeprom);
 #endif
 
+#if CO_OD_AUTOSAVE == 1
+    /* load OD_PERSIST_COMM, corrupt file is replaced with default values */
+    err = CO_OD_autosave_init(&odAutosave, &OD_PERSIST_COMM,
+                              sizeof(OD_PERSIST_COMM), odAutosaveFile, 64, 0);
+    if (err == CO_ERROR_DATA_CORRUPT || err == CO_ERROR_CRC) {
+        log_printf(LOG_ERR, DBG_OBJECT_DICTIONARY, odAutosaveFile);
+    }
+    else if (err != CO_ERROR_NO) {
+        log_printf(LOG_CRIT, DBG_GENERAL, "CO_OD_autosave_init(), err=", err);
+        exit(EXIT_FAILURE);
+    }
+#endif
+
+#if CO_FAST_RESUME == 1
+    /* Restore OD_RAM and NMT state from the previous run. Snapshot is
+     * consumed, invalid or old snapshot is ignored. */
+    err = CO_fastResume_load(frFile, OD, frRegions, 2, FAST_RESUME_MAX_AGE_S);
+    if (err == CO_ERROR_NO) {
+        fastResumed = true;
+        /* node-id, configured by LSS, unless set by program arguments */
+        if (!nodeIdFromArgs) {
+            CO_pendingNodeId = frState.nodeId;
+        }
+        log_printf(LOG_INFO, DBG_FAST_RESUME, frFile, "restored");
+    }
+    else if (err != CO_ERROR_SYSCALL) {
+        log_printf(LOG_NOTICE, DBG_FAST_RESUME, frFile, "ignored");
+    }
+#endif
+
     /* Catch signals SIGINT and SIGTERM */
     if(signal(SIGINT, sigHandler) == SIG_ERR) {
         log_printf(LOG_CRIT, DBG_ERRNO, "signal(SIGINT, sigHandler)");
@@ -475,9 +655,9 @@ int main (int argc, char *argv[]) {
 
         /* Wait rt_thread. */
         if(!firstRun) {
-            CO_LOCK_OD();
+            CO_LOCK_OD(CO->CANmodule);
             CO->CANmodule->CANnormal = false;
-            CO_UNLOCK_OD();
+            CO_UNLOCK_OD(CO->CANmodule);
         }
 
         /* Enter CAN configuration. */
@@ -567,15 +747,36 @@ int main (int argc, char *argv[]) {
             }
 #endif
 
-#if (CO_CONFIG_TRACE) & CO_CONFIG_TRACE_ENABLE
-            /* Initialize time */
-            CO_time_init(&CO_time, CO->SDO[0], &OD_time.epochTimeBaseMs, &OD_time.epochTimeOffsetMs, 0x2130);
+#if CO_FAST_RESUME == 1
+            /* Continue in the previous NMT state. First CO_NMT_process() sends
+             * boot-up message as usual, so NMT master and heartbeat consumers
+             * see the restart. Then it applies the internal command in the
+             * same call and reports the resulting state to the NMT callback
+             * and with the next heartbeat. NMT error transitions still apply.*/
+            if (fastResumed && frState.nodeId == CO_activeNodeId) {
+                uint8_t cmd = 0;
+
+                switch (frState.nmtState) {
+                case CO_NMT_PRE_OPERATIONAL:
+                    cmd = CO_NMT_ENTER_PRE_OPERATIONAL; break;
+                case CO_NMT_OPERATIONAL:
+                    cmd = CO_NMT_ENTER_OPERATIONAL; break;
+                case CO_NMT_STOPPED:
+                    cmd = CO_NMT_ENTER_STOPPED; break;
+                default: break;
+                }
+                CO->NMT->internalCommand = cmd;
+            }
 #endif
             log_printf(LOG_INFO, DBG_CAN_OPEN_INFO, CO_activeNodeId, "communication reset");
         }
         else {
             log_printf(LOG_INFO, DBG_CAN_OPEN_INFO, CO_activeNodeId, "node-id not initialized");
         }
+#if CO_FAST_RESUME == 1
+        /* snapshot is used only for the first communication reset */
+        fastResumed = false;
+#endif
 
         /* First time only initialization. */
         if(firstRun) {
@@ -635,7 +836,18 @@ int main (int argc, char *argv[]) {
 
         while(reset == CO_RESET_NOT && CO_endProgram == 0) {
 /* loop for normal program execution ******************************************/
+#if CO_DRIVER_REPLAY > 0
+            if (replayFile != NULL) {
+                if (!CO_CANreplay_wait(&replay, &epMain, CO->CANmodule)) {
+                    CO_endProgram = 1;
+                }
+            }
+            else {
+                CO_epoll_wait(&epMain);
+            }
+#else
             CO_epoll_wait(&epMain);
+#endif
 #ifdef CO_SINGLE_THREAD
             CO_epoll_processRT(&epMain, CO, false);
 #endif
@@ -652,6 +864,17 @@ int main (int argc, char *argv[]) {
 #if CO_OD_STORAGE == 1
             CO_OD_storage_autoSave(&odStorAuto,
                                    epMain.timeDifference_us, 60000000);
+#endif
+#if CO_OD_AUTOSAVE == 1
+            CO_OD_autosave_process(&odAutosave, CO->CANmodule,
+                                   epMain.timeDifference_us, 60000000);
+#endif
+#if CO_FAST_RESUME == 1
+            frTimer_us += epMain.timeDifference_us;
+            if (frTimer_us >= FAST_RESUME_INTERVAL_US) {
+                frTimer_us = 0;
+                fastResumeSave(CO);
+            }
 #endif
         }
     } /* while(reset != CO_RESET_APP */
@@ -676,6 +899,29 @@ int main (int argc, char *argv[]) {
     CO_OD_storage_autoSave(&odStorAuto, 0, 0);
     CO_OD_storage_autoSaveClose(&odStorAuto);
 #endif
+#if CO_OD_AUTOSAVE == 1
+    {
+        CO_OD_autosave_stats_t stats = {0};
+
+        CO_OD_autosave_flush(&odAutosave, CO->CANmodule);
+        CO_OD_autosave_getStats(&odAutosave, &stats);
+        log_printf(LOG_INFO, DBG_OD_AUTOSAVE_STATS, odAutosaveFile,
+                   stats.saveCount, stats.fullSaveCount,
+                   (unsigned long long)stats.totalBytes,
+                   stats.lastStall_us, stats.maxStall_us);
+        CO_OD_autosave_close(&odAutosave);
+    }
+#endif
+#if CO_FAST_RESUME == 1
+    /* Snapshot on clean shutdown only. After NMT reset or failure device
+     * must start normally. */
+    if (programExit == EXIT_SUCCESS && reset != CO_RESET_APP) {
+        fastResumeSave(CO);
+    }
+    else {
+        unlink(frFile);
+    }
+#endif
 
     /* delete objects from memory */
 #ifndef CO_SINGLE_THREAD
@@ -686,6 +932,18 @@ int main (int argc, char *argv[]) {
     CO_epoll_closeGtw(&epGtw);
 #endif
     CO_CANsetConfigurationMode((void *)&CANptr);
+#if CO_DRIVER_CAPTURE > 0
+    CO_CANcapture_attach(NULL, CO->CANmodule);
+    CO_CANcapture_stop(&canCapture);
+#endif
+#if CO_DRIVER_REPLAY > 0
+    if (replayFile != NULL) {
+        CO_CANreplay_attach(NULL, CO->CANmodule);
+        log_printf(LOG_INFO, DBG_CAN_REPLAY_STATS, replayFile,
+                   replay.rxCount, replay.txCount, replay.skipped);
+        CO_CANreplay_close(&replay);
+    }
+#endif
     CO_delete(CO);
 
     log_printf(LOG_INFO, DBG_CAN_OPEN_INFO, CO_activeNodeId, "finished");
@@ -715,14 +973,6 @@ static void* rt_thread(void* arg) {
         CO_epoll_processRT(&epRT, CO, true);
         CO_epoll_processLast(&epRT);
 
-#if (CO_CONFIG_TRACE) & CO_CONFIG_TRACE_ENABLE
-        /* Monitor variables with trace objects */
-        CO_time_process(&CO_time);
-        for(i=0; i<OD_traceEnable && i<co->CNT_TRACE; i++) {
-            CO_trace_process(CO->trace[i], *CO_time.epochTimeOffsetMs);
-        }
-#endif
-
 #ifdef CO_USE_APPLICATION
         /* Execute optional additional application code */
         app_program1ms(!CO->nodeIdUnconfigured, epRT.timeDifference_us);
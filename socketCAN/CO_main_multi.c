@@ -0,0 +1,838 @@
+/*
+ * CANopen main program file for multiple CANopen networks in one Linux process.
+ *
+ * @file        CO_main_multi.c
+ * @author      Janez Paternoster
+ * @copyright   2020 Janez Paternoster
+ *
+ * This file is part of CANopenNode, an opensource CANopen Stack.
+ * Project home page is <https://github.com/CANopenNode/CANopenNode>.
+ * For more information on CANopen see <http://www.can-cia.org/>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Each CANopen network, specified in configuration file, gets own copy of the
+ * Object Dictionary, own CANopen object, own epoll objects, own locks (inside
+ * CANmodule) and own mainline and realtime thread. Both threads of the network
+ * are pinned to the specified CPU. Networks do not share any mutable data,
+ * except the program end flag.
+ *
+ * Configuration file contains one line per network:
+ *   <CAN device> <Node ID> <CPU> <RT priority> [<command interface>]
+ *   [od=<OD image file>]
+ * CPU is -1 for no affinity, RT priority is -1 for normal scheduler. Command
+ * interface is specified as "stdio", "local-<file path>" or "tcp-<port>".
+ * Network with "od=" uses Object Dictionary from binary image instead of the
+ * compiled one, see CO_OD_image.h. Networks with the same image file share
+ * it. Empty lines and lines starting with '#' are ignored.
+ *
+ * "canopend_multi -W <OD image file>" writes the compiled Object Dictionary
+ * into image file and exits.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <sched.h>
+#include <signal.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <syslog.h>
+#include <time.h>
+#include <pthread.h>
+#include <net/if.h>
+
+#include "CANopen.h"
+#include "OD.h"
+#include "CO_error.h"
+#include "CO_epoll_interface.h"
+#include "CO_OD_clone.h"
+#include "CO_OD_image.h"
+
+#if (CO_CONFIG_GTW) & CO_CONFIG_GTW_ASCII
+#include "309/CO_gateway_ascii.h"
+#endif
+
+#ifndef CO_MULTIPLE_OD
+#error CO_main_multi.c requires CO_MULTIPLE_OD
+#endif
+#ifdef CO_SINGLE_THREAD
+#error CO_main_multi.c requires multi-thread operation
+#endif
+
+/* Interval of mainline and real-time thread in microseconds */
+#ifndef MAIN_THREAD_INTERVAL_US
+#define MAIN_THREAD_INTERVAL_US 100000
+#endif
+#ifndef TMR_THREAD_INTERVAL_US
+#define TMR_THREAD_INTERVAL_US 1000
+#endif
+
+/* Maximum number of CANopen networks */
+#ifndef CO_NETWORKS_MAX
+#define CO_NETWORKS_MAX 16
+#endif
+
+/* default values */
+#ifndef NMT_CONTROL
+#define NMT_CONTROL \
+            CO_NMT_STARTUP_TO_OPERATIONAL \
+         || CO_NMT_ERR_ON_ERR_REG \
+         || CO_ERR_REG_GENERIC_ERR \
+         || CO_ERR_REG_COMMUNICATION
+#endif
+#ifndef FIRST_HB_TIME
+#define FIRST_HB_TIME 500
+#endif
+#ifndef SDO_SRV_TIMEOUT_TIME
+#define SDO_SRV_TIMEOUT_TIME 1000
+#endif
+#ifndef SDO_CLI_TIMEOUT_TIME
+#define SDO_CLI_TIMEOUT_TIME 500
+#endif
+#ifndef SDO_CLI_BLOCK
+#define SDO_CLI_BLOCK false
+#endif
+#ifndef GATEWAY_ENABLE
+#define GATEWAY_ENABLE true
+#endif
+#ifndef OD_STATUS_BITS
+#define OD_STATUS_BITS NULL
+#endif
+
+/* Counts of CANopen objects, not all of them are defined in OD.h */
+#ifndef OD_CNT_NMT
+#define OD_CNT_NMT 0
+#endif
+#ifndef OD_CNT_HB_CONS
+#define OD_CNT_HB_CONS 0
+#endif
+#ifndef OD_CNT_EM
+#define OD_CNT_EM 0
+#endif
+#ifndef OD_CNT_SDO_SRV
+#define OD_CNT_SDO_SRV 0
+#endif
+#ifndef OD_CNT_SDO_CLI
+#define OD_CNT_SDO_CLI 0
+#endif
+#ifndef OD_CNT_TIME
+#define OD_CNT_TIME 0
+#endif
+#ifndef OD_CNT_SYNC
+#define OD_CNT_SYNC 0
+#endif
+#ifndef OD_CNT_RPDO
+#define OD_CNT_RPDO 0
+#endif
+#ifndef OD_CNT_TPDO
+#define OD_CNT_TPDO 0
+#endif
+#ifndef OD_CNT_LEDS
+#define OD_CNT_LEDS 0
+#endif
+#ifndef OD_CNT_GFC
+#define OD_CNT_GFC 0
+#endif
+#ifndef OD_CNT_SRDO
+#define OD_CNT_SRDO 0
+#endif
+#ifndef OD_CNT_LSS_SLV
+#define OD_CNT_LSS_SLV 1
+#endif
+#ifndef OD_CNT_LSS_MST
+#define OD_CNT_LSS_MST 1
+#endif
+#ifndef OD_CNT_GTWA
+#define OD_CNT_GTWA 1
+#endif
+#ifndef OD_CNT_TRACE
+#define OD_CNT_TRACE 0
+#endif
+
+/* Object for one CANopen network */
+typedef struct {
+    char *CANdevice;            /* CAN device name */
+    CO_CANptrSocketCan_t CANptr;/* CAN interface and epoll of RT thread */
+    uint8_t pendingNodeId;      /* Can be changed by LSS slave */
+    uint8_t activeNodeId;       /* Copied from pendingNodeId in comm. reset */
+    uint16_t pendingBitRate;    /* CAN bitrate, not used here */
+    int cpu;                    /* CPU for both threads, -1 for any */
+    int rtPriority;             /* SCHED_FIFO priority, -1 for normal */
+    int32_t commandInterface;   /* values from CO_commandInterface_t */
+    char *localSocketPath;      /* if CO_COMMAND_IF_LOCAL_SOCKET */
+    OD_t *od;                   /* Own copy of the Object Dictionary */
+    CO_OD_image_t *odImage;     /* Image, from which od is created, or NULL */
+    CO_config_t config;         /* Configuration for CO_new() */
+    CO_t *co;                   /* CANopen object */
+    CO_epoll_t epMain;          /* Epoll-timer object for mainline thread */
+    CO_epoll_t epRT;            /* Epoll-timer object for realtime thread */
+#if (CO_CONFIG_GTW) & CO_CONFIG_GTW_ASCII
+    CO_epoll_gtw_t epGtw;       /* Gateway object */
+#endif
+    bool_t epMainCreated;
+    bool_t epRTCreated;
+    bool_t epGtwCreated;
+    pthread_t mainThread;
+    pthread_t rtThread;
+    bool_t mainThreadStarted;
+    bool_t rtThreadStarted;
+    volatile bool_t endNetwork; /* set by mainline thread on exit */
+    int exitStatus;             /* EXIT_SUCCESS or EXIT_FAILURE */
+    /* statistics of the realtime thread, written only by that thread */
+    uint64_t rtCycles;
+    uint64_t rtSum_us;
+    uint32_t rtMax_us;
+    uint32_t rtIntervalMax_us;
+} CO_network_t;
+
+static CO_network_t networks[CO_NETWORKS_MAX];
+static int networksCount = 0;
+
+/* Object Dictionary images, shared between networks */
+typedef struct {
+    char *fileName;
+    CO_OD_image_t img;
+} CO_ODimageFile_t;
+static CO_ODimageFile_t odImages[CO_NETWORKS_MAX];
+static int odImagesCount = 0;
+
+/* Helper functions ***********************************************************/
+static void* main_thread(void* arg);
+static void* rt_thread(void* arg);
+
+/* Signal handler */
+volatile sig_atomic_t CO_endProgram = 0;
+static void sigHandler(int sig) {
+    (void)sig;
+    CO_endProgram = 1;
+}
+
+/* Message logging function, gateway log is not used, because it is not known,
+ * from which network the message comes */
+void log_printf(int priority, const char *format, ...) {
+    va_list ap;
+
+    va_start(ap, format);
+    vsyslog(priority, format, ap);
+    va_end(ap);
+}
+
+static uint64_t time_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Print usage */
+static void printUsage(char *progName) {
+printf(
+"Usage: %s <configuration file>\n"
+"       %s -W <OD image file>\n", progName, progName);
+printf(
+"\n"
+"Each line of the configuration file specifies one CANopen network:\n"
+"  <CAN device> <Node ID> <CPU> <RT priority> [<command interface>]\n"
+"  [od=<OD image file>]\n"
+"\n"
+"  <Node ID>           CANopen Node-id (1..127) or 0xFF (LSS unconfigured).\n"
+"  <CPU>               CPU for mainline and RT thread, -1 for any CPU.\n"
+"  <RT priority>       Real-time priority of RT thread (1 .. 99), -1 for\n"
+"                      normal scheduler.\n");
+#if (CO_CONFIG_GTW) & CO_CONFIG_GTW_ASCII
+printf(
+"  <command interface> Optional command interface for master functionality:\n"
+"                      \"stdio\", \"local-<file path>\" or \"tcp-<port>\".\n"
+"                      Only one network may use \"stdio\".\n");
+#endif
+printf(
+"  <OD image file>     Object Dictionary from binary image file instead of the\n"
+"                      compiled one. Image is written with option -W.\n"
+"\n"
+"Lines starting with '#' are ignored.\n"
+"\n"
+"See also: https://github.com/CANopenNode/CANopenNode\n"
+"\n");
+}
+
+/* Get opened Object Dictionary image, open it on first use */
+static CO_OD_image_t *odImageGet(const char *fileName) {
+    CO_ODimageFile_t *imgFile;
+    CO_ReturnError_t err;
+    int i;
+
+    for (i = 0; i < odImagesCount; i++) {
+        if (strcmp(odImages[i].fileName, fileName) == 0) {
+            return &odImages[i].img;
+        }
+    }
+    if (odImagesCount >= CO_NETWORKS_MAX) {
+        return NULL;
+    }
+
+    imgFile = &odImages[odImagesCount];
+    err = CO_OD_image_open(&imgFile->img, fileName);
+    if (err != CO_ERROR_NO) {
+        log_printf(LOG_CRIT, DBG_GENERAL, "CO_OD_image_open(), err=", err);
+        return NULL;
+    }
+    imgFile->fileName = strdup(fileName);
+    odImagesCount++;
+    return &imgFile->img;
+}
+
+/* Parse configuration file, return number of networks or -1 on error */
+static int parseConfig(const char *fileName) {
+    char line[256];
+    int count = 0;
+    FILE *f = fopen(fileName, "r");
+
+    if (f == NULL) {
+        log_printf(LOG_CRIT, DBG_ERRNO, "fopen()");
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char dev[IFNAMSIZ + 1], opts[2][200];
+        int nodeId, cpu, prio, nMatch, j;
+        CO_network_t *net;
+
+        if (line[strspn(line, " \t\r\n")] == '\0'
+            || line[strspn(line, " \t")] == '#'
+        ) {
+            continue;
+        }
+
+        opts[0][0] = '\0';
+        opts[1][0] = '\0';
+        nMatch = sscanf(line, "%16s %i %i %i %199s %199s",
+                        dev, &nodeId, &cpu, &prio, opts[0], opts[1]);
+        if (nMatch < 4) {
+            log_printf(LOG_CRIT, DBG_ARGUMENT_UNKNOWN, "config line", line);
+            fclose(f);
+            return -1;
+        }
+        if (count >= CO_NETWORKS_MAX) {
+            log_printf(LOG_CRIT, DBG_GENERAL, "too many networks, max=",
+                       CO_NETWORKS_MAX);
+            fclose(f);
+            return -1;
+        }
+
+        /* validate values before they are narrowed into network object */
+        if ((nodeId < 1 || nodeId > 127)
+            && nodeId != CO_LSS_NODE_ID_ASSIGNMENT
+        ) {
+            log_printf(LOG_CRIT, DBG_WRONG_NODE_ID, nodeId);
+            fclose(f);
+            return -1;
+        }
+        if (cpu < -1 || cpu >= CPU_SETSIZE) {
+            log_printf(LOG_CRIT, DBG_GENERAL, "wrong CPU ", cpu);
+            fclose(f);
+            return -1;
+        }
+
+        net = &networks[count];
+        net->CANdevice = strdup(dev);
+        net->CANptr.can_ifindex = if_nametoindex(dev);
+        net->pendingNodeId = (uint8_t)nodeId;
+        net->activeNodeId = net->pendingNodeId;
+        net->cpu = cpu;
+        net->rtPriority = prio;
+#if (CO_CONFIG_GTW) & CO_CONFIG_GTW_ASCII
+        net->commandInterface = CO_COMMAND_IF_DISABLED;
+#endif
+        net->localSocketPath = NULL;
+
+        if (net->CANptr.can_ifindex == 0) {
+            log_printf(LOG_CRIT, DBG_NO_CAN_DEVICE, dev);
+            fclose(f);
+            return -1;
+        }
+        if (prio != -1 && (prio < sched_get_priority_min(SCHED_FIFO)
+                           || prio > sched_get_priority_max(SCHED_FIFO))
+        ) {
+            log_printf(LOG_CRIT, DBG_WRONG_PRIORITY, prio);
+            fclose(f);
+            return -1;
+        }
+
+        for (j = 0; j < 2; j++) {
+            char *cmd = opts[j];
+#if (CO_CONFIG_GTW) & CO_CONFIG_GTW_ASCII
+            uint16_t port;
+#endif
+
+            if (cmd[0] == '\0') {
+                continue;
+            }
+            if (strncmp(cmd, "od=", 3) == 0) {
+                net->odImage = odImageGet(&cmd[3]);
+                if (net->odImage == NULL) {
+                    log_printf(LOG_CRIT, DBG_ARGUMENT_UNKNOWN, "od", &cmd[3]);
+                    fclose(f);
+                    return -1;
+                }
+            }
+#if (CO_CONFIG_GTW) & CO_CONFIG_GTW_ASCII
+            else if (strcmp(cmd, "stdio") == 0) {
+                net->commandInterface = CO_COMMAND_IF_STDIO;
+            }
+            else if (strncmp(cmd, "local-", 6) == 0) {
+                net->commandInterface = CO_COMMAND_IF_LOCAL_SOCKET;
+                net->localSocketPath = strdup(&cmd[6]);
+            }
+            else if (strncmp(cmd, "tcp-", 4) == 0
+                     && sscanf(&cmd[4], "%hu", &port) == 1
+            ) {
+                net->commandInterface = port;
+            }
+#endif
+            else {
+                log_printf(LOG_CRIT, DBG_ARGUMENT_UNKNOWN, "interface", cmd);
+                fclose(f);
+                return -1;
+            }
+        }
+        count++;
+    }
+
+    fclose(f);
+    return count;
+}
+
+/* Prepare own Object Dictionary and CANopen configuration for the network */
+static CO_ReturnError_t networkNew(CO_network_t *net) {
+    CO_config_t *c = &net->config;
+    OD_t *od;
+    uint32_t heapMemoryUsed = 0;
+
+    if (net->odImage != NULL) {
+        net->od = od = CO_OD_image_instance(net->odImage);
+    }
+    else {
+        net->od = od = CO_OD_clone(OD);
+    }
+    if (od == NULL) {
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+
+    c->CNT_NMT = OD_CNT_NMT;
+    c->ENTRY_H1017 = OD_find(od, 0x1017);
+    c->CNT_HB_CONS = OD_CNT_HB_CONS;
+    c->ENTRY_H1016 = OD_find(od, 0x1016);
+    c->CNT_EM = OD_CNT_EM;
+    c->ENTRY_H1001 = OD_find(od, 0x1001);
+    c->ENTRY_H1014 = OD_find(od, 0x1014);
+    c->ENTRY_H1015 = OD_find(od, 0x1015);
+    c->ENTRY_H1003 = OD_find(od, 0x1003);
+    c->CNT_SDO_SRV = OD_CNT_SDO_SRV;
+    c->ENTRY_H1200 = OD_find(od, 0x1200);
+    c->CNT_SDO_CLI = OD_CNT_SDO_CLI;
+    c->ENTRY_H1280 = OD_find(od, 0x1280);
+    c->CNT_TIME = OD_CNT_TIME;
+    c->ENTRY_H1012 = OD_find(od, 0x1012);
+    c->CNT_SYNC = OD_CNT_SYNC;
+    c->ENTRY_H1005 = OD_find(od, 0x1005);
+    c->ENTRY_H1006 = OD_find(od, 0x1006);
+    c->ENTRY_H1007 = OD_find(od, 0x1007);
+    c->ENTRY_H1019 = OD_find(od, 0x1019);
+    c->CNT_RPDO = OD_CNT_RPDO;
+    c->ENTRY_H1400 = OD_find(od, 0x1400);
+    c->ENTRY_H1600 = OD_find(od, 0x1600);
+    c->CNT_TPDO = OD_CNT_TPDO;
+    c->ENTRY_H1800 = OD_find(od, 0x1800);
+    c->ENTRY_H1A00 = OD_find(od, 0x1A00);
+    c->CNT_LEDS = OD_CNT_LEDS;
+    c->CNT_GFC = OD_CNT_GFC;
+    c->ENTRY_H1300 = OD_find(od, 0x1300);
+    c->CNT_SRDO = OD_CNT_SRDO;
+    c->ENTRY_H1301 = OD_find(od, 0x1301);
+    c->ENTRY_H1381 = OD_find(od, 0x1381);
+    c->ENTRY_H13FE = OD_find(od, 0x13FE);
+    c->ENTRY_H13FF = OD_find(od, 0x13FF);
+    c->CNT_LSS_SLV = OD_CNT_LSS_SLV;
+    c->CNT_LSS_MST = OD_CNT_LSS_MST;
+    c->CNT_GTWA = OD_CNT_GTWA;
+    c->CNT_TRACE = OD_CNT_TRACE;
+
+    net->co = CO_new(c, &heapMemoryUsed);
+    if (net->co == NULL) {
+        log_printf(LOG_CRIT, DBG_GENERAL,
+                   "CO_new(), heapMemoryUsed=", heapMemoryUsed);
+        return CO_ERROR_OUT_OF_MEMORY;
+    }
+
+    if (CO_epoll_create(&net->epMain, MAIN_THREAD_INTERVAL_US) != CO_ERROR_NO)
+        return CO_ERROR_SYSCALL;
+    net->epMainCreated = true;
+    if (CO_epoll_create(&net->epRT, TMR_THREAD_INTERVAL_US) != CO_ERROR_NO)
+        return CO_ERROR_SYSCALL;
+    net->epRTCreated = true;
+    net->CANptr.epoll_fd = net->epRT.epoll_fd;
+#if (CO_CONFIG_GTW) & CO_CONFIG_GTW_ASCII
+    if (CO_epoll_createGtw(&net->epGtw, net->epMain.epoll_fd,
+                           net->commandInterface, 0,
+                           net->localSocketPath) != CO_ERROR_NO
+    ) {
+        return CO_ERROR_SYSCALL;
+    }
+    net->epGtwCreated = true;
+#endif
+    return CO_ERROR_NO;
+}
+
+/* Create thread, pinned to the network CPU and optionally with RT priority */
+static int networkThreadCreate(CO_network_t *net, pthread_t *thread,
+                               void *(*fn)(void *), int rtPriority)
+{
+    pthread_attr_t attr;
+    int ret;
+
+    ret = pthread_attr_init(&attr);
+    if (ret != 0) {
+        errno = ret;
+        return ret;
+    }
+    if (net->cpu >= 0) {
+        cpu_set_t cpuset;
+
+        CPU_ZERO(&cpuset);
+        CPU_SET(net->cpu, &cpuset);
+        ret = pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+        if (ret != 0) {
+            log_printf(LOG_CRIT, DBG_GENERAL, "can't pin thread to CPU ",
+                       net->cpu);
+        }
+    }
+    if (ret == 0 && rtPriority > 0) {
+        struct sched_param param = {.sched_priority = rtPriority};
+
+        ret = pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        if (ret == 0) {
+            ret = pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        }
+        if (ret == 0) {
+            ret = pthread_attr_setschedparam(&attr, &param);
+        }
+    }
+    if (ret == 0) {
+        ret = pthread_create(thread, &attr, fn, net);
+    }
+    pthread_attr_destroy(&attr);
+
+    /* pthread functions don't set errno, callers log it */
+    if (ret != 0) {
+        errno = ret;
+    }
+    return ret;
+}
+
+static void networkDelete(CO_network_t *net) {
+    if (net->epRTCreated) CO_epoll_close(&net->epRT);
+    if (net->epMainCreated) CO_epoll_close(&net->epMain);
+#if (CO_CONFIG_GTW) & CO_CONFIG_GTW_ASCII
+    if (net->epGtwCreated) CO_epoll_closeGtw(&net->epGtw);
+#endif
+    if (net->co != NULL) {
+        CO_CANsetConfigurationMode((void *)&net->CANptr);
+        CO_delete(net->co);
+    }
+    if (net->odImage != NULL) {
+        CO_OD_image_instanceFree(net->od);
+    }
+    else {
+        free(net->od);
+    }
+    free(net->localSocketPath);
+    free(net->CANdevice);
+}
+
+
+/*******************************************************************************
+ * Program start
+ ******************************************************************************/
+int main (int argc, char *argv[]) {
+    int programExit = EXIT_SUCCESS;
+    int i;
+
+    /* configure system log */
+    setlogmask(LOG_UPTO (LOG_DEBUG)); /* LOG_DEBUG - log all messages */
+    openlog(argv[0], LOG_PID | LOG_PERROR, LOG_USER); /* print also to standard error */
+
+    if (argc == 3 && strcmp(argv[1], "-W") == 0) {
+        CO_ReturnError_t err = CO_OD_image_write(OD, argv[2]);
+
+        if (err != CO_ERROR_NO) {
+            log_printf(LOG_CRIT, DBG_GENERAL, "CO_OD_image_write(), err=", err);
+            exit(EXIT_FAILURE);
+        }
+        exit(EXIT_SUCCESS);
+    }
+    if(argc != 2 || strcmp(argv[1], "--help") == 0){
+        printUsage(argv[0]);
+        exit(argc != 2 ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
+    networksCount = parseConfig(argv[1]);
+    if (networksCount <= 0) {
+        printUsage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    /* Catch signals SIGINT and SIGTERM */
+    if(signal(SIGINT, sigHandler) == SIG_ERR) {
+        log_printf(LOG_CRIT, DBG_ERRNO, "signal(SIGINT, sigHandler)");
+        exit(EXIT_FAILURE);
+    }
+    if(signal(SIGTERM, sigHandler) == SIG_ERR) {
+        log_printf(LOG_CRIT, DBG_ERRNO, "signal(SIGTERM, sigHandler)");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Prepare all networks, then start their mainline threads */
+    for (i = 0; i < networksCount; i++) {
+        CO_network_t *net = &networks[i];
+        CO_ReturnError_t err = networkNew(net);
+
+        if (err != CO_ERROR_NO) {
+            log_printf(LOG_CRIT, DBG_CAN_OPEN, net->CANdevice, err);
+            CO_endProgram = 1;
+            programExit = EXIT_FAILURE;
+            break;
+        }
+        log_printf(LOG_INFO, DBG_CAN_OPEN_INFO, net->pendingNodeId,
+                   net->CANdevice);
+    }
+    for (i = 0; i < networksCount && CO_endProgram == 0; i++) {
+        CO_network_t *net = &networks[i];
+
+        if (networkThreadCreate(net, &net->mainThread, main_thread, -1) != 0) {
+            log_printf(LOG_CRIT, DBG_ERRNO, "pthread_create(main_thread)");
+            CO_endProgram = 1;
+            programExit = EXIT_FAILURE;
+            break;
+        }
+        net->mainThreadStarted = true;
+    }
+
+    /* Wait for the end of all networks */
+    for (i = 0; i < networksCount; i++) {
+        CO_network_t *net = &networks[i];
+
+        if (net->mainThreadStarted) {
+            pthread_join(net->mainThread, NULL);
+            if (net->exitStatus != EXIT_SUCCESS) {
+                programExit = EXIT_FAILURE;
+            }
+        }
+    }
+
+    /* Print statistics of realtime threads and delete objects */
+    for (i = 0; i < networksCount; i++) {
+        CO_network_t *net = &networks[i];
+
+        if (net->rtCycles > 0) {
+            log_printf(LOG_INFO,
+                "%s (cpu %d): RT cycles=%llu, process avg=%lluus, "
+                "max=%uus, max interval=%uus",
+                net->CANdevice, net->cpu,
+                (unsigned long long)net->rtCycles,
+                (unsigned long long)(net->rtSum_us / net->rtCycles),
+                net->rtMax_us, net->rtIntervalMax_us);
+        }
+        networkDelete(net);
+    }
+    for (i = 0; i < odImagesCount; i++) {
+        CO_OD_image_close(&odImages[i].img);
+        free(odImages[i].fileName);
+    }
+
+    exit(programExit);
+}
+
+
+/*******************************************************************************
+ * Mainline thread of one network
+ ******************************************************************************/
+static void* main_thread(void* arg) {
+    CO_network_t *net = arg;
+    CO_t *co = net->co;
+    CO_NMT_reset_cmd_t reset = CO_RESET_NOT;
+    CO_ReturnError_t err;
+    bool_t firstRun = true;
+
+    net->exitStatus = EXIT_SUCCESS;
+
+    while(reset != CO_RESET_APP && reset != CO_RESET_QUIT
+          && CO_endProgram == 0
+    ) {
+/* CANopen communication reset - initialize CANopen objects *******************/
+
+        /* Wait rt_thread. */
+        if(!firstRun) {
+            CO_LOCK_OD(co->CANmodule);
+            co->CANmodule->CANnormal = false;
+            CO_UNLOCK_OD(co->CANmodule);
+        }
+
+        /* Enter CAN configuration. */
+        CO_CANsetConfigurationMode((void *)&net->CANptr);
+        CO_CANmodule_disable(co->CANmodule);
+
+        /* initialize CANopen */
+        err = CO_CANinit(co, (void *)&net->CANptr, 0 /* bit rate not used */);
+        if(err != CO_ERROR_NO) {
+            log_printf(LOG_CRIT, DBG_CAN_OPEN, "CO_CANinit()", err);
+            net->exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        /* LSS address from own copy of the Object Dictionary, RT thread may
+         * already run */
+        const OD_entry_t *entry1018 = OD_find(net->od, 0x1018);
+        CO_LSS_address_t lssAddress;
+        uint32_t *identity[4] = {&lssAddress.identity.vendorID,
+                                 &lssAddress.identity.productCode,
+                                 &lssAddress.identity.revisionNumber,
+                                 &lssAddress.identity.serialNumber};
+        memset(&lssAddress, 0, sizeof(lssAddress));
+        for (uint8_t i = 0; i < 4; i++) {
+            OD_get_valueLocked(co->CANmodule, entry1018, i + 1, identity[i],
+                               sizeof(uint32_t), true);
+        }
+        err = CO_LSSinit(co, &lssAddress,
+                         &net->pendingNodeId, &net->pendingBitRate);
+        if(err != CO_ERROR_NO) {
+            log_printf(LOG_CRIT, DBG_CAN_OPEN, "CO_LSSinit()", err);
+            net->exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        net->activeNodeId = net->pendingNodeId;
+
+        err = CO_CANopenInit(co,                /* CANopen object */
+                             NULL,              /* alternate NMT */
+                             NULL,              /* alternate em */
+                             net->od,           /* Object dictionary */
+                             OD_STATUS_BITS,    /* Optional OD_statusBits */
+                             NMT_CONTROL,       /* CO_NMT_control_t */
+                             FIRST_HB_TIME,     /* firstHBTime_ms */
+                             SDO_SRV_TIMEOUT_TIME, /* SDOserverTimeoutTime_ms */
+                             SDO_CLI_TIMEOUT_TIME, /* SDOclientTimeoutTime_ms */
+                             SDO_CLI_BLOCK,     /* SDOclientBlockTransfer */
+                             net->activeNodeId);
+        if(err != CO_ERROR_NO && err != CO_ERROR_NODE_ID_UNCONFIGURED_LSS) {
+            if (err == CO_ERROR_OD_PARAMETERS) {
+                log_printf(LOG_CRIT, DBG_OD_ENTRY,
+                           (uint16_t)co->CANmodule->errinfo);
+            }
+            else {
+                log_printf(LOG_CRIT, DBG_CAN_OPEN, "CO_CANopenInit()", err);
+            }
+            net->exitStatus = EXIT_FAILURE;
+            break;
+        }
+
+        /* initialize part of threadMain and callbacks */
+        CO_epoll_initCANopenMain(&net->epMain, co);
+#if (CO_CONFIG_GTW) & CO_CONFIG_GTW_ASCII
+        CO_epoll_initCANopenGtw(&net->epGtw, co);
+#endif
+        log_printf(LOG_INFO, DBG_CAN_OPEN_INFO, net->activeNodeId,
+                   co->nodeIdUnconfigured ? "node-id not initialized"
+                                          : "communication reset");
+
+        /* First time only initialization. */
+        if(firstRun) {
+            firstRun = false;
+            if (networkThreadCreate(net, &net->rtThread, rt_thread,
+                                    net->rtPriority) != 0
+            ) {
+                log_printf(LOG_CRIT, DBG_ERRNO, "pthread_create(rt_thread)");
+                net->exitStatus = EXIT_FAILURE;
+                break;
+            }
+            net->rtThreadStarted = true;
+        }
+
+        /* start CAN */
+        CO_CANsetNormalMode(co->CANmodule);
+
+        reset = CO_RESET_NOT;
+
+        log_printf(LOG_INFO, DBG_CAN_OPEN_INFO, net->activeNodeId,
+                   "running ...");
+
+        while(reset == CO_RESET_NOT && CO_endProgram == 0) {
+/* loop for normal program execution ******************************************/
+            CO_epoll_wait(&net->epMain);
+#if (CO_CONFIG_GTW) & CO_CONFIG_GTW_ASCII
+            CO_epoll_processGtw(&net->epGtw, co, &net->epMain);
+#endif
+            CO_epoll_processMain(&net->epMain, co, GATEWAY_ENABLE, &reset);
+            CO_epoll_processLast(&net->epMain);
+        }
+    } /* while(reset != CO_RESET_APP */
+
+    /* Stop realtime thread of this network only */
+    net->endNetwork = true;
+    if (net->rtThreadStarted && pthread_join(net->rtThread, NULL) != 0) {
+        log_printf(LOG_CRIT, DBG_ERRNO, "pthread_join()");
+        net->exitStatus = EXIT_FAILURE;
+    }
+
+    log_printf(LOG_INFO, DBG_CAN_OPEN_INFO, net->activeNodeId, "finished");
+
+    return NULL;
+}
+
+
+/*******************************************************************************
+ * Realtime thread of one network for CAN receive and threadTmr
+ ******************************************************************************/
+static void* rt_thread(void* arg) {
+    CO_network_t *net = arg;
+
+    while(CO_endProgram == 0 && !net->endNetwork) {
+        uint64_t t0;
+        uint32_t dt;
+
+        CO_epoll_wait(&net->epRT);
+        t0 = time_us();
+        CO_epoll_processRT(&net->epRT, net->co, true);
+        CO_epoll_processLast(&net->epRT);
+        dt = (uint32_t)(time_us() - t0);
+
+        /* statistics for measurement of scaling over networks */
+        net->rtCycles++;
+        net->rtSum_us += dt;
+        if (dt > net->rtMax_us) {
+            net->rtMax_us = dt;
+        }
+        if (net->epRT.timerEvent
+            && net->epRT.timeDifference_us > net->rtIntervalMax_us
+        ) {
+            net->rtIntervalMax_us = net->epRT.timeDifference_us;
+        }
+    }
+
+    return NULL;
+}